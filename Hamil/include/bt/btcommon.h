@@ -7,4 +7,31 @@
 #pragma warning(push, 0)      // Silence some harmless warnings
 #include <btBulletCollisionCommon.h>
 #include <btBulletDynamicsCommon.h>
-#pragma warning(pop)
\ No newline at end of file
+#pragma warning(pop)
+
+namespace bt {
+
+class DynamicsWorldData;
+
+// btDefaultMotionState which, once its body has been added to a
+//   DynamicsWorld, records the body in it whenever Bullet moves it
+//   - Bullet only synchronizes the motion states of active (i.e.
+//     non-sleeping) bodies, so sleeping ones are never recorded
+//   - A body is recorded at most once per DynamicsWorld::step()
+class MotionState : public btDefaultMotionState {
+public:
+  MotionState(const btTransform& start_transform);
+
+  virtual void setWorldTransform(const btTransform& transform) override;
+
+private:
+  friend class DynamicsWorld;
+  friend class DynamicsWorldData;
+
+  btRigidBody *m_body = nullptr;
+  DynamicsWorldData *m_world = nullptr;
+
+  bool m_moved = false;
+};
+
+}
@@ -68,7 +68,7 @@ public:
   bool operator==(const RigidBody& other) const;
   bool operator!=(const RigidBody& other) const;
 
-  // Allocates a new btRigidBody with a btDefaultMotionState when mass > 0.0f
+  // Allocates a new btRigidBody with a bt::MotionState when mass > 0.0f
   //   i.e. when the body isn't static
   static RigidBody create(CollisionShape shape, vec3 origin, float mass = 0.0f, bool active = true);
 
@@ -7,6 +7,7 @@
 #include <math/geometry.h>
 
 #include <functional>
+#include <vector>
 
 namespace os {
 // Forward declaration
@@ -37,6 +38,17 @@ public:
 
   using RigidBodyIter = std::function<void(const RigidBody&)>;
 
+  // A body which was moved by the last step()
+  struct MovedBody {
+    RigidBody rb;
+    void *user;    // Same as rb.user()
+
+    // Both of these are the (interpolated) ones
+    //   the body's MotionState was last set to
+    mat4 transform;
+    AABB aabb;
+  };
+
   DynamicsWorld();
   ~DynamicsWorld();
 
@@ -55,12 +67,31 @@ public:
 
   void step(float dt);
 
+  // Returns all the bodies which were moved by the last step(),
+  //   gathered at its end in a single pass
+  //  - Only bodies with a bt::MotionState (i.e. non-static ones
+  //    created via RigidBody::create() or ones which had
+  //    createMotionState() called on them) are tracked
+  //  - Sleeping bodies are never included and don't
+  //    cost anything during the gathering
+  //  - The returned vector is overwritten by step() so
+  //    it must NOT be accessed concurrently with it
+  const std::vector<MovedBody>& movedBodies() const;
+
 private:
   using BtCollisionObjectIter = std::function<void(btCollisionObject *)>;
   using BtRigidBodyIter       = std::function<void(btRigidBody *)>;
 
   os::ReaderWriterLock& lock();
 
+  // Both must be called with the lock() held exclusively
+  void attachRigidBody(btRigidBody *rb);
+  void detachRigidBody(btRigidBody *rb);
+
+  // Fills m_data->moved with the bodies recorded
+  //   by their MotionStates during the step()
+  void gatherMovedBodies();
+
   // Iterates BACKWARDS
   void foreachObject(BtCollisionObjectIter fn);
 
@@ -15,7 +15,27 @@ struct GenError {
   { }
 };
 
-void resourcegen(std::vector<std::string> resources, std::set<std::string> types);
+enum ResourceGenFlags : uint {
+  GenDefault = 0,
+
+  // Convert *.obj meshes into the binary *.hmesh format (see
+  //   mesh/binmesh.h) and point their *.meta files at it
+  GenBakeMeshes = 1<<0,
+  // Store the normals and texture coordinates
+  //   of baked meshes as f16
+  GenHalfFloatMeshes = 1<<1,
+  // Reorder the triangles and vertices of baked meshes for
+  //   the GPU's vertex cache and to reduce overdraw
+  GenOptimizeMeshes = 1<<2,
+};
+
+void resourcegen(std::vector<std::string> resources, std::set<std::string> types,
+  uint /* ResourceGenFlags */ flags = GenDefault);
+
+// Packs all the *.meta files found in the current working directory
+//   (recursively) along with the files their 'location's refer to
+//   into a resource pack archive at 'out_path' (see res/pack.h)
+void resourcepack(const std::string& out_path);
 
 void ltc_lut_gen();
 
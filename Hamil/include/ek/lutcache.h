@@ -0,0 +1,95 @@
+#pragma once
+
+#include <ek/euklid.h>
+
+#include <res/io.h>
+#include <os/mutex.h>
+
+#include <string>
+#include <unordered_map>
+
+namespace ek {
+
+// Persistent cache of the data of generated RenderLUTs
+//   - Records are keyed by a hash of the RenderLUT's type,
+//     param and the version of it's generator, so changing
+//     a generator (and bumping RenderLUT::GeneratorVersion)
+//     invalidates all of it's records
+//   - The cache file is mapped by load() (via the
+//     ResourceManager, same as the LookupTable resources)
+//     and probe() returns views of the mapping, so hits
+//     never copy the data
+//   - probe(), insert() and dirty() can be called from
+//     multiple threads simultaneously
+class RenderLUTCache {
+public:
+  using Key = u64;
+
+  RenderLUTCache();
+
+  static Key key(u32 type, int param, u32 generator_version);
+
+  // Maps the cache file stored at 'path'
+  //   - A missing, out-of-date or corrupt cache file is
+  //     silently treated as empty
+  void load(const std::string& path);
+  // Same as above, except the contents of the cache
+  //   file are passed in directly
+  //  - The records reference (and share ownership of) 'file'
+  void load(const res::IOBuffer& file);
+  // Writes out all records which were probe()'d or insert()'ed
+  //   since load() (which prunes records of LUTs no longer used)
+  //  - The mapping of the cache file is released beforehand,
+  //    the probe()'d records are copied to memory
+  void save(const std::string& path);
+
+  // Returns 'true' when save() would write out a
+  //   different set of records than was load()'ed
+  bool dirty() const;
+
+  // Returns the cached data and marks the record as used
+  //   - Returns an empty IOBuffer when no record exists for 'k'
+  //     or when it's size isn't 'sz' (when sz != 0)
+  res::IOBuffer probe(Key k, size_t sz = 0);
+
+  void insert(Key k, const void *data, size_t sz);
+
+private:
+  enum : u32 {
+    Magic   = 0x54554C48,   // 'HLUT'
+    Version = 1,
+  };
+
+  struct Header {
+    u32 magic;
+    u32 version;
+
+    u64 num_records;
+  };
+
+  // Followed by 'size' bytes of LUT data padded
+  //   to a multiple of DataAlign bytes
+  struct RecordHeader {
+    Key key;
+    u64 size;
+  };
+
+  enum : size_t {
+    // Keeps the data suitably aligned for any texel format
+    DataAlign = 16,
+  };
+
+  struct Record {
+    res::IOBuffer data;
+
+    bool used = false;
+  };
+
+  mutable os::Mutex::Ptr m_mutex;
+
+  std::unordered_map<Key, Record> m_records;
+  size_t m_num_loaded = 0;
+  bool m_inserted = false;
+};
+
+}
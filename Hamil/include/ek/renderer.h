@@ -6,6 +6,7 @@
 #include <ek/mempool.h>
 #include <ek/renderobject.h>
 #include <ek/renderview.h>
+#include <ek/lutcache.h>
 
 #include <sched/job.h>
 #include <os/rwlock.h>
@@ -16,14 +17,17 @@
 #include <map>
 #include <set>
 #include <memory>
+#include <functional>
 
 namespace gx {
 class ResourcePool;
+class MeshPool;
 }
 
 namespace hm {
 struct Transform;
 struct Light;
+class TransformSystem;
 }
 
 namespace ek {
@@ -55,6 +59,13 @@ struct RenderLUT {
     NumTypes
   };
 
+  enum : u32 {
+    // Bump this when the output of any of the generate*()
+    //   methods changes, so the stale data stored in
+    //   RenderLUTCaches isn't used
+    GeneratorVersion = 1,
+  };
+
   RenderLUT();
 
   Type type;
@@ -66,12 +77,24 @@ struct RenderLUT {
   //   calling this method will populate 'tex_id'
   //   with a gx::ResourcePool::Id of a texture
   //   which contains the requested LUT
-  void generate(gx::ResourcePool& pool);
+  //  - When 'cache' != nullptr the LUT's data is taken
+  //    from it if possible, otherwise it's generated
+  //    and inserted into the cache
+  void generate(gx::ResourcePool& pool, RenderLUTCache *cache = nullptr);
 
 private:
-  void generateGaussian(gx::ResourcePool& pool);
-  void generateLTC(gx::ResourcePool& pool);
-  void generateHBAONoise(gx::ResourcePool& pool);
+  using GenerateDataFn = std::function<void(void * /* data */)>;
+
+  // Returns the LUT's data from 'cache' or (on a miss or when
+  //   cache == nullptr) a new buffer of 'sz' bytes filled in
+  //   by 'gen' which is then inserted into the cache
+  res::IOBuffer cachedData(RenderLUTCache *cache, size_t sz, const GenerateDataFn& gen) const;
+
+  void generateGaussian(gx::ResourcePool& pool, RenderLUTCache *cache);
+  // Uses the baked LookupTable when it's available and
+  //   fits the table (on a temporary WorkerPool) otherwise
+  void generateLTC(gx::ResourcePool& pool, RenderLUTCache *cache);
+  void generateHBAONoise(gx::ResourcePool& pool, RenderLUTCache *cache);
 };
 
 enum SamplerClass {
@@ -103,6 +126,10 @@ public:
     InitialMemoryPools     = 32,
   };
 
+  // Name of the RenderLUTCache file stored in
+  //   the working directory
+  static constexpr const char *LUTCacheFile = "lut.cache";
+
   Renderer();
   ~Renderer();
 
@@ -110,6 +137,10 @@ public:
   //   - Put all VertexArrays, Textures, etc. used for rendering
   //     here
   gx::ResourcePool& pool();
+  // MeshPool (backed by pool()) which res::Meshes should
+  //   be uploaded into, so they can share VertexArrays
+  //   and be batched together
+  gx::MeshPool& meshPool();
 
   // Pre-compile all GPU programs
   //   - Should be called before doing any rendering to
@@ -120,6 +151,15 @@ public:
   //   and populates it with RenderLights
   ExtractObjectsJob extractForView(hm::Entity scene, RenderView& view);
 
+  // When set, extractForView() uses the world matrices and AABBs
+  //   precomputed by 'transforms' for all the Entities it contains
+  //   instead of concatenating the hm::Transforms of their parents
+  //  - TransformSystem::update() must be called before any views
+  //    are extracted and the system can't be modified until all
+  //    the ExtractObjectsJobs are done
+  //  - Pass nullptr to go back to using hm::Transforms only
+  Renderer& transformSystem(const hm::TransformSystem *transforms);
+
   // Returns a RenderTarget compatible with 'config', recycling one
   //   used previously if possible
   //  - Remeber to call releaseRenderTarget()!
@@ -136,6 +176,27 @@ public:
   //     only ever exists one instance of a given program,
   //     hence there is no need to release them
   u32 queryProgram(const RenderView& view, const RenderObject& ro);
+  // Returns 'true' when the queryProgram() returned 'program' can
+  //   draw multiple RenderObjects with one instanced draw call
+  //  - Instancing is enabled explicitly in cachePrograms(), which
+  //    #defines INSTANCING and OBJECT_CONSTANTS_INDEX (as
+  //    uObjectConstantsOffset+gl_InstanceID) in such programs'
+  //    vertex shaders. All other programs are drawn one
+  //    RenderObject at a time
+  bool programSupportsInstancing(u32 program);
+  // Returns 'true' when 'program' can draw multiple RenderObjects
+  //   which DON'T share their meshes with one multiDrawIndirect(),
+  //   in which case each draw's base_instance is added to
+  //   OBJECT_CONSTANTS_INDEX
+  //  - Requires gx::info().multiDrawIndirect() and
+  //    gx::info().shaderDrawParameters()
+  bool programSupportsMultiDraw(u32 program);
+
+  // Returns the IndirectBuffer used by RenderViews for their
+  //   multiDrawIndirect()s
+  //   - It can be shared as every CommandBuffer::execute()
+  //     allocates fresh storage for it
+  u32 indirectBuffer() const;
 
   // Returns a ConstantBuffer with size() >= sz, recycling one
   //   used previously if possible
@@ -191,9 +252,20 @@ private:
 
   // Extracts an Entity and all it's children and appends
   //   them to 'objects'
+  //  - Meshes which need to be frustum culled (i.e. when the
+  //    view doesn't do occlusion culling) are appended as well
+  //    and their indices are pushed onto 'frustum_cull', so
+  //    they can all be culled at once by frustumCullObjects()
   void extractOne(RenderView& view,
-    ObjectVector& objects, const frustum3& frustum,
-    hm::Entity e, const mat4& parent);
+    ObjectVector& objects, std::vector<size_t>& frustum_cull,
+    const frustum3& frustum, hm::Entity e, const mat4& parent);
+
+  // Tests the AABBs of the RenderMeshes at 'indices' against
+  //   the frustum (with frustum_aabbs_inside()) and removes
+  //   the ones which are outside of it from 'objects'
+  //  - The order of the remaining objects is preserved
+  void frustumCullObjects(ObjectVector& objects,
+    const std::vector<size_t>& indices, const frustum3& frustum);
 
   // Returns 'true' when light was culled
   bool cullLight(RenderView& view,
@@ -203,6 +275,8 @@ private:
   // Stores the gx::ResourcePool of the Renderer
   RendererData *m_data;
 
+  const hm::TransformSystem *m_transforms;
+
   //   RenderTargets
   os::ReaderWriterLock::Ptr m_rts_lock;
   std::vector<RenderTarget> m_rts;
@@ -210,6 +284,11 @@ private:
   //   Programs
   os::ReaderWriterLock::Ptr m_programs_lock;
   std::vector<u32> m_programs;
+  // Indexed the same as 'm_programs'
+  std::vector<bool> m_programs_instancing;
+
+  //   IndirectBuffer
+  u32 m_indirect_buffer;
 
   //   ConstantBuffers
   os::ReaderWriterLock::Ptr m_const_buffers_lock;
@@ -218,6 +297,7 @@ private:
   //   RenderLUTs
   os::ReaderWriterLock::Ptr m_luts_lock;
   std::vector<RenderLUT> m_luts;
+  RenderLUTCache m_lut_cache;
 
   //   Samplers
   os::ReaderWriterLock::Ptr m_samplers_lock;
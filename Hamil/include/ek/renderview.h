@@ -148,6 +148,28 @@ private:
 
   constexpr static int ShadowBlurRadius = 1;  // See math/util.h
 
+  // A run of consecutive (after sorting) RenderObjects which
+  //   share their meshes, diffuse texture and Program and thus
+  //   can be drawn with a single instanced draw call
+  //  - Each instance has it's own ObjectConstants, which are
+  //    written to consecutive slots of the ObjectConstants
+  //    UniformBuffer so the shaders can fetch them via
+  //    OBJECT_CONSTANTS_INDEX (uObjectConstantsOffset+gl_InstanceID)
+  //  - Batches of more than one RenderObject are only formed for
+  //    Programs which do so (see Renderer::programSupportsInstancing())
+  //  - When 'multi_draw' is set the RenderObjects DON'T share their
+  //    meshes, only their Program, diffuse texture and gx::MeshPool
+  //    arena, and are drawn with one multiDrawIndirect() instead
+  //    (see canMultiDraw())
+  struct InstanceBatch {
+    const RenderObject * const *objects = nullptr;
+    size_t num = 0;
+
+    bool multi_draw = false;
+
+    const RenderObject& first() const { return *objects[0]; }
+  };
+
   std::string labelPrefix() const;
 
   // m_renderer->pool()
@@ -185,6 +207,10 @@ private:
   //   m_num_objects_per_block RenderObjects
   //  - Must be called AFTER the appropriate RenderFn
   void advanceConstantBlockBinding(gx::CommandBuffer& cmd);
+  // Returns the number of ObjectConstants which can still be
+  //   written before the currently bound block is exhausted
+  //   (i.e. the max number of instances in the next InstanceBatch)
+  size_t numFreeConstantBlockSlots() const;
 
   // Fills MemoryPool block 'h' with 'sz' bytes of
   //   scene constant data
@@ -192,6 +218,9 @@ private:
   // Returns an offset into the ObjectConstants UniformBuffer
   //   where the element under that offset describes 'ro'
   u32 writeConstants(const RenderObject& ro);
+  // Writes the ObjectConstants of every RenderObject in the
+  //   InstanceBatch and returns the offset of the first one
+  u32 writeConstants(const InstanceBatch& batch);
 
   // Calls Renderer::queryLUT()
   void initLuts();
@@ -212,17 +241,50 @@ private:
   // 'objects' will be altered by this method
   gx::CommandBuffer doRender(std::vector<RenderObject>& objects);
 
-  using RenderFn = void (RenderView::*)(const RenderObject&, gx::CommandBuffer&);
+  // Moves the RenderMeshes (which start at 'meshes_off' and
+  //   are already in draw order) which canInstance() each other
+  //   next to each other, with every group placed where
+  //   it's first member was
+  //  - Does nothing when the Program doesn't support instancing
+  void groupInstances(std::vector<RenderObject>& objects, size_t meshes_off);
+
+  // Returns 'true' when 'a' and 'b' can be drawn as instances
+  //   of a single draw call
+  bool canInstance(const RenderObject& a, const RenderObject& b);
+  // Returns 'true' when 'a' and 'b' can be drawn with a single
+  //   multiDrawIndirect(), i.e. they share their Program (which
+  //   must support it - see Renderer::programSupportsMultiDraw()),
+  //   diffuse texture, and all of their meshes are indexed and were
+  //   sub-allocated from the same gx::MeshPool arena
+  bool canMultiDraw(const RenderObject& a, const RenderObject& b);
+
+  using RenderFn = void (RenderView::*)(const InstanceBatch&, gx::CommandBuffer&);
   static const RenderFn RenderFns[NumViewTypes][NumRenderTypes];
 
   // m_type == CameraView, m_render == Forward
-  void forwardCameraRenderOne(const RenderObject& ro, gx::CommandBuffer& cmd);
+  void forwardCameraRenderBatch(const InstanceBatch& batch, gx::CommandBuffer& cmd);
 
   // m_type == ShadowView, m_render == DepthOnly
-  void shadowRenderOne(const RenderObject& ro, gx::CommandBuffer& cmd);
-
+  void shadowRenderBatch(const InstanceBatch& batch, gx::CommandBuffer& cmd);
+
+  // Emits the draw commands for all of the batch's RenderObjects
+  //   - 'offset_location' is the Program's uObjectConstantsOffset
+  //     uniform, which was set to 'constants_offset', and is
+  //     re-set for every RenderObject when a multi_draw batch
+  //     has to fall back to drawing them one by one
+  void emitBatch(const InstanceBatch& batch, uint offset_location, u32 constants_offset,
+      gx::CommandBuffer& cmd);
   // Emits the draw command for ro.mesh()
-  void emitDraw(const RenderMesh& ro, gx::CommandBuffer& cmd);
+  //   - When instances > 1 instanced draws are used
+  void emitDraw(const RenderMesh& ro, u32 instances, gx::CommandBuffer& cmd);
+  // Emits a single multiDrawIndirect() for all the meshes of
+  //   the batch's RenderObjects and returns 'true' when they
+  //   are all indexed and source the same vertex array (i.e. were
+  //   sub-allocated from one gx::MeshPool arena), otherwise
+  //   returns 'false' without emitting anything
+  //  - Only used for single RenderObjects with multiple
+  //    meshes and multi_draw batches
+  bool emitMultiDraw(const InstanceBatch& batch, gx::CommandBuffer& cmd);
 
   ViewType m_type;
   RenderType m_render;
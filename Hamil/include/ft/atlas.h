@@ -0,0 +1,76 @@
+#pragma once
+
+#include <common.h>
+
+#include <stb_rect_pack/stb_rect_pack.h>
+
+#include <vector>
+
+namespace ft {
+
+// CPU-side copy of the skyline packed glyph atlas of a FontCache
+//  - Stored upside down (the first row of the storage is the
+//    bottom row of the atlas), just like the atlases created
+//    by Font::populateRenderData(), so it can be uploaded
+//    to a texture as-is
+//  - Every bitmap is surrounded by a 1 texel wide empty border
+//    so sampling it with linear filtering doesn't bleed in
+//    the neighbouring glyphs
+class GlyphAtlas {
+public:
+  // Position of a packed bitmap in the atlas
+  //  - 'x', 'y' is the top-left corner of the border
+  //    around the bitmap (in stb_rect_pack's top-down
+  //    coordinates)
+  struct Rect {
+    u16 x = 0, y = 0;
+    u16 width = 0, rows = 0;
+  };
+
+  GlyphAtlas(unsigned size);
+
+  // Blits the 'width' x 'rows' (top row first) bitmap
+  //   into a free spot in the atlas
+  //  - Returns 'false' when there's no room left for it
+  bool pack(const u8 *pixels, unsigned width, unsigned rows, Rect& rect);
+
+  // Packs the bitmaps at 'rects' into an empty atlas again, tallest
+  //   first, which reclaims the space taken up by all the others
+  //  - The pixels are copied from the bitmaps' current positions,
+  //    so nothing has to be rasterized again
+  //  - 'rects' are updated in place, the entries of 'packed' (which
+  //    is resized to rects.size()) are set to 'false' for the ones
+  //    which didn't fit anymore
+  void repack(const std::vector<Rect *>& rects, std::vector<bool>& packed);
+
+  // Forgets all the packed bitmaps and zeroes the whole atlas
+  void reset();
+
+  // Copies out the bitmap packed at 'rect' (top row first)
+  std::vector<u8> read(const Rect& rect) const;
+
+  unsigned size() const;
+  const u8 *pixels() const;
+
+  // The rows of the storage in [dirtyBegin(), dirtyEnd()) were
+  //   written to since the last call to clearDirty()
+  unsigned dirtyBegin() const;
+  unsigned dirtyEnd() const;
+
+  void clearDirty();
+
+private:
+  // Returns the index of the first pixel of row 'y' of
+  //   the bitmap at 'rect' in 'm_pixels'
+  size_t rowOffset(const Rect& rect, unsigned y) const;
+
+  unsigned m_size;
+
+  stbrp_context m_packer;
+  std::vector<stbrp_node> m_packer_nodes;
+
+  std::vector<u8> m_pixels;
+  unsigned m_dirty_begin, m_dirty_end;
+};
+
+}
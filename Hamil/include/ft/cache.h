@@ -1,15 +1,185 @@
 #pragma once
 
 #include <ft/font.h>
+#include <ft/atlas.h>
+
+#include <gx/resourcepool.h>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
 
 namespace ft {
 
+// Glyph atlas and laid out string cache shared by many Fonts
+//   (see Font::Font(const FontFamily&, unsigned, const std::shared_ptr<FontCache>&))
+//  - Glyphs are rasterized on first use (for every Font, i.e.
+//    face and size, separately) and skyline packed into a single
+//    atlas, which means Fonts sharing a FontCache can be drawn
+//    without switching textures
+//  - The vertices/indices generated by Font::writeVertsAndIndices()
+//    are kept in an LRU cache keyed by the Font and the string, so
+//    repeatedly drawn strings are just copied out of it
+//  - When the atlas fills up the glyphs of the live Fonts are
+//    packed into it again (see GlyphAtlas::repack()), which
+//    reclaims the space left behind by evict()'ed ones
+//  - NOT thread-safe, all access must be done on the thread
+//    which owns the gx context
 class FontCache {
 public:
+  using Ptr = std::shared_ptr<FontCache>;
+
+  enum : unsigned {
+    DefaultAtlasSize = 1024,
+  };
+
+  enum : size_t {
+    DefaultMaxRuns = 1024,
+  };
+
+  struct Error { };
+
+  // Thrown when a glyph (or all the glyphs of a single
+  //   string) doesn't fit even in an empty atlas
+  struct AtlasFullError : public Error { };
+
+  struct Stats {
+    size_t hits = 0, misses = 0;
+    size_t evictions = 0;
+
+    // Number of times the atlas filled up and was repacked
+    size_t repacks = 0;
+
+    size_t num_glyphs = 0;
+    size_t num_runs = 0;
+  };
+
+  // 'atlas_size' is the width and height of the atlas texture (which
+  //   is created in 'pool') and 'max_runs' is the maximum number of
+  //   laid out strings which are kept
+  FontCache(gx::ResourcePool& pool, unsigned atlas_size = DefaultAtlasSize,
+    size_t max_runs = DefaultMaxRuns);
+  FontCache(const FontCache& other) = delete;
+  ~FontCache();
+
+  FontCache& operator=(const FontCache& other) = delete;
+
+  // Same as Font::writeVertsAndIndices(), except the vertices and
+  //   indices are copied from the cache when 'str' has been recently
+  //   laid out with the same 'font'
+  //  - Newly rasterized glyphs are uploaded to the atlas (via
+  //    flush()) before returning
+  //  - Vertices generated before the atlas gets repacked (see
+  //    Stats::repacks) have stale UVs and must be regenerated
+  String writeVertsAndIndices(const Font& font, const char *str,
+    StridePtr<Position> pos, StridePtr<UV> uv, u16 *inds);
+
+  // Uploads all the glyphs rasterized since the last call
+  //   to the atlas texture
+  //  - Must be called before drawing strings which weren't
+  //    generated by writeVertsAndIndices()
+  void flush();
+
+  // Drops all the cached glyphs and strings and clears the atlas
+  //   - All previously generated vertices are invalidated
+  void clear();
+
+  // Drops all the glyphs and cached strings of 'font'
+  //   - The space its glyphs occupy in the atlas is
+  //     reclaimed the next time the atlas fills up
+  void evict(const Font& font);
+
+  gx::ResourcePool::Id atlasId() const;
+
+  const Stats& stats() const;
 
 private:
+  friend class Font;
+
+  using GlyphRenderData = Font::GlyphRenderData;
+
+  struct GlyphKey {
+    const Font *font;
+    int ch;
+
+    bool operator==(const GlyphKey& other) const
+    {
+      return font == other.font && ch == other.ch;
+    }
+  };
+
+  struct GlyphKeyHash {
+    size_t operator()(const GlyphKey& key) const;
+  };
+
+  struct Run {
+    const Font *font;
+    std::string str;
+    size_t key;
+
+    String string;
+
+    std::vector<Position> pos;
+    std::vector<UV> uv;
+    std::vector<u16> inds;
+  };
+
+  // Front == most recently used
+  using LRUList = std::list<Run>;
+  using RunMap = std::unordered_map<size_t /* key */, LRUList::iterator>;
+
+  struct Glyph {
+    GlyphRenderData rd;
+    GlyphAtlas::Rect rect;
+  };
+
+  using GlyphMap = std::unordered_map<GlyphKey, Glyph, GlyphKeyHash>;
+
+  // Returns the glyph for 'ch' rasterizing it if it's not in the atlas yet
+  //   - Called by Font::getGlyphRenderData()
+  const GlyphRenderData& glyph(const Font& font, int ch);
+
+  // Rasterizes the glyph and packs it into the atlas, making
+  //   room for it with repack() or by dropping all the other
+  //   glyphs when there's none left
+  //  - Throws AtlasFullError when the glyph doesn't
+  //    fit in an empty atlas
+  Glyph rasterize(const Font& font, int ch);
+
+  // Packs 'g' into the atlas and fills in 'glyph'
+  //   - Returns 'false' when there's no room left for 'g'
+  bool pack(const Font::GlyphBitmap& g, Glyph& glyph);
+
+  // Packs all the glyphs in 'm_glyphs' into the atlas again,
+  //   dropping the ones which don't fit anymore
+  //  - All the cached strings are dropped, as their UVs
+  //    are no longer valid
+  void repack();
+
+  // Fills in the UVs of 'glyph' from 'glyph.rect'
+  void glyphUVs(Glyph& glyph) const;
+
+  static size_t run_key(const Font& font, const char *str, size_t len);
+  static void copy_run(const Run& run, StridePtr<Position> pos, StridePtr<UV> uv, u16 *inds);
+
+  void eraseRun(LRUList::iterator it);
+
+  gx::ResourcePool& m_pool;
+  gx::ResourcePool::Id m_atlas_id;
+
+  // The dirty rows are uploaded by flush()
+  GlyphAtlas m_atlas;
+
+  GlyphMap m_glyphs;
+
+  size_t m_max_runs;
 
+  LRUList m_lru;
+  RunMap m_runs;
 
+  Stats m_stats;
 };
 
-}
\ No newline at end of file
+}
@@ -37,6 +37,8 @@ class pGlyph;
 class pString;
 // -------------
 
+class FontCache;
+
 class FontFamily {
 public:
   FontFamily(const char *name);
@@ -63,6 +65,7 @@ protected:
 
 private:
   friend class Font;
+  friend class FontCache;
   
   pString *operator->() const { return get(); }
   pString *get() const;
@@ -75,9 +78,16 @@ public:
   using Ptr = std::shared_ptr<Font>;
 
   Font(const FontFamily& family, unsigned height, gx::ResourcePool *pool = nullptr);
+  // Instead of rasterizing a fixed set of glyphs up front into
+  //   a private atlas, the glyphs are rasterized on first use
+  //   into the 'cache's atlas (shared with other Fonts) and the
+  //   strings laid out by writeVertsAndIndices() are cached
+  Font(const FontFamily& family, unsigned height, const std::shared_ptr<FontCache>& cache);
   Font(const Font& other) = delete;
   ~Font();
 
+  // When the Font uses a FontCache glyph indices are
+  //   the same as character codes
   int glyphIndex(int ch) const;
 
   // Must be drawn with the same Font!
@@ -132,6 +142,8 @@ public:
   float monospaceWidth() const;
 
 private:
+  friend class FontCache;
+
   struct GlyphRenderData {
     unsigned idx;
     int top, left;
@@ -141,12 +153,29 @@ private:
     UV uvs[4];
   };
 
+  // A glyph rasterized by renderGlyph()
+  struct GlyphBitmap {
+    unsigned idx;
+    int top, left;
+    ivec2 advance;
+
+    unsigned width, rows;
+    std::vector<u8> pixels;  // 'width' x 'rows', top row first
+  };
+
+  void initFace(const FontFamily& family, unsigned height);
   void populateRenderData(const std::vector<pGlyph>& glyphs, gx::TextureHandle atlas);
 
+  // Used by FontCache to rasterize glyphs on demand
+  GlyphBitmap renderGlyph(int ch) const;
+  // Does the actual work for writeVertsAndIndices()
+  String layout(const char *str, StridePtr<Position> pos, StridePtr<UV> uv, u16 *inds) const;
+
   int getGlyphIndex(int ch) const;
   const GlyphRenderData& getGlyphRenderData(int ch) const;
 
   pFace *m;
+  std::shared_ptr<FontCache> m_cache;
 
   float m_bearing_y;
 
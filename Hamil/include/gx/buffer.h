@@ -69,6 +69,10 @@ public:
   void init(const void *data, size_t elem_sz, size_t elem_count);
   void upload(const void *data, size_t offset, size_t elem_sz, size_t elem_count);
 
+  // Returns the size of the Buffer's storage in bytes
+  //   or 0 before init() was called
+  size_t size() const;
+
   void copy(Buffer& dst, size_t src_offset, size_t dst_offset, size_t sz);
   void copy(Buffer& dst, size_t sz);
 
@@ -159,6 +163,12 @@ private:
   void clearBindings();
 };
 
+// Stores arguments for indirect draws (see gx::MultiDrawBuilder)
+class IndirectBuffer : public Buffer {
+public:
+  IndirectBuffer(Usage usage);
+};
+
 class TexelBuffer : public Buffer {
 public:
   TexelBuffer(Usage usage);
@@ -108,6 +108,25 @@ public:
     //   the base and offset respectively
     OpDrawBaseVertex,
 
+    // Same as Draw<Indexed> except the CommandWithExtra is
+    //   followed by three ExtraData which encode the
+    //   instance count, base and offset respectively
+    //   - A base == ~0u means the VertexArray is NOT indexed
+    OpDrawInstanced,
+
+    // CommandWithExtra where:
+    //   - OpData encodes the IndexedVertexArray ResourceId
+    //   - Bits [31;29] of OpExtra encode the Primitive
+    //   - Bits [28;0] of OpExtra encode the number of draws
+    //  followed by two ExtraData which encode the IndirectBuffer
+    //  ResourceId and the MemoryPool::Handle of the draws'
+    //  DrawElementsIndirectArgs respectively
+    //   - The arguments are uploaded to the IndirectBuffer during
+    //     execute() when multi-draw-indirect is supported, otherwise
+    //     the draws are issued one at a time straight from the
+    //     MemoryPool (see gx::GxInfo::multiDrawIndirect())
+    OpMultiDrawIndirect,
+
     // CommandWithExtra where:
     //   - OpData encodes the Buffer ResourceId
     //   - Bits [31;16] of OpExtra encode the upload size (in bytes)
@@ -163,6 +182,21 @@ public:
   CommandBuffer& draw(Primitive p, ResourceId vertex_array, size_t num_verts);
   CommandBuffer& drawIndexed(Primitive p, ResourceId indexed_vertex_array, size_t num_inds);
   CommandBuffer& drawBaseVertex(Primitive p, ResourceId iarray, size_t num, u32 base, u32 offset = 0);
+  // Draws 'instances' copies of the geometry in a single call
+  //   - A call with instances == 0 records nothing
+  CommandBuffer& drawInstanced(Primitive p, ResourceId vertex_array, size_t num_verts, u32 instances);
+  CommandBuffer& drawBaseVertexInstanced(Primitive p, ResourceId iarray, size_t num,
+      u32 instances, u32 base, u32 offset = 0);
+  // Submits 'num_draws' indexed draws whose DrawElementsIndirectArgs
+  //   are stored in the bound MemoryPool under 'draws'
+  //   (see gx::MultiDrawBuilder)
+  //   - Every execute() of the CommandBuffer uploads the arguments
+  //     of all it's multiDrawIndirect()s to consecutive ranges of
+  //     freshly allocated 'indirect_buffer' storage, so draws
+  //     recorded earlier are never overwritten
+  //   - A call with num_draws == 0 records nothing
+  CommandBuffer& multiDrawIndirect(Primitive p, ResourceId iarray,
+      ResourceId indirect_buffer, MemoryPool::Handle draws, size_t num_draws);
   CommandBuffer& bufferUpload(ResourceId buf, MemoryPool::Handle h, size_t sz);
 
   CommandBuffer& uniformInt(uint location, int value);
@@ -202,6 +236,9 @@ public:
   //   and MemoryPool bindings previously created
   CommandBuffer& reset();
 
+  // Returns the recorded (encoded) commands
+  const std::vector<u32>& dbg_Commands() const;
+
 protected:
   CommandBuffer(size_t initial_alloc);
 
@@ -210,6 +247,12 @@ private:
     NonIndexedDraw = ~0u,
   };
 
+  enum : size_t {
+    // Minimum size of the storage allocated for IndirectBuffers
+    //   by multiDrawIndirect() during execute()
+    MinIndirectBufferSize = 16 * 1024,
+  };
+
   union CommandWithExtra {
     struct {
       u32 command;
@@ -228,6 +271,8 @@ private:
   u32 *dispatch(u32 *op);
 
   void drawCommand(CommandWithExtra op, u32 base = ~0u, u32 offset = 0);
+  void drawInstancedCommand(CommandWithExtra op, u32 instances, u32 base, u32 offset);
+  void multiDrawIndirectCommand(CommandWithExtra op, ResourceId indirect_buffer, MemoryPool::Handle draws);
   void uploadCommand(CommandWithExtra op);
   void pushUniformCommand(CommandWithExtra op);
   void fenceCommand(u32 data);
@@ -261,6 +306,8 @@ private:
   static CommandWithExtra make_draw(Primitive p, ResourceId array, size_t num_verts);
   static CommandWithExtra make_draw_indexed(Primitive p, ResourceId array, size_t num_inds);
   static CommandWithExtra make_draw_base_vertex(Primitive p, ResourceId array, size_t num_inds);
+  static CommandWithExtra make_draw_instanced(Primitive p, ResourceId array, size_t num);
+  static CommandWithExtra make_multi_draw_indirect(Primitive p, ResourceId array, size_t num_draws);
 
   static CommandWithExtra make_buffer_upload(ResourceId buf, MemoryPool::Handle h, size_t sz);
 
@@ -283,6 +330,12 @@ private:
   //   NonIndexedDraw otherwise
   u32 m_last_draw;
 
+  // The IndirectBuffer the last multiDrawIndirect() uploaded it's
+  //   arguments to during the current execute() (or ~0u) and
+  //   the offset (in bytes) where the next upload should go
+  ResourceId m_indirect_buffer;
+  size_t m_indirect_offset;
+
 };
 
 }
\ No newline at end of file
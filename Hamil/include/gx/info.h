@@ -18,6 +18,9 @@ static const std::string ComputeShader       = "GL_ARB_compute_shader";
 static const std::string ShaderStorageBuffer = "GL_ARB_shader_storage_buffer_object";
 static const std::string BindlessTexture     = "GL_ARB_bindless_texture";
 static const std::string TextureBPTC         = "GL_ARB_texture_compression_bptc";
+static const std::string DrawIndirect        = "GL_ARB_draw_indirect";
+static const std::string MultiDrawIndirect   = "GL_ARB_multi_draw_indirect";
+static const std::string ShaderDrawParameters = "GL_ARB_shader_draw_parameters";
 }
 // ----------------------
 
@@ -62,6 +65,17 @@ public:
   //  - See above for some predefined const name strings
   bool extension(const std::string& name) const;
 
+  // Returns 'true' when glMultiDrawElementsIndirect() (and thus
+  //   IndirectBuffers) can be used, which requires OpenGL 4.3
+  //   or both ARB::DrawIndirect and ARB::MultiDrawIndirect
+  bool multiDrawIndirect() const;
+
+  // Returns 'true' when shaders can read gl_BaseInstanceARB and
+  //   gl_DrawIDARB, which requires ARB::ShaderDrawParameters
+  //  - gx::Shader enables the extension automatically
+  //    when it's supported
+  bool shaderDrawParameters() const;
+
 protected:
   // 'num_extensions' is needed to decrease amount of
   //   std::unordered_set reallocations
@@ -98,6 +112,9 @@ private:
   // GL_MAX_LABEL_LENGTH
   size_t m_max_label_length;
 
+  bool m_multi_draw_indirect;
+  bool m_shader_draw_parameters;
+
   std::unordered_set<std::string> m_extensions;
 };
 
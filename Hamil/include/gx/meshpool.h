@@ -0,0 +1,135 @@
+#pragma once
+
+#include <gx/gx.h>
+#include <gx/resourcepool.h>
+#include <gx/vertex.h>
+
+#include <util/allocator.h>
+
+#include <vector>
+#include <memory>
+
+namespace gx {
+
+// Sub-allocates vertex and index ranges for many meshes out of a
+//   few large VertexBuffers/IndexBuffers (arenas) grouped by
+//   VertexFormat, so all meshes allocated from the same arena
+//   share a single IndexedVertexArray
+//  - Meshes are then drawn via CommandBuffer::drawBaseVertex()
+//    (or batched via a MultiDrawBuilder) using an Allocation's
+//    'base_vertex' and 'first_index' without rebinding the VAO
+//  - Indices are always of Type::u32
+//  - All methods MUST be called on the GL thread
+//
+//   Usage:
+//       auto meshes = gx::MeshPool(pool);
+//
+//       auto a = meshes.alloc(fmt, num_verts, num_inds);
+//       meshes.uploadVertices(a, verts);
+//       meshes.uploadIndices(a, inds);
+//
+//       mesh
+//         .withIndexedArray(a.array)
+//         .withBase(a.base_vertex)
+//         .withOffset(a.first_index)
+//         .withNum(a.num_inds);
+//
+class MeshPool {
+public:
+  using ResourceId = ResourcePool::Id;
+
+  enum : size_t {
+    DefaultArenaVertices = 1<<20,
+    DefaultArenaIndices  = 3<<20,
+  };
+
+  struct Error { };
+
+  // Thrown when a single allocation can never fit in an arena
+  struct AllocTooLargeError : public Error { };
+
+  struct Allocation {
+    ResourceId array = ResourcePool::Invalid;   // IndexedVertexArray
+
+    u32 arena = ~0u;
+
+    u32 base_vertex = 0;
+    u32 first_index = 0;
+
+    u32 num_verts = 0;
+    u32 num_inds  = 0;
+
+    bool valid() const { return array != ResourcePool::Invalid; }
+  };
+
+  // Shared with the owners of Allocations which can outlive
+  //   the MeshPool (eg. res::Mesh) - it points to nullptr
+  //   once the MeshPool has been destroyed
+  using Ref = std::shared_ptr<MeshPool *>;
+
+  // 'arena_verts' and 'arena_inds' determine the sizes (in elements)
+  //   of each arena's VertexBuffer and IndexBuffer respectively
+  MeshPool(ResourcePool& pool,
+      size_t arena_verts = DefaultArenaVertices, size_t arena_inds = DefaultArenaIndices);
+  MeshPool(const MeshPool& other) = delete;
+  ~MeshPool();
+
+  // Reserves space for 'num_verts' vertices of format 'fmt' and
+  //   'num_inds' indices in an arena, creating a new one when
+  //   none of the existing ones (with a matching VertexFormat)
+  //   have enough space left
+  //  - Throws AllocTooLargeError when 'num_verts' or 'num_inds'
+  //    exceed the arena sizes passed to the constructor
+  Allocation alloc(const VertexFormat& fmt, u32 num_verts, u32 num_inds);
+  // Returns the ranges reserved by 'a' to their arena
+  //   - Passing an invalid Allocation is a no-op
+  void dealloc(const Allocation& a);
+
+  // Uploads 'num' vertices (or all of them when num == ~0u)
+  //   at 'offset' relative to the Allocation's base_vertex
+  void uploadVertices(const Allocation& a, const void *verts, u32 offset = 0, u32 num = ~0u);
+  // Uploads 'num' indices (or all of them when num == ~0u)
+  //   at 'offset' relative to the Allocation's first_index
+  //  - The indices are relative to 'base_vertex'
+  void uploadIndices(const Allocation& a, const u32 *inds, u32 offset = 0, u32 num = ~0u);
+
+  // Returns a Ref to this MeshPool
+  Ref ref() const;
+
+  size_t numArenas() const;
+
+  // Returns the ids of the arena's resources, useful for
+  //   eg. copying data into them on the GPU
+  ResourceId arenaVertexBuffer(u32 arena) const;
+  ResourceId arenaIndexBuffer(u32 arena) const;
+  ResourceId arenaArray(u32 arena) const;
+
+private:
+  struct Arena {
+    VertexFormat fmt;
+    size_t vertex_sz;
+
+    ResourceId vertex_buf = ResourcePool::Invalid;
+    ResourceId index_buf  = ResourcePool::Invalid;
+    ResourceId array      = ResourcePool::Invalid;
+
+    TLSFAllocator verts;
+    TLSFAllocator inds;
+
+    Arena(const VertexFormat& fmt_, size_t num_verts, size_t num_inds);
+  };
+
+  // Returns the index of the newly created Arena
+  u32 createArena(const VertexFormat& fmt);
+
+  ResourcePool *m_pool;
+
+  size_t m_arena_verts;
+  size_t m_arena_inds;
+
+  std::vector<Arena> m_arenas;
+
+  Ref m_ref;
+};
+
+}
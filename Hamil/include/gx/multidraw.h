@@ -0,0 +1,102 @@
+#pragma once
+
+#include <gx/gx.h>
+#include <gx/resourcepool.h>
+#include <gx/memorypool.h>
+
+#include <vector>
+
+namespace gx {
+
+class CommandBuffer;
+
+// Arguments of a single indexed draw
+//   - The layout MUST match OpenGL's DrawElementsIndirectCommand
+struct DrawElementsIndirectArgs {
+  u32 count;
+  u32 instance_count;
+  u32 first_index;
+  i32 base_vertex;
+  u32 base_instance;
+};
+static_assert(sizeof(DrawElementsIndirectArgs) == 5*sizeof(u32),
+    "DrawElementsIndirectArgs must be tightly packed!");
+
+// Packs the arguments of many indexed draws which source their
+//   vertices/indices from the same IndexedVertexArray (i.e. meshes
+//   sub-allocated from shared buffers and addressed via a base vertex
+//   and first index) so they can be submitted to the GPU with a single
+//   CommandBuffer::multiDrawIndirect()
+//
+//   Usage:
+//       auto batch = gx::MultiDrawBuilder(gx::Primitive::Triangles, array_id);
+//
+//       for(const auto& mesh : meshes) {
+//         if(!batch.draw(mesh.num, mesh.base, mesh.offset)) {
+//           batch.emit(cmd, mempool, indirect_buffer_id);  // The batch is full
+//           batch.draw(mesh.num, mesh.base, mesh.offset);
+//         }
+//       }
+//       batch.emit(cmd, mempool, indirect_buffer_id);
+//
+class MultiDrawBuilder {
+public:
+  using ResourceId = ResourcePool::Id;
+
+  using DrawElementsArgs = DrawElementsIndirectArgs;
+
+  enum : size_t {
+    // Keeps the arguments of a single batch small
+    //   enough for the CommandBuffer's MemoryPool
+    MaxArgsSize = (1<<16) - 1,
+
+    MaxDraws = MaxArgsSize / sizeof(DrawElementsArgs),
+  };
+
+  struct Error { };
+
+  struct AllocFailedError : public Error { };
+
+  MultiDrawBuilder(Primitive p, ResourceId indexed_array);
+
+  Primitive primitive() const;
+  ResourceId array() const;
+
+  // Returns 'true' when draws with the given Primitive sourcing
+  //   from 'indexed_array' can be appended to this batch
+  bool accepts(Primitive p, ResourceId indexed_array) const;
+
+  // Appends the arguments of a single draw to the batch and
+  //   returns 'true' or returns 'false' when the batch
+  //   is full (has MaxDraws draws)
+  bool draw(u32 num, u32 base_vertex, u32 first_index,
+      u32 instances = 1, u32 base_instance = 0);
+
+  size_t numDraws() const;
+  bool empty() const;
+
+  // Returns a pointer to the packed draw arguments
+  const DrawElementsArgs *data() const;
+  // Returns the size of the packed draw arguments in bytes
+  size_t byteSize() const;
+
+  // Copies the packed draw arguments into 'mempool' and records
+  //   a multiDrawIndirect() sourcing them (through the IndirectBuffer
+  //   'indirect_buffer' when supported), then clears the batch
+  //  - 'mempool' MUST be the MemoryPool bound to 'cmd'
+  //  - Throws AllocFailedError when 'mempool' is exhausted, in
+  //    which case the batch is left intact
+  //  - Calling this method on an empty batch is a no-op
+  CommandBuffer& emit(CommandBuffer& cmd, MemoryPool& mempool, ResourceId indirect_buffer);
+
+  // Clears the batch without emitting any commands
+  MultiDrawBuilder& reset();
+
+private:
+  Primitive m_primitive;
+  ResourceId m_array;
+
+  std::vector<DrawElementsArgs> m_draws;
+};
+
+}
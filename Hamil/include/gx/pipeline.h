@@ -17,6 +17,8 @@ namespace gx {
 class Program;
 class ResourcePool;
 
+struct DrawElementsIndirectArgs;
+
 class Pipeline {
 public:
   using ResourceId = u32;   // Must match ResourcePool::Id
@@ -368,6 +370,21 @@ public:
 
   Pipeline& drawBaseVertex(size_t base, size_t offset, size_t num);
 
+  // Same as draw()/drawBaseVertex() except 'instances' copies
+  //   of the geometry are drawn (gl_InstanceID = [0; instances))
+  Pipeline& drawInstanced(size_t offset, size_t num, size_t instances);
+  Pipeline& drawBaseVertexInstanced(size_t base, size_t offset, size_t num, size_t instances);
+
+  // Sources the arguments of 'num_draws' indexed draws from
+  //   an IndirectBuffer starting at byte 'offset'
+  //   - See gx::MultiDrawBuilder
+  Pipeline& multiDrawIndirect(ResourceId indirect_buffer, size_t offset, size_t num_draws);
+  // Issues the same draws as multiDrawIndirect() one at a time
+  //   sourcing their arguments from CPU memory, for when
+  //   IndirectBuffers can't be used
+  //   - The 'base_instance' of the draws is ignored
+  Pipeline& multiDrawBaseVertex(const DrawElementsIndirectArgs *draws, size_t num_draws);
+
 private:
   using ConfigStructArray = std::array<ConfigStruct, std::variant_size_v<ConfigStruct>-2>;
   //                                                 ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
@@ -85,6 +85,10 @@ public:
 
   // Returns the 'id' which will be assigned to the next added subpass()
   uint nextSubpassId() const;
+  // Removes all the added subpasses, so the next one will have 'id' == 0
+  //   - Any CommandBuffer which references them MUST NOT
+  //     be executed afterwards
+  RenderPass& clearSubpasses();
 
   const RenderPass& begin(ResourcePool& pool) const;
   const RenderPass& beginSubpass(ResourcePool& pool, uint id) const;
@@ -11,19 +11,28 @@
 #include <gx/query.h>
 
 #include <util/smallvector.h>
-#include <util/tupleindex.h>
-#include <os/rwlock.h>
+#include <os/mutex.h>
 
-#include <vector>
 #include <array>
 #include <tuple>
+#include <atomic>
+#include <algorithm>
 #include <utility>
+#include <type_traits>
+#include <cassert>
 
 namespace gx {
 
-// The pool_size is not enforced, so due to std::vector
-//   iterator/reference invalidaton semantics reource pointers
-//   can become invalid when it is exceeded
+// Resources are stored in fixed-size pages which are never
+//   moved or freed (until the ResourcePool is destroyed), so
+//   references to them stay valid until they're release()'d
+//   and get() is wait-free
+//  - Ids encode a slot index and the slot's generation, which is
+//    bumped on every release(), so a stale Id is detected
+//    (see InvalidIdError) instead of aliasing a newer resource
+//  - Ids never exceed 27 bits, so they fit in a CommandBuffer's
+//    OpData
+//  - create() and release() are serialized by a Mutex
 class ResourcePool {
 public:
   using Id = u32;
@@ -32,11 +41,34 @@ public:
     Invalid = ~0u,
   };
 
-  template <typename... Args>
-  using TupleOfVectors = std::tuple<std::vector<Args>...>;
+  enum : u32 {
+    IndexBits = 16,
+    IndexMask = (1u<<IndexBits) - 1,
+
+    GenerationBits  = 11,
+    GenerationShift = IndexBits,
+    GenerationMask  = (1u<<GenerationBits) - 1,
+
+    PageBits = 8,
+    PageSize = 1u<<PageBits,
+    PageMask = PageSize - 1,
+
+    // Max number of resources of a single type
+    MaxResources = 1u<<IndexBits,
+    MaxPages     = MaxResources / PageSize,
+  };
 
   using FreeList = util::SmallVector<Id, 64>;
 
+  struct Error { };
+
+  // Thrown by get() when the resource the Id referred
+  //   to has been release()'d or the Id is malformed
+  struct InvalidIdError : public Error { };
+  // Thrown by create() when MaxResources of the
+  //   given type are live
+  struct PoolExhaustedError : public Error { };
+
   // 'pool_size' represents the number of pre-allocated
   //   Ids per resource type
   ResourcePool(uint32_t pool_size);
@@ -71,19 +103,20 @@ public:
   {
     if(id == Invalid) return;
 
-    m_lock->acquireExclusive();
+    auto guard = m_lock->acquireScoped();
 
-    FreeList& free_list = getFreeList<T>();
-    auto& vec = getVector<T>();
+    auto& storage = getStorage<T>();
+    auto& slot = storage.lookup(id);
 
-    assert(id < vec.size() && "Invalid 'id' passed to release()!");
-    assert(vec.at(id).refs() == 1 && "Attempted to release() an in-use resource!");
+    assert(slot.get()->refs() == 1 && "Attempted to release() an in-use resource!");
+
+    // Invalidate all outstanding Ids referring to this slot
+    slot.live_id.store(Invalid, std::memory_order_release);
+    slot.generation = (slot.generation + 1) & GenerationMask;
 
     // Calling the destructor is deferred until the
     //   resource is re-used
-    free_list.append(id);
-
-    m_lock->releaseExclusive();
+    storage.free_list.append(index(id));
   }
 
   // Passing 'id' == Invalid is a no-op
@@ -138,22 +171,21 @@ public:
     return createBuffer<T>(label.data(), std::forward<Args>(args)...);
   }
 
+  // Wait-free
+  //   - Throws InvalidIdError when 'id' is stale
   template <typename T> T& get(Id id)
   {
-    // Most of the time there sould be no contention here
-    m_lock->acquireShared();
-    auto& resource = getVector<T>().at(id);
-    m_lock->releaseShared();
-
-    return resource;
+    return *getStorage<T>().lookup(id).get();
   }
   template <typename T> const T& get(Id id) const
   {
-    m_lock->acquireShared();
-    const auto& resource = getVector<T>().at(id);
-    m_lock->releaseShared();
+    return *getStorage<T>().lookup(id).get();
+  }
 
-    return resource;
+  // Returns 'true' when 'id' refers to a live resource of type T
+  template <typename T> bool valid(Id id) const
+  {
+    return getStorage<T>().valid(id);
   }
 
   template <typename T> T& getTexture(Id id) { return getTexture(id).get<T>(); }
@@ -176,85 +208,184 @@ public:
 
   // Destroys all resources which are referenced
   //   by ONLY this ResourcePool
+  //   - All Ids issued before the call become stale
   void purge();
 
 private:
   template <typename T>
-  std::vector<T>& getVector()
+  struct Storage {
+    struct Slot {
+      std::aligned_storage_t<sizeof(T), alignof(T)> data;
+
+      // Stores the slot's current Id when it holds a live
+      //   resource or Invalid otherwise, which allows get()
+      //   to validate Ids with a single atomic load
+      std::atomic<Id> live_id = Invalid;
+
+      // The fields below are guarded by the ResourcePool's lock
+      Id generation = 0;
+      bool constructed = false;
+
+      T *get() { return (T *)&data; }
+    };
+
+    using Page = std::array<Slot, PageSize>;
+
+    Storage()
+    {
+      for(auto& page : pages) page.store(nullptr, std::memory_order_relaxed);
+    }
+    Storage(const Storage& other) = delete;
+
+    ~Storage()
+    {
+      clear();
+
+      for(auto& page : pages) delete page.load(std::memory_order_relaxed);
+    }
+
+    // Must be called with the ResourcePool's lock held
+    Slot& slot(Id idx)
+    {
+      auto& page = pages[idx >> PageBits];
+
+      auto p = page.load(std::memory_order_relaxed);
+      if(!p) {
+        p = new Page();
+        page.store(p, std::memory_order_release);
+      }
+
+      return p->at(idx & PageMask);
+    }
+
+    // Returns nullptr for Invalid, which would otherwise
+    //   match every released slot's live_id
+    Slot *find(Id id) const
+    {
+      if(id == Invalid) return nullptr;
+
+      auto idx = index(id);
+
+      auto page = pages[idx >> PageBits].load(std::memory_order_acquire);
+      if(!page) return nullptr;
+
+      auto& slot = (*page)[idx & PageMask];
+      if(slot.live_id.load(std::memory_order_acquire) != id) return nullptr;
+
+      return (Slot *)&slot;
+    }
+
+    Slot& lookup(Id id) const
+    {
+      auto slot = find(id);
+      if(!slot) throw InvalidIdError();
+
+      return *slot;
+    }
+
+    bool valid(Id id) const
+    {
+      return find(id);
+    }
+
+    void reserve(Id num)
+    {
+      num = std::min<Id>(num, MaxResources);
+
+      for(Id idx = 0; idx < num; idx += PageSize) slot(idx);
+    }
+
+    // Destroys all the resources and invalidates their Ids,
+    //   must be called with the ResourcePool's lock held
+    void clear()
+    {
+      for(Id idx = 0; idx < size; idx++) {
+        auto& s = slot(idx);
+
+        s.live_id.store(Invalid, std::memory_order_release);
+        s.generation = (s.generation + 1) & GenerationMask;
+
+        if(s.constructed) s.get()->~T();
+        s.constructed = false;
+      }
+
+      size = 0;
+      free_list.clear();
+    }
+
+    std::array<std::atomic<Page *>, MaxPages> pages;
+
+    // Number of slots ever used
+    Id size = 0;
+    FreeList free_list;
+  };
+
+  static constexpr Id index(Id id)
   {
-    return std::get<std::vector<T>>(m_resources);
+    return id & IndexMask;
   }
 
-  template <typename T>
-  const std::vector<T>& getVector() const
+  static constexpr Id make_id(Id index, Id generation)
   {
-    return std::get<std::vector<T>>(m_resources);
+    return (generation << GenerationShift) | index;
   }
 
   template <typename T>
-  FreeList& getFreeList()
+  Storage<T>& getStorage()
   {
-    auto idx = util::tuple_index_v<std::vector<T>, decltype(m_resources)>;
-
-    return m_free_lists.at(idx);
+    return std::get<Storage<T>>(m_resources);
   }
 
   template <typename T>
-  const FreeList& getFreeList() const
+  const Storage<T>& getStorage() const
   {
-    auto idx = util::tuple_index_v<std::vector<T>, decltype(m_resources)>;
-
-    return m_free_lists.at(idx);
+    return std::get<Storage<T>>(m_resources);
   }
 
   template <typename T, typename... Args>
   inline std::pair<Id, T*> doCreate(Args... args)
   {
-    m_lock->acquireExclusive();
-
-    FreeList& free_list = getFreeList<T>();
-    auto& vec = getVector<T>();
+    auto guard = m_lock->acquireScoped();
 
-    T *resource = nullptr;
-    Id id = Invalid;
+    auto& storage = getStorage<T>();
 
-    if(free_list.empty()) {
-      id = (Id)vec.size();
+    Id idx = Invalid;
+    if(storage.free_list.empty()) {
+      if(storage.size >= MaxResources) throw PoolExhaustedError();
 
-      resource = &vec.emplace_back(std::forward<Args>(args)...);
+      idx = storage.size++;
     } else {
-      id = free_list.pop();
-      resource = vec.data() + id;
-
-      resource->~T();
-      new(resource) T(std::forward<Args>(args)...);
+      idx = storage.free_list.pop();
     }
 
-    m_lock->releaseExclusive();
+    auto& slot = storage.slot(idx);
 
-    return std::make_pair(id, resource);
-  }
+    if(slot.constructed) slot.get()->~T();
+    new(slot.get()) T(std::forward<Args>(args)...);
 
-  mutable os::ReaderWriterLock::Ptr m_lock = os::ReaderWriterLock::alloc();
-
-  TupleOfVectors<
-    Program,
-    VertexArray,
-    IndexedVertexArray,
-    Framebuffer,
-    TextureHandle,
-    Sampler,
-    BufferHandle,
-    RenderPass,
-    Fence,
-    Query
-  > m_resources;
+    slot.constructed = true;
 
-  enum {
-    NumResources = std::tuple_size_v<decltype(m_resources)>,
-  };
+    // Publish the resource to get()
+    auto id = make_id(idx, slot.generation);
+    slot.live_id.store(id, std::memory_order_release);
 
-  std::array<FreeList, NumResources> m_free_lists;
+    return std::make_pair(id, slot.get());
+  }
+
+  mutable os::Mutex::Ptr m_lock = os::Mutex::alloc();
+
+  std::tuple<
+    Storage<Program>,
+    Storage<VertexArray>,
+    Storage<IndexedVertexArray>,
+    Storage<Framebuffer>,
+    Storage<TextureHandle>,
+    Storage<Sampler>,
+    Storage<BufferHandle>,
+    Storage<RenderPass>,
+    Storage<Fence>,
+    Storage<Query>
+  > m_resources;
 };
 
 }
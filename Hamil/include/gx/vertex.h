@@ -33,6 +33,12 @@ public:
   GLboolean attrNormalized(unsigned idx) const;
   bool attrInteger(unsigned idx) const;
 
+  // Returns 'true' when both VertexFormats describe the
+  //   exact same attributes (which means they can share
+  //   VertexBuffers/VertexArrays)
+  bool operator==(const VertexFormat& other) const;
+  bool operator!=(const VertexFormat& other) const;
+
 private:
   friend class VertexArray;
 
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <hm/hamil.h>
+
+#include <math/geometry.h>
+#include <bt/world.h>
+
+#include <vector>
+#include <unordered_map>
+
+namespace sched {
+class WorkerPool;
+}
+
+namespace hm {
+
+// Computes world matrices (and AABBs) for a hierarchy of Entities
+//   - All the nodes are stored in flat (SoA) arrays sorted by their
+//     depth in the hierarchy, so update() can process the whole
+//     hierarchy one level at a time with every parent's world
+//     matrix already computed before its children are visited
+//   - Changing a node's local matrix marks it dirty and update()
+//     recomputes only the dirty nodes and their descendants
+//   - Adding/removing nodes invalidates the layout, which is
+//     rebuilt during the next update()
+//   - NOT thread-safe, world() and worldAABB() can be called
+//     concurrently but only while no other methods are
+class TransformSystem {
+public:
+  enum : u32 {
+    // Levels with at least this many nodes are split
+    //   among the WorkerPool's workers by update()
+    ParallelThreshold = 1024,
+
+    NumJobs = 4,
+  };
+
+  struct Error { };
+
+  struct EntityExistsError : public Error { };
+  struct NoSuchEntityError : public Error { };
+  struct NoSuchParentError : public Error { };
+
+  TransformSystem();
+
+  // Adds 'e' as a child of 'parent' or as a root when
+  //   parent == Entity::Invalid
+  //  - 'local_aabb' must be in the Entity's local space,
+  //    the world AABB is the box which bounds it after
+  //    being transformed by the world matrix
+  //  - The 'parent' must've been previously add()'ed
+  TransformSystem& add(EntityId e, EntityId parent, const mat4& local, const AABB& local_aabb);
+  // Removes 'e' and all of its descendants
+  TransformSystem& remove(EntityId e);
+
+  bool contains(EntityId e) const;
+
+  // Marks 'e' (and by extension all of its descendants) dirty
+  TransformSystem& local(EntityId e, const mat4& local);
+  TransformSystem& localAABB(EntityId e, const AABB& local_aabb);
+
+  const mat4& local(EntityId e) const;
+
+  // Sets the world matrix of 'e', which marks it dirty
+  //   - The local matrix is derived from it (and the parent's
+  //     world matrix) during the next update(), so moving both
+  //     a node and one of it's ancestors this way is fine
+  //   - Until then local(e) returns the world matrix
+  TransformSystem& world(EntityId e, const mat4& world);
+
+  // Sets the world matrices (see above) of all the Entities
+  //   whose bt::RigidBodies were moved by the last world.step()
+  //   in one pass
+  //  - 'moved_bodies' is the world's movedBodies() and so must
+  //    not be accessed concurrently with world.step()
+  //  - The RigidBodies' user() pointers must store the Entities,
+  //    ones which weren't add()'ed to the system are skipped
+  //  - Returns the number of nodes marked dirty
+  size_t syncPhysics(const std::vector<bt::DynamicsWorld::MovedBody>& moved_bodies);
+
+  // Both of these are only valid after an update(), which
+  //   must be called after any changes were made
+  const mat4& world(EntityId e) const;
+  const AABB& worldAABB(EntityId e) const;
+
+  // Recomputes the world matrices and AABBs of all the dirty
+  //   nodes and their descendants
+  //  - When 'pool' != nullptr levels with >= ParallelThreshold
+  //    nodes are processed by NumJobs jobs scheduled on it
+  //  - Returns the number of recomputed nodes
+  size_t update(sched::WorkerPool *pool = nullptr);
+
+  // Returns the number of nodes
+  size_t size() const;
+
+private:
+  enum : u32 {
+    NoParent = ~0u,
+  };
+
+  enum Flags : u8 {
+    Dirty   = 1<<0,
+    Removed = 1<<1,
+
+    // m_local holds a world matrix (see world(e, world))
+    WorldSpace = 1<<2,
+  };
+
+  u32 nodeIndex(EntityId e) const;
+
+  // Sorts the nodes by depth and drops the removed ones
+  void rebuild();
+
+  // Recomputes the nodes in [begin, end) (which must all be
+  //   on the same level) and returns how many were dirty
+  size_t updateRange(u32 begin, u32 end);
+
+  // Indexed by node, sorted by depth after a rebuild()
+  std::vector<EntityId> m_entity;
+  std::vector<u32> m_parent;
+  std::vector<u32> m_depth;
+  std::vector<u8> m_flags;
+
+  std::vector<mat4> m_local;
+  std::vector<mat4> m_world;
+  std::vector<AABB> m_local_aabb;
+  std::vector<AABB> m_world_aabb;
+
+  // m_level[i] is the index of the first node on level 'i', with
+  //   an extra entry at the end equal to the number of nodes
+  std::vector<u32> m_level;
+
+  std::unordered_map<EntityId, u32> m_index;
+
+  // Set when nodes were added/removed since the last rebuild()
+  bool m_needs_rebuild;
+  // Set when any node is dirty
+  bool m_dirty;
+};
+
+}
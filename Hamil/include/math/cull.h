@@ -0,0 +1,53 @@
+#pragma once
+
+#include <math/geometry.h>
+#include <math/frustum.h>
+
+// Batched versions of the frustum3 tests and AABB transforms
+//   which process many objects per call
+//  - The objects are passed in as structures of arrays (SoA),
+//    which lets the tests be done for 8 (with AVX) or
+//    4 (with SSE) objects at a time
+//  - The results are written out as bitmasks, where bit 'i'
+//    (i.e. bit i%32 of mask[i/32]) corresponds to object 'i'
+//    and 'mask' must have room for cull_mask_size(n) u32s
+
+struct SpheresSoA {
+  const float *x, *y, *z;
+  const float *r;
+};
+
+struct AABBsSoA {
+  const float *min_x, *min_y, *min_z;
+  const float *max_x, *max_y, *max_z;
+};
+
+// Returns the number of u32s needed to store a mask for 'n' objects
+inline size_t cull_mask_size(size_t n)
+{
+  return (n + 31) / 32;
+}
+
+inline bool cull_mask_test(const u32 *mask, size_t idx)
+{
+  return (mask[idx / 32] >> (idx % 32)) & 1;
+}
+
+// Sets the bit of every sphere which is (at least partially) inside
+//   the frustum, same as frustum3::sphereInside()
+//  - The spheres must be in world space
+void frustum_spheres_inside(const frustum3& frustum, const SpheresSoA& spheres, size_t n, u32 *mask);
+
+// Sets the bit of every AABB which is (at least partially) inside
+//   the frustum, same as frustum3::aabbInside()
+//  - The AABBs must be in world space
+void frustum_aabbs_inside(const frustum3& frustum, const AABBsSoA& aabbs, size_t n, u32 *mask);
+
+// Returns the AABB which bounds 'aabb' after transforming it by 'm'
+//   using Arvo's method (see Graphics Gems, "Transforming
+//   Axis-Aligned Bounding Boxes")
+AABB aabb_transform(const mat4& m, const AABB& aabb);
+
+// Writes aabb_transform(m[i], aabbs[i]) to out[i] for 'n' AABBs
+//   - 'aabbs' and 'out' can point to the same array
+void aabbs_transform(const mat4 *m, const AABB *aabbs, AABB *out, size_t n);
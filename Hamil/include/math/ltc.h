@@ -5,6 +5,10 @@
 
 #include <array>
 
+namespace sched {
+class WorkerPool;
+}
+
 namespace ltc {
 
 // All LTC fitting related code (so ltc.h, brdf.h and neldermead.h) based on:
@@ -50,6 +54,9 @@ public:
 
   enum {
     NumSamples = 32,
+
+    // Number of Jobs fit() splits the table's rows between
+    NumJobs = 8,
   };
 
   // Stores half-precision floats
@@ -60,18 +67,38 @@ public:
   LTC_CoeffsTable(LTC_CoeffsTable&& other);
   ~LTC_CoeffsTable();
 
-  LTC_CoeffsTable& fit(const brdf::BRDF_GGX& brdf);
+  // Fits an LTC to 'brdf' for every (roughness, theta) cell of the table
+  //   - Each cell's fit is seeded with the one of its neighbour, so
+  //     the first column (theta == 0, where each cell depends on the
+  //     one with the previous roughness) is always fit serially, after
+  //     which every row (which only depends on its first cell) can be
+  //     fit independently
+  //  - When 'pool' != nullptr the rows are fit by NumJobs Jobs
+  //    scheduled on it, the result is identical to a serial fit()
+  //  - Only the 'extent.x' rows with the highest roughness and the
+  //    first 'extent.y' cells of each are fit (which don't depend
+  //    on any of the others), the rest of the table is left as-is
+  LTC_CoeffsTable& fit(const brdf::BRDF_GGX& brdf, sched::WorkerPool *pool = nullptr,
+    uvec2 extent = TableSize);
 
   // LTC transform matrix coefficients
   const CoeffsArray& coeffs1() const;
   const CoeffsArray& coeffs2() const;
 
 private:
+  // Stores the parts of computeError() which don't depend
+  //   on the LTC being fit (defined in ltc.cpp)
+  struct ErrorSamples;
+
+  // Fits the cell with roughness index 'a' and theta index 't'
+  //   using 'ltc' as the first guess when t > 0
+  void fitCell(LTC& ltc, const brdf::BRDF_GGX& brdf, unsigned a, unsigned t);
+
   void averageTerms(const brdf::BRDF_GGX& brdf, const vec3& V, float alpha,
     float& norm, float& fresnel, vec3& avg_dir);
 
   float computeError(const LTC& ltc, const brdf::BRDF_GGX& brdf,
-    const vec3& V, float alpha);
+    const vec3& V, float alpha, const ErrorSamples& samples);
 
   void fitOne(LTC& ltc, const brdf::BRDF_GGX& brdf,
     const vec3& V, float alpha, float eps = 0.05f, bool isotropic = false);
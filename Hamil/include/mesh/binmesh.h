@@ -0,0 +1,193 @@
+#pragma once
+
+#include <mesh/loader.h>
+
+#include <math/geometry.h>
+
+#include <vector>
+
+namespace os {
+class File;
+}
+
+namespace mesh {
+
+class ObjLoader;
+
+// Layout of a binary mesh (*.hmesh) file:
+//     BinMeshHeader
+//     BinSubmesh[BinMeshHeader::num_submeshes]
+//     vertices           (interleaved, see BinMeshLoader::vertexFormat())
+//     indices            (BinMeshHeader::index_size bytes each)
+//     occluder vertices  (vec3[BinMeshHeader::num_occluder_verts])
+//     occluder indices   (u16[BinMeshHeader::num_occluder_inds])
+//   - All offsets are relative to the beginning of the file
+//   - The vertices and indices are aligned to BinMeshDataAlign,
+//     so they can be uploaded to the GPU straight from a mapping
+//   - The vertices are interleaved in the following order:
+//         position (f32 x3)
+//         normal   (f32 x3 or f16 x4 when HalfFloat is set)
+//         texcoord (f32 x2 or f16 x2 when HalfFloat is set)
+//     where only the attributes in 'vertex_components' are present
+struct BinMeshHeader {
+  enum : u32 {
+    Magic   = 0x48534D48,  // 'HMSH'
+    Version = 1,
+  };
+
+  enum Flags : u32 {
+    // Normals and texture coordinates are stored as f16
+    HalfFloat = 1<<0,
+  };
+
+  u32 magic;
+  u32 version;
+
+  u32 flags;
+  u32 vertex_components;  // mesh::Mesh::VertexComponent
+
+  u32 vertex_stride;
+  u32 index_size;         // 2 or 4
+
+  u32 num_submeshes;
+  u32 num_verts;
+  u32 num_inds;
+
+  u32 num_occluder_verts;
+  u32 num_occluder_inds;
+  u32 reserved_;
+
+  float aabb_min[3];
+  float aabb_max[3];
+
+  u64 vertex_offset;
+  u64 index_offset;
+  u64 occluder_offset;
+};
+
+// Corresponds to a single ObjMesh of the source *.obj
+struct BinSubmesh {
+  u32 first_index;
+  u32 num_inds;
+
+  float aabb_min[3];
+  float aabb_max[3];
+};
+
+static_assert(sizeof(BinMeshHeader) == 12*sizeof(u32) + 6*sizeof(float) + 3*sizeof(u64),
+    "BinMeshHeader must be tightly packed!");
+static_assert(sizeof(BinSubmesh) == 2*sizeof(u32) + 6*sizeof(float),
+    "BinSubmesh must be tightly packed!");
+
+enum : size_t {
+  BinMeshDataAlign = 16,
+};
+
+// Loads meshes baked by a BinMeshBuilder (see the '--bake-meshes'
+//   command line option), which requires no parsing - the vertices
+//   and indices are uploaded to the GPU as-is
+//  - Only the header, submeshes and occluder are copied by load(),
+//    the vertices and indices are read straight from the buffer
+//    passed to loadParams() during stream<Indexed>()
+class BinMeshLoader : public MeshLoader {
+public:
+  // Also thrown when a submesh or index lies outside
+  //   of the mesh's indices or vertices respectively
+  struct InvalidBinMeshError : public ParseError { };
+
+  // Thrown by streamIndexed()/streamPooled() when the VertexFormat's vertex
+  //   size doesn't match the one of the baked vertices
+  struct VertexFormatMismatchError : public Error { };
+
+  virtual bool loaded() const;
+
+  // Returns a VertexFormat which matches the layout of the
+  //   baked vertices (valid only after load())
+  virtual gx::VertexFormat vertexFormat() const;
+
+  virtual uint numSubmeshes() const;
+  virtual Submesh submesh(uint idx) const;
+
+  virtual void positions(std::vector<vec3>& verts, std::vector<u32>& inds) const;
+
+  const BinMeshHeader& header() const;
+
+  AABB aabb() const;
+
+  // A simplified mesh which can be used as a VisibilityObject::Occluder
+  //   - Both vectors are empty when the mesh doesn't have one
+  const std::vector<vec3>& occluderVertices() const;
+  const std::vector<u16>& occluderIndices() const;
+
+protected:
+  virtual MeshLoader& doLoad(const void *data, size_t sz);
+
+  virtual MeshLoader& initBuffers(const gx::VertexFormat& fmt, gx::BufferHandle verts);
+  virtual MeshLoader& initBuffers(const gx::VertexFormat& fmt,
+    gx::BufferHandle verts, gx::BufferHandle inds);
+
+  virtual MeshLoader& doStream(const gx::VertexFormat& fmt, gx::BufferHandle verts);
+  virtual MeshLoader& doStreamIndexed(const gx::VertexFormat& fmt,
+    gx::BufferHandle verts, gx::BufferHandle inds);
+
+  virtual MeshLoader& doStreamPooled(const gx::VertexFormat& fmt,
+    std::vector<byte>& verts, std::vector<u32>& inds);
+
+private:
+  // Returns the baked index at position 'idx'
+  //   regardless of it's size
+  u32 index(u32 idx) const;
+
+  BinMeshHeader m_header;
+  bool m_loaded = false;
+
+  const byte *m_verts = nullptr;
+  const byte *m_inds = nullptr;
+
+  std::vector<BinSubmesh> m_submeshes;
+
+  std::vector<vec3> m_occluder_verts;
+  std::vector<u16> m_occluder_inds;
+};
+
+// Bakes a mesh into the *.hmesh format
+class BinMeshBuilder {
+public:
+  enum Flags : uint {
+    Default = 0,
+
+    // Store normals and texture coordinates as f16
+    HalfFloat = 1<<0,
+  };
+
+  struct Error { };
+
+  // The ObjLoader wasn't loaded with ObjLoader::Normalize
+  struct NotNormalizedError : public Error { };
+  // The occluder has too many vertices to use u16 indices
+  struct OccluderTooLargeError : public Error { };
+
+  // Takes all of the ObjMeshes (as submeshes) and
+  //   the vertex attributes from 'obj'
+  //  - 'obj' MUST be normalized
+  BinMeshBuilder& fromObj(const ObjLoader& obj, uint flags = Default);
+
+  // Sets the triangle mesh used as the occluder proxy
+  BinMeshBuilder& occluder(std::vector<vec3> verts, std::vector<u16> inds);
+
+  // Returns the size of the written file in bytes
+  size_t write(os::File& file);
+
+private:
+  BinMeshHeader m_header;
+
+  std::vector<BinSubmesh> m_submeshes;
+
+  std::vector<byte> m_verts;
+  std::vector<u32> m_inds;
+
+  std::vector<vec3> m_occluder_verts;
+  std::vector<u16> m_occluder_inds;
+};
+
+}
@@ -2,8 +2,7 @@
 
 #include <common.h>
 
-#include <map>
-#include <set>
+#include <vector>
 #include <array>
 #include <memory>
 #include <functional>
@@ -44,24 +43,35 @@ struct HalfEdge {
   Index edge;
 };
 
-// TODO: Broken as of now!
+// Built from a list of triangles in O(n) time
+//   - The halfedges of face 'f' are stored at indices
+//     [f*3, f*3+3) in the order v0->v1, v1->v2, v2->v0,
+//     followed by the halfedges on the mesh's boundary
+//     (for which HalfEdge::face == HalfEdge::None)
+//   - The neighbours of each vertex are additionally stored
+//     contiguously (CSR-style), so walking them doesn't
+//     require chasing the HalfEdge::next pointers and
+//     halfedge(a, b) only has to scan the neighbours of 'a'
 class HalfEdgeStructure {
 public:
-  using EdgeSet   = std::set<HalfEdge::Edge>;
   using Edges     = std::vector<HalfEdge::Edge>;
   using Faces     = std::vector<HalfEdge::Face>;
   using HalfEdges = std::vector<HalfEdge>;
 
   using IndexVector = std::vector<HalfEdge::Index>;
 
-  using DirectedEdgeMap = std::map<HalfEdge::Edge, HalfEdge::Index>;
-
   struct Error {
   };
 
   struct ButterflyVertexError : public Error {
   };
 
+  // Thrown when the same directed edge is shared by more
+  //   than one face (i.e. the edge is non-manifold or
+  //   the faces' winding is inconsistent)
+  struct NonManifoldEdgeError : public Error {
+  };
+
   struct InvalidQueryError : public Error {
   };
 
@@ -73,6 +83,18 @@ public:
   //   to actually build the half-edge structure
   void build(size_t num_verts);
 
+  size_t numFaces() const;
+  size_t numEdges() const;
+  size_t numHalfEdges() const;
+
+  const HalfEdge::Face& face(HalfEdge::Index idx) const;
+  // Returns the undirected edge with the given index
+  //   (where Edge::first < Edge::second)
+  const HalfEdge::Edge& edge(HalfEdge::Index idx) const;
+
+  const HalfEdge& halfedge(HalfEdge::Index idx) const;
+  // Returns the halfedge going from vertex 'a' to vertex 'b'
+  //   - Throws InvalidQueryError if the vertices aren't adjacent
   const HalfEdge& halfedge(HalfEdge::Vertex a, HalfEdge::Vertex b) const;
 
   using VertexVisitor = std::function<void(HalfEdge::Vertex)>;
@@ -82,19 +104,22 @@ public:
   void walkFaceNeighbours(HalfEdge::Vertex v, FaceVisitor visitor) const;
 
 private:
-  // Intermediate structures
-  std::unique_ptr<EdgeSet> m_edge_set;
   Edges m_edges;
-
   Faces m_faces;
 
   HalfEdges m_halfedges;
 
-  IndexVector m_vert_he;
+  IndexVector m_vert_he;   // Outgoing halfedge (on the boundary when possible)
   IndexVector m_face_he;
   IndexVector m_edge_he;
 
-  DirectedEdgeMap m_edge_to_halfedge;
+  // For vertex 'v' the neighbouring vertices and the halfedges going
+  //   to them are stored at [m_vert_offsets[v], m_vert_offsets[v+1])
+  //   in 'm_vert_neighbours' and 'm_vert_halfedges' respectively (in
+  //   the order they'd be encountered when walking around the vertex)
+  IndexVector m_vert_offsets;
+  IndexVector m_vert_neighbours;
+  IndexVector m_vert_halfedges;
 };
 
-}
\ No newline at end of file
+}
@@ -6,8 +6,11 @@
 #include <sched/job.h>
 #include <gx/vertex.h>
 #include <gx/buffer.h>
+#include <gx/meshpool.h>
+#include <math/geometry.h>
 
 #include <memory>
+#include <vector>
 #include <functional>
 
 namespace mesh {
@@ -27,9 +30,38 @@ public:
 
   using OnLoadedFn = std::function<void(MeshLoader&)>;
 
+  // A range of indices, in the order in which they are emitted
+  //   by streamIndexed()/streamPooled(), which makes up a single
+  //   object (ObjMesh, BinSubmesh...) of the mesh
+  struct Submesh {
+    u32 first_index;
+    u32 num_inds;
+
+    AABB aabb;
+  };
+
+  virtual ~MeshLoader() = default;
+
   // Uses the loadParams()
   MeshLoader& load();
 
+  // Returns 'true' when the mesh has already been loaded
+  virtual bool loaded() const = 0;
+
+  // The methods below are valid only after load()
+
+  // Returns a VertexFormat matching the native layout of
+  //   the mesh's vertices (the one used by streamPooled()
+  //   when no VertexFormat is given)
+  virtual gx::VertexFormat vertexFormat() const = 0;
+
+  virtual uint numSubmeshes() const = 0;
+  virtual Submesh submesh(uint idx) const = 0;
+
+  // Fills 'verts' with the positions of all the vertices and
+  //   'inds' with the indices of all the Submeshes
+  virtual void positions(std::vector<vec3>& verts, std::vector<u32>& inds) const = 0;
+
   // Stores 'data' pointer for async loading in stream<Indexed>()
   MeshLoader& loadParams(const void *data, size_t sz);
 
@@ -44,6 +76,28 @@ public:
   StreamJobPtr streamIndexed(const gx::VertexFormat& fmt,
     gx::BufferHandle verts, gx::BufferHandle inds);
 
+  // Unpacks the Meshes vertices (based on 'fmt') and it's
+  //   indices into memory, so they can later be copied into
+  //   a gx::MeshPool by upload()
+  //  - Calls load() if the mesh hasn't been loaded yet
+  //  - Nothing here touches OpenGL so the job can be scheduled
+  //    on any WorkerPool
+  //  - The returned StreamJobPtr must be passed directly
+  //    to WorkerPool::scheduleJob()
+  StreamJobPtr streamPooled(const gx::VertexFormat& fmt);
+  // Same as streamPooled(fmt), except the vertices are
+  //   unpacked according to vertexFormat()
+  StreamJobPtr streamPooled();
+
+  // Allocates room for the vertices and indices unpacked by
+  //   streamPooled() in 'pool' and uploads them, after which
+  //   the unpacked copies are freed
+  //  - MUST be called on the GL thread once the job returned
+  //    from streamPooled() is done
+  //  - Returns an invalid Allocation when there was nothing
+  //    to upload
+  gx::MeshPool::Allocation upload(gx::MeshPool& pool);
+
   MeshLoader& onLoaded(OnLoadedFn fn);
 
 protected:
@@ -51,14 +105,14 @@ protected:
   virtual MeshLoader& doLoad(const void *data, size_t sz) = 0;
 
   // Calls Buffer::init() with mesh-dependent parameters
-  //   - Stubbed out when the Mesh format is indexed-only
   virtual MeshLoader& initBuffers(const gx::VertexFormat& fmt, gx::BufferHandle verts) = 0;
   // Calls Buffer::init() with mesh-depentent parameters
   virtual MeshLoader& initBuffers(const gx::VertexFormat& fmt,
     gx::BufferHandle verts, gx::BufferHandle inds) = 0;
 
   // - Calls load() if the mesh hasn't been loaded yet
-  // - Stubbed out when the Mesh format is indexed-only
+  // - The vertices of all the faces are written out in
+  //   order, so the indices aren't needed to draw them
   virtual MeshLoader& doStream(const gx::VertexFormat& fmt,  gx::BufferHandle verts) = 0;
   // - Calls load() when mesh hasn't been loaded yet
   // TODO: for now the format of the vertices is hard-coded into the
@@ -66,10 +120,22 @@ protected:
   virtual MeshLoader& doStreamIndexed(const gx::VertexFormat& fmt,
     gx::BufferHandle verts, gx::BufferHandle inds) = 0;
 
+  // - Calls load() when mesh hasn't been loaded yet
+  // - Fills 'verts' with the vertices laid out according to
+  //   'fmt' and 'inds' with the indices of all the meshes,
+  //   in the same order as doStreamIndexed()
+  virtual MeshLoader& doStreamPooled(const gx::VertexFormat& fmt,
+    std::vector<byte>& verts, std::vector<u32>& inds) = 0;
+
 private:
   const void *m_data = nullptr;
   size_t m_sz = ~0ull;
 
+  // Filled by streamPooled() and consumed by upload()
+  gx::VertexFormat m_pooled_fmt;
+  std::vector<byte> m_pooled_verts;
+  std::vector<u32> m_pooled_inds;
+
   OnLoadedFn m_on_loaded;
 };
 
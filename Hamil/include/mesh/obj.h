@@ -1,12 +1,18 @@
 #pragma once
 
 #include <mesh/loader.h>
+#include <mesh/optimize.h>
 
 #include <math/geometry.h>
 
 #include <string>
 #include <array>
 #include <vector>
+#include <unordered_map>
+
+namespace sched {
+class WorkerPool;
+}
 
 namespace mesh {
 
@@ -81,9 +87,38 @@ public:
     // Make sure  that for every triangle
     //     v == vn == vt  (where v,vn,vt != None)
     Normalize = 1<<0,
+
+    // Call optimize() after loading (implies Normalize)
+    Optimize = 1<<1,
   };
 
   ObjLoader& load(const void *data, size_t sz, uint /* LoadFlags */ flags = Default);
+  // Same as load(), except large files are split into chunks
+  //   which are parsed in parallel on the 'pool's workers
+  //  - MUST NOT be called from one of the 'pool's workers
+  ObjLoader& load(sched::WorkerPool& pool, const void *data, size_t sz,
+      uint /* LoadFlags */ flags = Default);
+
+  // Reorders the faces of every ObjMesh for the post-transform vertex
+  //   cache and then renumbers the vertices in order of their first
+  //   use (see mesh/optimize.h for both)
+  //  - Normalizes the meshes first if needed
+  //  - Returns the vertex cache statistics of all the meshes
+  //    combined from before and after the optimization
+  OptimizeStats optimize(uint /* OptimizeFlags */ flags = OptimizeDefault);
+
+  // Returns 'true' once the file has been parsed
+  virtual bool loaded() const;
+
+  // Position (f32 x3), followed by the normal (f32 x3) and
+  //   texture coordinate (f32 x2) when they're present
+  virtual gx::VertexFormat vertexFormat() const;
+
+  // Every ObjMesh is a Submesh
+  virtual uint numSubmeshes() const;
+  virtual Submesh submesh(uint idx) const;
+
+  virtual void positions(std::vector<vec3>& verts, std::vector<u32>& inds) const;
 
   // Returns the number of objects in the *.obj file
   size_t numMeshes() const;
@@ -121,36 +156,44 @@ protected:
   virtual MeshLoader& doStreamIndexed(const gx::VertexFormat& fmt,
     gx::BufferHandle verts, gx::BufferHandle inds);
 
+  virtual MeshLoader& doStreamPooled(const gx::VertexFormat& fmt,
+    std::vector<byte>& verts, std::vector<u32>& inds);
+
 private:
+  enum : size_t {
+    // Files are split into line-aligned chunks of roughly
+    //   this size when parsed on a WorkerPool
+    ParseChunkSize = 4*1024*1024,
+
+    NumParseJobs = 8,
+  };
+
+  // Data parsed from a line-aligned chunk of the file
+  struct ParsedChunk;
+
+  // Parses the file, splitting it into chunks parsed
+  //   on 'pool's workers when it's != nullptr
+  void parse(const char *data, size_t sz, sched::WorkerPool *pool);
+
+  // Parses the lines in [begin, end) into 'chunk'
+  //   - Throws ParseError or NonTriangularFaceError
+  static void parseChunk(const char *begin, const char *end, ParsedChunk& chunk);
+
+  // Appends a chunk's attributes and faces (to the
+  //   proper ObjMeshes) in order of appearance
+  void mergeChunk(ParsedChunk& chunk);
+
   // Appends a new ObjMesh to 'm_meshes' and returns a
   //   pointer to it (do NOT keep it around as
   //   it can become invalidated after another call
   //   to this method)
   ObjMesh *appendMesh(const std::string& name = "");
 
-  // Processes a single line of the file
-  //   - The line must start with an *.obj command
-  //     (i.e. caller must take care of skipping
-  //     whitespace)
-  void parseLine(std::string::const_iterator it);
-
-  // Implements 'o' command
-  std::string loadName(std::string::const_iterator it);
-
-  // Helper for load<Vertex,TexCoord,Normal>()
-  vec3 loadVec3(std::string::const_iterator it);
-
-  // Implements 'v' command
-  vec3 loadVertex(std::string::const_iterator it);
-  // Implements 'vt' command
-  vec3 loadTexCoord(std::string::const_iterator it);
-  // Implements 'vn' command
-  vec3 loadNormal(std::string::const_iterator it);
-
-  // Implements 'f' command
-  //   - Throws MeshLoader::NonTriangularFaceError when
-  //     a face with > 3 vertices is encountered
-  ObjMesh::Triangle loadTriangle(std::string::const_iterator it);
+  // Computes the AABBs of all the ObjMeshes
+  //   - Throws ParseError if a face references
+  //     a vertex, texture coordinate or normal
+  //     which doesn't exist
+  void computeAABBs();
 
   // Ensures that, for every face, v == vn == vt
   //   - Useful to allow the mesh to be used
@@ -160,8 +203,30 @@ private:
   //     this method
   void normalizeMeshes();
 
+  struct VertexHash {
+    size_t operator()(const ObjMesh::Vertex& v) const;
+  };
+  struct VertexEqual {
+    bool operator()(const ObjMesh::Vertex& a, const ObjMesh::Vertex& b) const;
+  };
+
+  // Maps un-normalized vertices to their normalized indices
+  using VertexMap = std::unordered_map<ObjMesh::Vertex, uint, VertexHash, VertexEqual>;
+
   // Called by normalizeMeshes()
-  void normalizeOne(ObjMesh& mesh);
+  //   - Un-normalized vertices which have already been
+  //     seen (i.e. are in 'remap') reuse the same index
+  void normalizeOne(ObjMesh& mesh, VertexMap& remap);
+
+  // Loads and normalizes the meshes if that
+  //   hasn't been done yet
+  void ensureNormalized();
+
+  // Interleaves the (normalized) vertex attributes
+  //   into 'verts' according to 'fmt'
+  //  - 'verts' must have room for vertices().size()
+  //    vertices
+  void unpackVertices(const gx::VertexFormat& fmt, byte *verts) const;
 
   // After load() this flag will be == false
   //   if normalizeMeshes() needs to be called
@@ -174,7 +239,7 @@ private:
   std::vector<vec3> m_vt;
   std::vector<vec3> m_vn;
 
-  // Incremented by loadTriangle()
+  // Incremented for every face vertex appended to the meshes
   size_t m_current_offset;
 
   // List of objects loaded from the file
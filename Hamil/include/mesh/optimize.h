@@ -0,0 +1,89 @@
+#pragma once
+
+#include <common.h>
+
+#include <math/geometry.h>
+
+#include <vector>
+
+namespace mesh {
+
+// All of the functions below operate on triangle lists,
+//   where 'inds' points to 'num_inds' (a multiple of 3)
+//   indices which are all < 'num_verts'
+//  - When many meshes share a single vertex array each
+//    one should be optimized separately, as the triangles
+//    are only ever reordered within 'inds'
+
+enum : uint {
+  // Number of entries in the FIFO cache simulated
+  //   by vertex_cache_stats() and tipsify()
+  DefaultVertexCacheSize = 16,
+};
+
+struct VertexCacheStats {
+  // Average Cache Miss Ratio - number of vertices transformed per
+  //   triangle (from 3.0 down to ~0.5 for very regular meshes)
+  float acmr = 0.0f;
+  // Average Transformed Vertex Ratio - number of vertices transformed
+  //   per vertex referenced by the mesh (1.0 is optimal)
+  float atvr = 0.0f;
+};
+
+struct OptimizeStats {
+  VertexCacheStats before, after;
+};
+
+enum OptimizeFlags : uint {
+  OptimizeDefault = 0,
+
+  // Use tipsify() instead of optimize_vertex_cache() and then
+  //   order the resulting clusters with optimize_overdraw()
+  OptimizeOverdraw = 1<<0,
+};
+
+// Simulates a FIFO post-transform cache with 'cache_size' entries
+VertexCacheStats vertex_cache_stats(const u32 *inds, size_t num_inds, size_t num_verts,
+  uint cache_size = DefaultVertexCacheSize);
+
+// Reorders the triangles in-place with Tom Forsyth's
+//   'Linear-Speed Vertex Cache Optimisation', which doesn't
+//   depend on the exact size of the GPU's cache
+void optimize_vertex_cache(u32 *inds, size_t num_inds, size_t num_verts);
+
+// Reorders the triangles in-place for a cache of 'cache_size' entries
+//   with 'Tipsify' (Sander, Nehab, Barczak - 'Fast Triangle Reordering
+//   for Vertex Locality and Reduced Overdraw')
+//  - When 'clusters' != nullptr the index of the first triangle of
+//    every cluster (a run of triangles which doesn't depend on the
+//    previous contents of the cache) is stored in it
+void tipsify(u32 *inds, size_t num_inds, size_t num_verts,
+  uint cache_size = DefaultVertexCacheSize, std::vector<u32> *clusters = nullptr);
+
+// Reorders the 'clusters' (as returned by tipsify()) in-place so the ones
+//   facing away from the mesh's centroid are drawn first, which makes
+//   them occlude the rest of the mesh from most view directions
+//  - Clusters are first split where their ACMR drops below the mesh's
+//    ACMR times 'threshold', which bounds how much the vertex cache
+//    efficiency is degraded, though only loosely - clusters which never
+//    get below it start cold wherever they end up (expect ~5-10% on top)
+//  - 'positions' must point to 'num_verts' vertex positions
+void optimize_overdraw(u32 *inds, size_t num_inds, StridePtr<vec3> positions, size_t num_verts,
+  const std::vector<u32>& clusters, float threshold = 1.05f, uint cache_size = DefaultVertexCacheSize);
+
+// Renumbers the vertices in-place in order of their first use in 'inds'
+//   and returns a table mapping the old vertex indices to the new ones
+//   which must be passed to remap_vertices() for every vertex attribute
+//  - Vertices not referenced by 'inds' are moved to the end
+std::vector<u32> optimize_vertex_fetch(u32 *inds, size_t num_inds, size_t num_verts);
+
+template <typename T>
+void remap_vertices(std::vector<T>& verts, const std::vector<u32>& remap)
+{
+  std::vector<T> remapped(verts.size());
+  for(size_t i = 0; i < verts.size(); i++) remapped[remap[i]] = verts[i];
+
+  verts = std::move(remapped);
+}
+
+}
@@ -4,14 +4,21 @@
 #include <res/resource.h>
 
 #include <unordered_map>
+#include <list>
 #include <memory>
 #include <optional>
 
 namespace res {
 
+// Stores loaded Resources, keeping track of the total number
+//   of bytes they occupy (see Resource::residentSize())
+//  - When the total exceeds the cache's budget, least recently
+//    used Resources which aren't referenced outside of the cache
+//    are evicted (Static caches never evict), after which they
+//    have to be re-loaded via ResourceManager::load()
+//  - NOT thread-safe, all access must be done on a single thread
 class ResourceCache {
 public:
-  using Map = std::unordered_map<Resource::Id, Resource::Ptr>;
   using ResourcePtr = std::weak_ptr<Resource>;
 
   enum Type {
@@ -20,16 +27,62 @@ public:
     NumTypes,
   };
 
-  ResourceCache(Type type);
+  enum : size_t {
+    NoBudget = ~0ull,
+  };
+
+  struct Stats {
+    size_t hits = 0, misses = 0;
+    size_t evictions = 0;
+
+    size_t num_resources = 0;
+    size_t resident_bytes = 0;
+  };
 
+  ResourceCache(Type type, size_t budget = NoBudget);
+
+  // Marks the Resource as most recently used
   std::optional<ResourcePtr> probe(Resource::Id id);
+  // Can evict Resources to stay within the budget
+  //   (but never the one being inserted)
   ResourcePtr fill(const Resource::Ptr& r);
 
+  // Sets the budget (in bytes) and evicts Resources
+  //   until the cache fits in it
+  ResourceCache& budget(size_t budget);
+  size_t budget() const;
+
+  // Evicts unreferenced Resources (least recently used first)
+  //   until resident bytes <= budget() and returns the number
+  //   of evicted Resources
+  //  - Resources can grow after being inserted, so the
+  //    accounting is refreshed for all of them first
+  size_t trim();
+
+  const Stats& stats() const;
+
 private:
+  struct Entry {
+    Resource::Ptr r;
+    size_t size;
+  };
+
+  // Front == most recently used
+  using LRUList = std::list<Entry>;
+  using Map = std::unordered_map<Resource::Id, LRUList::iterator>;
+
+  // Evicts until resident bytes <= m_budget, skipping 'keep'
+  size_t evict(const Resource *keep);
+
   Type m_type;
+  size_t m_budget;
+
+  LRUList m_lru;
   Map m;
+
+  Stats m_stats;
 };
 
 using ResourceHandle = ResourceCache::ResourcePtr;
 
-}
\ No newline at end of file
+}
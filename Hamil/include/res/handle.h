@@ -4,6 +4,8 @@
 #include <res/resource.h>
 #include <res/cache.h>
 
+#include <memory>
+
 namespace res {
 
 class HandleBase {
@@ -11,27 +13,44 @@ public:
   HandleBase(Resource::Id id);
 
 protected:
-  Resource::Ptr& lock();
+  // Re-loads the resource if it was evicted and returns
+  //   nullptr when that fails
+  Resource::Ptr lock();
+
+  Resource::Id m_id;
 
   ResourceHandle m;
-  Resource::Ptr m_locked;
 };
 
 // The resource is acquired through ResourceManager::handle(),
 //   which means it must've been previously ResourceManager::load()'ed
 //   or a NoSuchResourceError will be thrown
+//  - When the resource gets evicted from the ResourceCache (either
+//    before or after the Handle is created) it's transparently
+//    re-loaded
+//  - The Handle itself doesn't keep the resource from being
+//    evicted, only the references returned by lock() (and
+//    the temporary ones created by operator->(), which last
+//    until the end of the full-expression) do
 // Only to be used after res::init()
 template <typename T>
 class Handle : public HandleBase {
 public:
   using HandleBase::HandleBase;
 
-  // Returns 'nullptr' if the resource has expired
-  T *operator->()
+  // Returns 'nullptr' if the resource couldn't be re-loaded
+  std::shared_ptr<T> lock()
   {
-    if(auto& r = lock()) return r->template as<T>();
+    auto r = HandleBase::lock();
+    if(!r || !r->template as<T>()) return nullptr;
 
-    return nullptr;
+    return std::static_pointer_cast<T>(r);
+  }
+
+  // Returns 'nullptr' if the resource couldn't be re-loaded
+  std::shared_ptr<T> operator->()
+  {
+    return lock();
   }
 };
 
@@ -37,6 +37,8 @@ public:
     return (T *)m_data;
   }
 
+  virtual size_t residentSize() const;
+
 protected:
   using Resource::Resource;
 
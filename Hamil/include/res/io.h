@@ -34,8 +34,21 @@ public:
   void *get();
   template <typename T> T *get() { return (T *)get(); }
 
+  const void *get() const;
+  template <typename T> const T *get() const { return (const T *)get(); }
+
   // Returns the size of the underlying data
   size_t size() const;
+  // Returns the number of bytes of heap memory viewed by this
+  //   IOBuffer, i.e. size() for ones backed by a regular buffer
+  //   and 0 for file views (the page cache backs those and can
+  //   drop their pages whenever it needs to)
+  size_t ownedSize() const;
+
+  // Returns an IOBuffer which views 'sz' bytes of this one
+  //   starting at 'offset' and shares ownership of the
+  //   underlying data (i.e. no copy is made)
+  IOBuffer slice(size_t offset, size_t sz) const;
 
   // Returns 'true' when the IOBuffer holds valid data
   operator bool() const;
@@ -3,6 +3,7 @@
 #include <common.h>
 #include <res/resource.h>
 #include <res/io.h>
+#include <res/metacache.h>
 #include <os/error.h>
 #include <os/mutex.h>
 
@@ -10,6 +11,9 @@
 #include <unordered_map>
 #include <tuple>
 #include <memory>
+#include <optional>
+#include <vector>
+#include <deque>
 
 namespace os {
 class FileQuery;
@@ -25,8 +29,8 @@ namespace res {
 enum LoadFlags : int {
   LoadDefault = 0,        // Load the resource immediately
   LoadStatic  = 1<<0,     // Never purge the resource from the cache
-  Precache    = 1<<1,     // Load the recource asynchronously, 
-                          //   check Resource::loaded() to know when loading is done
+  Precache    = 1<<1,     // Load the recource asynchronously (see
+                          //   ResourceManager::loadAsync())
 };
 
 class ResourceManager;
@@ -67,24 +71,27 @@ private:
   ResourceManager *m_man;
 };
 
-// SimpleFsLoader:
-//   - loads assets from the specified folder
-//   - only support synchronous right-now loading (LoadDefault)
-//   - parses the resource-descriptor twice (all of it is slow anyways...)
-class SimpleFsLoader : public ResourceLoader {
+// Base class for loaders which describe resources via *.meta
+//   yaml documents (resource descriptors) and load them based
+//   on the descriptor's 'tag'
+//   - The source of the data a descriptor's 'location' refers
+//     to is defined by the derived class
+class MetaLoader : public ResourceLoader {
 public:
-  SimpleFsLoader(const char *base_path);
+  // Returns the meta's Resource::Tag if it passes validation
+  //   and std::nullopt otherwise
+  static std::optional<Resource::Tag> validate(const yaml::Document& meta);
 
 protected:
-  virtual void doInit();
-  virtual Resource::Ptr doLoad(Resource::Id id, LoadFlags flags);
+  // 'meta' MUST have passed validate()
+  Resource::Ptr loadFromMeta(Resource::Id id, Resource::Tag tag, const yaml::Document& meta);
 
-private:
-  void enumAvailable(std::string path);
-
-  void metaIoCompleted(std::string full_path, IORequest& req);
-  static Resource::Id enumOne(const char *meta_file, size_t sz, const char *full_path = "");
+  // Returns the contents of 'location' read into memory
+  virtual IOBuffer readLocation(Resource::Id id, const yaml::Scalar *location) = 0;
+  // Returns the contents of 'location' mapped into memory (when possible)
+  virtual IOBuffer mapLocation(Resource::Id id, const yaml::Scalar *location) = 0;
 
+private:
   using NamePathTuple = std::tuple<
     const yaml::Scalar* /* name */, const yaml::Scalar* /* path */
   >;
@@ -96,7 +103,7 @@ private:
   static NamePathTuple name_path(const yaml::Document& meta);
   static NamePathLocationTuple name_path_location(const yaml::Document& meta);
 
-  using LoaderFn = Resource::Ptr(SimpleFsLoader::*)(Resource::Id, const yaml::Document&);
+  using LoaderFn = Resource::Ptr(MetaLoader::*)(Resource::Id, const yaml::Document&);
 
   static const std::unordered_map<Resource::Tag, LoaderFn> loader_fns;
 
@@ -106,19 +113,89 @@ private:
   Resource::Ptr loadTexture(Resource::Id id, const yaml::Document& meta);
   Resource::Ptr loadMesh(Resource::Id id, const yaml::Document& meta);
   Resource::Ptr loadLUT(Resource::Id id, const yaml::Document& meta);
+};
+
+// SimpleFsLoader:
+//   - loads assets from the specified folder
+//   - only support synchronous right-now loading (LoadDefault)
+//   - compiled resource-descriptors are kept in a MetaCache
+//     (stored in the base folder), so the yaml parser only
+//     runs for new or edited *.meta files
+class SimpleFsLoader : public MetaLoader {
+public:
+  enum Flags : uint {
+    Default = 0,
+
+    // Defer enumerating the *.meta files until the first
+    //   load(), for when the loader is only a fallback
+    //   which might never be needed (see res::init())
+    EnumOnDemand = 1<<0,
+  };
+
+  // Name of the MetaCache file stored in 'base_path'
+  static constexpr const char *MetaCacheFile = "meta.cache";
+
+  SimpleFsLoader(const char *base_path, uint /* Flags */ flags = Default);
+
+protected:
+  virtual void doInit();
+  virtual Resource::Ptr doLoad(Resource::Id id, LoadFlags flags);
+
+  virtual IOBuffer readLocation(Resource::Id id, const yaml::Scalar *location);
+  virtual IOBuffer mapLocation(Resource::Id id, const yaml::Scalar *location);
+
+private:
+  // Enumerates all the available resources and saves the
+  //   MetaCache if it's been modified
+  //   - Only the first call does any work
+  void ensureEnumerated();
+
+  // Walks the directory tree starting at 'base_path' and kicks off
+  //   reads of all the *.meta files found along the way, which are
+  //   then parsed on the IO workers (see metaIoCompleted()), so
+  //   traversal, IO and parsing all overlap
+  //   - Blocks until all the reads have completed
+  void enumAvailable(const std::string& base_path);
+  // Waits for the oldest in-flight reads until at most
+  //   'max_in_flight' remain
+  void retireMetaReads(size_t max_in_flight);
+
+  void metaIoCompleted(std::string full_path, IORequest& req);
+  // Parses 'meta_file' into 'meta' and returns the descriptor's guid
+  static Resource::Id enumOne(const char *meta_file, size_t sz, yaml::Document& meta,
+      const char *full_path = "");
+
+  struct AvailableMeta {
+    IOBuffer meta_file;
+    MetaCache::Key cache_key;
+  };
 
   std::string m_path;
+  uint m_flags;
+
+  // Serializes ensureEnumerated(), as with EnumOnDemand
+  //   load() can be called on multiple threads before
+  //   the enumeration has been done
+  os::Mutex::Ptr m_enum_mutex;
+  bool m_enumerated = false;
 
   // enumAvailable() kicks off IORequests which after completion
   //   call metaIoCompleted() which inserts into m_available. Because
   //   it can be called on multiple threads simultaneously a Mutex
   //   is needed
   os::Mutex::Ptr m_available_mutex;
-  std::unordered_map<Resource::Id, IOBuffer /* meta_file */>  m_available;
+  std::unordered_map<Resource::Id, AvailableMeta>  m_available;
+
+  MetaCache m_meta_cache;
+
+  enum : size_t {
+    // Every in-flight IORequest holds on to a WorkerPool JobId
+    //   until it's waited on, so the number of them must be bounded
+    MaxInFlightMetaReads = 256,
+  };
 
-  std::vector<IORequest::Ptr> m_io_reqs;   // Declared here to avoid use-after-free
-                                           //   bugs caused by reference invalidation
-                                           //   (see enumAvailable() for details)
+  // The in-flight *.meta file reads, oldest first
+  std::deque<IORequest::Ptr> m_io_reqs;
 };
 
 }
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <common.h>
+#include <res/resource.h>
+#include <res/loader.h>
+#include <res/cache.h>
+
+#include <memory>
+#include <functional>
+#include <atomic>
+
+namespace res {
+
+class ResourceManager;
+
+// Handle to a Resource being loaded in the background,
+//   returned by ResourceManager::loadAsync()
+//  - Requests are serviced in order of their priority (higher
+//    priorities first, ties are broken in FIFO order)
+//  - The Resource is inserted into the cache and the completion
+//    callback is called on the thread which calls
+//    ResourceManager::dispatchLoads() (i.e. the main thread)
+class LoadRequest {
+public:
+  using Ptr = std::shared_ptr<LoadRequest>;
+
+  using Priority = int;
+
+  using LoadComplete = std::function<void(LoadRequest&)>;
+
+  enum Status : int {
+    Queued,     // Waiting for a free streaming worker
+    Loading,    // A streaming worker is loading the Resource
+    Loaded,     // result() can be called
+    Failed,     // No loader could provide the Resource
+    Cancelled,  // cancel() was called before the load started
+  };
+
+  LoadRequest(const LoadRequest&) = delete;
+
+  Resource::Id id() const;
+  LoadFlags flags() const;
+
+  Status status() const;
+  // Returns 'true' when the request is Loaded, Failed or Cancelled
+  bool done() const;
+
+  Priority priority() const;
+  // Moves the request in the queue according to the new
+  //   priority - a no-op when the load has already started
+  LoadRequest& priority(Priority p);
+
+  // Removes the request from the queue and returns 'true',
+  //   or returns 'false' when the load has already started
+  //   (in which case it will complete normally)
+  //  - The completion callback is NOT called for
+  //    cancelled requests
+  bool cancel();
+
+  // Sets a callback called by ResourceManager::dispatchLoads()
+  //   once the request is either Loaded or Failed
+  //  - Must be called on the same thread as dispatchLoads()
+  LoadRequest& onCompleted(LoadComplete fn);
+
+  // Returns a handle to the loaded Resource
+  //   - Can be called ONLY after status() == Loaded
+  ResourceHandle result() const;
+
+  // Orders LoadRequests in a std::*_heap() so the
+  //   one which should be loaded next is at the front
+  struct Order {
+    bool operator()(const Ptr& a, const Ptr& b) const;
+  };
+
+private:
+  friend ResourceManager;
+
+  LoadRequest(ResourceManager *man, Resource::Id id, LoadFlags flags, Priority p, u64 seq);
+
+  ResourceManager *m_man;
+
+  Resource::Id m_id;
+  LoadFlags m_flags;
+
+  std::atomic<Status> m_status = Queued;
+
+  // Both guarded by ResourceManager's streaming queue mutex
+  Priority m_priority;
+  u64 m_seq;   // Order in which the requests were made
+
+  // Written by the streaming worker, consumed
+  //   by ResourceManager::dispatchLoads()
+  Resource::Ptr m_resource;
+
+  ResourceHandle m_handle;
+  LoadComplete m_complete;
+};
+
+}
@@ -32,9 +32,12 @@ public:
   
   DataType type() const;
 
-  void *data();
+  // The data is read-only, as it can be backed by a FileView
+  const void *data() const;
   size_t size() const;
 
+  virtual size_t residentSize() const;
+
 protected:
   using Resource::Resource;
 
@@ -5,11 +5,15 @@
 #include <res/io.h>
 #include <res/loader.h>
 #include <res/cache.h>
+#include <res/loadrequest.h>
 
 #include <sched/pool.h>
+#include <os/mutex.h>
 
 #include <string>
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include <initializer_list>
 #include <memory>
 #include <optional>
@@ -30,7 +34,13 @@ public:
   using Ptr = std::unique_ptr<ResourceManager>;
 
   enum {
-    NumIOWorkers = 2,
+    // The number of IO workers is based on the number of
+    //   hardware threads, clamped to this range
+    MinIOWorkers = 2,
+    MaxIOWorkers = 8,
+
+    // Number of workers which run the loaders for loadAsync()
+    NumStreamingWorkers = 2,
   };
 
   struct Error { };
@@ -43,6 +53,7 @@ public:
   };
 
   ResourceManager(std::initializer_list<ResourceLoader *> loader_chain);
+  ~ResourceManager();
 
   template <typename T>
   static Resource::Id guid(const std::string& name, const std::string& path)
@@ -53,11 +64,38 @@ public:
   }
   static Resource::Id guid(Resource::Tag tag, const std::string& name, const std::string& path);
 
+  // When 'flags' has the Precache bit set this is equivalent
+  //   to calling loadAsync() and returns an empty handle
+  //  - Outstanding loadAsync() requests are cancelled (or
+  //    waited for when in-flight) by ~ResourceManager()
   ResourceHandle load(Resource::Id id, LoadFlags flags = LoadDefault);
+  // Queues the resource to be loaded on the streaming workers
+  //   - The whole loader chain runs on the streaming workers,
+  //     the loaders map their data so the IO is done by the
+  //     page faults taken while decoding it
+  //   - When a request for 'id' is already in-flight it's
+  //     returned instead (with it's priority raised to
+  //     'priority' if it's lower)
+  //   - When the resource is already cached the request
+  //     completes during the next dispatchLoads()
+  LoadRequest::Ptr loadAsync(Resource::Id id, LoadRequest::Priority priority = 0,
+      LoadFlags flags = LoadDefault);
+  // Inserts the resources loaded by the streaming workers into
+  //   the cache and calls the LoadRequests' completion callbacks
+  //   - Should be called once per frame on the main thread
+  ResourceManager& dispatchLoads();
   // Gets handle to an already loaded resource
   //   - throws NoSuchResourceError when it can't be found
   ResourceHandle handle(Resource::Id id);
 
+  // Sets the memory budget (in bytes) of the cache which
+  //   holds non-LoadStatic resources, over which unreferenced
+  //   resources get evicted (there's no budget by default)
+  ResourceManager& memoryBudget(size_t budget);
+  // Returns the hit/miss/eviction counters and
+  //   memory usage of a given cache
+  const ResourceCache::Stats& cacheStats(ResourceCache::Type type) const;
+
   // Kicks off an IORequest
   ResourceManager& requestIo(const IORequest::Ptr& req);
   // Blocks until 'req' completes and returns it's result
@@ -65,18 +103,63 @@ public:
 
   ResourceManager& waitIoIdle();
 
+  // Can be used by the loaders to offload CPU-heavy work
+  //   - Jobs scheduled on the IO workers must NEVER
+  //     wait for other Jobs, to avoid deadlocks
+  sched::WorkerPool& ioWorkers();
+
   // - Returns an IOBuffer backed by a FileView when the location is a '!file'
   IOBuffer mapLocation(const yaml::Scalar *location, size_t offset = 0, size_t sz = 0);
+  // Returns an IOBuffer backed by a FileView of the file at 'path'
+  //   - When 'sz' == 0 the whole file is mapped
+  IOBuffer mapFile(const std::string& path, size_t offset = 0, size_t sz = 0);
 
   static std::optional<Resource::Tag> make_tag(const char *tag);
 
 private:
+  friend LoadRequest;
+
+  static int num_io_workers();
+
+  // Returns nullptr when no loader can provide the resource
+  Resource::Ptr loadFromChain(Resource::Id id, LoadFlags flags);
+
+  // Schedules another streaming Job if there aren't
+  //   already NumStreamingWorkers of them in-flight
+  //   - Must be called with m_stream_mutex held
+  void kickStreamingJob();
+  // Drains m_stream_queue, Fn for the streaming Jobs
+  Unit streamingJob();
+
+  void reprioritizeLoad(LoadRequest& req, LoadRequest::Priority priority);
+  bool cancelLoad(LoadRequest& req);
+
+
   ResourceCache& getCache(LoadFlags flags);
 
   std::vector<ResourceCache> m_caches;
   std::vector<ResourceLoader::Ptr> m_loader_chain;
 
   sched::WorkerPool m_io_workers;
+  sched::WorkerPool m_stream_workers;
+
+  using StreamingJob = std::unique_ptr<sched::Job<Unit>>;
+
+  // Guards all the m_stream_* members below
+  os::Mutex::Ptr m_stream_mutex;
+
+  // Heap of Queued requests ordered by LoadRequest::Order
+  std::vector<LoadRequest::Ptr> m_stream_queue;
+  // All the requests which haven't been dispatched yet
+  std::unordered_map<Resource::Id, LoadRequest::Ptr> m_stream_requests;
+  // Requests waiting for dispatchLoads()
+  std::vector<LoadRequest::Ptr> m_stream_completed;
+
+  // Jobs are reaped (waited on) in dispatchLoads()
+  std::deque<std::pair<sched::WorkerPool::JobId, StreamingJob>> m_stream_jobs;
+  uint m_num_stream_jobs = 0;   // The number of Jobs still draining the queue
+
+  u64 m_stream_seq = 0;
 };
 
 }
\ No newline at end of file
@@ -7,7 +7,9 @@
 #include <win32/file.h>
 #include <mesh/mesh.h>
 #include <mesh/loader.h>
+#include <gx/meshpool.h>
 
+#include <memory>
 #include <optional>
 #include <utility>
 
@@ -37,8 +39,28 @@ public:
   //   if Resource::loaded() == true
   mesh::MeshLoader& loader();
 
+  // Copies the vertices and indices unpacked by loader().streamPooled()
+  //   into 'pool' and points mesh() at the allocated range, so all
+  //   Meshes sharing a VertexFormat are drawn from one IndexedVertexArray
+  //  - MUST be called on the GL thread
+  //  - The range is returned to 'pool' by deallocate() or
+  //    when the Mesh is destroyed (eg. evicted from the
+  //    ResourceCache), unless 'pool' is gone by then
+  Mesh& upload(gx::MeshPool& pool);
+  // Returns the range in the MeshPool passed to upload() (the
+  //   Allocation is invalid before that)
+  const gx::MeshPool::Allocation& allocation() const;
+  // Returns the Meshes range to it's MeshPool
+  //   - Calling this method on a Mesh which hasn't
+  //     been uploaded (or was already deallocated) is a no-op
+  void deallocate();
+
   const mesh::Mesh& mesh() const;
 
+  virtual size_t residentSize() const;
+
+  virtual ~Mesh();
+
 protected:
   using Resource::Resource;
 
@@ -48,7 +70,10 @@ private:
   void populate(const yaml::Document& doc);
 
   mesh::Mesh m_mesh;
-  mesh::MeshLoader *m_loader = nullptr;
+  std::unique_ptr<mesh::MeshLoader> m_loader;
+
+  gx::MeshPool::Ref m_mesh_pool;
+  gx::MeshPool::Allocation m_alloc;
 
   IOBuffer m_mesh_data;
 };
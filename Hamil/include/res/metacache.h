@@ -0,0 +1,92 @@
+#pragma once
+
+#include <common.h>
+#include <res/resource.h>
+#include <os/mutex.h>
+
+#include <string>
+#include <optional>
+#include <unordered_map>
+
+namespace yaml {
+class Document;
+}
+
+namespace res {
+
+// Persistent cache of compiled resource descriptors (*.meta files)
+//   - A record stores the descriptor after it has passed
+//     MetaLoader::validate(), serialized with yaml::Document::toBinary(),
+//     so it can be reconstructed without running the yaml parser
+//     or the schema validation again
+//   - Records are keyed by a hash of the *.meta file's contents,
+//     so any edit to the file invalidates it's record
+//   - probe(), document() and insert() can be called from
+//     multiple threads simultaneously
+class MetaCache {
+public:
+  using Key = u64;
+
+  MetaCache();
+
+  static Key key(const void *meta_file, size_t sz);
+
+  // Reads the records stored at 'path'
+  //   - A missing, out-of-date or corrupt cache file is
+  //     silently treated as empty
+  void load(const std::string& path);
+  // Writes out all records which were probe()'d or insert()'ed
+  //   since load() (which prunes records of removed/edited files)
+  void save(const std::string& path);
+
+  // Returns 'true' when save() would write out a
+  //   different set of records than was load()'ed
+  bool dirty() const;
+
+  // Returns the Resource::Id of the cached descriptor
+  //   and marks the record as used
+  std::optional<Resource::Id> probe(Key k);
+
+  // Reconstructs the cached descriptor
+  //   - Returns std::nullopt when no record exists for 'k'
+  std::optional<yaml::Document> document(Key k) const;
+
+  // 'meta' MUST have passed MetaLoader::validate()
+  void insert(Key k, Resource::Id id, const yaml::Document& meta);
+
+private:
+  enum : u32 {
+    Magic   = 0x43544D48,   // 'HMTC'
+    Version = 1,
+  };
+
+  struct Header {
+    u32 magic;
+    u32 version;
+
+    u64 num_records;
+  };
+
+  // Followed by 'size' bytes of serialized yaml::Document
+  struct RecordHeader {
+    Key key;
+    u64 id;
+
+    u64 size;
+  };
+
+  struct Record {
+    Resource::Id id;
+    std::string data;
+
+    bool used = false;
+  };
+
+  mutable os::Mutex::Ptr m_mutex;
+
+  std::unordered_map<Key, Record> m_records;
+  size_t m_num_loaded = 0;
+  bool m_inserted = false;
+};
+
+}
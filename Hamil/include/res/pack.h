@@ -0,0 +1,188 @@
+#pragma once
+
+#include <common.h>
+#include <res/resource.h>
+#include <res/loader.h>
+#include <res/io.h>
+#include <os/error.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+namespace os {
+class File;
+}
+
+namespace res {
+
+// Layout of a resource pack (*.pack) archive:
+//     PackHeader
+//     PackEntry[PackHeader::num_entries]   (sorted by 'id')
+//     meta data blobs                      (descriptors compiled via yaml::Document::toBinary())
+//     source paths                         (of the *.meta files, relative to the source folder)
+//     payloads                             (each aligned to PackPayloadAlign)
+//   - All offsets are relative to the beginning of the archive
+//   - Every meta stored in an archive has passed MetaLoader::validate()
+//     when the archive was built, so it's not re-validated on load
+//   - A payload holds the contents of the file the meta's 'location'
+//     refers to (when it has one)
+struct PackHeader {
+  enum : u32 {
+    Magic   = 0x4B415048,  // 'HPAK'
+    Version = 3,
+  };
+
+  u32 magic;
+  u32 version;
+
+  u64 num_entries;
+  u64 index_offset;
+
+  u64 size;  // Size of the whole archive in bytes
+};
+
+struct PackEntry {
+  u64 id;
+
+  u64 meta_offset;
+  u64 meta_size;
+
+  u64 payload_offset;
+  u64 payload_size;    // Can be == 0 for an empty payload file
+
+  u64 source_offset;
+  u64 source_size;
+
+  u64 source_key;      // MetaCache::key() of the source *.meta file
+  u64 location_hash;   // util::hash() of the 'location' the payload was read
+                       //   from or == 0 when the resource has no payload
+};
+
+static_assert(sizeof(PackHeader) == 4*sizeof(u64), "PackHeader must be tightly packed!");
+static_assert(sizeof(PackEntry) == 9*sizeof(u64), "PackEntry must be tightly packed!");
+
+enum : size_t {
+  // Payloads are aligned so they can be used in-place
+  //   (eg. by GPU uploads) straight from the mapping
+  PackPayloadAlign = 4096,
+};
+
+// PackLoader:
+//   - loads assets from a resource pack built by a PackBuilder
+//     (see the '--resource-pack' command line option)
+//   - init() only maps the archive into memory and checks it's
+//     header and index, which is then searched in-place (O(log n))
+//     on load
+//   - An archive which fails the checks is ignored (with a warning)
+//     and every load() returns nullptr, so the next loader in the
+//     chain is used instead
+//   - When 'source_path' is given, load() returns nullptr for any
+//     resource whose *.meta file (or payload) under 'source_path'
+//     has changed since the archive was built. Missing source files
+//     aren't considered stale, so archives can be shipped on
+//     their own
+//   - The staleness check reads the source files, so it's meant
+//     for development only (res::init() passes 'source_path'
+//     in debug builds) and is done at most once per entry
+class PackLoader : public MetaLoader {
+public:
+  struct InvalidPackError final : public os::Error {
+    const std::string file;
+    InvalidPackError(const std::string& file_) :
+      os::Error("invalid resource pack archive!"),
+      file(file_)
+    { }
+  };
+
+  PackLoader(const char *archive_path, const char *source_path = nullptr);
+
+protected:
+  virtual void doInit();
+  virtual Resource::Ptr doLoad(Resource::Id id, LoadFlags flags);
+
+  virtual IOBuffer readLocation(Resource::Id id, const yaml::Scalar *location);
+  virtual IOBuffer mapLocation(Resource::Id id, const yaml::Scalar *location);
+
+private:
+  // Throws InvalidPackError when the archive's header
+  //   or index is malformed
+  void checkArchive();
+
+  // Returns nullptr when 'id' isn't present in the archive
+  const PackEntry *find(Resource::Id id) const;
+
+  // Returns 'true' when the source files 'entry' was built
+  //   from have been modified since (see note above)
+  //   - The result is cached in m_stale
+  bool stale(const PackEntry& entry, const yaml::Document& meta);
+  bool checkStale(const PackEntry& entry, const yaml::Document& meta) const;
+
+  // Returns a view of the entry's payload (zero-copy)
+  //   - Throws IOError when 'location' isn't the one
+  //     the payload was packed from
+  //   - An empty payload file yields a valid, zero-sized view
+  IOBuffer payload(Resource::Id id, const yaml::Scalar *location);
+
+  std::string m_path;
+  std::string m_source_path;
+
+  IOBuffer m_archive;
+
+  const PackEntry *m_index = nullptr;
+  size_t m_num_entries = 0;
+
+  enum StaleState : u8 {
+    StaleUnknown, StaleFresh, StaleStale,
+  };
+
+  // Indexed the same as 'm_index' - concurrent loads
+  //   can at worst check the same entry twice
+  std::unique_ptr<std::atomic<u8>[]> m_stale;
+};
+
+// Gathers resource descriptors (metas) and their payloads
+//   and writes them out as a resource pack
+class PackBuilder {
+public:
+  struct Error { };
+
+  struct DuplicateIdError : public Error {
+    const Resource::Id id;
+    DuplicateIdError(Resource::Id id_) :
+      id(id_)
+    { }
+  };
+
+  // 'meta' MUST have passed MetaLoader::validate() and
+  //   be serialized via yaml::Document::toBinary()
+  //   - 'source_path' is the *.meta file 'meta' was read from
+  //   - 'payload_path' can be empty when the resource
+  //     has no payload
+  //   - Both paths are relative to the working directory and
+  //     are stored in the archive (for PackLoader's staleness
+  //     checks)
+  PackBuilder& add(Resource::Id id, const std::string& meta,
+      const std::string& source_path, const std::string& payload_path = "");
+
+  size_t numEntries() const;
+
+  // Throws DuplicateIdError when two entries with the
+  //   same Resource::Id were add()'ed
+  void write(os::File& file);
+
+private:
+  struct Entry {
+    Resource::Id id;
+
+    std::string meta;
+
+    std::string source_path;
+    std::string payload_path;
+  };
+
+  std::vector<Entry> m_entries;
+};
+
+}
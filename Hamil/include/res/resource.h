@@ -54,6 +54,14 @@ public:
   bool loaded() const { return m_loaded; }
   operator bool() const { return loaded(); }
 
+  // Returns the number of bytes of memory the Resource
+  //   currently holds on to (used for ResourceCache budgeting)
+  //  - Derived classes should add the size of their data
+  //    to the value returned by this method
+  //  - Only heap memory counts, data viewed straight from
+  //    mapped files doesn't (see IOBuffer::ownedSize())
+  virtual size_t residentSize() const;
+
   struct Hash    { size_t operator()(const Resource::Ptr& r) const { return r->id(); } };
   // Resources are considered the same when:
   //   - their types (tags) match
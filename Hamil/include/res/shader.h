@@ -49,6 +49,8 @@ public:
   static Resource::Ptr from_yaml(const yaml::Document& doc, Id id,
     const std::string& name = "", const std::string& path = "");
 
+  virtual size_t residentSize() const;
+
 protected:
   using Resource::Resource;
 
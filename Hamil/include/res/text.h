@@ -1,6 +1,7 @@
 #pragma once
 
 #include <res/resource.h>
+#include <res/io.h>
 
 #include <memory>
 #include <string_view>
@@ -17,9 +18,19 @@ public:
   static Resource::Ptr from_file(const char *buf, size_t sz, Id id,       // 'buf' is always copied
     const std::string& name = "", const std::string& path = "");
 
-  const std::string_view& str() const;
+  // 'buf' is never copied, instead the Text keeps a reference to it
+  static Resource::Ptr from_buffer(IOBuffer buf, Id id,
+    const std::string& name = "", const std::string& path = "");
+
+  // Returns a sized view of the text
+  //   - It's NOT guaranteed to be NULL-terminated (Texts created
+  //     via from_buffer() usually view a mapped file), so
+  //     str().data() must never be treated as a C string
+  std::string_view str() const;
   const std::string_view *operator->() const; // accesses str()
 
+  virtual size_t residentSize() const;
+
 protected:
   using Resource::Resource;
 
@@ -31,6 +42,9 @@ private:
 
   std::string_view m_str;
   std::unique_ptr<char[]> m_buf;
+
+  // Holds the data for Texts created via from_buffer()
+  IOBuffer m_data;
 };
 
 }
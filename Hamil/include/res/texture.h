@@ -19,9 +19,16 @@ public:
   static Resource::Ptr from_yaml(IOBuffer& image,
     const yaml::Document& doc, Id id,
     const std::string& name = "", const std::string& path = "");
+  // Same as above, except the layers/levels of the
+  //   image are copied on the 'workers'
+  static Resource::Ptr from_yaml(sched::WorkerPool& workers, IOBuffer& image,
+    const yaml::Document& doc, Id id,
+    const std::string& name = "", const std::string& path = "");
 
   const util::DDSImage& get() const;
 
+  virtual size_t residentSize() const;
+
 protected:
   using Resource::Resource;
 
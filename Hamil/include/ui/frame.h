@@ -100,6 +100,16 @@ public:
   // Intended for internal use
   virtual bool isLayout() const { return false; }
 
+  // Must be called whenever something which affects the
+  //   way the Frame is painted changes
+  //  - Ui::paint() repaints only the top-level Frames (i.e. the
+  //    ones passed to Ui::frame()) which have been marked dirty,
+  //    along with all the ones drawn above them
+  void markDirty();
+  // Returns 'true' when the Frame's top-level Frame will
+  //   be repainted by the next Ui::paint()
+  bool dirty() const;
+
 protected:
   friend Ui;
   Ui *m_ui;
@@ -130,6 +140,9 @@ private:
   Gravity m_gravity;
   Geometry m_geom;
   vec2 m_pad;
+
+  // Only meaningful for top-level Frames (see markDirty())
+  bool m_dirty;
 };
 
 // Returns a reference to a HEAP allocated Frame
@@ -184,8 +184,29 @@ public:
 
   gx::Pipeline defaultPipeline(ivec4 scissor);
 
+  // A position in the vertex/index buffers and Command lists
+  //   from which painting can later be resumed (see begin())
+  struct Mark {
+    size_t base = 0, offset = 0;
+    size_t num_commands = 0, num_overlay_commands = 0;
+
+    gx::Pipeline pipeline = gx::Pipeline(nullptr);
+  };
+
   // Must be called before painting anything after calling end()
   VertexPainter& begin(Vertex *verts, size_t num_verts, u16 *inds, size_t num_inds);
+  // Resumes painting at 'from' (returned by an earlier mark()), discarding
+  //   all the Commands emitted after it while keeping the ones before
+  //   - 'verts' and 'inds' must point to the storage for the vertex at
+  //     'from.base' and the index at 'from.offset' respectively, all
+  //     the vertices/indices before them are assumed to be unchanged
+  VertexPainter& begin(const Mark& from, Vertex *verts, size_t num_verts, u16 *inds, size_t num_inds);
+
+  // Returns a Mark for the current position
+  //   - The Command emitted right after this call is never merged
+  //     with the ones before it, so they stay valid when painting
+  //     is resumed from the Mark
+  Mark mark();
 
   VertexPainter& line(vec2 a, vec2 b, float width, LineCap cap, float cap_r, Color ca, Color cb);
   VertexPainter& line(vec2 a, vec2 b, float width, LineCap cap, Color ca, Color cb);
@@ -268,7 +289,8 @@ private:
   void appendVerticesAndIndices(const Drawable& d);
   void appendCommand(const Command& c);
   // Method ONLY for interal use by appendCommand()
-  void doAppendCommand(const Command& c, std::vector<Command>& commands);
+  //   - Commands at indices < 'merge_floor' are never merged with 'c'
+  void doAppendCommand(const Command& c, std::vector<Command>& commands, size_t merge_floor);
   // Emit a Vertex::RestartIndex into the IndexBuffer
   //   - Called automatically by appendCommand when needed
   void restartPrimitive();
@@ -290,6 +312,11 @@ private:
 
   gx::Pipeline::ResourceId m_vtx_id;
 
+  // Index of the first vertex/index pointed to by
+  //   m_buf/m_ind in the Vertex/IndexBuffer
+  size_t m_buf_first;
+  size_t m_ind_first;
+
   // VertexBuffer view pointer
   Vertex *m_buf;
   // Current write offset in VertexBuffer
@@ -311,6 +338,10 @@ private:
 
   std::vector<Command> m_commands;
   std::vector<Command> m_overlay_commands;
+
+  // See mark()
+  size_t m_merge_floor = 0;
+  size_t m_overlay_merge_floor = 0;
 };
 
 }
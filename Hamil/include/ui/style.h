@@ -3,6 +3,7 @@
 #include <ui/uicommon.h>
 #include <ui/painter.h>
 #include <ft/font.h>
+#include <ft/cache.h>
 
 #include <cstring>
 
@@ -29,6 +30,9 @@ struct Style {
     } monospace;
   } font_style;
 
+  // Shared by 'font' and 'monospace', so they're both
+  //   drawn from a single atlas
+  ft::FontCache::Ptr font_cache;
   ft::Font::Ptr font, monospace;
 
   struct {
@@ -15,19 +15,17 @@
 #include <gx/vertex.h>
 #include <gx/resourcepool.h>
 #include <gx/memorypool.h>
+#include <gx/commandbuffer.h>
 
 #include <string>
 #include <vector>
 #include <list>
 #include <unordered_map>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <type_traits>
 
-namespace gx {
-class CommandBuffer;
-}
-
 namespace ui {
 
 // Must be called AFTER gx::init()!
@@ -118,14 +116,34 @@ public:
   bool input(CursorDriver& cursor, const InputPtr& input);
   // Generates a gx::CommandBuffer which will draw the Ui
   //   into the texture referenced by framebufferTextureId()
+  //  - Only the top-level Frames which were marked dirty (see
+  //    Frame::markDirty()) and the ones above them are repainted,
+  //    when there are none the previous CommandBuffer is returned
   gx::CommandBuffer paint();
 
   // For internal use (DO NOT call externally)
   void capture(Frame *frame);
   // For internal use (DO NOT call externally)
   void keyboard(Frame *frame);
+  // For internal use (DO NOT call externally)
+  void markDirty(Frame *frame);
 
 private:
+  // A top-level Frame along with the position of
+  //   its vertices/Commands in 'm_painter'
+  struct PaintedFrame {
+    Frame *frame;
+    VertexPainter::Mark mark;
+  };
+
+  // Paints all the top-level Frames starting from the first
+  //   one which is dirty or was moved in 'm_frames' since the
+  //   previous paint(), reusing the vertices of the rest
+  //  - Returns 'false' when nothing had to be painted
+  bool repaintFrames();
+  // Records the gx::CommandBuffer for everything in 'm_painter'
+  gx::CommandBuffer recordCommands(bool fence_wait);
+
   // Size of the Framebuffer the Ui will be drawn to
   //   - Needed to correctly specify gx::Pipeline::scissor()
   //     parameters
@@ -169,9 +187,22 @@ private:
   // Used as argument for all Frame::paint() calls
   VertexPainter m_painter;
 
-  // Set to 'true' when frame vertices need to be repainted (TODO)
+  // Set to 'true' when any of the top-level Frames was
+  //   marked dirty or 'm_frames' was reordered
   bool m_repaint;
 
+  // The top-level Frames in the order they were painted
+  //   by the last paint(), which is cleared to force
+  //   a full repaint
+  std::vector<PaintedFrame> m_painted;
+  // Position right after the last of 'm_painted'
+  VertexPainter::Mark m_painted_end;
+
+  // The gx::CommandBuffer returned by the last paint(), which
+  //   is returned again when nothing has changed since
+  //  - Empty when it has to be recorded again
+  std::optional<gx::CommandBuffer> m_command_buf;
+
   // 'm_vtx_id' backing buffer, invalidated everytime paint() is called
   gx::VertexBuffer m_buf;
   gx::IndexBuffer m_ind;
@@ -49,6 +49,9 @@ struct Geometry {
 
   vec2 center() const;
   vec2 centerRelative() const;
+
+  bool operator==(const Geometry& other) const;
+  bool operator!=(const Geometry& other) const;
 };
 
 struct Color : public Vector4<byte> {
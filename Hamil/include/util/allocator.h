@@ -2,27 +2,110 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <list>
+#include <vector>
+#include <array>
 #include <utility>
 
-class FreeListAllocator {
+// Two-Level Segregated Fit allocator which hands out
+//   offsets into an abstract range [0; sz)
+//   - alloc() runs in O(1) time, as does dealloc() for ranges
+//     smaller than MaxStartBuckets (for larger ones it has to
+//     skip over the Blocks which start before 'offset' in the
+//     same bucket - see m_block_starts)
+//   - Neighbouring free ranges are coalesced immediately
+//     in dealloc()
+//   - No bookkeeping data is stored in the managed range,
+//     so it can be used to sub-allocate GPU buffers etc.
+class TLSFAllocator {
 public:
-  using Range = std::pair<size_t, size_t>;
-
   enum : size_t {
     Error = ~0llu,
   };
 
-  FreeListAllocator(size_t sz);
+  TLSFAllocator(size_t sz);
 
+  // Returns TLSFAllocator::Error on failure
   size_t alloc(size_t sz);
+  // 'offset' MUST have been returned by alloc(sz)
   void dealloc(size_t offset, size_t sz);
 
+  // Returns the size of the managed range
+  size_t size() const;
+
 private:
-  size_t allocAtEnd(size_t sz);
-  void coalesce();
+  enum : unsigned {
+    SecondLevelBits  = 4,
+    SecondLevelCount = 1u<<SecondLevelBits,
+
+    // Sizes < SecondLevelCount all go into the first
+    //   first-level bin
+    FirstLevelCount = sizeof(size_t)*8 - SecondLevelBits + 1,
+  };
+
+  enum : uint32_t {
+    NilBlock = ~0u,
+  };
+
+  enum : size_t {
+    // Upper bound on the size of 'm_block_starts'
+    MaxStartBuckets = 1<<16,
+  };
+
+  struct Block {
+    size_t offset, sz;
+
+    // Neighbouring blocks in the managed range
+    uint32_t prev_phys = NilBlock, next_phys = NilBlock;
+    // Neighbouring blocks in the free list
+    uint32_t prev_free = NilBlock, next_free = NilBlock;
+
+    bool free = false;
+  };
+
+  // Returns the indices of the bin which stores blocks of size 'sz'
+  static std::pair<unsigned, unsigned> mapping_insert(size_t sz);
+  // Returns the indices of the first bin whose blocks are all >= 'sz'
+  static std::pair<unsigned, unsigned> mapping_search(size_t sz);
+
+  // Returns NilBlock when no suitable block exists
+  uint32_t findFreeBlock(size_t sz);
+
+  void insertFreeBlock(uint32_t idx);
+  void removeFreeBlock(uint32_t idx);
+
+  // Merges block 'next' into 'idx' and releases 'next'
+  void absorb(uint32_t idx, uint32_t next);
+
+  // Returns the Block which starts at 'offset' or NilBlock
+  uint32_t findBlock(size_t offset) const;
+
+  // Must be called for every Block which gets split off
+  //   from another one, before it's linked with it's
+  //   neighbours in the managed range
+  void blockStarted(uint32_t idx);
+  // Must be called for every Block which is about to be
+  //   absorbed, while it's still linked with it's neighbours
+  void blockRemoved(uint32_t idx);
+
+  uint32_t newBlock();
+  void releaseBlock(uint32_t idx);
 
   size_t m_sz;
-  size_t m_ptr;
-  std::list<Range> m_free_list;
-};
\ No newline at end of file
+
+  uint64_t m_fl_bitmap = 0;
+  std::array<uint32_t, FirstLevelCount> m_sl_bitmaps;
+
+  // Heads of the free lists for each (first-level, second-level) bin
+  std::array<std::array<uint32_t, SecondLevelCount>, FirstLevelCount> m_free_lists;
+
+  std::vector<Block> m_blocks;
+  std::vector<uint32_t> m_unused_blocks;
+
+  // The managed range is split into buckets of 2^m_start_shift
+  //   offsets, and for each one the Block with the lowest offset
+  //   starting in it is stored here (or NilBlock), so the Block
+  //   given to dealloc() can be found by walking the physical
+  //   neighbours from there instead of hashing
+  unsigned m_start_shift = 0;
+  std::vector<uint32_t> m_block_starts;
+};
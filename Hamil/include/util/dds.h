@@ -18,6 +18,10 @@ enum Format : uint;
 enum class Type : uint;
 }
 
+namespace sched {
+class WorkerPool;
+}
+
 namespace util {
 
 class DDSImage {
@@ -139,6 +143,12 @@ public:
   DDSImage& operator=(DDSImage&& other);
 
   DDSImage& load(const void *data, size_t sz, uint flags = LoadDefault);
+  // Same as load(), except the copies of the individual
+  //   layers/levels are distributed among the 'pool's
+  //   workers (useful for Cubemaps and Arrays with
+  //   full mip chains)
+  //  - Blocks until all of the data has been copied
+  DDSImage& load(sched::WorkerPool& pool, const void *data, size_t sz, uint flags = LoadDefault);
 
   Type type() const;
   Format format() const;
@@ -243,6 +253,28 @@ public:
   void *releaseData(CubemapFace face, uint level = 0);
 
 private:
+  enum : size_t {
+    // Levels smaller than this are copied on the
+    //   thread which called load(WorkerPool&, ...)
+    ParallelCopyMinSize = 64*1024,
+
+    NumCopyJobs = 8,
+  };
+
+  // Copy of the data for a single layer/face and level
+  struct CopyOp {
+    Image *img;
+    byte *src;
+
+    uint layer, level;
+  };
+  using CopyOps = std::vector<CopyOp>;
+
+  // Parses the headers and allocates storage for all
+  //   the Images, then returns the copies which need
+  //   to be performed to fill them
+  CopyOps loadLayout(const void *data, size_t sz);
+
   // Size in bytes of an image of size WxH
   //   with format == m_format
   size_t byteSize(ulong w, ulong h);
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <common.h>
+
+#include <yaml/node.h>
+#include <yaml/document.h>
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+namespace yaml {
+
+class ArenaParser;
+
+// A bump allocator which frees all of its allocations at once
+//   when it's destroyed
+//  - Objects allocated from an Arena never have their destructors run
+class Arena {
+public:
+  enum : size_t {
+    BlockSize = 4096,
+
+    // Allocations larger than this get their own block
+    MaxSmallAlloc = BlockSize / 4,
+  };
+
+  Arena() = default;
+  Arena(const Arena& other) = delete;
+  ~Arena();
+
+  Arena& operator=(const Arena& other) = delete;
+
+  void *alloc(size_t sz, size_t align = alignof(std::max_align_t));
+
+  template <typename T>
+  T *alloc(size_t n = 1)
+  {
+    static_assert(std::is_trivially_destructible_v<T>,
+      "only trivially destructible types can be allocated from an Arena!");
+
+    return (T *)alloc(n*sizeof(T), alignof(T));
+  }
+
+  // Returns a null-terminated copy of 'data'
+  const char *copy(const void *data, size_t sz);
+
+  // Returns the total number of bytes allocated
+  size_t size() const;
+
+private:
+  std::vector<byte *> m_blocks;
+
+  byte *m_ptr = nullptr;
+  byte *m_end = nullptr;
+
+  size_t m_size = 0;
+};
+
+// A read-only equivalent of yaml::Node which lives inside an
+//   ArenaDocument's Arena
+//  - Mapping entries are kept in document order, along with an
+//    index of them sorted by key so get(key) can binary search
+//  - Aliases point to the same ArenaNode as their anchor
+class ArenaNode {
+public:
+  using Type     = Node::Type;
+  using Style    = Node::Style;
+  using DataType = Scalar::DataType;
+
+  Type type() const;
+  Style style() const;
+
+  // Returns an empty string when the node isn't tagged
+  std::string_view tag() const;
+  bool tagged() const;
+
+  // For Scalars returns the length of the value, for
+  //   Sequences/Mappings returns the number of items
+  size_t size() const;
+
+  // Scalar accessors - the string returned by str() isn't
+  //   null-terminated when it points into the source document
+  std::string_view str() const;
+  DataType dataType() const;
+
+  long long i() const;
+  unsigned long long ui() const;
+  double f() const;
+  bool b() const;
+  bool null() const;
+
+  // Returns nullptr when this isn't a Sequence or 'idx' is out of bounds
+  const ArenaNode *get(size_t idx) const;
+  // Returns nullptr when this isn't a Mapping or it has no such key,
+  //   when the key occurs more than once the first value is returned
+  const ArenaNode *get(std::string_view key) const;
+
+  // Mapping entries in document order
+  const ArenaNode *key(size_t idx) const;
+  const ArenaNode *value(size_t idx) const;
+
+  // Returns a (deep) copy of this node and its children
+  Node::Ptr toNode() const;
+
+private:
+  friend ArenaParser;
+
+  enum Flags : u8 {
+    Anchored = 1<<0,
+  };
+
+  u8 m_type;
+  u8 m_style;
+  u8 m_flags;
+
+  u32 m_tag_len;
+  u32 m_size;
+
+  const char *m_tag;
+
+  union {
+    const char *m_str;          // Scalar
+    const ArenaNode **m_items;  // Sequence, Mapping (interleaved keys and values)
+  };
+
+  const u32 *m_sorted;          // Mapping only, entry indices sorted by key
+};
+
+// An alternative to Document for when many (small) documents
+//   only have to be read, which avoids per-node allocations
+//  - The whole tree is stored in a single Arena and plain scalars
+//    point straight into the source document, which means it
+//    MUST outlive the ArenaDocument
+//  - toDocument() creates a regular Document for APIs which need one
+class ArenaDocument {
+public:
+  ArenaDocument();
+  ArenaDocument(ArenaDocument&& other) = default;
+  ~ArenaDocument();
+
+  ArenaDocument& operator=(ArenaDocument&& other) = default;
+
+  // Throws the same errors as Document::from_string()
+  static ArenaDocument from_string(const char *doc, size_t len);
+
+  // returns the root element
+  const ArenaNode *get() const;
+
+  const ArenaNode *get(const Path& path) const;
+  const ArenaNode *operator()(const Path& path) const { return get(path); }
+
+  Document toDocument() const;
+
+  // Returns the number of bytes allocated from the Arena
+  size_t arenaSize() const;
+
+private:
+  std::unique_ptr<Arena> m_arena;
+  const ArenaNode *m_root = nullptr;
+};
+
+}
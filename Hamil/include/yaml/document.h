@@ -5,11 +5,34 @@
 #include <yaml/node.h>
 
 #include <string>
+#include <vector>
 #include <memory>
 #include <utility>
 
 namespace yaml {
 
+// A pre-split Document::get() path, which avoids re-parsing
+//   the string when the same lookup is done on many Documents
+//  - 'what' can contain either mapping keys or integer indices
+//    separated by '.' (dots) to signify nested elements
+class Path {
+public:
+  struct Term {
+    std::string key;
+    size_t idx;
+    bool is_index;  // When 'true' only 'idx' is valid
+  };
+
+  using Terms = std::vector<Term>;
+
+  explicit Path(const std::string& what);
+
+  const Terms& terms() const;
+
+private:
+  Terms m_terms;
+};
+
 class Document {
 public:
   struct Error {
@@ -38,6 +61,14 @@ public:
     using Error::Error;
   };
 
+  // Thrown by from_binary() when the data is truncated or corrupt
+  struct BinaryFormatError : public Error {
+  public:
+    BinaryFormatError(size_t offset) :
+      Error(0, offset, "malformed binary document")
+    { }
+  };
+
   Document();
   Document(const Node::Ptr& root);
 
@@ -46,6 +77,13 @@ public:
 
   std::string toString();
 
+  // Serializes the Document into a compact binary form, which
+  //   can be turned back into a Document by from_binary()
+  //   without going through the (comparatively slow) parser
+  //  - Tags, styles and Mapping key order are preserved
+  std::string toBinary() const;
+  static Document from_binary(const void *data, size_t sz);
+
   // returns the root element
   Node::Ptr get() const;
 
@@ -54,6 +92,9 @@ public:
   Node::Ptr get(const std::string& what) const;
   Node::Ptr operator()(const std::string& what) const { return get(what); }
 
+  Node::Ptr get(const Path& path) const;
+  Node::Ptr operator()(const Path& path) const { return get(path); }
+
 private:
   Node::Ptr m_root;
 };
@@ -113,6 +113,15 @@ public:
 
   DataType dataType() const;
 
+  // Returns the DataType an untagged scalar with the value 'data'
+  //   would have ('data' doesn't have to be null-terminated)
+  static DataType data_type(const char *data, size_t sz);
+  // Returns the DataType implied by a scalar's 'tag'
+  static DataType tag_data_type(const std::string& tag);
+
+  // Returns 'false' when 'data' isn't a Boolean
+  static bool parse_bool(const char *data, size_t sz);
+
   const char *str() const;
   long long i() const;
   unsigned long long ui() const;
@@ -7,7 +7,6 @@
 #include <vector>
 #include <initializer_list>
 #include <utility>
-#include <regex>
 #include <optional>
 
 namespace yaml {
@@ -17,6 +16,32 @@ enum Flags : unsigned {
   Optional = 1<<0,
 };
 
+class SchemaCondition;
+
+// A single instruction of a compiled Schema
+struct SchemaOp {
+  enum Code : u8 {
+    IsScalar, IsPath, IsFile, IsSequence, IsMapping,
+
+    // Runs the op at 'element' for every item of a Sequence
+    AllOf,
+
+    // Calls 'custom'->validate(), for SchemaConditions
+    //   which don't override compile()
+    Custom,
+  };
+
+  Code code;
+  Flags flags;
+
+  Scalar::DataType type;  // Scalar only
+  u32 element;            // AllOf only
+
+  const SchemaCondition *custom;
+};
+
+using SchemaProgram = std::vector<SchemaOp>;
+
 class SchemaCondition {
 public:
   using Ptr = std::shared_ptr<SchemaCondition>;
@@ -27,10 +52,18 @@ public:
 
   bool validate(const Node::Ptr& node) const;
 
+  // Appends the SchemaOp(s) equivalent to this condition to 'program'
+  //   and returns the index of the one which should be run
+  //  - The default implementation emits a SchemaOp::Custom
+  virtual u32 compile(SchemaProgram& program) const;
+
 protected:
   // only called with a valid Node
   virtual bool doValidate(const Node::Ptr& node) const = 0;
 
+  u32 emit(SchemaProgram& program, SchemaOp::Code code,
+    Scalar::DataType type = Scalar::Invalid, u32 element = 0) const;
+
 private:
   Flags m_flags;
 };
@@ -40,6 +73,8 @@ public:
   // when 'type' is not given a value any Scalar will pass validation
   ScalarCondition(Flags flags = Default, Scalar::DataType type = Scalar::Invalid);
 
+  virtual u32 compile(SchemaProgram& program) const;
+
 protected:
   virtual bool doValidate(const Node::Ptr& node) const;
 
@@ -47,16 +82,6 @@ private:
   Scalar::DataType m_type;
 };
 
-class RegexCondition : public SchemaCondition {
-public:
-  RegexCondition(Flags flags = Default);
-
-protected:
-  virtual bool doValidate(const Node::Ptr& node) const;
-
-  virtual const std::regex& regex() const = 0;
-};
-
 // Matches a path of the form
 //   /<dir>/<dir>/<file>
 //   /<dir>/<dir>/
@@ -64,27 +89,33 @@ protected:
 // path characters except spaces
 // 
 // Or an empty string
-class PathCondition : public RegexCondition {
+class PathCondition : public SchemaCondition {
 public:
-  using RegexCondition::RegexCondition;
+  PathCondition(Flags flags = Default);
+
+  virtual u32 compile(SchemaProgram& program) const;
 
 protected:
-  virtual const std::regex& regex() const;
+  virtual bool doValidate(const Node::Ptr& node) const;
 };
 
 // Matches a valid win32 file name with no spaces
-class FileCondition : public RegexCondition {
+class FileCondition : public SchemaCondition {
 public:
-  using RegexCondition::RegexCondition;
+  FileCondition(Flags flags = Default);
+
+  virtual u32 compile(SchemaProgram& program) const;
 
 protected:
-  virtual const std::regex& regex() const;
+  virtual bool doValidate(const Node::Ptr& node) const;
 };
 
 class SequenceCondition : public SchemaCondition {
 public:
   SequenceCondition(Flags flags = Default);
 
+  virtual u32 compile(SchemaProgram& program) const;
+
 protected:
   virtual bool doValidate(const Node::Ptr& node) const;
 };
@@ -93,6 +124,8 @@ class MappingCondition : public SchemaCondition {
 public:
   MappingCondition(Flags flags = Default);
 
+  virtual u32 compile(SchemaProgram& program) const;
+
 private:
   virtual bool doValidate(const Node::Ptr& node) const;
 };
@@ -101,6 +134,8 @@ class AllOfCondition : public SchemaCondition {
 public:
   AllOfCondition(SchemaCondition::Ptr cond, Flags flags = Default);
 
+  virtual u32 compile(SchemaProgram& program) const;
+
 private:
   virtual bool doValidate(const Node::Ptr& node) const;
 
@@ -114,6 +149,10 @@ private:
 //       .sequence("b");
 //
 //   if(schema.validate(...)) panic();
+//
+// Every condition is compiled into a flat SchemaProgram (and
+//   its node path into a yaml::Path) when it's added, so
+//   validate() doesn't have to re-parse anything
 class Schema {
 public:
   // returns a pointer to the first Node which failed validation
@@ -139,9 +178,20 @@ public:
   }
 
 private:
+  struct Check {
+    Path path;
+    u32 op;
+
+    // Keeps SchemaOp::Custom conditions alive
+    SchemaCondition::Ptr cond;
+  };
+
   Schema& condition(const std::string& node, SchemaCondition *cond);
 
-  std::vector<std::pair<std::string, SchemaCondition::Ptr>> m_conditions;
+  bool execute(u32 op, const Node::Ptr& node) const;
+
+  std::vector<Check> m_checks;
+  SchemaProgram m_program;
 };
 
 }
@@ -38,7 +38,7 @@ RigidBody RigidBody::create(CollisionShape shape, vec3 origin, float mass, bool
     //   and create a btMotionState for it
 
     local_inertia = to_btVector3(shape.calculateLocalInertia(mass));
-    motion_state = new btDefaultMotionState(transform);
+    motion_state = new MotionState(transform);
   }
 
   RigidBody body = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(
@@ -168,7 +168,7 @@ RigidBody& RigidBody::createMotionState(const xform::Transform& t)
   btTransform start_transform;
   start_transform.setFromOpenGLMatrix(t.matrix().transpose());
 
-  m->setMotionState(new btDefaultMotionState(start_transform));
+  m->setMotionState(new MotionState(start_transform));
 
   return *this;
 }
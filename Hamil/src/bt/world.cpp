@@ -8,7 +8,9 @@
 
 #include <atomic>
 #include <array>
+#include <vector>
 #include <utility>
+#include <algorithm>
 
 namespace bt {
 
@@ -84,6 +86,11 @@ public:
   std::atomic<uint> queue_head = 0;
   std::array<QueueEntry, AddRemoveQueueDepth> queue;
 
+  // Appended to by MotionState::setWorldTransform() during step()
+  std::vector<btRigidBody *> moved_bodies;
+  // Returned by DynamicsWorld::movedBodies()
+  std::vector<DynamicsWorld::MovedBody> moved;
+
   void queueAppend(QueueEntry e);
   QueueEntry queuePop();
   bool queueEmpty();
@@ -130,6 +137,26 @@ bool DynamicsWorldData::queueEmpty()
   return queue_head.load() == 0;
 }
 
+MotionState::MotionState(const btTransform& start_transform) :
+  btDefaultMotionState(start_transform)
+{
+}
+
+void MotionState::setWorldTransform(const btTransform& transform)
+{
+  auto old_transform = m_graphicsWorldTrans;
+  btDefaultMotionState::setWorldTransform(transform);
+
+  // Bodies which are resting but haven't been put to sleep
+  //   yet still get synchronized - don't record those
+  if(!m_world || m_moved || m_graphicsWorldTrans == old_transform) return;
+
+  // Bullet synchronizes the motion states serially from
+  //   inside stepSimulation(), so no locking is needed here
+  m_world->moved_bodies.push_back(m_body);
+  m_moved = true;
+}
+
 DynamicsWorld::DynamicsWorld()
 {
   m_data = new DynamicsWorldData();
@@ -170,7 +197,7 @@ void DynamicsWorld::addRigidBody(RigidBody rb)
   if(lock().tryAcquireExclusive()) {
     // No one else was accessing the world so we can
     //   add the RigidBody right away
-    m_world->addRigidBody(rb.m);
+    attachRigidBody(rb.m);
 
     lock().releaseExclusive();
   } else {
@@ -179,7 +206,7 @@ void DynamicsWorld::addRigidBody(RigidBody rb)
     m_data->queueAppend({ DynamicsWorldData::QueueAdd, rb.m });
   }
 #else
-  m_world->addRigidBody(rb.m);
+  attachRigidBody(rb.m);
 #endif
 }
 
@@ -188,14 +215,14 @@ void DynamicsWorld::removeRigidBody(RigidBody rb)
 {
 #if !defined(NO_MT_SAFETY)
   if(lock().tryAcquireExclusive()) {
-    m_world->removeRigidBody(rb.m);
+    detachRigidBody(rb.m);
 
     lock().releaseExclusive();
   } else {
     m_data->queueAppend({ DynamicsWorldData::QueueRemove, rb.m });
   }
 #else
-  m_world->removeRigidBody(rb.m);
+  detachRigidBody(rb.m);
 #endif
 }
 
@@ -235,14 +262,15 @@ void DynamicsWorld::step(float dt)
   lock().acquireExclusive();
 
   m_world->stepSimulation(dt, SimulationMaxSubsteps);
+  gatherMovedBodies();
 
   // Perform the queued ops
   while(!m_data->queueEmpty()) {
     auto e = m_data->queuePop();
 
     switch(e.first) {
-    case DynamicsWorldData::QueueAdd:    m_world->addRigidBody(e.second); break;
-    case DynamicsWorldData::QueueRemove: m_world->removeRigidBody(e.second); break;
+    case DynamicsWorldData::QueueAdd:    attachRigidBody(e.second); break;
+    case DynamicsWorldData::QueueRemove: detachRigidBody(e.second); break;
     }
   }
 
@@ -250,14 +278,83 @@ void DynamicsWorld::step(float dt)
   lock().releaseExclusive();
 #else
   m_world->stepSimulation(dt, SimulationMaxSubsteps);
+  gatherMovedBodies();
 #endif
 }
 
+const std::vector<DynamicsWorld::MovedBody>& DynamicsWorld::movedBodies() const
+{
+  return m_data->moved;
+}
+
 os::ReaderWriterLock& DynamicsWorld::lock()
 {
   return *m_data->lock;
 }
 
+void DynamicsWorld::attachRigidBody(btRigidBody *rb)
+{
+  m_world->addRigidBody(rb);
+
+  if(auto motion_state = dynamic_cast<MotionState *>(rb->getMotionState())) {
+    motion_state->m_body = rb;
+    motion_state->m_world = m_data;
+  }
+}
+
+void DynamicsWorld::detachRigidBody(btRigidBody *rb)
+{
+  m_world->removeRigidBody(rb);
+
+  if(auto motion_state = dynamic_cast<MotionState *>(rb->getMotionState())) {
+    motion_state->m_body = nullptr;
+    motion_state->m_world = nullptr;
+    motion_state->m_moved = false;
+  }
+
+  // Make sure the body can't be reached through
+  //   movedBodies() after it's been removed
+  auto& moved = m_data->moved;
+  moved.erase(std::remove_if(moved.begin(), moved.end(), [rb](const MovedBody& b) {
+    return b.rb.m == rb;
+  }), moved.end());
+}
+
+void DynamicsWorld::gatherMovedBodies()
+{
+  auto& moved = m_data->moved;
+
+  moved.clear();
+  moved.reserve(m_data->moved_bodies.size());
+
+  for(auto body : m_data->moved_bodies) {
+    auto motion_state = (MotionState *)body->getMotionState();
+    const auto& transform = motion_state->m_graphicsWorldTrans;
+
+    MovedBody b;
+    b.rb = body;
+    b.user = body->getUserPointer();
+
+    mat4 matrix;
+    transform.getOpenGLMatrix(matrix);
+
+    b.transform = matrix.transpose();
+
+    // Compute the AABB from the shape, as the one stored in the
+    //   broadphase doesn't account for the interpolation
+    btVector3 aabb_min, aabb_max;
+    body->getCollisionShape()->getAabb(transform, aabb_min, aabb_max);
+
+    b.aabb = AABB(from_btVector3(aabb_min), from_btVector3(aabb_max));
+
+    moved.push_back(b);
+
+    motion_state->m_moved = false;
+  }
+
+  m_data->moved_bodies.clear();
+}
+
 void DynamicsWorld::foreachObject(BtCollisionObjectIter fn)
 {
   auto& objects = m_world->getCollisionObjectArray();
@@ -18,6 +18,11 @@ int args(int argc, char *argv[])
     .boolean("resource-gen", "generate *.meta files (resource descriptors) from images, sound files etc.")
     .list("resources", "list of resource files for resource-gen")
     .list("types", "list of resource file types to be processed by resource-gen")
+    .boolean("bake-meshes", "convert *.obj meshes into the binary *.hmesh format during resource-gen")
+    .boolean("half-float-meshes", "store normals and texture coordinates of baked meshes as f16")
+    .boolean("optimize-meshes", "optimize baked meshes for the vertex cache and overdraw")
+
+    .string("resource-pack", "pack all *.meta files and the files they refer to into the given archive")
 
     .boolean("ltc-lut-gen", "generate fitted LTC look-up table resource")
     ;
@@ -39,11 +44,26 @@ int args(int argc, char *argv[])
     try {
       std::vector<std::string> resources;
       std::set<std::string> types;
+      uint flags = GenDefault;
 
       if(auto opt = opts("resources")) resources = opt->list();
       if(auto opt = opts("types")) types.insert(opt->list().cbegin(), opt->list().cend());
 
-      resourcegen(resources, types);
+      if(opts("bake-meshes")->b())       flags |= GenBakeMeshes;
+      if(opts("half-float-meshes")->b()) flags |= GenHalfFloatMeshes;
+      if(opts("optimize-meshes")->b())   flags |= GenOptimizeMeshes;
+
+      resourcegen(resources, types, flags);
+    } catch(const GenError& e) {
+      printf("error: %s\n", e.what.data());
+
+      return -1;
+    }
+
+    exit_code = 1;
+  } else if(auto opt = opts("resource-pack")) {
+    try {
+      resourcepack(opt->str());
     } catch(const GenError& e) {
       printf("error: %s\n", e.what.data());
 
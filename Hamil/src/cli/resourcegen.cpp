@@ -7,8 +7,10 @@
 #include <util/format.h>
 #include <mesh/mesh.h>
 #include <mesh/obj.h>
+#include <mesh/binmesh.h>
 #include <math/brdf.h>
 #include <math/ltc.h>
+#include <sched/pool.h>
 
 #include <res/res.h>
 #include <res/manager.h>
@@ -19,6 +21,8 @@
 #include <res/texture.h>
 #include <res/mesh.h>
 #include <res/lut.h>
+#include <res/loader.h>
+#include <res/pack.h>
 
 #include <string>
 #include <vector>
@@ -32,20 +36,25 @@
 namespace cli {
 
 static yaml::Document shadergen(os::File& file,
-  const std::string& name, const std::string& path, const std::string& extension);
+  const std::string& name, const std::string& path, const std::string& extension, uint flags,
+  sched::WorkerPool& pool);
 
 static yaml::Document imagegen(os::File& file,
-  const std::string& name, const std::string& path, const std::string& extension);
+  const std::string& name, const std::string& path, const std::string& extension, uint flags,
+  sched::WorkerPool& pool);
 
 static yaml::Document texturegen(os::File& file,
-  const std::string& name, const std::string& path, const std::string& extension);
+  const std::string& name, const std::string& path, const std::string& extension, uint flags,
+  sched::WorkerPool& pool);
 
 static yaml::Document meshgen(os::File& file,
-  const std::string& name, const std::string& path, const std::string& extension);
+  const std::string& name, const std::string& path, const std::string& extension, uint flags,
+  sched::WorkerPool& pool);
 
 using GenFunc = std::function<
   yaml::Document(os::File& file,
-    const std::string& name, const std::string& path, const std::string& extension)
+    const std::string& name, const std::string& path, const std::string& extension, uint flags,
+    sched::WorkerPool& pool)
   >;
 static const std::map<std::string, GenFunc> p_gen_fns = {
   // ------------------ Shaders -----------------------------
@@ -74,7 +83,7 @@ static const std::map<std::string, GenFunc> p_gen_fns = {
 };
 
 static const std::regex p_name_regex("^((?:[^/ ]+/)*)([^./ ]*)\\.([a-z]+)$", std::regex::optimize);
-void resourcegen(std::vector<std::string> resources, std::set<std::string> types)
+void resourcegen(std::vector<std::string> resources, std::set<std::string> types, uint flags)
 {
   using namespace std::literals::string_literals;
 
@@ -99,6 +108,11 @@ void resourcegen(std::vector<std::string> resources, std::set<std::string> types
 
   std::set<res::Resource::Id> guids;
 
+  // Shared by all the generators (e.g. large *.obj files
+  //   are split into chunks parsed in parallel)
+  sched::WorkerPool pool;
+  pool.kickWorkers("ResourceGen_Worker");
+
   for(const auto& resource : resources) {
     // [1] = path
     // [2] = name
@@ -124,7 +138,7 @@ void resourcegen(std::vector<std::string> resources, std::set<std::string> types
     auto f = os::File::alloc();
     f().open(resource.data(), os::File::Read, os::File::ShareRead, os::File::OpenExisting);
 
-    auto meta = it->second(f(), name, path, extension);
+    auto meta = it->second(f(), name, path, extension, flags, pool);
     // Check if parsing the file succeeded
     if(!meta.get()) continue;
 
@@ -154,6 +168,75 @@ void resourcegen(std::vector<std::string> resources, std::set<std::string> types
   }
 }
 
+void resourcepack(const std::string& out_path)
+{
+  using namespace std::literals::string_literals;
+
+  res::PackBuilder pack;
+
+  std::function<void(const std::string&)> enum_metas = [&](const std::string& path) {
+    auto dir_query = os::FileQuery::open((path + "*").data());
+
+    dir_query().foreach([&](const char *name, os::FileQuery::Attributes attrs) {
+      if(attrs & os::FileQuery::IsDirectory) enum_metas(path + name + "/"s);
+    });
+
+    auto meta_query = os::FileQuery::null();
+    try {
+      meta_query = os::FileQuery::open((path + "*.meta").data());
+    } catch(const os::FileQuery::Error&) {
+      return; // no .meta files in this directory
+    }
+
+    meta_query().foreach([&](const char *name, os::FileQuery::Attributes attrs) {
+      if(attrs & os::FileQuery::IsDirectory) return;
+
+      auto full_path = path + name;
+
+      auto f = os::File::alloc();
+      f().open(full_path.data(), os::File::Read, os::File::ShareRead, os::File::OpenExisting);
+
+      auto view = f().map(os::File::ProtectRead);
+      auto meta_data = std::string(view->get<const char>(), f().size());
+
+      yaml::Document meta;
+      try {
+        meta = yaml::Document::from_string(meta_data);
+      } catch(const yaml::Document::Error& e) {
+        throw GenError(util::fmt("%s: %s", full_path, e.what()));
+      }
+
+      if(!res::MetaLoader::validate(meta)) throw GenError(util::fmt("%s: invalid resource descriptor!", full_path));
+
+      auto guid = meta("guid")->as<yaml::Scalar>()->ui();
+
+      std::string payload_path;
+      if(auto location = meta("location")) {
+        auto location_scalar = location->as<yaml::Scalar>();
+
+        if(location_scalar->tag().value() == "!file") payload_path = location_scalar->str();
+      }
+
+      printf("packing %-25s: 0x%.16llx\n", full_path.data(), guid);
+
+      pack.add(guid, meta.toBinary(), full_path, payload_path);
+    });
+  };
+
+  enum_metas("./");
+
+  auto f_pack = os::File::alloc();
+  f_pack().open(out_path.data(), os::File::Write, os::File::ShareRead, os::File::CreateAlways);
+
+  try {
+    pack.write(f_pack());
+  } catch(const res::PackBuilder::DuplicateIdError& e) {
+    throw GenError(util::fmt("guid collision detected (0x%.16llx)", e.id));
+  }
+
+  printf("packed %zu resources into `%s'\n", pack.numEntries(), out_path.data());
+}
+
 template <typename T>
 yaml::Mapping *make_meta(const std::string& name, const std::string& path)
 {
@@ -199,7 +282,8 @@ static const std::vector<PragmaInfo> p_pragmas = {
 };
 
 static yaml::Document shadergen(os::File& file,
-  const std::string& name, const std::string& path, const std::string& extension)
+  const std::string& name, const std::string& path, const std::string& extension, uint flags,
+  sched::WorkerPool& pool)
 {
   auto view = file.map(os::File::ProtectRead);
   auto source = view->get<const char>();
@@ -317,7 +401,8 @@ static yaml::Document shadergen(os::File& file,
 }
 
 static yaml::Document imagegen(os::File& file,
-  const std::string& name, const std::string& path, const std::string& extension)
+  const std::string& name, const std::string& path, const std::string& extension, uint flags,
+  sched::WorkerPool& pool)
 {
   auto location = util::fmt("./%s/%s.%s", path, name, extension);
   std::optional<yaml::Document> params = std::nullopt;
@@ -367,7 +452,8 @@ static yaml::Document imagegen(os::File& file,
 }
 
 static yaml::Document texturegen(os::File& file,
-  const std::string& name, const std::string& path, const std::string& extension)
+  const std::string& name, const std::string& path, const std::string& extension, uint flags,
+  sched::WorkerPool& pool)
 {
   auto location = util::fmt("./%s/%s.%s", path, name, extension);
 
@@ -379,16 +465,61 @@ static yaml::Document texturegen(os::File& file,
   return yaml::Node::Ptr(meta);
 }
 
+// Meshes with at most this many triangles are used
+//   as their own occluders when baked
+static constexpr size_t p_max_occluder_triangles = 2048;
+
+// Writes out 'obj' as ./<path>/<name>.hmesh and returns
+//   the location of the written file
+//  - 'obj' MUST be normalized
+static std::string bake_mesh(const mesh::ObjLoader& obj,
+  const std::string& name, const std::string& path, uint flags)
+{
+  auto location = util::fmt("./%s/%s.hmesh", path, name);
+
+  auto builder = mesh::BinMeshBuilder()
+    .fromObj(obj, (flags & GenHalfFloatMeshes) ? mesh::BinMeshBuilder::HalfFloat : mesh::BinMeshBuilder::Default);
+
+  size_t num_tris = 0;
+  for(size_t i = 0; i < obj.numMeshes(); i++) num_tris += obj.mesh((uint)i).faces().size();
+
+  if(num_tris <= p_max_occluder_triangles && obj.vertices().size() <= (1u<<16)) {
+    std::vector<u16> inds;
+    inds.reserve(num_tris * 3);
+
+    for(size_t i = 0; i < obj.numMeshes(); i++) {
+      for(const auto& face : obj.mesh((uint)i).faces()) {
+        for(const auto& vert : face) inds.push_back((u16)vert.v);
+      }
+    }
+
+    builder.occluder(obj.vertices(), std::move(inds));
+  }
+
+  auto f_mesh = os::File::alloc();
+  f_mesh().open(location.data(), os::File::Write, os::File::ShareRead, os::File::CreateAlways);
+
+  auto sz = builder.write(f_mesh());
+
+  printf("    baked into %s (%zu bytes)\n", location.data(), sz);
+
+  return location;
+}
+
 static yaml::Document meshgen(os::File& file,
-  const std::string& name, const std::string& path, const std::string& extension)
+  const std::string& name, const std::string& path, const std::string& extension, uint flags,
+  sched::WorkerPool& pool)
 {
   auto location = util::fmt("./%s/%s.%s", path, name, extension);
 
   auto mesh_view = file.map(os::File::ProtectRead);
 
+  // Baked meshes are indexed with a single index for all attributes
+  uint load_flags = (flags & GenBakeMeshes) ? mesh::ObjLoader::Normalize : mesh::ObjLoader::Default;
+
   auto obj_loader = mesh::ObjLoader();
   try {
-    obj_loader.load(mesh_view->get<const char>(), file.size());
+    obj_loader.load(pool, mesh_view->get<const char>(), file.size(), load_flags);
   } catch(const mesh::MeshLoader::NonTriangularFaceError&) {
     printf("Non triangular face present!\n");
     printf("    ...skipping\n");
@@ -404,6 +535,17 @@ static yaml::Document meshgen(os::File& file,
   auto obj_mesh = obj_loader.mesh();
   [[maybe_unused]] size_t num_faces = obj_mesh.faces().size();
 
+  if(flags & GenBakeMeshes) {
+    if(flags & GenOptimizeMeshes) {
+      auto stats = obj_loader.optimize(mesh::OptimizeOverdraw);
+
+      printf("    optimized: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+          stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr);
+    }
+
+    location = bake_mesh(obj_loader, name, path, flags);
+  }
+
   auto meta_vertex = new yaml::Mapping();
   meta_vertex->retainOrder()->append(
     yaml::Scalar::from_str("normals"), yaml::Scalar::from_b(obj_loader.hasNormals())
@@ -449,7 +591,13 @@ void ltc_lut_gen()
   auto ggx = brdf::BRDF_GGX();
   auto ltc_lut = ltc::LTC_CoeffsTable();
 
-  ltc_lut.fit(ggx);
+  // The rows of the table can be fit in parallel
+  sched::WorkerPool fit_pool;
+  fit_pool.kickWorkers("LTC_FitWorker");
+
+  ltc_lut.fit(ggx, &fit_pool);
+
+  fit_pool.killWorkers();
 
   auto f_name = util::fmt("./%s/%s.meta",
     meta("path")->as<yaml::Scalar>()->str(),
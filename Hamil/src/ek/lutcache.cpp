@@ -0,0 +1,173 @@
+#include <ek/lutcache.h>
+
+#include <res/res.h>
+#include <res/manager.h>
+#include <util/hash.h>
+#include <os/file.h>
+#include <os/error.h>
+
+#include <cstring>
+
+namespace ek {
+
+static size_t align_data(size_t sz, size_t alignment)
+{
+  return (sz + (alignment-1)) & ~(alignment-1);
+}
+
+RenderLUTCache::RenderLUTCache() :
+  m_mutex(os::Mutex::alloc())
+{
+}
+
+RenderLUTCache::Key RenderLUTCache::key(u32 type, int param, u32 generator_version)
+{
+  const u32 data[] = { type, (u32)param, generator_version };
+
+  return util::hash(data, sizeof(data));
+}
+
+void RenderLUTCache::load(const std::string& path)
+{
+  res::IOBuffer view;
+  try {
+    view = res::resources().mapFile(path);
+  } catch(const os::Error&) {
+    // No cache yet - 'view' is left empty
+  }
+
+  load(view);
+}
+
+void RenderLUTCache::load(const res::IOBuffer& view)
+{
+  auto guard = m_mutex->acquireScoped();
+
+  m_records.clear();
+  m_num_loaded = 0;
+  m_inserted = false;
+
+  auto sz = view.size();
+  if(sz < sizeof(Header)) return;
+
+  auto data = view.get<const byte>();
+
+  Header header;
+  memcpy(&header, data, sizeof(Header));
+
+  if(header.magic != Magic || header.version != Version) return;
+
+  size_t offset = sizeof(Header);
+  for(u64 i = 0; i < header.num_records; i++) {
+    // The padding of the last record can put 'offset' past
+    //   the end, and 'record.size' is untrusted - so never
+    //   add to 'offset' before comparing
+    RecordHeader record;
+    if(offset > sz || sizeof(RecordHeader) > sz - offset) break;
+
+    memcpy(&record, data + offset, sizeof(RecordHeader));
+    offset += sizeof(RecordHeader);
+
+    if(record.size > sz - offset) break;   // Truncated cache
+
+    // The records share ownership of the mapping
+    m_records[record.key].data = view.slice(offset, record.size);
+
+    offset += align_data(record.size, DataAlign);
+  }
+
+  m_num_loaded = m_records.size();
+}
+
+void RenderLUTCache::save(const std::string& path)
+{
+  auto guard = m_mutex->acquireScoped();
+
+  std::string out;
+
+  Header header;
+  header.magic = Magic;
+  header.version = Version;
+  header.num_records = 0;
+
+  out.append((const char *)&header, sizeof(Header));
+
+  for(auto it = m_records.begin(); it != m_records.end();) {
+    auto& r = it->second;
+    if(!r.used) {
+      it = m_records.erase(it);
+      continue;
+    }
+
+    RecordHeader record;
+    record.key = it->first;
+    record.size = r.data.size();
+
+    out.append((const char *)&record, sizeof(RecordHeader));
+    out.append(r.data.get<const char>(), r.data.size());
+    out.append(align_data(r.data.size(), DataAlign) - r.data.size(), '\0');
+
+    // Copy the data out of the mapping so it can be released
+    auto copy = res::IOBuffer::make_memory_buffer(r.data.size());
+    memcpy(copy.get(), r.data.get(), r.data.size());
+
+    r.data = copy;
+
+    header.num_records++;
+    it++;
+  }
+
+  memcpy(out.data(), &header, sizeof(Header));
+
+  m_num_loaded = m_records.size();
+  m_inserted = false;
+
+  auto f = os::File::alloc();
+  f().open(path.data(), os::File::Write, os::File::ShareRead, os::File::CreateAlways);
+
+  f().write(out.data(), out.size());
+}
+
+bool RenderLUTCache::dirty() const
+{
+  auto guard = m_mutex->acquireScoped();
+  if(m_inserted) return true;
+
+  size_t num_used = 0;
+  for(const auto& [key, r] : m_records) {
+    if(r.used) num_used++;
+  }
+
+  return num_used != m_num_loaded;
+}
+
+res::IOBuffer RenderLUTCache::probe(Key k, size_t sz)
+{
+  auto guard = m_mutex->acquireScoped();
+
+  auto it = m_records.find(k);
+  if(it == m_records.end()) return {};
+
+  auto& r = it->second;
+  if(sz && r.data.size() != sz) return {};  // Stale record
+
+  r.used = true;
+
+  return r.data;
+}
+
+void RenderLUTCache::insert(Key k, const void *data, size_t sz)
+{
+  auto buf = res::IOBuffer::make_memory_buffer(sz);
+  memcpy(buf.get(), data, sz);
+
+  auto guard = m_mutex->acquireScoped();
+
+  auto& r = m_records[k];
+  r.data = buf;
+  r.used = true;
+
+  m_inserted = true;
+}
+
+}
@@ -8,6 +8,7 @@
 #include <math/util.h>
 #include <math/brdf.h>
 #include <math/ltc.h>
+#include <math/cull.h>
 #include <hm/component.h>
 #include <hm/components/gameobject.h>
 #include <hm/components/transform.h>
@@ -15,11 +16,18 @@
 #include <hm/components/material.h>
 #include <hm/components/light.h>
 #include <hm/components/visibility.h>
+#include <hm/transformsystem.h>
+#include <gx/info.h>
+#include <gx/buffer.h>
 #include <gx/resourcepool.h>
+#include <gx/meshpool.h>
 #include <gx/memorypool.h>
 #include <gx/program.h>
 #include <gx/fence.h>
+#include <sched/pool.h>
+#include <os/error.h>
 #include <res/res.h>
+#include <res/manager.h>
 #include <res/handle.h>
 #include <res/shader.h>
 #include <res/texture.h>
@@ -30,6 +38,8 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 
 #include <algorithm>
 #include <random>
@@ -42,86 +52,137 @@ RenderLUT::RenderLUT() :
 {
 }
 
-void RenderLUT::generate(gx::ResourcePool& pool)
+void RenderLUT::generate(gx::ResourcePool& pool, RenderLUTCache *cache)
 {
   switch(type) {
-  case GaussianKernel: generateGaussian(pool); break;
-  case LTCCoeffs:     generateLTC(pool); break;
-  case HBAONoise:     generateHBAONoise(pool); break;
+  case GaussianKernel: generateGaussian(pool, cache); break;
+  case LTCCoeffs:     generateLTC(pool, cache); break;
+  case HBAONoise:     generateHBAONoise(pool, cache); break;
 
   default: assert(0);  // unreachable
   }
 }
 
-void RenderLUT::generateGaussian(gx::ResourcePool& pool)
+res::IOBuffer RenderLUT::cachedData(RenderLUTCache *cache, size_t sz, const GenerateDataFn& gen) const
 {
-  auto kernel = gaussian_kernel(param);
+  auto key = RenderLUTCache::key(type, param, GeneratorVersion);
 
+  if(cache) {
+    if(auto data = cache->probe(key, sz)) return data;
+  }
+
+  auto data = res::IOBuffer::make_memory_buffer(sz);
+  gen(data.get());
+
+  if(cache) cache->insert(key, data.get(), sz);
+
+  return data;
+}
+
+void RenderLUT::generateGaussian(gx::ResourcePool& pool, RenderLUTCache *cache)
+{
   auto kernel_dims = param*2 + 1;
 
+  // The kernel is followed by the normalization factor
+  auto kernel_size = (size_t)kernel_dims + 1;
+
+  auto kernel = cachedData(cache, kernel_size*sizeof(float), [this,kernel_size](void *data) {
+    auto kernel = gaussian_kernel(param);
+    assert(kernel.size() == kernel_size);
+
+    memcpy(data, kernel.data(), kernel_size*sizeof(float));
+  });
+
   tex_id = pool.createTexture<gx::Texture1D>(
     util::fmt("t1dGaussianKernel%dx%d", kernel_dims, kernel_dims),
     gx::r32f);
   auto blur_kernel = pool.getTexture(tex_id);
   blur_kernel()
-    .init(kernel.data(), 0, (unsigned)kernel.size(), gx::r, gx::Type::f32);
+    .init(kernel.get<float>(), 0, (unsigned)kernel_size, gx::r, gx::Type::f32);
 }
 
-void RenderLUT::generateLTC(gx::ResourcePool& pool)
+void RenderLUT::generateLTC(gx::ResourcePool& pool, RenderLUTCache *cache)
 {
   static constexpr auto TexSize = ltc::LTC_CoeffsTable::TableSize;
+  static constexpr size_t CoeffsSize = sizeof(ltc::LTC_CoeffsTable::CoeffsArray);
 
   res::load(R.texture.ids);
 
-  return;
+  auto upload = [&](const u16 *coeffs1, const u16 *coeffs2) {
+    tex_id = pool.createTexture<gx::Texture2DArray>(
+      "t2daLTCCoefficients",
+      gx::rgba16f);
+    auto ltc = pool.getTexture(tex_id);
+
+    ltc().init(TexSize.s, TexSize.t, 2);
+    ltc().upload(coeffs1, /* mip */ 0,
+      /* x */ 0, /* y */ 0, /* z */ 0, TexSize.s, TexSize.t, 1,
+      gx::rgba, gx::Type::f16);
+    ltc().upload(coeffs2, /* mip */ 0,
+      /* x */ 0, /* y */ 0, /* z */ 1, TexSize.s, TexSize.t, 1,
+      gx::rgba, gx::Type::f16);
+  };
+
+  // The table baked by 'resourcegen --ltc-lut-gen' is
+  //   already mapped straight from disk...
+  try {
+    res::load(R.lut.ltc_lut);
+    res::Handle<res::LookupTable> r_ltc = R.lut.ltc_lut;
+    auto ltc = r_ltc.lock();
+
+    if(ltc->size() == CoeffsSize*2) {
+      auto coeffs = (const u16 *)ltc->data();
+      upload(coeffs, coeffs + TexSize.area()*4);
+
+      return;
+    }
+  } catch(const res::ResourceManager::Error&) {
+    // Not baked - fit the table below
+  }
 
-#if 0
-  res::Handle<res::Texture> r_ltc_1 = R.texture.ltc_1,
-    r_ltc_2 = R.texture.ltc_2;
+  // ...otherwise it has to be fit, which takes a good while,
+  //   so the result is kept in the RenderLUTCache
+  auto coeffs = cachedData(cache, CoeffsSize*2, [](void *data) {
+    auto ggx = brdf::BRDF_GGX();
+    auto table = ltc::LTC_CoeffsTable();
 
-  auto coeffs1 = r_ltc_1->get().image().getData();
-  auto coeffs2 = r_ltc_2->get().image().getData();
-#else
-  res::load(R.lut.ltc_lut);
-  res::Handle<res::LookupTable> r_ltc = R.lut.ltc_lut;
+    sched::WorkerPool fit_pool;
+    fit_pool.kickWorkers("LTC_FitWorker");
 
-  auto coeffs1 = (u16 *)r_ltc->data();
-  auto coeffs2 = coeffs1 + TexSize.area()*4;
-#endif
+    table.fit(ggx, &fit_pool);
 
-  tex_id = pool.createTexture<gx::Texture2DArray>(
-    "t2daLTCCoefficients",
-    gx::rgba16f);
-  auto ltc = pool.getTexture(tex_id);
+    fit_pool.killWorkers();
+
+    memcpy(data, table.coeffs1().data(), CoeffsSize);
+    memcpy((byte *)data + CoeffsSize, table.coeffs2().data(), CoeffsSize);
+  });
 
-  ltc().init(TexSize.s, TexSize.t, 2);
-  ltc().upload(coeffs1, /* mip */ 0,
-    /* x */ 0, /* y */ 0, /* z */ 0, TexSize.s, TexSize.t, 1,
-    gx::rgba, gx::Type::f16);
-  ltc().upload(coeffs2, /* mip */ 0,
-    /* x */ 0, /* y */ 0, /* z */ 1, TexSize.s, TexSize.t, 1,
-    gx::rgba, gx::Type::f16);
+  auto coeffs1 = coeffs.get<const u16>();
+  upload(coeffs1, coeffs1 + TexSize.area()*4);
 }
 
-void RenderLUT::generateHBAONoise(gx::ResourcePool& pool)
+void RenderLUT::generateHBAONoise(gx::ResourcePool& pool, RenderLUTCache *cache)
 {
   static constexpr uvec2 NoiseSize = { 4, 4 };
   const float NumDirections = param > 0 ? (float)param : 8.0f;
 
-  // Generate random rotations and offsets for HBAO kernel
+  auto noise = cachedData(cache, NoiseSize.area()*sizeof(vec3), [=](void *data) {
+    // Generate random rotations and offsets for HBAO kernel
 
-  std::mt19937 rd;
-  std::uniform_real_distribution<float> floats(0.0f, 1.0f);
-  std::array<vec3, NoiseSize.area()> noise;
-  for(auto& sample : noise) {
-    float r0 = floats(rd),
-      r1 = floats(rd);
+    std::mt19937 rd;
+    std::uniform_real_distribution<float> floats(0.0f, 1.0f);
 
-    float angle = 2.0f*PIf*r0 / NumDirections;
+    auto sample = (vec3 *)data;
+    for(unsigned i = 0; i < NoiseSize.area(); i++) {
+      float r0 = floats(rd),
+        r1 = floats(rd);
 
-    // sample = vec3(cos(rotation), sin(rotation), start_offset)
-    sample = vec3(cosf(angle), sinf(angle), r1);
-  }
+      float angle = 2.0f*PIf*r0 / NumDirections;
+
+      // sample = vec3(cos(rotation), sin(rotation), start_offset)
+      sample[i] = vec3(cosf(angle), sinf(angle), r1);
+    }
+  });
 
   tex_id = pool.createTexture<gx::Texture2D>(
     util::fmt("t2dHBAONoise%d", (int)NumDirections),
@@ -129,7 +190,7 @@ void RenderLUT::generateHBAONoise(gx::ResourcePool& pool)
   auto noise_tex = pool.getTexture(tex_id);
 
   noise_tex()
-    .init(noise.data(), 0, NoiseSize.s, NoiseSize.t, gx::rgb, gx::Type::f32);
+    .init(noise.get<vec3>(), 0, NoiseSize.s, NoiseSize.t, gx::rgb, gx::Type::f32);
 }
 
 class RendererData {
@@ -138,15 +199,18 @@ public:
 
   RendererData() :
     pool(InitialResourcePoolAlloc),
+    mesh_pool(pool),
     raster_pool(std::max<int>(ViewVisibility::NumJobs, OcclusionBuffer::NumJobs))
   { }
 
   gx::ResourcePool pool;
+  gx::MeshPool mesh_pool;    // Must be destroyed before 'pool'
   sched::WorkerPool raster_pool;
 };
 
 Renderer::Renderer() :
-  m_data(new RendererData)
+  m_data(new RendererData),
+  m_transforms(nullptr)
 {
   m_data->raster_pool.kickWorkers("Occlusion_Worker");
 
@@ -174,17 +238,37 @@ Renderer::Renderer() :
   m_mempools_lock = os::ReaderWriterLock::alloc();
   m_mempools.reserve(InitialMemoryPools);
 
+  //   IndirectBuffer
+  //     - Labeling a Buffer binds it, which can only be done
+  //       when IndirectBuffers are supported
+  m_indirect_buffer = gx::info().multiDrawIndirect() ?
+    pool().createBuffer<gx::IndirectBuffer>("buIndirectDraws", gx::Buffer::Stream) :
+    pool().createBuffer<gx::IndirectBuffer>(gx::Buffer::Stream);
+
   precacheLUTs();
   precacheSamplers();
 }
 
 Renderer::~Renderer()
 {
+  // Saved here (and not after precacheLUTs()) so the
+  //   LUTs generated by queryLUT() aren't pruned
+  //  - Failing to write the cache only means the LUTs
+  //    will be generated again on the next run
+  if(m_lut_cache.dirty()) {
+    try {
+      m_lut_cache.save(LUTCacheFile);
+    } catch(const os::Error& e) {
+      printf("warning: RenderLUT cache '%s' couldn't be saved (%s)\n", LUTCacheFile, e.what());
+    }
+  }
+
   // RenderTargets release their resources in the destructor
   m_rts.clear();
 
   for(auto program_id : m_programs) pool().release<gx::Program>(program_id);
   for(auto& buf : m_const_buffers)  pool().releaseBuffer(buf.id());
+  pool().releaseBuffer(m_indirect_buffer);
   for(auto render_lut : m_luts)     pool().releaseTexture(render_lut.tex_id);
   for(auto sampler : m_samplers)    pool().release<gx::Sampler>(sampler.second);
 
@@ -199,6 +283,32 @@ Renderer::~Renderer()
   delete m_data;
 }
 
+// Prepended to the vertex stage of every Program which fetches
+//   ObjectConstants, so the shaders never have to know whether
+//   they're drawn instanced or not - they should always index
+//   the ObjectConstantsBlock with OBJECT_CONSTANTS_INDEX
+//  - gl_BaseInstanceARB selects the ObjectConstants of each draw
+//    of a multiDrawIndirect() (see programSupportsMultiDraw())
+static const char *p_object_constants_vs_prelude[] = {
+  "#define OBJECT_CONSTANTS_INDEX (uObjectConstantsOffset)\n\n",
+
+  "#define INSTANCING 1\n"
+  "#if defined(GL_ARB_shader_draw_parameters)\n"
+  "#  define OBJECT_CONSTANTS_INDEX (uObjectConstantsOffset + gl_BaseInstanceARB + gl_InstanceID)\n"
+  "#else\n"
+  "#  define OBJECT_CONSTANTS_INDEX (uObjectConstantsOffset + gl_InstanceID)\n"
+  "#endif\n\n",
+};
+
+static std::vector<const char *> object_constants_vs_source(const std::vector<const char *>& vs, bool instanced)
+{
+  std::vector<const char *> source = { p_object_constants_vs_prelude[instanced] };
+
+  source.insert(source.end(), vs.begin(), vs.end());
+
+  return source;
+}
+
 Renderer& Renderer::cachePrograms()
 {
   if(!m_programs.empty()) return *this; // Already cached
@@ -215,10 +325,18 @@ Renderer& Renderer::cachePrograms()
   res::Handle<res::Shader> f_forward = R.shader.shaders.forward;
   res::Handle<res::Shader> f_rendermsm = R.shader.shaders.rendermsm;
 
+  // Both programs index their ObjectConstants with
+  //   OBJECT_CONSTANTS_INDEX (see above), so they can
+  //   draw whole InstanceBatches at once
+  const bool forward_instanced = true;
+  const bool rendermsm_instanced = true;
+
   auto forward = pool().create<gx::Program>(gx::make_program("pForward",
-    f_forward->source(res::Shader::Vertex), f_forward->source(res::Shader::Fragment), U.forward));
+    object_constants_vs_source(f_forward->source(res::Shader::Vertex), forward_instanced),
+    f_forward->source(res::Shader::Fragment), U.forward));
   auto rendermsm = pool().create<gx::Program>(gx::make_program("pMSM",
-    f_rendermsm->source(res::Shader::Vertex), f_rendermsm->source(res::Shader::Fragment), U.rendermsm));
+    object_constants_vs_source(f_rendermsm->source(res::Shader::Vertex), rendermsm_instanced),
+    f_rendermsm->source(res::Shader::Fragment), U.rendermsm));
 
   // Writing to 'm_programs'
   m_programs_lock->acquireExclusive();
@@ -226,6 +344,9 @@ Renderer& Renderer::cachePrograms()
   m_programs.push_back(forward);
   m_programs.push_back(rendermsm);
 
+  m_programs_instancing.push_back(forward_instanced);
+  m_programs_instancing.push_back(rendermsm_instanced);
+
   m_programs_lock->releaseExclusive();
 
   return *this;
@@ -242,6 +363,13 @@ Renderer::ExtractObjectsJob Renderer::extractForView(hm::Entity scene, RenderVie
   ));
 }
 
+Renderer& Renderer::transformSystem(const hm::TransformSystem *transforms)
+{
+  m_transforms = transforms;
+
+  return *this;
+}
+
 const RenderTarget& Renderer::queryRenderTarget(const RenderTargetConfig& config, u32 fence_id)
 {
   auto& fence = pool().get<gx::Fence>(fence_id);
@@ -308,6 +436,39 @@ u32 Renderer::queryProgram(const RenderView& view, const RenderObject& ro)
   return program;
 }
 
+u32 Renderer::indirectBuffer() const
+{
+  return m_indirect_buffer;
+}
+
+bool Renderer::programSupportsInstancing(u32 program)
+{
+  if(m_programs.empty()) cachePrograms();
+
+  m_programs_lock->acquireShared();
+
+  bool supports_instancing = false;
+  for(size_t i = 0; i < m_programs.size(); i++) {
+    if(m_programs[i] != program) continue;
+
+    supports_instancing = m_programs_instancing[i];
+    break;
+  }
+
+  m_programs_lock->releaseShared();
+
+  return supports_instancing;
+}
+
+bool Renderer::programSupportsMultiDraw(u32 program)
+{
+  // The shaders can only read the per-draw base_instance
+  //   when the draws are issued through an IndirectBuffer
+  if(!gx::info().multiDrawIndirect() || !gx::info().shaderDrawParameters()) return false;
+
+  return programSupportsInstancing(program);
+}
+
 const ConstantBuffer& Renderer::queryConstantBuffer(size_t sz, u32 fence_id, const std::string& label)
 {
   auto& fence = pool().get<gx::Fence>(fence_id);
@@ -394,7 +555,7 @@ u32 Renderer::queryLUT(RenderLUT::Type type, int param)
   m_luts_lock->releaseExclusive();
 
   // Generate and upload the texture
-  lut.generate(pool());
+  lut.generate(pool(), &m_lut_cache);
 
   return lut.tex_id;
 }
@@ -547,23 +708,30 @@ gx::ResourcePool& Renderer::pool()
   return m_data->pool;
 }
 
+gx::MeshPool& Renderer::meshPool()
+{
+  return m_data->mesh_pool;
+}
+
 void Renderer::precacheLUTs()
 {
   // Load pre-computed LUTs
   res::load(R.lut.ids);
 
+  m_lut_cache.load(LUTCacheFile);
+
   auto& gauss_lut = m_luts.emplace_back();
   gauss_lut.type = RenderLUT::GaussianKernel;
   gauss_lut.param = RenderView::ShadowBlurRadius;
-  gauss_lut.generate(pool());
+  gauss_lut.generate(pool(), &m_lut_cache);
 
   auto& ltc_lut = m_luts.emplace_back();
   ltc_lut.type = RenderLUT::LTCCoeffs;
-  ltc_lut.generate(pool());
+  ltc_lut.generate(pool(), &m_lut_cache);
 
   auto& hbao_nosie_lut = m_luts.emplace_back();
   hbao_nosie_lut.type = RenderLUT::HBAONoise;
-  hbao_nosie_lut.generate(pool());
+  hbao_nosie_lut.generate(pool(), &m_lut_cache);
 }
 
 void Renderer::precacheSamplers()
@@ -580,6 +748,7 @@ void Renderer::precacheSamplers()
 Renderer::ObjectVector Renderer::doExtractForView(hm::Entity scene, RenderView& view)
 {
   ObjectVector objects;
+  std::vector<size_t> frustum_cull;
   auto frustum = view.constructFrustum();
 
   // Make the Components immutable
@@ -591,9 +760,11 @@ Renderer::ObjectVector Renderer::doExtractForView(hm::Entity scene, RenderView&
 
   auto transform_matrix = scene.component<hm::Transform>().get().matrix();
   scene.gameObject().foreachChild([&](hm::Entity e) {
-    extractOne(view, objects, frustum, e, transform_matrix);
+    extractOne(view, objects, frustum_cull, frustum, e, transform_matrix);
   });
 
+  frustumCullObjects(objects, frustum_cull, frustum);
+
   // Done reading components
   //hm::components().unlock();
 
@@ -608,18 +779,27 @@ Renderer::ObjectVector Renderer::doExtractForView(hm::Entity scene, RenderView&
   return objects;
 }
 
-void Renderer::extractOne(RenderView& view, ObjectVector& objects,
+void Renderer::extractOne(RenderView& view, ObjectVector& objects, std::vector<size_t>& frustum_cull,
   const frustum3& frustum, hm::Entity e, const mat4& parent)
 {
-  auto transform = e.component<hm::Transform>();
-  auto model_matrix = parent * transform().matrix();
-  auto aabb = transform().aabb;
+  mat4 model_matrix;
+  AABB aabb;
+
+  if(m_transforms && m_transforms->contains(e.id())) {
+    model_matrix = m_transforms->world(e.id());
+    aabb = m_transforms->worldAABB(e.id());
+  } else {
+    auto transform = e.component<hm::Transform>();
+
+    model_matrix = parent * transform().matrix();
+    aabb = transform().aabb;
+  }
 
   bool occlusion_cull = view.wantsOcclusionCulling();
 
   // Extract children
   e.gameObject().foreachChild([&](hm::Entity child) {
-    extractOne(view, objects, frustum, child, model_matrix);
+    extractOne(view, objects, frustum_cull, frustum, child, model_matrix);
   });
 
   // Extract the object
@@ -634,7 +814,8 @@ void Renderer::extractOne(RenderView& view, ObjectVector& objects,
 
       view.visibility().addObjectRef(vis().visObject());
     } else if(vis && !occlusion_cull) {  // Otherwise - do simple frustum culling
-      if(!frustum.aabbInside(aabb)) return;
+      frustum_cull.push_back(objects.size());   // Deferred until the whole
+                                                //   scene has been extracted
     } else {
       return;   // Assume Entities with no Visibility Component
                 //   are invisible
@@ -662,6 +843,46 @@ void Renderer::extractOne(RenderView& view, ObjectVector& objects,
   }
 }
 
+void Renderer::frustumCullObjects(ObjectVector& objects,
+  const std::vector<size_t>& indices, const frustum3& frustum)
+{
+  if(indices.empty()) return;
+
+  auto num = indices.size();
+
+  std::vector<float> min_x(num), min_y(num), min_z(num);
+  std::vector<float> max_x(num), max_y(num), max_z(num);
+  for(size_t i = 0; i < num; i++) {
+    const auto& aabb = objects[indices[i]].mesh().aabb;
+
+    min_x[i] = aabb.min.x; min_y[i] = aabb.min.y; min_z[i] = aabb.min.z;
+    max_x[i] = aabb.max.x; max_y[i] = aabb.max.y; max_z[i] = aabb.max.z;
+  }
+
+  AABBsSoA aabbs = {
+    min_x.data(), min_y.data(), min_z.data(),
+    max_x.data(), max_y.data(), max_z.data(),
+  };
+
+  std::vector<u32> inside(cull_mask_size(num));
+  frustum_aabbs_inside(frustum, aabbs, num, inside.data());
+
+  // 'indices' are in increasing order, so the objects can
+  //   be compacted in a single pass
+  size_t out = indices.front();
+  size_t next_cull = 0;
+  for(size_t i = indices.front(); i < objects.size(); i++) {
+    if(next_cull < num && indices[next_cull] == i) {
+      if(!cull_mask_test(inside.data(), next_cull++)) continue;
+    }
+
+    if(out != i) objects[out] = std::move(objects[i]);
+    out++;
+  }
+
+  objects.erase(objects.begin() + out, objects.end());
+}
+
 // TODO: Better light culling
 bool Renderer::cullLight(RenderView& view, const vec3& pos,
   const hm::Light& light, const frustum3& frustum)
@@ -17,6 +17,7 @@
 #include <gx/vertex.h>
 #include <gx/texture.h>
 #include <gx/fence.h>
+#include <gx/multidraw.h>
 #include <hm/components/mesh.h>
 #include <hm/components/material.h>
 #include <hm/components/light.h>
@@ -27,6 +28,8 @@
 #include <cstring>
 #include <algorithm>
 #include <optional>
+#include <tuple>
+#include <map>
 
 namespace ek {
 
@@ -105,6 +108,61 @@ struct alignas(16) ObjectShadowConstants {
 };
 #pragma pack(pop)
 
+// Used to gather the RenderObjects which can be instanced
+//   (see RenderView::canInstance()) into groups
+static auto instance_sort_key(const RenderObject& ro)
+{
+  const auto& meshes = ro.mesh().mesh().m;
+  const auto& material = ro.mesh().mat();
+
+  u32 diff_tex = material.diff_type == hm::Material::DiffuseTexture ?
+    material.diff_tex.id : ~0u;
+
+  if(meshes.empty()) return std::make_tuple(~0u, ~0u, ~0u, ~0u, 0u, diff_tex);
+
+  const auto& m = meshes.front();
+  return std::make_tuple(m.vertex_array_id, m.base, m.offset, m.num, meshes.size(), diff_tex);
+}
+
+// Returns 'true' when 'a' and 'b' are drawn with the same diffuse
+//   texture (the rest of the material's properties are stored
+//   in the per-object ObjectConstants)
+static bool same_diffuse_texture(const RenderObject& a, const RenderObject& b)
+{
+  const auto& a_material = a.mesh().mat();
+  const auto& b_material = b.mesh().mat();
+
+  auto a_textured = a_material.diff_type == hm::Material::DiffuseTexture;
+  auto b_textured = b_material.diff_type == hm::Material::DiffuseTexture;
+
+  if(a_textured != b_textured) return false;
+  if(!a_textured) return true;
+
+  return a_material.diff_tex.id == b_material.diff_tex.id &&
+    a_material.diff_tex.sampler_id == b_material.diff_tex.sampler_id;
+}
+
+// Returns 'true' when all of 'ro's meshes are indexed and source their
+//   vertices from one IndexedVertexArray (i.e. were sub-allocated from
+//   a single gx::MeshPool arena) with the same Primitive, which are
+//   then written to 'array' and 'primitive'
+static bool mesh_arena(const RenderObject& ro, gx::ResourcePool::Id& array, gx::Primitive& primitive)
+{
+  const auto& meshes = ro.mesh().mesh().m;
+  if(meshes.empty()) return false;
+
+  array = meshes.front().vertex_array_id;
+  primitive = meshes.front().getPrimitive();
+
+  bool shared = true;
+  meshes.foreach([&](const mesh::Mesh& mesh) {
+    if(!mesh.isIndexed()) shared = false;
+    if(mesh.vertex_array_id != array || mesh.getPrimitive() != primitive) shared = false;
+  });
+
+  return shared;
+}
+
 class RenderViewData {
 public:
   // Make SURE to unmap this before calling CommandBuffer::execute()!
@@ -269,9 +327,9 @@ RenderView::RenderJob RenderView::render()
 
 const RenderView::RenderFn RenderView::RenderFns[NumViewTypes][NumRenderTypes] = {
   { nullptr, nullptr, nullptr },   // Invalid
-  { nullptr, &RenderView::forwardCameraRenderOne, nullptr },   // CameraView
+  { nullptr, &RenderView::forwardCameraRenderBatch, nullptr },   // CameraView
   { nullptr, nullptr, nullptr },   // LightView
-  { &RenderView::shadowRenderOne, nullptr, nullptr },   // ShadowView
+  { &RenderView::shadowRenderBatch, nullptr, nullptr },   // ShadowView
 };
 
 gx::CommandBuffer RenderView::doRender(std::vector<RenderObject>& objects)
@@ -308,6 +366,8 @@ gx::CommandBuffer RenderView::doRender(std::vector<RenderObject>& objects)
     return eye.distance2(a_pos) > eye.distance2(b_pos);
   });
 
+  groupInstances(objects, meshes_off);
+
   auto cmd = gx::CommandBuffer::begin()
     .bindResourcePool(&pool())
     .bindMemoryPool(m_mempools.front()->ptr())
@@ -319,7 +379,10 @@ gx::CommandBuffer RenderView::doRender(std::vector<RenderObject>& objects)
   int num_culled = 0;
   int num_full_tests = 0;
 #endif
-  auto render_one = RenderFns[m_type][m_render];
+  // RenderObjects which survived culling
+  std::vector<const RenderObject *> visible;
+  visible.reserve(objects.size() - meshes_off);
+
   for(size_t i = meshes_off; i < objects.size(); i++) {
     const auto& ro = objects[i];
 
@@ -346,8 +409,49 @@ gx::CommandBuffer RenderView::doRender(std::vector<RenderObject>& objects)
 
     if(meshes_culled == vis_object->numMeshes()) continue;
 
-    (this->*render_one)(ro, cmd);
+    visible.push_back(&ro);
+  }
+
+  auto render_batch = RenderFns[m_type][m_render];
+  for(size_t i = 0; i < visible.size();) {
+    // All of the instances' ObjectConstants must fit
+    //   in the currently bound block
+    auto max_instances = numFreeConstantBlockSlots();
+
+    size_t num_instances = 1;
+    while(i+num_instances < visible.size() && num_instances < max_instances) {
+      if(!canInstance(*visible[i], *visible[i+num_instances])) break;
+
+      num_instances++;
+    }
+
+    // RenderObjects which can't be instanced can still share
+    //   a single multiDrawIndirect()
+    bool multi_draw = false;
+    if(num_instances == 1) {
+      size_t num_draws = visible[i]->mesh().mesh().m.size();
+      while(i+num_instances < visible.size() && num_instances < max_instances) {
+        const auto& next = *visible[i+num_instances];
+        if(!canMultiDraw(*visible[i], next)) break;
+
+        num_draws += next.mesh().mesh().m.size();
+        if(num_draws > gx::MultiDrawBuilder::MaxDraws) break;
+
+        num_instances++;
+      }
+
+      multi_draw = num_instances > 1;
+    }
+
+    InstanceBatch batch;
+    batch.objects = visible.data() + i;
+    batch.num = num_instances;
+    batch.multi_draw = multi_draw;
+
+    (this->*render_batch)(batch, cmd);
     advanceConstantBlockBinding(cmd);
+
+    i += num_instances;
   }
 
 #if !defined(NDEBUG)
@@ -551,13 +655,20 @@ void RenderView::initConstantBuffers(size_t num_ros)
   const u32 ObjectConstantsSize = constantBlockSizeAlign(sizeof(ObjectConstants));
   const u32 SceneConstantsSize  = constantBlockSizeAlign(sizeof(SceneConstants));
 
-  // Unaligned size of ObjectConstants UniformBuffer
-  const size_t ObjectConstantBufferUASize = num_ros * ObjectConstantsSize;
+  // The ObjectConstants UniformBuffer is bound one block of
+  //   m_num_objects_per_block ObjectConstants at a time, and both
+  //   advanceConstantBlockBinding() and numFreeConstantBlockSlots()
+  //   derive the block boundaries from this number
+  m_num_objects_per_block = std::min(m_constant_block_sz / ObjectConstantsSize, 256u);
+
+  // Size of one such block - ObjectConstantsSize is already
+  //   aligned, so every block's offset is a valid bind offset
+  const u32 ObjectConstantBlockSize = (u32)m_num_objects_per_block * ObjectConstantsSize;
 
-  // Must be a multiple of ConstantBlockMaxSize, so align it assuming it's
-  //   unaligned (could waste some space in case that's false)
-  const size_t ObjectConstantBufferSize = ObjectConstantBufferUASize +
-    /* align */ (m_constant_block_sz - (ObjectConstantBufferUASize % m_constant_block_sz));
+  // Must be a multiple of ObjectConstantBlockSize, so the
+  //   last block can always be bound in whole
+  const size_t num_blocks = (num_ros + m_num_objects_per_block-1) / m_num_objects_per_block;
+  const size_t ObjectConstantBufferSize = std::max<size_t>(num_blocks, 1) * ObjectConstantBlockSize;
 
   m_const_bufs[SceneConstantsBinding] = &renderer().queryConstantBuffer(
     constantBlockSizeAlign(SceneConstantsSize), m_data->fence,
@@ -568,8 +679,6 @@ void RenderView::initConstantBuffers(size_t num_ros)
     labelPrefix() + "ObjectConstants"
   );
 
-  m_num_objects_per_block = std::min(m_constant_block_sz / ObjectConstantsSize, 256u);
-
   m_data->object_ubo_view.emplace(
     constantBuffer(ObjectConstantsBinding).map(gx::Buffer::Write,
       // ConstantBuffers returned by renderer().queryConstantBuffer() are
@@ -584,7 +693,7 @@ void RenderView::initConstantBuffers(size_t num_ros)
   getRenderpass()
     .uniformBuffersRange({
       { SceneConstantsBinding,  { constantBufferId(SceneConstantsBinding), 0, SceneConstantsSize } },
-      { ObjectConstantsBinding, { constantBufferId(ObjectConstantsBinding), 0, m_constant_block_sz } },
+      { ObjectConstantsBinding, { constantBufferId(ObjectConstantsBinding), 0, ObjectConstantBlockSize } },
     });
 }
 
@@ -592,22 +701,30 @@ void RenderView::advanceConstantBlockBinding(gx::CommandBuffer& cmd)
 {
   auto& renderpass = getRenderpass();
 
-  auto current_rover = (uintptr_t)m_objects_rover.get();
-  auto current_rover_off = current_rover - (uintptr_t)m_objects;
-
   // Check if we need to advance to the next uniform block yet
-  if(current_rover_off % m_constant_block_sz != 0) return;
+  if(numFreeConstantBlockSlots() != m_num_objects_per_block) return;
+
+  auto current_rover_off = (uintptr_t)m_objects_rover.get() - (uintptr_t)m_objects;
+  auto block_sz = m_num_objects_per_block * m_objects_rover.stride();
 
   // We need to advance to a new part of the UniformBuffer
   auto next_subpass = renderpass.nextSubpassId();
   auto subpass = gx::RenderPass::Subpass()
     .uniformBufferRange(ObjectConstantsBinding, constantBufferId(ObjectConstantsBinding),
-      current_rover_off, m_constant_block_sz);
+      current_rover_off, block_sz);
 
   renderpass.subpass(subpass);
   cmd.subpass(next_subpass);
 }
 
+size_t RenderView::numFreeConstantBlockSlots() const
+{
+  auto rover_off = (uintptr_t)m_objects_rover.get() - (uintptr_t)m_objects;
+  auto rover_idx = rover_off / m_objects_rover.stride();
+
+  return m_num_objects_per_block - (rover_idx % m_num_objects_per_block);
+}
+
 ShaderConstants RenderView::generateSceneConstants()
 {
   ShaderConstants constants;
@@ -694,6 +811,17 @@ u32 RenderView::writeConstants(const RenderObject& ro)
   return block_off;
 }
 
+u32 RenderView::writeConstants(const InstanceBatch& batch)
+{
+  auto constants_offset = writeConstants(batch.first());
+
+  // The remaining instances' ObjectConstants directly follow
+  //   the first one's
+  for(size_t i = 1; i < batch.num; i++) writeConstants(*batch.objects[i]);
+
+  return constants_offset;
+}
+
 void RenderView::initLuts()
 {
   auto blur_lut_id = renderer().queryLUT(RenderLUT::GaussianKernel, ShadowBlurRadius);
@@ -782,10 +910,97 @@ LightConstants RenderView::generateLineLightConstants(const RenderObject& ro)
   return consts;
 }
 
+void RenderView::groupInstances(std::vector<RenderObject>& objects, size_t meshes_off)
+{
+  if(meshes_off == objects.size()) return;
+
+  // All the meshes are drawn with the same Program
+  auto program = renderer().queryProgram(*this, objects[meshes_off]);
+  if(!renderer().programSupportsInstancing(program)) return;
+
+  using InstanceKey = decltype(instance_sort_key(objects.front()));
+
+  const size_t num_meshes = objects.size() - meshes_off;
+
+  // Each group is ranked by it's first (i.e. the one which
+  //   would be drawn first) member, and the rank of every
+  //   object is looked up only once...
+  std::map<InstanceKey, size_t> group_rank;
+  std::vector<size_t> rank(num_meshes);
+  for(size_t i = 0; i < num_meshes; i++) {
+    auto key = instance_sort_key(objects[meshes_off + i]);
+    auto it = group_rank.emplace(key, group_rank.size()).first;
+
+    rank[i] = it->second;
+  }
+
+  // ...so only the indices have to be sorted - a stable
+  //   sort keeps the members' relative order
+  std::vector<size_t> order(num_meshes);
+  for(size_t i = 0; i < num_meshes; i++) order[i] = i;
+
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return rank[a] < rank[b];
+  });
+
+  std::vector<RenderObject> sorted;
+  sorted.reserve(num_meshes);
+  for(auto idx : order) sorted.push_back(std::move(objects[meshes_off + idx]));
+
+  std::move(sorted.begin(), sorted.end(), objects.begin()+meshes_off);
+}
+
+bool RenderView::canInstance(const RenderObject& a, const RenderObject& b)
+{
+  const auto& a_meshes = a.mesh().mesh().m;
+  const auto& b_meshes = b.mesh().mesh().m;
+
+  if(a_meshes.size() != b_meshes.size()) return false;
+
+  for(u32 i = 0; i < a_meshes.size(); i++) {
+    const auto& a_mesh = a_meshes.at(i);
+    const auto& b_mesh = b_meshes.at(i);
+
+    if(a_mesh.vertex_array_id != b_mesh.vertex_array_id) return false;
+    if(a_mesh.vertex_array_flags != b_mesh.vertex_array_flags) return false;
+    if(a_mesh.array_primitive != b_mesh.array_primitive) return false;
+
+    if(a_mesh.base != b_mesh.base || a_mesh.offset != b_mesh.offset) return false;
+    if(a_mesh.num != b_mesh.num) return false;
+  }
+
+  if(!same_diffuse_texture(a, b)) return false;
+
+  auto program = renderer().queryProgram(*this, a);
+  if(program != renderer().queryProgram(*this, b)) return false;
+
+  return renderer().programSupportsInstancing(program);
+}
+
+bool RenderView::canMultiDraw(const RenderObject& a, const RenderObject& b)
+{
+  if(!same_diffuse_texture(a, b)) return false;
+
+  auto program = renderer().queryProgram(*this, a);
+  if(program != renderer().queryProgram(*this, b)) return false;
+
+  if(!renderer().programSupportsMultiDraw(program)) return false;
+
+  gx::ResourcePool::Id a_array, b_array;
+  gx::Primitive a_primitive, b_primitive;
+
+  if(!mesh_arena(a, a_array, a_primitive)) return false;
+  if(!mesh_arena(b, b_array, b_primitive)) return false;
+
+  return a_array == b_array && a_primitive == b_primitive;
+}
+
 // TODO
-void RenderView::forwardCameraRenderOne(const RenderObject& ro, gx::CommandBuffer& cmd)
+void RenderView::forwardCameraRenderBatch(const InstanceBatch& batch, gx::CommandBuffer& cmd)
 {
-  auto constants_offset = writeConstants(ro);
+  auto constants_offset = writeConstants(batch);
+
+  const auto& ro = batch.first();
 
   auto program_id = renderer().queryProgram(*this, ro);
   auto& program = pool().get<gx::Program>(program_id);  // R.shader.shaders.forward
@@ -822,12 +1037,14 @@ void RenderView::forwardCameraRenderOne(const RenderObject& ro, gx::CommandBuffe
     cmd.subpass(next_subpass);
   }
 
-  emitDraw(ro.mesh(), cmd);
+  emitBatch(batch, U.forward.uObjectConstantsOffset, constants_offset, cmd);
 }
 
-void RenderView::shadowRenderOne(const RenderObject& ro, gx::CommandBuffer& cmd)
+void RenderView::shadowRenderBatch(const InstanceBatch& batch, gx::CommandBuffer& cmd)
 {
-  auto constants_offset = writeConstants(ro);
+  auto constants_offset = writeConstants(batch);
+
+  const auto& ro = batch.first();
 
   auto program_id = renderer().queryProgram(*this, ro);
   auto& program = pool().get<gx::Program>(program_id);  // R.shader.shaders.rendermsm
@@ -844,14 +1061,45 @@ void RenderView::shadowRenderOne(const RenderObject& ro, gx::CommandBuffer& cmd)
     .program(program_id)
     .uniformInt(U.rendermsm.uObjectConstantsOffset, constants_offset);
 
-  emitDraw(ro.mesh(), cmd);
+  emitBatch(batch, U.rendermsm.uObjectConstantsOffset, constants_offset, cmd);
 }
 
-void RenderView::emitDraw(const RenderMesh& ro, gx::CommandBuffer& cmd)
+void RenderView::emitBatch(const InstanceBatch& batch, uint offset_location, u32 constants_offset,
+  gx::CommandBuffer& cmd)
+{
+  // Instanced RenderObjects share their meshes
+  if(batch.num > 1 && !batch.multi_draw) return emitDraw(batch.first().mesh(), (u32)batch.num, cmd);
+
+  if(emitMultiDraw(batch, cmd)) return;
+
+  // Draw the RenderObjects one by one, pointing
+  //   uObjectConstantsOffset at each one's ObjectConstants
+  for(size_t i = 0; i < batch.num; i++) {
+    if(i > 0) cmd.uniformInt(offset_location, (int)(constants_offset + i));
+
+    emitDraw(batch.objects[i]->mesh(), 1, cmd);
+  }
+}
+
+void RenderView::emitDraw(const RenderMesh& ro, u32 instances, gx::CommandBuffer& cmd)
 {
   const auto& meshes = ro.mesh().m;
 
   meshes.foreach([&](const mesh::Mesh& mesh) {
+    if(instances > 1) {
+      if(mesh.isIndexed()) {
+        u32 base = mesh.base != mesh::Mesh::None && mesh.offset != mesh::Mesh::None ? mesh.base : 0;
+        u32 offset = mesh.offset != mesh::Mesh::None ? mesh.offset : 0;
+
+        cmd.drawBaseVertexInstanced(mesh.getPrimitive(), mesh.vertex_array_id,
+          mesh.num, instances, base, offset);
+      } else {
+        cmd.drawInstanced(mesh.getPrimitive(), mesh.vertex_array_id, mesh.num, instances);
+      }
+
+      return;
+    }
+
     if(mesh.isIndexed()) {
       if(mesh.base != mesh::Mesh::None && mesh.offset != mesh::Mesh::None) {
         cmd.drawBaseVertex(mesh.getPrimitive(), mesh.vertex_array_id,
@@ -870,4 +1118,47 @@ void RenderView::emitDraw(const RenderMesh& ro, gx::CommandBuffer& cmd)
   m_num_drawcalls += meshes.size();
 }
 
+bool RenderView::emitMultiDraw(const InstanceBatch& batch, gx::CommandBuffer& cmd)
+{
+  const auto& first_meshes = batch.first().mesh().mesh().m;
+  if(batch.num == 1 && first_meshes.size() < 2) return false;   // drawBaseVertex() is cheaper
+
+  gx::ResourcePool::Id array;
+  gx::Primitive primitive;
+  if(!mesh_arena(batch.first(), array, primitive)) return false;
+
+  auto builder = gx::MultiDrawBuilder(primitive, array);
+
+  bool can_batch = true;
+  for(size_t i = 0; i < batch.num && can_batch; i++) {
+    batch.objects[i]->mesh().mesh().m.foreach([&](const mesh::Mesh& mesh) {
+      if(!can_batch) return;
+
+      if(!mesh.isIndexed() || !builder.accepts(mesh.getPrimitive(), mesh.vertex_array_id)) {
+        can_batch = false;
+        return;
+      }
+
+      u32 base = mesh.base != mesh::Mesh::None && mesh.offset != mesh::Mesh::None ? mesh.base : 0;
+      u32 offset = mesh.offset != mesh::Mesh::None ? mesh.offset : 0;
+
+      // The base_instance selects the RenderObject's ObjectConstants
+      //   (see Renderer::programSupportsMultiDraw())
+      can_batch = builder.draw(mesh.num, base, offset, 1, (u32)i);
+    });
+  }
+
+  if(!can_batch) return false;
+
+  try {
+    builder.emit(cmd, m_mempools.front()->get(), renderer().indirectBuffer());
+  } catch(const gx::MultiDrawBuilder::AllocFailedError&) {
+    return false;   // Fall back to drawing the meshes one by one
+  }
+
+  m_num_drawcalls++;
+
+  return true;
+}
+
 }
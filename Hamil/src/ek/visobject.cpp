@@ -3,6 +3,7 @@
 #include <ek/mempool.h>
 
 #include <gx/memorypool.h>
+#include <math/cull.h>
 
 #include <xmmintrin.h>
 #include <pmmintrin.h>
@@ -10,6 +11,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <algorithm>
 
 namespace ek {
 
@@ -61,14 +63,7 @@ VisibilityObject& VisibilityObject::addMesh(VisibilityMesh&& mesh)
 VisibilityObject& VisibilityObject::transformAABBs()
 {
   for(auto& mesh : m_meshes) {
-    const auto& model = mesh.model;
-    const auto& aabb  = mesh.aabb;
-
-    vec4 min = model * vec4(aabb.min, 1.0f);
-    vec4 max = model * vec4(aabb.max, 1.0f);
-
-    mesh.transformed_aabb.min = min.xyz();
-    mesh.transformed_aabb.max = max.xyz();
+    mesh.transformed_aabb = aabb_transform(mesh.model, mesh.aabb);
   }
 
   return *this;
@@ -76,13 +71,37 @@ VisibilityObject& VisibilityObject::transformAABBs()
 
 VisibilityObject& VisibilityObject::frustumCullMeshes(const frustum3& frustum)
 {
-  for(auto& mesh : m_meshes) {
-    if(!frustum.aabbInside(mesh.transformed_aabb)) {
-      mesh.visible = VisibilityMesh::Invisible;
-      mesh.vis_flags = VisibilityMesh::FrustumOut;
-    } else {
-      mesh.visible = VisibilityMesh::PotentiallyVisible;
-      mesh.vis_flags = 0;
+  // The meshes are tested in batches to keep the SoA arrays on the stack
+  static constexpr uint BatchSize = 32;
+
+  alignas(16) float min_x[BatchSize], min_y[BatchSize], min_z[BatchSize];
+  alignas(16) float max_x[BatchSize], max_y[BatchSize], max_z[BatchSize];
+
+  AABBsSoA aabbs = { min_x, min_y, min_z, max_x, max_y, max_z };
+
+  for(uint base = 0; base < m_meshes.size(); base += BatchSize) {
+    uint num = std::min<uint>(BatchSize, (uint)m_meshes.size() - base);
+
+    for(uint i = 0; i < num; i++) {
+      const auto& aabb = m_meshes[base+i].transformed_aabb;
+
+      min_x[i] = aabb.min.x; min_y[i] = aabb.min.y; min_z[i] = aabb.min.z;
+      max_x[i] = aabb.max.x; max_y[i] = aabb.max.y; max_z[i] = aabb.max.z;
+    }
+
+    u32 inside = 0;
+    frustum_aabbs_inside(frustum, aabbs, num, &inside);
+
+    for(uint i = 0; i < num; i++) {
+      auto& mesh = m_meshes[base+i];
+
+      if(!cull_mask_test(&inside, i)) {
+        mesh.visible = VisibilityMesh::Invisible;
+        mesh.vis_flags = VisibilityMesh::FrustumOut;
+      } else {
+        mesh.visible = VisibilityMesh::PotentiallyVisible;
+        mesh.vis_flags = 0;
+      }
     }
   }
 
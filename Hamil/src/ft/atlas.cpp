@@ -0,0 +1,131 @@
+#include <ft/atlas.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace ft {
+
+GlyphAtlas::GlyphAtlas(unsigned size) :
+  m_size(size),
+  m_packer_nodes(size),
+  m_pixels(size*size),
+  m_dirty_begin(0), m_dirty_end(size)
+{
+  stbrp_init_target(&m_packer, (int)size, (int)size,
+    m_packer_nodes.data(), (int)m_packer_nodes.size());
+}
+
+bool GlyphAtlas::pack(const u8 *pixels, unsigned width, unsigned rows, Rect& rect)
+{
+  // Spacing around glyphs
+  stbrp_rect r = {
+    0,
+    (stbrp_coord)(width + 2), (stbrp_coord)(rows + 2)
+  };
+
+  stbrp_pack_rects(&m_packer, &r, 1);
+  if(!r.was_packed) return false;
+
+  rect.x = (u16)r.x; rect.y = (u16)r.y;
+  rect.width = (u16)width; rect.rows = (u16)rows;
+
+  for(unsigned y = 0; y < rows; y++) {
+    auto src = pixels + y*width;
+    auto dst = m_pixels.data() + rowOffset(rect, y);
+
+    std::copy(src, src+width, dst);
+  }
+
+  // The bitmap's rows are stored bottom-up
+  if(rows) {
+    auto first = (unsigned)(rowOffset(rect, rows-1) / m_size),
+      last = (unsigned)(rowOffset(rect, 0) / m_size);
+
+    m_dirty_begin = std::min(m_dirty_begin, first);
+    m_dirty_end   = std::max(m_dirty_end, last+1);
+  }
+
+  return true;
+}
+
+void GlyphAtlas::repack(const std::vector<Rect *>& rects, std::vector<bool>& packed)
+{
+  std::vector<std::vector<u8>> bitmaps;
+  bitmaps.reserve(rects.size());
+  for(auto rect : rects) bitmaps.push_back(read(*rect));
+
+  std::vector<size_t> order(rects.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  // Skyline packing wastes the least space when
+  //   the rects are sorted by height
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return rects[a]->rows > rects[b]->rows;
+  });
+
+  reset();
+
+  packed.assign(rects.size(), false);
+  for(auto i : order) {
+    auto& rect = *rects[i];
+
+    packed[i] = pack(bitmaps[i].data(), rect.width, rect.rows, rect);
+  }
+}
+
+void GlyphAtlas::reset()
+{
+  stbrp_init_target(&m_packer, (int)m_size, (int)m_size,
+    m_packer_nodes.data(), (int)m_packer_nodes.size());
+
+  std::fill(m_pixels.begin(), m_pixels.end(), 0);
+  m_dirty_begin = 0;
+  m_dirty_end = m_size;
+}
+
+std::vector<u8> GlyphAtlas::read(const Rect& rect) const
+{
+  std::vector<u8> bitmap(rect.width * rect.rows);
+  for(unsigned y = 0; y < rect.rows; y++) {
+    auto src = m_pixels.data() + rowOffset(rect, y);
+
+    std::copy(src, src+rect.width, bitmap.data() + y*rect.width);
+  }
+
+  return bitmap;
+}
+
+unsigned GlyphAtlas::size() const
+{
+  return m_size;
+}
+
+const u8 *GlyphAtlas::pixels() const
+{
+  return m_pixels.data();
+}
+
+unsigned GlyphAtlas::dirtyBegin() const
+{
+  return m_dirty_begin;
+}
+
+unsigned GlyphAtlas::dirtyEnd() const
+{
+  return m_dirty_end;
+}
+
+void GlyphAtlas::clearDirty()
+{
+  m_dirty_begin = m_size;
+  m_dirty_end = 0;
+}
+
+size_t GlyphAtlas::rowOffset(const Rect& rect, unsigned y) const
+{
+  size_t dsty = (m_size - (rect.y+y))-2;
+
+  return dsty*m_size + rect.x+1;
+}
+
+}
@@ -1,6 +1,305 @@
 #include <ft/cache.h>
 
+#include <util/hash.h>
+#include <gx/texture.h>
+
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <string_view>
+
 namespace ft {
 
+FontCache::FontCache(gx::ResourcePool& pool, unsigned atlas_size, size_t max_runs) :
+  m_pool(pool),
+  m_atlas_id(gx::ResourcePool::Invalid),
+  m_atlas(atlas_size),
+  m_max_runs(max_runs)
+{
+  m_atlas_id = m_pool.createTexture<gx::Texture2D>("t2dFtCacheAtlas", gx::r8);
+  m_pool.getTexture<gx::Texture2D>(m_atlas_id)
+    .init(m_atlas.pixels(), 0, atlas_size, atlas_size, gx::r, gx::Type::u8);
+
+  m_atlas.clearDirty();
+}
+
+FontCache::~FontCache()
+{
+}
+
+String FontCache::writeVertsAndIndices(const Font& font, const char *str,
+  StridePtr<Position> pos, StridePtr<UV> uv, u16 *inds)
+{
+  auto len = strlen(str);
+  auto key = run_key(font, str, len);
+
+  auto it = m_runs.find(key);
+  if(it != m_runs.end()) {
+    auto run = it->second;
+
+    if(run->font == &font && run->str == std::string_view(str, len)) {
+      m_stats.hits++;
+
+      // Move the run to the front of the LRU list
+      m_lru.splice(m_lru.begin(), m_lru, run);
+
+      copy_run(*run, pos, uv, inds);
+      return run->string;
+    }
+
+    // Hash collision - replace the old run
+    eraseRun(run);
+  }
+
+  m_stats.misses++;
+
+  Run run;
+  run.font = &font;
+  run.str.assign(str, len);
+  run.key = key;
+
+  run.pos.resize(len*NumCharVerts);
+  run.uv.resize(len*NumCharVerts);
+  run.inds.resize(len*NumCharIndices);
+
+  auto do_layout = [&]() {
+    return font.layout(str,
+      StridePtr<Position>(run.pos.data(), sizeof(Position)),
+      StridePtr<UV>(run.uv.data(), sizeof(UV)),
+      run.inds.data());
+  };
+
+  auto repacks = m_stats.repacks;
+  run.string = do_layout();
+
+  // The atlas was repacked half way through the string, which moved
+  //   the glyphs laid out before that - do it again now that all of
+  //   them are in the atlas
+  if(m_stats.repacks != repacks) {
+    repacks = m_stats.repacks;
+    run.string = do_layout();
+
+    // The string's glyphs can't all fit in the atlas at once
+    if(m_stats.repacks != repacks) throw AtlasFullError();
+  }
+
+  auto num = run.string.num();
+  run.pos.resize(num / NumCharIndices * NumCharVerts);
+  run.uv.resize(run.pos.size());
+  run.inds.resize(num);
+
+  // The layout could've rasterized new glyphs
+  flush();
+
+  m_lru.push_front(std::move(run));
+  m_runs.emplace(key, m_lru.begin());
+
+  // Evict least recently used runs (but never the new one)
+  while(m_lru.size() > m_max_runs) {
+    eraseRun(std::prev(m_lru.end()));
+
+    m_stats.evictions++;
+  }
+  m_stats.num_runs = m_lru.size();
+
+  const auto& front = m_lru.front();
+
+  copy_run(front, pos, uv, inds);
+  return front.string;
+}
+
+void FontCache::flush()
+{
+  auto begin = m_atlas.dirtyBegin(), end = m_atlas.dirtyEnd();
+  if(begin >= end) return;
+
+  auto size = m_atlas.size();
+
+  m_pool.getTexture<gx::Texture2D>(m_atlas_id)
+    .upload(m_atlas.pixels() + begin*size, 0,
+      0, begin, size, end - begin, gx::r, gx::Type::u8);
+
+  m_atlas.clearDirty();
+}
+
+void FontCache::clear()
+{
+  m_glyphs.clear();
+  m_lru.clear();
+  m_runs.clear();
+
+  m_atlas.reset();
+  flush();
+
+  m_stats.num_glyphs = m_stats.num_runs = 0;
+}
+
+void FontCache::evict(const Font& font)
+{
+  for(auto it = m_glyphs.begin(); it != m_glyphs.end();) {
+    it = it->first.font == &font ? m_glyphs.erase(it) : std::next(it);
+  }
+
+  for(auto it = m_lru.begin(); it != m_lru.end();) {
+    auto next = std::next(it);
+    if(it->font == &font) eraseRun(it);
+
+    it = next;
+  }
+
+  m_stats.num_glyphs = m_glyphs.size();
+  m_stats.num_runs = m_lru.size();
+}
+
+gx::ResourcePool::Id FontCache::atlasId() const
+{
+  return m_atlas_id;
+}
+
+const FontCache::Stats& FontCache::stats() const
+{
+  return m_stats;
+}
+
+size_t FontCache::GlyphKeyHash::operator()(const GlyphKey& key) const
+{
+  size_t seed = 0;
+  util::hash_combine<std::hash<const Font *>>(seed, key.font);
+  util::hash_combine<std::hash<int>>(seed, key.ch);
+
+  return seed;
+}
+
+const FontCache::GlyphRenderData& FontCache::glyph(const Font& font, int ch)
+{
+  GlyphKey key = { &font, ch };
+
+  auto it = m_glyphs.find(key);
+  if(it != m_glyphs.end()) return it->second.rd;
+
+  // References to elements of an unordered_map stay
+  //   valid after inserting new ones
+  auto& glyph = m_glyphs.emplace(key, rasterize(font, ch)).first->second;
+  m_stats.num_glyphs = m_glyphs.size();
+
+  return glyph.rd;
+}
+
+FontCache::Glyph FontCache::rasterize(const Font& font, int ch)
+{
+  auto g = font.renderGlyph(ch);
+
+  Glyph glyph;
+  if(pack(g, glyph)) return glyph;
+
+  // The atlas is full - pack the glyphs which are still
+  //   in use again, without the holes left by evict()...
+  repack();
+  if(pack(g, glyph)) return glyph;
+
+  // ...and when that doesn't free up enough space
+  //   start over from an empty atlas
+  m_glyphs.clear();
+  m_stats.num_glyphs = 0;
+
+  m_atlas.reset();
+  if(pack(g, glyph)) return glyph;
+
+  throw AtlasFullError();
+}
+
+bool FontCache::pack(const Font::GlyphBitmap& g, Glyph& glyph)
+{
+  if(!m_atlas.pack(g.pixels.data(), g.width, g.rows, glyph.rect)) return false;
+
+  auto& rd = glyph.rd;
+
+  rd.idx     = g.idx;
+  rd.top     = g.top;
+  rd.left    = g.left;
+  rd.width   = g.width;
+  rd.height  = g.rows+1;
+  rd.advance = g.advance;
+
+  glyphUVs(glyph);
+
+  return true;
+}
+
+void FontCache::repack()
+{
+  std::vector<GlyphMap::iterator> glyphs;
+  std::vector<GlyphAtlas::Rect *> rects;
+
+  glyphs.reserve(m_glyphs.size());
+  rects.reserve(m_glyphs.size());
+  for(auto it = m_glyphs.begin(); it != m_glyphs.end(); it++) {
+    glyphs.push_back(it);
+    rects.push_back(&it->second.rect);
+  }
+
+  std::vector<bool> packed;
+  m_atlas.repack(rects, packed);
+
+  for(size_t i = 0; i < glyphs.size(); i++) {
+    // Glyphs which don't fit anymore are rasterized again on demand
+    if(!packed[i]) {
+      m_glyphs.erase(glyphs[i]);
+      continue;
+    }
+
+    glyphUVs(glyphs[i]->second);
+  }
+
+  m_lru.clear();
+  m_runs.clear();
+
+  m_stats.repacks++;
+  m_stats.num_glyphs = m_glyphs.size();
+  m_stats.num_runs = 0;
+}
+
+void FontCache::glyphUVs(Glyph& glyph) const
+{
+  const auto& r = glyph.rect;
+  auto atlas_size = m_atlas.size();
+
+  u16 x0 = r.x+1, y0 = r.y,
+    x1 = r.x+r.width+1, y1 = r.y+r.rows+1;
+
+  y0 = atlas_size - y0;
+  y1 = atlas_size - y1;
+
+  auto& rd = glyph.rd;
+
+  rd.uvs[0] = { x0, y0 }; rd.uvs[1] = { x0, y1 };
+  rd.uvs[2] = { x1, y0 }; rd.uvs[3] = { x1, y1 };
+}
+
+size_t FontCache::run_key(const Font& font, const char *str, size_t len)
+{
+  size_t seed = util::hash(str, len);
+  util::hash_combine<std::hash<const Font *>>(seed, &font);
+
+  return seed;
+}
+
+void FontCache::copy_run(const Run& run, StridePtr<Position> pos, StridePtr<UV> uv, u16 *inds)
+{
+  // The destination vertices are usually interleaved
+  //   with other attributes, so they're copied one by one
+  for(size_t i = 0; i < run.pos.size(); i++) {
+    *pos++ = run.pos[i];
+    *uv++ = run.uv[i];
+  }
+
+  memcpy(inds, run.inds.data(), run.inds.size()*sizeof(u16));
+}
+
+void FontCache::eraseRun(LRUList::iterator it)
+{
+  m_runs.erase(it->key);
+  m_lru.erase(it);
+}
 
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include <ft/font.h>
+#include <ft/cache.h>
 
 #include <config>
 
@@ -101,7 +102,7 @@ public:
   gx::ResourcePool::Id program_id = gx::ResourcePool::Invalid;
 
   // Manages space for vertices and indices in 'vtx'
-  FreeListAllocator allocator;
+  TLSFAllocator allocator;
 
   static const gx::VertexFormat fmt;
   gx::ResourcePool::Id buf_id = gx::ResourcePool::Invalid;
@@ -267,20 +268,12 @@ Font::Font(const FontFamily& family, unsigned height, gx::ResourcePool *pool) :
   m_atlas_private = pool == nullptr;
 #endif
 
-  FT_Face face;
-  auto err = FT_New_Face(ft, family.getPath(), 0, &face);
-  if(err) {
-    std::string err_message = "FreeType face creation error (" + std::to_string(err) + ")";
-    os::panic(err_message.data(), os::FreeTypeFaceCreationError);
-  }
+  initFace(family, height);
 
-  m = new pFace(face);
-  m_bearing_y = 0;
-      
-  FT_Set_Pixel_Sizes(*m, 0, height);
+  FT_Face face = *m;
 
   FT_Stroker stroker;
-  err = FT_Stroker_New(ft, &stroker);
+  auto err = FT_Stroker_New(ft, &stroker);
   assert(!err && "FreeType stroker creation error!");
 
   FT_Stroker_Set(stroker, 2<<6, FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_ROUND, 0);
@@ -314,20 +307,61 @@ Font::Font(const FontFamily& family, unsigned height, gx::ResourcePool *pool) :
   populateRenderData(glyphs, pool->getTexture(m_atlas));
 }
 
+Font::Font(const FontFamily& family, unsigned height, const std::shared_ptr<FontCache>& cache) :
+  m_cache(cache),
+  m_atlas(gx::ResourcePool::Invalid)
+{
+#if !defined(NDEBUG)
+  m_atlas_private = false;
+#endif
+
+  initFace(family, height);
+
+  FT_Face face = *m;
+
+  // Only the metrics are needed here - the glyphs
+  //   are rasterized by the FontCache on first use
+  for(int i = 0x20; i < 0x7F; i++) {
+    auto idx = FT_Get_Char_Index(face, i);
+    FT_Load_Glyph(face, idx, FT_LOAD_DEFAULT);
+
+    m_bearing_y = std::max(m_bearing_y, (float)(face->glyph->metrics.horiBearingY >> 6));
+  }
+}
+
 Font::~Font()
 {
+  if(m_cache) m_cache->evict(*this);
+
   delete m;
 }
 
+void Font::initFace(const FontFamily& family, unsigned height)
+{
+  FT_Face face;
+  auto err = FT_New_Face(ft, family.getPath(), 0, &face);
+  if(err) {
+    std::string err_message = "FreeType face creation error (" + std::to_string(err) + ")";
+    os::panic(err_message.data(), os::FreeTypeFaceCreationError);
+  }
+
+  m = new pFace(face);
+  m_bearing_y = 0;
+
+  FT_Set_Pixel_Sizes(*m, 0, height);
+}
+
 int Font::glyphIndex(int ch) const
 {
+  if(m_cache) return ch;
+
   return (size_t)ch < m_glyph_index.size() ? getGlyphIndex(ch) : -1;
 }
 
 String Font::string(const char *str, size_t length) const
 {
-  auto ptr = (unsigned)p->allocator.alloc(length); // Simple free list alloator
-  assert(ptr != (unsigned)FreeListAllocator::Error && "no more space in string vertex buffer!");
+  auto ptr = (unsigned)p->allocator.alloc(length); // O(1) TLSF allocator
+  assert(ptr != (unsigned)TLSFAllocator::Error && "no more space in string vertex buffer!");
 
   std::vector<Vertex> vtx(length*NumCharVerts);
   std::vector<u16> inds(length*NumCharIndices);
@@ -366,7 +400,9 @@ String Font::stringMetrics(const char *str) const
   FT_Vector pen = { 0, 0 };
   float width = 0.0f;
   while(*str) {
-    const auto& g = getGlyphRenderData(*str);
+    // Copied, as a FontCache can drop its glyphs when it
+    //   runs out of atlas space while fetching another one
+    const auto g = getGlyphRenderData(*str);
 
     float x = (float)pen.x / (float)(1<<16),
       y = (float)pen.y / (float)(1<<16);
@@ -420,6 +456,13 @@ String Font::stringMetrics(const std::string& str) const
 }
 
 String Font::writeVertsAndIndices(const char *str, StridePtr<Position> pos, StridePtr<UV> uv, u16 *inds) const
+{
+  if(m_cache) return m_cache->writeVertsAndIndices(*this, str, pos, uv, inds);
+
+  return layout(str, pos, uv, inds);
+}
+
+String Font::layout(const char *str, StridePtr<Position> pos, StridePtr<UV> uv, u16 *inds) const
 {
   auto make_pos = [](auto x, auto y) -> Position
   {
@@ -434,7 +477,9 @@ String Font::writeVertsAndIndices(const char *str, StridePtr<Position> pos, Stri
   FT_Vector pen = { 0, 0 };
   float width = 0.0f;
   while(*str) {
-    const auto& g = getGlyphRenderData(*str);
+    // Copied, as a FontCache can drop its glyphs when it
+    //   runs out of atlas space while fetching another one
+    const auto g = getGlyphRenderData(*str);
 
     float x = (float)pen.x / (float)(1<<16),
       y = (float)pen.y / (float)(1<<16);
@@ -591,6 +636,8 @@ float Font::bearingY() const
 
 float Font::advance(int glyph_index) const
 {
+  if(m_cache) return m_cache->glyph(*this, glyph_index).advance.x / (float)(1<<16);
+
   if((size_t)glyph_index > m_render_data.size()) return NAN;
 
   const auto& rd = m_render_data[glyph_index];
@@ -599,7 +646,7 @@ float Font::advance(int glyph_index) const
 
 float Font::charAdvance(int ch) const
 {
-  return advance(getGlyphIndex(ch));
+  return advance(glyphIndex(ch));
 }
 
 void Font::bindFontAltas(int unit) const
@@ -617,7 +664,7 @@ void Font::bindFontAltas(int unit) const
 
 gx::ResourcePool::Id Font::atlasId() const
 {
-  return m_atlas;
+  return m_cache ? m_cache->atlasId() : m_atlas;
 }
 
 bool Font::monospace() const
@@ -731,6 +778,40 @@ void Font::populateRenderData(const std::vector<pGlyph>& glyphs, gx::TextureHand
   }
 }
 
+Font::GlyphBitmap Font::renderGlyph(int ch) const
+{
+  FT_Face face = *m;
+
+  auto idx = FT_Get_Char_Index(face, ch);
+  FT_Glyph glyph;
+
+  FT_Load_Glyph(face, idx, FT_LOAD_DEFAULT);
+
+  FT_Get_Glyph(face->glyph, &glyph);
+  FT_Glyph_To_Bitmap(&glyph, FT_RENDER_MODE_NORMAL, nullptr, true);
+
+  auto bm = (FT_BitmapGlyph)glyph;
+
+  GlyphBitmap g;
+  g.idx     = idx;
+  g.top     = bm->top;
+  g.left    = bm->left;
+  g.advance = ivec2{ (int)glyph->advance.x, (int)glyph->advance.y };
+  g.width   = bm->bitmap.width;
+  g.rows    = bm->bitmap.rows;
+
+  g.pixels.resize(g.width*g.rows);
+  for(unsigned y = 0; y < g.rows; y++) {
+    auto src = bm->bitmap.buffer + (y*bm->bitmap.pitch);
+
+    std::copy(src, src+g.width, g.pixels.data() + y*g.width);
+  }
+
+  FT_Done_Glyph(glyph);
+
+  return g;
+}
+
 int Font::getGlyphIndex(int ch) const
 {
   return m_glyph_index[ch];
@@ -738,6 +819,8 @@ int Font::getGlyphIndex(int ch) const
 
 const Font::GlyphRenderData& Font::getGlyphRenderData(int ch) const
 {
+  if(m_cache) return m_cache->glyph(*this, ch);
+
   return m_render_data[getGlyphIndex(ch)];
 }
 
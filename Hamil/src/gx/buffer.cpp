@@ -135,6 +135,11 @@ void Buffer::upload(const void *data, size_t offset, size_t elem_sz, size_t elem
   unbind();
 }
 
+size_t Buffer::size() const
+{
+  return m_sz > 0 ? (size_t)m_sz : 0;
+}
+
 void Buffer::copy(Buffer& dst, size_t src_offset, size_t dst_offset, size_t sz)
 {
   glBindBuffer(GL_COPY_READ_BUFFER, m);
@@ -315,6 +320,11 @@ void UniformBuffer::clearBindings()
   }
 }
 
+IndirectBuffer::IndirectBuffer(Usage usage) :
+  Buffer(usage, GL_DRAW_INDIRECT_BUFFER)
+{
+}
+
 TexelBuffer::TexelBuffer(Usage usage) :
   Buffer(usage, GL_TEXTURE_BUFFER)
 {
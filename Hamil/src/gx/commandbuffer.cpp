@@ -2,8 +2,13 @@
 #include <gx/renderpass.h>
 #include <gx/program.h>
 #include <gx/vertex.h>
+#include <gx/buffer.h>
+#include <gx/multidraw.h>
+#include <gx/pipeline.h>
+#include <gx/info.h>
 
 #include <cassert>
+#include <algorithm>
 
 namespace gx {
 
@@ -12,7 +17,8 @@ CommandBuffer::CommandBuffer(size_t initial_alloc) :
   m_memory(nullptr),
   m_program(nullptr),
   m_renderpass(nullptr),
-  m_last_draw(NonIndexedDraw)
+  m_last_draw(NonIndexedDraw),
+  m_indirect_buffer(~0u), m_indirect_offset(0)
 {
   m_commands.reserve(initial_alloc);
 }
@@ -59,6 +65,43 @@ CommandBuffer & CommandBuffer::drawBaseVertex(Primitive p,
     .appendExtraData(offset);
 }
 
+CommandBuffer& CommandBuffer::drawInstanced(Primitive p,
+  ResourceId vertex_array, size_t num_verts, u32 instances)
+{
+  if(!instances) return *this;  // Nothing to draw
+
+  return appendCommand(make_draw_instanced(p, vertex_array, num_verts))
+    .appendExtraData(instances)
+    .appendExtraData(NonIndexedDraw)
+    .appendExtraData(0);
+}
+
+CommandBuffer& CommandBuffer::drawBaseVertexInstanced(Primitive p,
+  ResourceId indexed_vertex_array, size_t num, u32 instances, u32 base, u32 offset)
+{
+  if(!instances) return *this;  // Nothing to draw
+
+  assert(base != NonIndexedDraw && "drawBaseVertexInstanced() 'base' out of range!");
+
+  return appendCommand(make_draw_instanced(p, indexed_vertex_array, num))
+    .appendExtraData(instances)
+    .appendExtraData(base)
+    .appendExtraData(offset);
+}
+
+CommandBuffer& CommandBuffer::multiDrawIndirect(Primitive p, ResourceId indexed_vertex_array,
+  ResourceId indirect_buffer, MemoryPool::Handle draws, size_t num_draws)
+{
+  if(!num_draws) return *this;  // Nothing to draw
+
+  checkResourceId(indirect_buffer);
+  checkHandle(draws);
+
+  return appendCommand(make_multi_draw_indirect(p, indexed_vertex_array, num_draws))
+    .appendExtraData(indirect_buffer)
+    .appendExtraData(draws);
+}
+
 CommandBuffer& CommandBuffer::bufferUpload(ResourceId buf, MemoryPool::Handle h, size_t sz)
 {
   checkResourceId(buf);
@@ -180,6 +223,10 @@ CommandBuffer& CommandBuffer::execute()
     "(Or commands were added after the end() call)");
   assertResourcePool();
 
+  // Start uploading the indirect draw arguments anew
+  m_indirect_buffer = ~0u;
+  m_indirect_offset = 0;
+
   u32 *pc = m_commands.data();
   while(auto next_pc = dispatch(pc)) {
     pc =  next_pc;
@@ -196,6 +243,11 @@ CommandBuffer& CommandBuffer::reset()
   return *this;
 }
 
+const std::vector<CommandBuffer::u32>& CommandBuffer::dbg_Commands() const
+{
+  return m_commands;
+}
+
 CommandBuffer& CommandBuffer::appendCommand(Command opcode, u32 data)
 {
   assert((data & ~OpDataMask) == 0 && "OpData has overflown into the opcode!");
@@ -278,6 +330,37 @@ CommandBuffer::u32 *CommandBuffer::dispatch(u32 *op)
     break;
   }
 
+  case OpDrawInstanced: {
+    assertProgram();
+
+    auto extra = fetch_extra();
+
+    op++;
+    u32 instances = *op;
+    op++;
+    u32 base = *op;
+    op++;
+    u32 offset = *op;
+
+    drawInstancedCommand(extra, instances, base, offset);
+    break;
+  }
+
+  case OpMultiDrawIndirect: {
+    assertProgram();
+    assertMemoryPool();
+
+    auto extra = fetch_extra();
+
+    op++;
+    u32 indirect_buffer = *op;
+    op++;
+    MemoryPool::Handle draws = *op;
+
+    multiDrawIndirectCommand(extra, indirect_buffer, draws);
+    break;
+  }
+
   case OpBufferUpload:
     assertMemoryPool();
 
@@ -345,6 +428,66 @@ void CommandBuffer::drawCommand(CommandWithExtra op, u32 base, u32 offset)
   }
 }
 
+void CommandBuffer::drawInstancedCommand(CommandWithExtra op, u32 instances, u32 base, u32 offset)
+{
+  auto array = draw_array(op);
+  auto num   = draw_num(op);
+
+  if(m_last_draw != array) endIndexedArray();
+
+  if(base == NonIndexedDraw) {
+    Pipeline::current()
+        .drawInstanced(offset, num, instances);
+    return;
+  }
+
+  Pipeline::current()
+      .drawBaseVertexInstanced(base, offset, num, instances);
+  m_last_draw = array;
+}
+
+void CommandBuffer::multiDrawIndirectCommand(CommandWithExtra op,
+  ResourceId indirect_buffer, MemoryPool::Handle draws)
+{
+  auto array     = draw_array(op);
+  auto num_draws = draw_num(op);
+
+  if(m_last_draw != array) endIndexedArray();
+
+  auto args = m_memory->ptr<const DrawElementsIndirectArgs>(draws);
+
+  if(!info().multiDrawIndirect()) {
+    // IndirectBuffers can't be used at all - issue the draws one by one
+    Pipeline::current()
+        .multiDrawBaseVertex(args, num_draws);
+    m_last_draw = array;
+
+    return;
+  }
+
+  auto sz = num_draws * sizeof(DrawElementsIndirectArgs);
+  auto& buf = m_pool->getBuffer(indirect_buffer).get();
+
+  // Allocate fresh storage (orphaning the old one, which the GPU
+  //   could still be reading from) for the first upload during
+  //   an execute() and whenever the current storage runs out
+  if(indirect_buffer != m_indirect_buffer || m_indirect_offset+sz > buf.size()) {
+    auto storage_sz = std::max({ buf.size(), sz, (size_t)MinIndirectBufferSize });
+    buf.init(sizeof(byte), storage_sz);
+
+    m_indirect_buffer = indirect_buffer;
+    m_indirect_offset = 0;
+  }
+
+  buf.upload(args, m_indirect_offset, sizeof(byte), sz);
+
+  Pipeline::current()
+      .multiDrawIndirect(indirect_buffer, m_indirect_offset, num_draws);
+  m_last_draw = array;
+
+  m_indirect_offset += sz;
+}
+
 void CommandBuffer::uploadCommand(CommandWithExtra op)
 {
   auto buffer = xfer_buffer(op);
@@ -556,6 +699,28 @@ CommandBuffer::CommandWithExtra CommandBuffer::make_draw_base_vertex(Primitive p
   return c;
 }
 
+CommandBuffer::CommandWithExtra CommandBuffer::make_draw_instanced(Primitive p,
+  ResourceId array, size_t num)
+{
+  auto c = make_draw(p, array, num);
+
+  c.command &= ~(OpMask << OpShift);
+  c.command |= OpDrawInstanced << OpShift;
+
+  return c;
+}
+
+CommandBuffer::CommandWithExtra CommandBuffer::make_multi_draw_indirect(Primitive p,
+  ResourceId array, size_t num_draws)
+{
+  auto c = make_draw(p, array, num_draws);
+
+  c.command &= ~(OpMask << OpShift);
+  c.command |= OpMultiDrawIndirect << OpShift;
+
+  return c;
+}
+
 CommandBuffer::CommandWithExtra CommandBuffer::make_buffer_upload(ResourceId buf,
   MemoryPool::Handle h, size_t sz)
 {
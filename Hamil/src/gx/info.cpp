@@ -48,6 +48,16 @@ bool GxInfo::extension(const std::string& name) const
   return it != m_extensions.end();
 }
 
+bool GxInfo::multiDrawIndirect() const
+{
+  return m_multi_draw_indirect;
+}
+
+bool GxInfo::shaderDrawParameters() const
+{
+  return m_shader_draw_parameters;
+}
+
 static void p_glGet(GLenum pname, size_t *data)
 {
   return glGetInteger64v(pname, (GLint64 *)data);
@@ -76,6 +86,18 @@ GxInfo *GxInfo::create()
     self->m_extensions.emplace(extension);
   }
 
+  int major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+  bool gl43 = major > 4 || (major == 4 && minor >= 3);
+
+  self->m_multi_draw_indirect = gl43 ||
+    (self->extension(ARB::DrawIndirect) && self->extension(ARB::MultiDrawIndirect));
+  // All shaders are '#version 330', so the core (4.6) gl_BaseInstance
+  //   can't be used - only the extension's gl_BaseInstanceARB
+  self->m_shader_draw_parameters = self->extension(ARB::ShaderDrawParameters);
+
   return self;
 }
 
@@ -0,0 +1,164 @@
+#include <gx/meshpool.h>
+#include <gx/buffer.h>
+
+#include <util/format.h>
+
+#include <cassert>
+
+namespace gx {
+
+MeshPool::Arena::Arena(const VertexFormat& fmt_, size_t num_verts, size_t num_inds) :
+  fmt(fmt_), vertex_sz(fmt_.vertexByteSize()),
+  verts(num_verts), inds(num_inds)
+{
+}
+
+MeshPool::MeshPool(ResourcePool& pool, size_t arena_verts, size_t arena_inds) :
+  m_pool(&pool),
+  m_arena_verts(arena_verts), m_arena_inds(arena_inds),
+  m_ref(std::make_shared<MeshPool *>(this))
+{
+}
+
+MeshPool::~MeshPool()
+{
+  *m_ref = nullptr;
+
+  for(auto& arena : m_arenas) {
+    // Release the array first, as it references the buffers
+    m_pool->release<IndexedVertexArray>(arena.array);
+
+    m_pool->releaseBuffer(arena.vertex_buf);
+    m_pool->releaseBuffer(arena.index_buf);
+  }
+}
+
+auto MeshPool::alloc(const VertexFormat& fmt, u32 num_verts, u32 num_inds) -> Allocation
+{
+  if(num_verts > m_arena_verts || num_inds > m_arena_inds) throw AllocTooLargeError();
+
+  auto try_alloc = [&](u32 idx) -> Allocation {
+    auto& arena = m_arenas[idx];
+
+    auto base = arena.verts.alloc(num_verts);
+    if(base == TLSFAllocator::Error) return Allocation();
+
+    auto first = arena.inds.alloc(num_inds);
+    if(first == TLSFAllocator::Error) {
+      arena.verts.dealloc(base, num_verts);
+
+      return Allocation();
+    }
+
+    Allocation a;
+    a.array = arena.array;
+    a.arena = idx;
+    a.base_vertex = (u32)base;
+    a.first_index = (u32)first;
+    a.num_verts = num_verts;
+    a.num_inds  = num_inds;
+
+    return a;
+  };
+
+  for(u32 idx = 0; idx < m_arenas.size(); idx++) {
+    if(m_arenas[idx].fmt != fmt) continue;
+
+    auto a = try_alloc(idx);
+    if(a.valid()) return a;
+  }
+
+  // All arenas with a matching format are full
+  auto a = try_alloc(createArena(fmt));
+  assert(a.valid() && "failed to allocate from a fresh arena!");
+
+  return a;
+}
+
+void MeshPool::dealloc(const Allocation& a)
+{
+  if(!a.valid()) return;
+
+  assert(a.arena < m_arenas.size() && "invalid Allocation passed to dealloc()!");
+
+  auto& arena = m_arenas[a.arena];
+
+  arena.verts.dealloc(a.base_vertex, a.num_verts);
+  arena.inds.dealloc(a.first_index, a.num_inds);
+}
+
+void MeshPool::uploadVertices(const Allocation& a, const void *verts, u32 offset, u32 num)
+{
+  assert(a.valid() && a.arena < m_arenas.size() && "invalid Allocation passed to uploadVertices()!");
+
+  if(num == ~0u) num = a.num_verts - offset;
+  assert(offset+num <= a.num_verts && "uploadVertices() out of the Allocation's range!");
+
+  auto& arena = m_arenas[a.arena];
+  auto& buf = m_pool->getBuffer<VertexBuffer>(arena.vertex_buf);
+
+  buf.upload(verts, a.base_vertex + offset, arena.vertex_sz, num);
+}
+
+void MeshPool::uploadIndices(const Allocation& a, const u32 *inds, u32 offset, u32 num)
+{
+  assert(a.valid() && a.arena < m_arenas.size() && "invalid Allocation passed to uploadIndices()!");
+
+  if(num == ~0u) num = a.num_inds - offset;
+  assert(offset+num <= a.num_inds && "uploadIndices() out of the Allocation's range!");
+
+  auto& arena = m_arenas[a.arena];
+  auto& buf = m_pool->getBuffer<IndexBuffer>(arena.index_buf);
+
+  buf.upload(inds, a.first_index + offset, num);
+}
+
+MeshPool::Ref MeshPool::ref() const
+{
+  return m_ref;
+}
+
+size_t MeshPool::numArenas() const
+{
+  return m_arenas.size();
+}
+
+MeshPool::ResourceId MeshPool::arenaVertexBuffer(u32 arena) const
+{
+  return m_arenas.at(arena).vertex_buf;
+}
+
+MeshPool::ResourceId MeshPool::arenaIndexBuffer(u32 arena) const
+{
+  return m_arenas.at(arena).index_buf;
+}
+
+MeshPool::ResourceId MeshPool::arenaArray(u32 arena) const
+{
+  return m_arenas.at(arena).array;
+}
+
+u32 MeshPool::createArena(const VertexFormat& fmt)
+{
+  auto idx = (u32)m_arenas.size();
+  auto& arena = m_arenas.emplace_back(fmt, m_arena_verts, m_arena_inds);
+
+  arena.vertex_buf = m_pool->createBuffer<VertexBuffer>(util::fmt("bvMeshPool%u", idx),
+      Buffer::Static);
+  arena.index_buf = m_pool->createBuffer<IndexBuffer>(util::fmt("biMeshPool%u", idx),
+      Buffer::Static, Type::u32);
+
+  auto& vbuf = m_pool->getBuffer<VertexBuffer>(arena.vertex_buf);
+  auto& ibuf = m_pool->getBuffer<IndexBuffer>(arena.index_buf);
+
+  // Allocate storage for the whole arena upfront
+  vbuf.init(arena.vertex_sz, m_arena_verts);
+  ibuf.init(sizeof(u32), m_arena_inds);
+
+  arena.array = m_pool->create<IndexedVertexArray>(util::fmt("iaMeshPool%u", idx),
+      fmt, vbuf, ibuf);
+
+  return idx;
+}
+
+}
@@ -0,0 +1,92 @@
+#include <gx/multidraw.h>
+#include <gx/commandbuffer.h>
+
+#include <cassert>
+#include <cstring>
+
+namespace gx {
+
+MultiDrawBuilder::MultiDrawBuilder(Primitive p, ResourceId indexed_array) :
+  m_primitive(p), m_array(indexed_array)
+{
+}
+
+Primitive MultiDrawBuilder::primitive() const
+{
+  return m_primitive;
+}
+
+MultiDrawBuilder::ResourceId MultiDrawBuilder::array() const
+{
+  return m_array;
+}
+
+bool MultiDrawBuilder::accepts(Primitive p, ResourceId indexed_array) const
+{
+  return p == m_primitive && indexed_array == m_array;
+}
+
+bool MultiDrawBuilder::draw(u32 num, u32 base_vertex, u32 first_index,
+  u32 instances, u32 base_instance)
+{
+  if(m_draws.size() >= MaxDraws) return false;
+
+  DrawElementsArgs args;
+  args.count = num;
+  args.instance_count = instances;
+  args.first_index = first_index;
+  args.base_vertex = (i32)base_vertex;
+  args.base_instance = base_instance;
+
+  m_draws.push_back(args);
+
+  return true;
+}
+
+size_t MultiDrawBuilder::numDraws() const
+{
+  return m_draws.size();
+}
+
+bool MultiDrawBuilder::empty() const
+{
+  return m_draws.empty();
+}
+
+auto MultiDrawBuilder::data() const -> const DrawElementsArgs *
+{
+  return m_draws.data();
+}
+
+size_t MultiDrawBuilder::byteSize() const
+{
+  return m_draws.size() * sizeof(DrawElementsArgs);
+}
+
+CommandBuffer& MultiDrawBuilder::emit(CommandBuffer& cmd, MemoryPool& mempool, ResourceId indirect_buffer)
+{
+  if(empty()) return cmd;
+
+  auto sz = byteSize();
+  assert(sz <= MaxArgsSize && "MultiDrawBuilder has too many draws!");
+
+  auto h = mempool.alloc(sz);
+  if(h == MemoryPool::Invalid) throw AllocFailedError();
+
+  memcpy(mempool.ptr(h), data(), sz);
+
+  cmd.multiDrawIndirect(m_primitive, m_array, indirect_buffer, h, numDraws());
+
+  reset();
+
+  return cmd;
+}
+
+MultiDrawBuilder& MultiDrawBuilder::reset()
+{
+  m_draws.clear();
+
+  return *this;
+}
+
+}
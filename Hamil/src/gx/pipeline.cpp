@@ -2,6 +2,7 @@
 #include <gx/resourcepool.h>
 #include <gx/vertex.h>
 #include <gx/program.h>
+#include <gx/multidraw.h>
 #include <math/geometry.h>
 
 #include <cassert>
@@ -204,6 +205,177 @@ Pipeline& Pipeline::drawBaseVertex(size_t base, size_t offset, size_t num)
   return *this;
 }
 
+Pipeline& Pipeline::drawInstanced(size_t offset, size_t num, size_t instances)
+{
+  assert(m_pool && "a Pipeline MUST have a ResourcePool bound to draw() with it!");
+
+  assert(getConfig<VertexInput>() && getConfig<InputAssembly>() &&
+      "a Pipeline MUST have VertexInput and InputAssembly configs to call draw()!");
+
+  auto& vi = *getConfig<VertexInput>();
+  auto& ia = *getConfig<InputAssembly>();
+
+  assert(vi.array != ~0u && "VertexInput.with_array() not set before drawInstanced()!");
+
+  assert(ia.primitive != gx::Primitive::Invalid &&
+      "invalid InputAssembly config bound to Pipeline! (missing 'primitive')");
+
+  auto prim = gl_prim(ia.primitive);
+
+  if(auto program_conf = getConfig<Program>()) {
+    auto& program = m_pool->get<gx::Program>(program_conf->id);
+
+    program.use();
+  } else {
+    // TODO: bind NULL program here...
+  }
+
+  if(!vi.isIndexed()) {
+    auto& vtx = m_pool->get<VertexArray>(vi.array);
+
+    vtx.use();
+    glDrawArraysInstanced(prim, (int)offset, (GLsizei)num, (GLsizei)instances);
+  } else {
+    auto& vtx  = m_pool->get<IndexedVertexArray>(vi.array);
+    auto idx_type = gl_type(vtx.indexType());
+
+    auto off = (void *)(offset * vtx.indexSize());
+
+    vtx.use();
+    glDrawElementsInstanced(prim, (GLsizei)num, idx_type, off, (GLsizei)instances);
+  }
+
+  return *this;
+}
+
+Pipeline& Pipeline::drawBaseVertexInstanced(size_t base, size_t offset, size_t num, size_t instances)
+{
+  assert(m_pool && "a Pipeline MUST have a ResourcePool bound to draw() with it!");
+
+  assert(getConfig<VertexInput>() && getConfig<InputAssembly>() &&
+      "a Pipeline MUST have VertexInput and InputAssembly configs to call draw()!");
+
+  auto& vi = *getConfig<VertexInput>();
+  auto& ia = *getConfig<InputAssembly>();
+
+  assert(vi.array != ~0u && "VertexInput.with_array() not set before drawBaseVertexInstanced()!");
+
+  assert(vi.isIndexed() &&
+      "drawBaseVertexInstanced() can only be called with indexed VertexInputs!");
+
+  assert(ia.primitive != gx::Primitive::Invalid &&
+      "invalid InputAssembly config bound to Pipeline! (missing 'primitive')");
+
+  auto prim = gl_prim(ia.primitive);
+
+  if(auto program_conf = getConfig<Program>()) {
+    auto& program = m_pool->get<gx::Program>(program_conf->id);
+
+    program.use();
+  } else {
+    // TODO: bind NULL program here...
+  }
+
+  auto& vtx = m_pool->get<IndexedVertexArray>(vi.array);
+  auto idx_type = gl_type(vtx.indexType());
+
+  auto off = (void *)(offset * vtx.indexSize());
+
+  vtx.use();
+  glDrawElementsInstancedBaseVertex(prim, (GLsizei)num, idx_type, off,
+      (GLsizei)instances, (int)base);
+
+  return *this;
+}
+
+Pipeline& Pipeline::multiDrawIndirect(ResourceId indirect_buffer, size_t offset, size_t num_draws)
+{
+  assert(m_pool && "a Pipeline MUST have a ResourcePool bound to draw() with it!");
+
+  assert(getConfig<VertexInput>() && getConfig<InputAssembly>() &&
+      "a Pipeline MUST have VertexInput and InputAssembly configs to call draw()!");
+
+  auto& vi = *getConfig<VertexInput>();
+  auto& ia = *getConfig<InputAssembly>();
+
+  assert(vi.array != ~0u && "VertexInput.with_array() not set before multiDrawIndirect()!");
+
+  assert(vi.isIndexed() &&
+      "multiDrawIndirect() can only be called with indexed VertexInputs!");
+
+  assert(ia.primitive != gx::Primitive::Invalid &&
+      "invalid InputAssembly config bound to Pipeline! (missing 'primitive')");
+
+  auto prim = gl_prim(ia.primitive);
+
+  if(auto program_conf = getConfig<Program>()) {
+    auto& program = m_pool->get<gx::Program>(program_conf->id);
+
+    program.use();
+  } else {
+    // TODO: bind NULL program here...
+  }
+
+  auto& vtx = m_pool->get<IndexedVertexArray>(vi.array);
+  auto idx_type = gl_type(vtx.indexType());
+
+  auto& indirect = m_pool->getBuffer(indirect_buffer).get();
+
+  vtx.use();
+  indirect.use();
+  glMultiDrawElementsIndirect(prim, idx_type, (void *)offset, (GLsizei)num_draws, 0);
+
+  return *this;
+}
+
+Pipeline& Pipeline::multiDrawBaseVertex(const DrawElementsIndirectArgs *draws, size_t num_draws)
+{
+  assert(m_pool && "a Pipeline MUST have a ResourcePool bound to draw() with it!");
+
+  assert(getConfig<VertexInput>() && getConfig<InputAssembly>() &&
+      "a Pipeline MUST have VertexInput and InputAssembly configs to call draw()!");
+
+  auto& vi = *getConfig<VertexInput>();
+  auto& ia = *getConfig<InputAssembly>();
+
+  assert(vi.array != ~0u && "VertexInput.with_array() not set before multiDrawBaseVertex()!");
+
+  assert(vi.isIndexed() &&
+      "multiDrawBaseVertex() can only be called with indexed VertexInputs!");
+
+  assert(ia.primitive != gx::Primitive::Invalid &&
+      "invalid InputAssembly config bound to Pipeline! (missing 'primitive')");
+
+  auto prim = gl_prim(ia.primitive);
+
+  if(auto program_conf = getConfig<Program>()) {
+    auto& program = m_pool->get<gx::Program>(program_conf->id);
+
+    program.use();
+  } else {
+    // TODO: bind NULL program here...
+  }
+
+  auto& vtx = m_pool->get<IndexedVertexArray>(vi.array);
+  auto idx_type = gl_type(vtx.indexType());
+
+  vtx.use();
+  for(size_t i = 0; i < num_draws; i++) {
+    const auto& draw = draws[i];
+
+    auto off = (void *)((size_t)draw.first_index * vtx.indexSize());
+
+    if(draw.instance_count == 1) {
+      glDrawElementsBaseVertex(prim, (GLsizei)draw.count, idx_type, off, draw.base_vertex);
+    } else {
+      glDrawElementsInstancedBaseVertex(prim, (GLsizei)draw.count, idx_type, off,
+          (GLsizei)draw.instance_count, draw.base_vertex);
+    }
+  }
+
+  return *this;
+}
+
 Pipeline Pipeline::current()
 {
   return p_current;
@@ -1,6 +1,7 @@
 #include <gx/program.h>
 #include <gx/buffer.h>
 #include <gx/vertex.h>
+#include <gx/info.h>
 
 #include <os/panic.h>
 #include <util/format.h>
@@ -339,12 +340,23 @@ void Program::getUniformBlockDescriptors()
 }
 
 thread_local static const char *p_shader_source[256] = {
-  "#version 330 core\n\n"         // Concatenate the strings
-  "layout(row_major) uniform;\n"
-  "layout(std140) uniform;\n\n",
+  nullptr,  // The prelude (see below)
   nullptr,
 };
 
+static const char *p_shader_prelude =
+  "#version 330 core\n\n"         // Concatenate the strings
+  "layout(row_major) uniform;\n"
+  "layout(std140) uniform;\n\n";
+
+// #extension directives must precede any other tokens,
+//   so they can't be a part of the user sources
+static const char *p_shader_prelude_draw_parameters =
+  "#version 330 core\n"
+  "#extension GL_ARB_shader_draw_parameters : enable\n\n"
+  "layout(row_major) uniform;\n"
+  "layout(std140) uniform;\n\n";
+
 Shader::Shader(Type type, SourcesList sources) :
   Shader(type, sources.data(), sources.size())
 {
@@ -354,6 +366,8 @@ Shader::Shader(Type type, const char *const sources[], size_t count)
 {
   m = glCreateShader(type);
 
+  p_shader_source[0] = info().shaderDrawParameters() ?
+    p_shader_prelude_draw_parameters : p_shader_prelude;
   memcpy(p_shader_source+1, sources, count*sizeof(const char *));
 
   glShaderSource(m, (GLsizei)count+1 /* add the prelude */, p_shader_source, nullptr);
@@ -109,6 +109,13 @@ uint RenderPass::nextSubpassId() const
   return (uint)m_subpasses.size();
 }
 
+RenderPass& RenderPass::clearSubpasses()
+{
+  m_subpasses.clear();
+
+  return *this;
+}
+
 const RenderPass& RenderPass::begin(ResourcePool& pool) const
 { 
   auto& framebuffer = pool.get<Framebuffer>(m_framebuffer);
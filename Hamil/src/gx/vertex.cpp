@@ -78,6 +78,25 @@ bool VertexFormat::attrInteger(unsigned idx) const
   return m_descs[idx].flags & Integer;
 }
 
+bool VertexFormat::operator==(const VertexFormat& other) const
+{
+  if(m_descs.size() != other.m_descs.size()) return false;
+
+  for(size_t i = 0; i < m_descs.size(); i++) {
+    const auto& a = m_descs[i];
+    const auto& b = other.m_descs[i];
+
+    if(a.index != b.index || a.type != b.type || a.size != b.size || a.flags != b.flags) return false;
+  }
+
+  return true;
+}
+
+bool VertexFormat::operator!=(const VertexFormat& other) const
+{
+  return !(*this == other);
+}
+
 size_t VertexFormat::byteSize(Desc desc)
 {
   size_t size = desc.size;
@@ -0,0 +1,327 @@
+#include <hm/transformsystem.h>
+#include <hm/entity.h>
+
+#include <util/unit.h>
+#include <math/cull.h>
+#include <sched/pool.h>
+#include <sched/job.h>
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+
+namespace hm {
+
+TransformSystem::TransformSystem() :
+  m_needs_rebuild(false), m_dirty(false)
+{
+}
+
+TransformSystem& TransformSystem::add(EntityId e, EntityId parent, const mat4& local, const AABB& local_aabb)
+{
+  if(contains(e)) throw EntityExistsError();
+
+  u32 parent_idx = NoParent;
+  if(parent != Entity::Invalid) {
+    auto it = m_index.find(parent);
+    if(it == m_index.end()) throw NoSuchParentError();
+
+    parent_idx = it->second;
+  }
+
+  // Parents always end up before their children, which
+  //   is relied upon by remove() and rebuild()
+  auto idx = (u32)m_entity.size();
+
+  m_entity.push_back(e);
+  m_parent.push_back(parent_idx);
+  m_depth.push_back(parent_idx != NoParent ? m_depth[parent_idx]+1 : 0);
+  m_flags.push_back(Dirty);
+
+  m_local.push_back(local);
+  m_world.push_back(local);
+  m_local_aabb.push_back(local_aabb);
+  m_world_aabb.push_back(local_aabb);
+
+  m_index.emplace(e, idx);
+
+  m_needs_rebuild = true;
+  m_dirty = true;
+
+  return *this;
+}
+
+TransformSystem& TransformSystem::remove(EntityId e)
+{
+  auto idx = nodeIndex(e);
+
+  m_flags[idx] |= Removed;
+  m_index.erase(e);
+
+  // Children are always stored after their parents so all the
+  //   descendants can be found in a single forward pass
+  for(auto i = idx+1; i < m_entity.size(); i++) {
+    auto parent = m_parent[i];
+    if(parent == NoParent || !(m_flags[parent] & Removed) || (m_flags[i] & Removed)) continue;
+
+    m_flags[i] |= Removed;
+    m_index.erase(m_entity[i]);
+  }
+
+  m_needs_rebuild = true;
+
+  return *this;
+}
+
+bool TransformSystem::contains(EntityId e) const
+{
+  return m_index.find(e) != m_index.end();
+}
+
+TransformSystem& TransformSystem::local(EntityId e, const mat4& local)
+{
+  auto idx = nodeIndex(e);
+
+  m_local[idx] = local;
+  m_flags[idx] |= Dirty;
+
+  m_dirty = true;
+
+  return *this;
+}
+
+TransformSystem& TransformSystem::world(EntityId e, const mat4& world)
+{
+  auto idx = nodeIndex(e);
+
+  m_local[idx] = world;
+  m_flags[idx] |= Dirty|WorldSpace;
+
+  m_dirty = true;
+
+  return *this;
+}
+
+TransformSystem& TransformSystem::localAABB(EntityId e, const AABB& local_aabb)
+{
+  auto idx = nodeIndex(e);
+
+  m_local_aabb[idx] = local_aabb;
+  m_flags[idx] |= Dirty;
+
+  m_dirty = true;
+
+  return *this;
+}
+
+const mat4& TransformSystem::local(EntityId e) const
+{
+  return m_local[nodeIndex(e)];
+}
+
+const mat4& TransformSystem::world(EntityId e) const
+{
+  return m_world[nodeIndex(e)];
+}
+
+const AABB& TransformSystem::worldAABB(EntityId e) const
+{
+  return m_world_aabb[nodeIndex(e)];
+}
+
+size_t TransformSystem::syncPhysics(const std::vector<bt::DynamicsWorld::MovedBody>& moved_bodies)
+{
+  size_t num_synced = 0;
+  for(const auto& body : moved_bodies) {
+    auto e = (EntityId)(uintptr_t)body.user;
+
+    auto it = m_index.find(e);
+    if(it == m_index.end()) continue;
+
+    auto idx = it->second;
+
+    // The body's transform is world-space
+    m_local[idx] = body.transform;
+    m_flags[idx] |= Dirty|WorldSpace;
+
+    num_synced++;
+  }
+
+  if(num_synced) m_dirty = true;
+
+  return num_synced;
+}
+
+size_t TransformSystem::update(sched::WorkerPool *pool)
+{
+  if(m_needs_rebuild) rebuild();
+  if(!m_dirty) return 0;
+
+  using UpdateJobData = std::pair<sched::WorkerPool::JobId, sched::IJob *>;
+
+  // Number of nodes a job processes at once
+  static constexpr u32 BlockSize = 256;
+
+  size_t num_updated = 0;
+  for(size_t level = 0; level+1 < m_level.size(); level++) {
+    auto begin = m_level[level];
+    auto end   = m_level[level+1];
+
+    if(!pool || (end - begin) < ParallelThreshold) {
+      num_updated += updateRange(begin, end);
+      continue;
+    }
+
+    // Nodes on the same level only read their parents' (which
+    //   are on the previous level) world matrices and flags so
+    //   they can be safely updated in parallel
+    std::atomic<u32> next_block(begin);
+    std::atomic<size_t> num_updated_level(0);
+
+    std::array<UpdateJobData, NumJobs> jobs;
+    for(uint job_idx = 0; job_idx < NumJobs; job_idx++) {
+      sched::IJob *job = new sched::Job<Unit>(sched::create_job([&,end]() -> Unit {
+        u32 block = 0;
+        while((block = next_block.fetch_add(BlockSize)) < end) {
+          auto n = updateRange(block, std::min(block + BlockSize, end));
+
+          num_updated_level.fetch_add(n);
+        }
+
+        return {};
+      }));
+
+      auto id = pool->scheduleJob(job);
+      jobs[job_idx] = std::make_pair(id, job);
+    }
+
+    // The next level can only be processed after this one is done
+    for(const auto& job : jobs) {
+      pool->waitJob(job.first);
+      delete job.second;
+    }
+
+    num_updated += num_updated_level.load();
+  }
+
+  for(auto& flags : m_flags) flags &= ~Dirty;
+  m_dirty = false;
+
+  return num_updated;
+}
+
+size_t TransformSystem::size() const
+{
+  return m_index.size();
+}
+
+u32 TransformSystem::nodeIndex(EntityId e) const
+{
+  auto it = m_index.find(e);
+  if(it == m_index.end()) throw NoSuchEntityError();
+
+  return it->second;
+}
+
+void TransformSystem::rebuild()
+{
+  // Counting sort by depth, which keeps the relative order of
+  //   the nodes on each level (and so is stable across rebuilds)
+  std::vector<u32> level_size;
+  for(size_t i = 0; i < m_entity.size(); i++) {
+    if(m_flags[i] & Removed) continue;
+
+    auto depth = m_depth[i];
+    if(depth >= level_size.size()) level_size.resize(depth+1);
+
+    level_size[depth]++;
+  }
+
+  m_level.resize(level_size.size() + 1);
+  m_level[0] = 0;
+  for(size_t level = 0; level < level_size.size(); level++) {
+    m_level[level+1] = m_level[level] + level_size[level];
+  }
+
+  auto num_nodes = m_level.back();
+
+  std::vector<u32> remap(m_entity.size(), NoParent);
+  std::vector<u32> next(m_level.begin(), m_level.end()-1);
+  for(size_t i = 0; i < m_entity.size(); i++) {
+    if(m_flags[i] & Removed) continue;
+
+    remap[i] = next[m_depth[i]]++;
+  }
+
+  std::vector<EntityId> entity(num_nodes);
+  std::vector<u32> parent(num_nodes);
+  std::vector<u32> depth(num_nodes);
+  std::vector<u8> flags(num_nodes);
+
+  std::vector<mat4> local(num_nodes);
+  std::vector<mat4> world(num_nodes);
+  std::vector<AABB> local_aabb(num_nodes);
+  std::vector<AABB> world_aabb(num_nodes);
+
+  for(size_t i = 0; i < m_entity.size(); i++) {
+    auto idx = remap[i];
+    if(idx == NoParent) continue;
+
+    entity[idx] = m_entity[i];
+    parent[idx] = m_parent[i] != NoParent ? remap[m_parent[i]] : NoParent;
+    depth[idx]  = m_depth[i];
+    flags[idx]  = m_flags[i];
+
+    local[idx] = m_local[i];
+    world[idx] = m_world[i];
+    local_aabb[idx] = m_local_aabb[i];
+    world_aabb[idx] = m_world_aabb[i];
+
+    m_index[entity[idx]] = idx;
+  }
+
+  m_entity = std::move(entity);
+  m_parent = std::move(parent);
+  m_depth  = std::move(depth);
+  m_flags  = std::move(flags);
+
+  m_local = std::move(local);
+  m_world = std::move(world);
+  m_local_aabb = std::move(local_aabb);
+  m_world_aabb = std::move(world_aabb);
+
+  m_needs_rebuild = false;
+}
+
+size_t TransformSystem::updateRange(u32 begin, u32 end)
+{
+  size_t num_updated = 0;
+  for(auto i = begin; i < end; i++) {
+    auto parent = m_parent[i];
+
+    // Propagate the parent's dirty flag down the hierarchy
+    if(parent != NoParent && (m_flags[parent] & Dirty)) m_flags[i] |= Dirty;
+    if(!(m_flags[i] & Dirty)) continue;
+
+    if(m_flags[i] & WorldSpace) {
+      // The parent's world matrix is already up to date, so
+      //   the local matrix can be recovered from it
+      m_world[i] = m_local[i];
+      if(parent != NoParent) m_local[i] = m_world[parent].inverse() * m_world[i];
+
+      m_flags[i] &= ~WorldSpace;
+    } else if(parent != NoParent) {
+      m_world[i] = m_world[parent] * m_local[i];
+    } else {
+      m_world[i] = m_local[i];
+    }
+
+    m_world_aabb[i] = aabb_transform(m_world[i], m_local_aabb[i]);
+
+    num_updated++;
+  }
+
+  return num_updated;
+}
+
+}
@@ -0,0 +1,237 @@
+#include <math/cull.h>
+
+#include <util/simd.h>
+
+#include <cstring>
+
+// The 8-wide kernels can only be used when the compiler
+//   is allowed to emit AVX instructions
+#if !defined(NO_SSE) && !defined(NO_AVX) && defined(__AVX__)
+#  define CULL_AVX
+#endif
+
+// The sphere is outside when its center is further
+//   than 'r' behind any of the planes
+static bool sphere_inside(const frustum3& frustum, float x, float y, float z, float r)
+{
+  for(const auto& p : frustum.planes) {
+    float d = p.x*x + p.y*y + p.z*z + p.w;
+    if(d < -r) return false;
+  }
+
+  return true;
+}
+
+// Selects (for every plane) the corner of the AABB which is furthest
+//   along the plane's normal (the 'positive vertex') - when it's behind
+//   the plane all the other corners are as well
+struct PlanePVertex {
+  const float *x, *y, *z;
+};
+
+static void plane_pvertices(const frustum3& frustum, const AABBsSoA& aabbs, PlanePVertex *pv)
+{
+  for(size_t i = 0; i < frustum.planes.size(); i++) {
+    const auto& p = frustum.planes[i];
+
+    pv[i].x = p.x > 0.0f ? aabbs.max_x : aabbs.min_x;
+    pv[i].y = p.y > 0.0f ? aabbs.max_y : aabbs.min_y;
+    pv[i].z = p.z > 0.0f ? aabbs.max_z : aabbs.min_z;
+  }
+}
+
+static bool aabb_inside(const frustum3& frustum, const PlanePVertex *pv, size_t idx)
+{
+  for(size_t i = 0; i < frustum.planes.size(); i++) {
+    const auto& p = frustum.planes[i];
+
+    float d = p.x*pv[i].x[idx] + p.y*pv[i].y[idx] + p.z*pv[i].z[idx] + p.w;
+    if(d <= 0.0f) return false;
+  }
+
+  return true;
+}
+
+static void set_mask_bits(u32 *mask, size_t idx, u32 bits)
+{
+  // Blocks are always 4 or 8 objects wide and start
+  //   at a multiple of their width so 'bits' never
+  //   straddles two mask words
+  mask[idx / 32] |= bits << (idx % 32);
+}
+
+void frustum_spheres_inside(const frustum3& frustum, const SpheresSoA& spheres, size_t n, u32 *mask)
+{
+  memset(mask, 0, cull_mask_size(n)*sizeof(u32));
+
+  size_t i = 0;
+
+#if defined(CULL_AVX)
+  for(; i+8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(spheres.x + i);
+    __m256 y = _mm256_loadu_ps(spheres.y + i);
+    __m256 z = _mm256_loadu_ps(spheres.z + i);
+    __m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.r + i));
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for(const auto& p : frustum.planes) {
+      __m256 d = _mm256_set1_ps(p.w);
+      d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(p.x), x));
+      d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(p.y), y));
+      d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(p.z), z));
+
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_GE_OQ));
+    }
+
+    set_mask_bits(mask, i, (u32)_mm256_movemask_ps(inside));
+  }
+#endif
+
+#if !defined(NO_SSE)
+  for(; i+4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(spheres.x + i);
+    __m128 y = _mm_loadu_ps(spheres.y + i);
+    __m128 z = _mm_loadu_ps(spheres.z + i);
+    __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.r + i));
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for(const auto& p : frustum.planes) {
+      __m128 d = _mm_set1_ps(p.w);
+      d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(p.x), x));
+      d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(p.y), y));
+      d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(p.z), z));
+
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_r));
+    }
+
+    set_mask_bits(mask, i, (u32)_mm_movemask_ps(inside));
+  }
+#endif
+
+  // Leftover spheres
+  for(; i < n; i++) {
+    if(!sphere_inside(frustum, spheres.x[i], spheres.y[i], spheres.z[i], spheres.r[i])) continue;
+
+    set_mask_bits(mask, i, 1);
+  }
+}
+
+void frustum_aabbs_inside(const frustum3& frustum, const AABBsSoA& aabbs, size_t n, u32 *mask)
+{
+  memset(mask, 0, cull_mask_size(n)*sizeof(u32));
+
+  // The positive vertex depends only on the signs of the
+  //   plane's normal, so it's the same for all the AABBs
+  PlanePVertex pv[std::tuple_size_v<decltype(frustum3::planes)>];
+  plane_pvertices(frustum, aabbs, pv);
+
+  size_t i = 0;
+
+#if defined(CULL_AVX)
+  for(; i+8 <= n; i += 8) {
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for(size_t j = 0; j < frustum.planes.size(); j++) {
+      const auto& p = frustum.planes[j];
+
+      __m256 d = _mm256_set1_ps(p.w);
+      d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(p.x), _mm256_loadu_ps(pv[j].x + i)));
+      d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(p.y), _mm256_loadu_ps(pv[j].y + i)));
+      d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(p.z), _mm256_loadu_ps(pv[j].z + i)));
+
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GT_OQ));
+    }
+
+    set_mask_bits(mask, i, (u32)_mm256_movemask_ps(inside));
+  }
+#endif
+
+#if !defined(NO_SSE)
+  for(; i+4 <= n; i += 4) {
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for(size_t j = 0; j < frustum.planes.size(); j++) {
+      const auto& p = frustum.planes[j];
+
+      __m128 d = _mm_set1_ps(p.w);
+      d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(p.x), _mm_loadu_ps(pv[j].x + i)));
+      d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(p.y), _mm_loadu_ps(pv[j].y + i)));
+      d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(p.z), _mm_loadu_ps(pv[j].z + i)));
+
+      inside = _mm_and_ps(inside, _mm_cmpgt_ps(d, _mm_setzero_ps()));
+    }
+
+    set_mask_bits(mask, i, (u32)_mm_movemask_ps(inside));
+  }
+#endif
+
+  // Leftover AABBs
+  for(; i < n; i++) {
+    if(!aabb_inside(frustum, pv, i)) continue;
+
+    set_mask_bits(mask, i, 1);
+  }
+}
+
+#if !defined(NO_SSE)
+#  define splat_ps(a, i) _mm_shuffle_ps(a, a, _MM_SHUFFLE(i, i, i, i))
+
+static void arvo_accumulate(__m128 col, __m128 min, __m128 max, __m128& out_min, __m128& out_max)
+{
+  __m128 a = _mm_mul_ps(col, min);
+  __m128 b = _mm_mul_ps(col, max);
+
+  out_min = _mm_add_ps(out_min, _mm_min_ps(a, b));
+  out_max = _mm_add_ps(out_max, _mm_max_ps(a, b));
+}
+#endif
+
+AABB aabb_transform(const mat4& m, const AABB& aabb)
+{
+  AABB out;
+
+#if !defined(NO_SSE)
+  __m128 col0 = _mm_load_ps(m.d + 0);
+  __m128 col1 = _mm_load_ps(m.d + 4);
+  __m128 col2 = _mm_load_ps(m.d + 8);
+  __m128 col3 = _mm_load_ps(m.d + 12);
+
+  // Matrices are stored row-major
+  _MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+
+  __m128 min = _mm_loadu_ps(aabb.pad0_);
+  __m128 max = _mm_loadu_ps(aabb.pad1_);
+
+  // Start from the translation and for every column accumulate
+  //   the smaller/larger of the products with min and max, which
+  //   computes all 3 rows of the result at once
+  __m128 out_min = col3;
+  __m128 out_max = col3;
+
+  arvo_accumulate(col0, splat_ps(min, 0), splat_ps(max, 0), out_min, out_max);
+  arvo_accumulate(col1, splat_ps(min, 1), splat_ps(max, 1), out_min, out_max);
+  arvo_accumulate(col2, splat_ps(min, 2), splat_ps(max, 2), out_min, out_max);
+
+  _mm_storeu_ps(out.pad0_, out_min);
+  _mm_storeu_ps(out.pad1_, out_max);
+#else
+  vec3 t = m.translation();
+
+  out.min = t;
+  out.max = t;
+  for(unsigned row = 0; row < 3; row++) {
+    for(unsigned col = 0; col < 3; col++) {
+      float a = m(col, row) * aabb.min[col];
+      float b = m(col, row) * aabb.max[col];
+
+      out.min[row] += std::min(a, b);
+      out.max[row] += std::max(a, b);
+    }
+  }
+#endif
+
+  return out;
+}
+
+void aabbs_transform(const mat4 *m, const AABB *aabbs, AABB *out, size_t n)
+{
+  for(size_t i = 0; i < n; i++) out[i] = aabb_transform(m[i], aabbs[i]);
+}
@@ -4,10 +4,16 @@
 #include <math/intrin.h>
 
 #include <util/format.h>
+#include <util/unit.h>
+#include <sched/pool.h>
+#include <sched/job.h>
 
 #include <cmath>
 #include <cstring>
 #include <cstdio>
+#include <array>
+#include <vector>
+#include <atomic>
 #include <algorithm>
 #include <functional>
 
@@ -175,95 +181,142 @@ LTC_CoeffsTable::~LTC_CoeffsTable()
   delete m_data;
 }
 
-LTC_CoeffsTable& LTC_CoeffsTable::fit(const brdf::BRDF_GGX& brdf)
+LTC_CoeffsTable& LTC_CoeffsTable::fit(const brdf::BRDF_GGX& brdf, sched::WorkerPool *pool,
+  uvec2 extent)
 {
+  static constexpr unsigned N = TableSize.x;
+
+  const unsigned first_row  = N - std::min(extent.x, N);
+  const unsigned num_thetas = std::min(extent.y, TableSize.y);
+
+  using FitJobData = std::pair<sched::WorkerPool::JobId, sched::IJob *>;
+
+  // 1. Fit the first column from the highest roughness down, saving
+  //    each of the results as the first guess for the rest of it's row
+  std::array<LTC, N> row_ltc;
+
   LTC ltc;
+  for(unsigned a = N; a-- > first_row;) {
+    fitCell(ltc, brdf, a, 0);
 
-  static constexpr unsigned N = TableSize.x;
-  for(unsigned a = N-1; a >= 0; a--) {
-    for(unsigned t = 0; t <= N-1; t++) {
-      float x = t / float(N-1);
-      float ct = 1.0f - x*x;
+    row_ltc[a] = ltc;
+  }
 
-      // cosf() returns -0.0f when theta == PIf/2
-      //   which is undesired, a small bias fixes this
-      float theta = std::min(PIf/2.0f - 1e-7f, acosf(ct));
+  // 2. Fit the remaining cells of each row
+  auto fit_row = [&](unsigned a) {
+    LTC ltc = row_ltc[a];
+    for(unsigned t = 1; t < num_thetas; t++) fitCell(ltc, brdf, a, t);
+  };
 
-      vec3 V = { sinf(theta), 0.0f, cosf(theta) };
+  if(!pool) {
+    for(unsigned a = N; a-- > first_row;) fit_row(a);
+  } else {
+    std::atomic<unsigned> next_row(first_row);
 
-      float roughness = a / float(N-1);
-      float alpha = std::max(roughness*roughness, MinAlpha);
+    std::array<FitJobData, NumJobs> jobs;
+    for(unsigned job_idx = 0; job_idx < NumJobs; job_idx++) {
+      sched::IJob *job = new sched::Job<Unit>(sched::create_job([&]() -> Unit {
+        unsigned a = 0;
+        while((a = next_row.fetch_add(1)) < N) fit_row(a);
 
-      vec3 avg_dir;
+        return {};
+      }));
 
-      // Fills in 'ltc' and 'avg_dir'
-      averageTerms(brdf, V, alpha, ltc.magnitude, ltc.fresnel, avg_dir);
+      auto id = pool->scheduleJob(job);
+      jobs[job_idx] = std::make_pair(id, job);
+    }
 
-      bool isotropic;
+    for(const auto& job : jobs) {
+      pool->waitJob(job.first);
+      delete job.second;
+    }
+  }
 
-      // 1. First guess for the fit
-      if(t == 0) {
-        ltc.X = vec3::right();
-        ltc.Y = vec3::up();
-        ltc.Z = vec3::forward();
+  m_data->pack();
 
-        if(a == N-1) { // roughness == 1.0f
-          ltc.m11 = 1.0f;
-          ltc.m22 = 1.0f;
-        } else {       // Use previous roughness
-          mat3 prev_M = m_data->M[a + 1 + t*N];
+  return *this;
+}
 
-          ltc.m11 = prev_M(0, 0);
-          ltc.m22 = prev_M(1, 1);
-        }
+void LTC_CoeffsTable::fitCell(LTC& ltc, const brdf::BRDF_GGX& brdf, unsigned a, unsigned t)
+{
+  static constexpr unsigned N = TableSize.x;
 
-        ltc.m13 = 0.0f;
-        ltc.compute();
+  float x = t / float(N-1);
+  float ct = 1.0f - x*x;
 
-        isotropic = true;
-      } else {  // Use previous fit as first guess if possible
-        // Construct basis
-        auto L = avg_dir;
-        auto T1 = vec3(L.z, 0.0, -L.x);
-        auto T2 = vec3::up();
+  // cosf() returns -0.0f when theta == PIf/2
+  //   which is undesired, a small bias fixes this
+  float theta = std::min(PIf/2.0f - 1e-7f, acosf(ct));
 
-        ltc.X = T1;
-        ltc.Y = T2;
-        ltc.Z = L;
+  vec3 V = { sinf(theta), 0.0f, cosf(theta) };
 
-        ltc.compute();
-        isotropic = false;
-      }
+  float roughness = a / float(N-1);
+  float alpha = std::max(roughness*roughness, MinAlpha);
 
-      // 2. Fit (refine first guess)
-      const float eps = 0.05f;
-      fitOne(ltc, brdf, V, alpha, eps, isotropic);
+  vec3 avg_dir;
 
-      mat3& M = m_data->M[a + t*N];
+  // Fills in 'ltc' and 'avg_dir'
+  averageTerms(brdf, V, alpha, ltc.magnitude, ltc.fresnel, avg_dir);
 
-      memcpy(M.d, ltc.M.d, sizeof(M));
-      m_data->magnitude_fresnel[a + t*N].x = ltc.magnitude;
-      m_data->magnitude_fresnel[a + t*N].y = ltc.fresnel;
+  bool isotropic;
 
-      // Zero-out useless coefficients
-      M(0, 1) = M(1, 0) = M(2, 1) = M(1, 2) = 0.0f;
+  // 1. First guess for the fit
+  if(t == 0) {
+    ltc.X = vec3::right();
+    ltc.Y = vec3::up();
+    ltc.Z = vec3::forward();
 
-      auto str = util::fmt("a = %d t = %d\n"
-        "roghness = %f (alpha, theta) = (%f, %f)\n"
-        "V = %s \t average_dir = %s\n"
-        "%s\nmagnitude = %f fresnel = %f\n\n",
-        a, t,
-        roughness, alpha, theta,
-        math::to_str(V), math::to_str(avg_dir),
-        math::to_str(M), ltc.magnitude, ltc.fresnel);
+    if(a == N-1) { // roughness == 1.0f
+      ltc.m11 = 1.0f;
+      ltc.m22 = 1.0f;
+    } else {       // Use previous roughness
+      mat3 prev_M = m_data->M[a + 1 + t*N];
 
-      puts(str.data());
+      ltc.m11 = prev_M(0, 0);
+      ltc.m22 = prev_M(1, 1);
     }
+
+    ltc.m13 = 0.0f;
+    ltc.compute();
+
+    isotropic = true;
+  } else {  // Use previous fit as first guess if possible
+    // Construct basis
+    auto L = avg_dir;
+    auto T1 = vec3(L.z, 0.0, -L.x);
+    auto T2 = vec3::up();
+
+    ltc.X = T1;
+    ltc.Y = T2;
+    ltc.Z = L;
+
+    ltc.compute();
+    isotropic = false;
   }
 
-  m_data->pack();
+  // 2. Fit (refine first guess)
+  const float eps = 0.05f;
+  fitOne(ltc, brdf, V, alpha, eps, isotropic);
 
-  return *this;
+  mat3& M = m_data->M[a + t*N];
+
+  memcpy(M.d, ltc.M.d, sizeof(M));
+  m_data->magnitude_fresnel[a + t*N].x = ltc.magnitude;
+  m_data->magnitude_fresnel[a + t*N].y = ltc.fresnel;
+
+  // Zero-out useless coefficients
+  M(0, 1) = M(1, 0) = M(2, 1) = M(1, 2) = 0.0f;
+
+  auto str = util::fmt("a = %d t = %d\n"
+    "roghness = %f (alpha, theta) = (%f, %f)\n"
+    "V = %s \t average_dir = %s\n"
+    "%s\nmagnitude = %f fresnel = %f\n\n",
+    a, t,
+    roughness, alpha, theta,
+    math::to_str(V), math::to_str(avg_dir),
+    math::to_str(M), ltc.magnitude, ltc.fresnel);
+
+  puts(str.data());
 }
 
 const LTC_CoeffsTable::CoeffsArray& LTC_CoeffsTable::coeffs1() const
@@ -314,8 +367,62 @@ void LTC_CoeffsTable::averageTerms(const brdf::BRDF_GGX& brdf, const vec3& V, fl
   avg_dir = avg_dir.normalize();
 }
 
+// Directions used for importance sampling the LTC (in it's local,
+//   untransformed space) - they only depend on the sample index
+static const std::array<vec3, LTC_CoeffsTable::NumSamples*LTC_CoeffsTable::NumSamples>& ltc_sample_dirs()
+{
+  static constexpr int NumSamples = LTC_CoeffsTable::NumSamples;
+
+  static const auto dirs = []() {
+    std::array<vec3, NumSamples*NumSamples> dirs;
+    for(int j = 0; j < NumSamples; j++) {
+      for(int i = 0; i < NumSamples; i++) {
+        auto U1 = ((float)i + 0.5f) / NumSamples;
+        auto U2 = ((float)j + 0.5f) / NumSamples;
+
+        // Same as LTC::sample() without the transform by 'M'
+        const float theta = acosf(sqrtf(U1));
+        const float phi = 2.0f*PIf * U2;
+
+        dirs[i + j*NumSamples] = vec3::from_spherical(theta, phi);
+      }
+    }
+
+    return dirs;
+  }();
+
+  return dirs;
+}
+
+// The BRDF importance sampled directions and the BRDF evaluated
+//   for them are the same for every iteration of a cell's fit,
+//   so they're computed only once per cell by fitOne()
+struct LTC_CoeffsTable::ErrorSamples {
+  ErrorSamples(const brdf::BRDF_GGX& brdf, const vec3& V, float alpha)
+  {
+    for(int j = 0; j < NumSamples; j++) {
+      for(int i = 0; i < NumSamples; i++) {
+        auto U1 = ((float)i + 0.5f) / NumSamples;
+        auto U2 = ((float)j + 0.5f) / NumSamples;
+
+        auto idx = i + j*NumSamples;
+
+        L[idx] = brdf.sample(V, alpha, U1, U2);
+
+        auto [eval, pdf] = brdf.eval(V, L[idx], alpha);
+        brdf_eval[idx] = eval;
+        brdf_pdf[idx]  = pdf;
+      }
+    }
+  }
+
+  std::array<vec3, NumSamples*NumSamples> L;
+  std::array<float, NumSamples*NumSamples> brdf_eval;
+  std::array<float, NumSamples*NumSamples> brdf_pdf;
+};
+
 float LTC_CoeffsTable::computeError(const LTC& ltc, const brdf::BRDF_GGX& brdf,
-  const vec3& V, float alpha)
+  const vec3& V, float alpha, const ErrorSamples& samples)
 {
   double error = 0.0;
 
@@ -329,28 +436,24 @@ float LTC_CoeffsTable::computeError(const LTC& ltc, const brdf::BRDF_GGX& brdf,
 
   static constexpr auto NumSamples2 = (double)(NumSamples*NumSamples);
 
-  for(int j = 0; j < NumSamples; j++) {
-    for(int i = 0; i < NumSamples; i++) {
-      auto U1 = ((float)i + 0.5f) / NumSamples;
-      auto U2 = ((float)j + 0.5f) / NumSamples;
-
-      {      // LTC importance sampling
-        vec3 L = ltc.sample(U1, U2);
+  const auto& ltc_dirs = ltc_sample_dirs();
 
-        auto [brdf_eval, brdf_pdf] = brdf.eval(V, L, alpha);
-        auto [ltc_eval, ltc_pdf] = ltc.eval(L);
+  // The samples are accumulated in the same order as before
+  //   they were cached so the fit doesn't change
+  for(int idx = 0; idx < NumSamples*NumSamples; idx++) {
+    {      // LTC importance sampling
+      vec3 L = (ltc.M * ltc_dirs[idx]).normalize();
 
-        error += calc_error(brdf_pdf, brdf_eval, ltc_pdf, ltc_eval);
-      }
+      auto [brdf_eval, brdf_pdf] = brdf.eval(V, L, alpha);
+      auto [ltc_eval, ltc_pdf] = ltc.eval(L);
 
-      {     // BRDF importance sampling
-        vec3 L = brdf.sample(V, alpha, U1, U2);
+      error += calc_error(brdf_pdf, brdf_eval, ltc_pdf, ltc_eval);
+    }
 
-        auto [brdf_eval, brdf_pdf] = brdf.eval(V, L, alpha);
-        auto [ltc_eval, ltc_pdf] = ltc.eval(L);
+    {     // BRDF importance sampling
+      auto [ltc_eval, ltc_pdf] = ltc.eval(samples.L[idx]);
 
-        error += calc_error(brdf_pdf, brdf_eval, ltc_pdf, ltc_eval);
-      }
+      error += calc_error(samples.brdf_pdf[idx], samples.brdf_eval[idx], ltc_pdf, ltc_eval);
     }
   }
 
@@ -380,7 +483,10 @@ void LTC_CoeffsTable::fitOne(LTC& ltc, const brdf::BRDF_GGX& brdf,
     ltc.compute();
   };
 
-  auto get_error = std::bind(&LTC_CoeffsTable::computeError, this, std::placeholders::_1, brdf, V, alpha);
+  const ErrorSamples samples(brdf, V, alpha);
+
+  auto get_error = std::bind(&LTC_CoeffsTable::computeError, this,
+    std::placeholders::_1, brdf, V, alpha, std::cref(samples));
 
   [[maybe_unused]]
   float error = nedler_mead<3>(result, start, eps, 1e-5f, 100, [&](const float *params) -> float {
@@ -60,7 +60,7 @@ static constexpr i32 F16InfC  = F32Inf >> F16Shift;
 static constexpr i32 F16NaN   = (F16InfC + 1) << F16Shift;
 static constexpr i32 F16MinC  = F32MinN >> F16Shift;
 static constexpr i32 F16MaxC  = F32MaxN >> F16Shift;
-static constexpr i32 F16SignC = F32Sign >> F16Shift;
+static constexpr i32 F16SignC = F32Sign >> F16SignShift;
 
 static constexpr i32 F16SubC = 0x003FF;
 static constexpr i32 F16NorC = 0x00400;
@@ -0,0 +1,481 @@
+#include <mesh/binmesh.h>
+#include <mesh/mesh.h>
+#include <mesh/obj.h>
+
+#include <math/util.h>
+#include <os/file.h>
+#include <gx/buffer.h>
+
+#include <cassert>
+#include <cstring>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace mesh {
+
+static size_t align_offset(size_t offset, size_t align)
+{
+  return (offset + align-1) & ~(align-1);
+}
+
+static void write_padding(os::File& file, size_t offset, size_t padded_offset)
+{
+  static const byte zeroes[BinMeshDataAlign] = { 0 };
+
+  assert(padded_offset-offset <= sizeof(zeroes));
+
+  file.write(zeroes, padded_offset-offset);
+}
+
+// Returns the size of a single vertex with the given
+//   components stored according to BinMeshHeader::Flags
+static u32 vertex_stride(u32 components, u32 flags)
+{
+  bool half = flags & BinMeshHeader::HalfFloat;
+
+  u32 stride = sizeof(vec3);
+  if(components & Mesh::Normal)   stride += half ? sizeof(hvec4) : sizeof(vec3);
+  if(components & Mesh::TexCoord) stride += half ? sizeof(hvec2) : sizeof(vec2);
+
+  return stride;
+}
+
+bool BinMeshLoader::loaded() const
+{
+  return m_loaded;
+}
+
+gx::VertexFormat BinMeshLoader::vertexFormat() const
+{
+  assert(m_loaded && "vertexFormat() called before load()!");
+
+  bool half = m_header.flags & BinMeshHeader::HalfFloat;
+
+  auto fmt = gx::VertexFormat()
+    .attr(gx::Type::f32, 3);
+
+  if(m_header.vertex_components & Mesh::Normal) {
+    if(half) {
+      fmt.attr(gx::Type::f16, 4);
+    } else {
+      fmt.attr(gx::Type::f32, 3);
+    }
+  }
+
+  if(m_header.vertex_components & Mesh::TexCoord) fmt.attr(half ? gx::Type::f16 : gx::Type::f32, 2);
+
+  return fmt;
+}
+
+uint BinMeshLoader::numSubmeshes() const
+{
+  return (uint)m_submeshes.size();
+}
+
+MeshLoader::Submesh BinMeshLoader::submesh(uint idx) const
+{
+  const auto& submesh = m_submeshes.at(idx);
+
+  Submesh s;
+  s.first_index = submesh.first_index;
+  s.num_inds = submesh.num_inds;
+  s.aabb = AABB(
+      vec3(submesh.aabb_min[0], submesh.aabb_min[1], submesh.aabb_min[2]),
+      vec3(submesh.aabb_max[0], submesh.aabb_max[1], submesh.aabb_max[2])
+  );
+
+  return s;
+}
+
+void BinMeshLoader::positions(std::vector<vec3>& verts, std::vector<u32>& inds) const
+{
+  assert(m_loaded && "positions() called before load()!");
+
+  // The position is always the first attribute
+  verts.resize(m_header.num_verts);
+  for(u32 i = 0; i < m_header.num_verts; i++) {
+    memcpy(&verts[i], m_verts + (size_t)i*m_header.vertex_stride, sizeof(vec3));
+  }
+
+  inds.resize(m_header.num_inds);
+  for(u32 i = 0; i < m_header.num_inds; i++) inds[i] = index(i);
+}
+
+const BinMeshHeader& BinMeshLoader::header() const
+{
+  return m_header;
+}
+
+AABB BinMeshLoader::aabb() const
+{
+  return AABB(
+      vec3(m_header.aabb_min[0], m_header.aabb_min[1], m_header.aabb_min[2]),
+      vec3(m_header.aabb_max[0], m_header.aabb_max[1], m_header.aabb_max[2])
+  );
+}
+
+const std::vector<vec3>& BinMeshLoader::occluderVertices() const
+{
+  return m_occluder_verts;
+}
+
+const std::vector<u16>& BinMeshLoader::occluderIndices() const
+{
+  return m_occluder_inds;
+}
+
+MeshLoader& BinMeshLoader::doLoad(const void *data, size_t sz)
+{
+  auto ptr = (const byte *)data;
+
+  if(sz < sizeof(BinMeshHeader)) throw InvalidBinMeshError();
+  memcpy(&m_header, ptr, sizeof(BinMeshHeader));
+
+  if(m_header.magic != BinMeshHeader::Magic || m_header.version != BinMeshHeader::Version) {
+    throw InvalidBinMeshError();
+  }
+
+  if(m_header.index_size != sizeof(u16) && m_header.index_size != sizeof(u32)) {
+    throw InvalidBinMeshError();
+  }
+
+  if(m_header.vertex_stride != vertex_stride(m_header.vertex_components, m_header.flags)) {
+    throw InvalidBinMeshError();
+  }
+
+  // Make sure all of the sections lie inside of the buffer
+  auto in_bounds = [sz](size_t offset, size_t size) {
+    return offset <= sz && size <= sz-offset;
+  };
+
+  size_t submeshes_sz = (size_t)m_header.num_submeshes * sizeof(BinSubmesh);
+  size_t verts_sz = (size_t)m_header.num_verts * m_header.vertex_stride;
+  size_t inds_sz  = (size_t)m_header.num_inds * m_header.index_size;
+  size_t occluder_sz = (size_t)m_header.num_occluder_verts*sizeof(vec3)
+    + (size_t)m_header.num_occluder_inds*sizeof(u16);
+
+  if(!in_bounds(sizeof(BinMeshHeader), submeshes_sz)
+    || !in_bounds(m_header.vertex_offset, verts_sz)
+    || !in_bounds(m_header.index_offset, inds_sz)
+    || !in_bounds(m_header.occluder_offset, occluder_sz)) {
+    throw InvalidBinMeshError();
+  }
+
+  m_submeshes.resize(m_header.num_submeshes);
+  memcpy(m_submeshes.data(), ptr + sizeof(BinMeshHeader), submeshes_sz);
+
+  // Make sure the submeshes and indices don't reference
+  //   anything past the end of their respective arrays
+  for(const auto& submesh : m_submeshes) {
+    if(submesh.first_index > m_header.num_inds
+      || submesh.num_inds > m_header.num_inds - submesh.first_index) {
+      throw InvalidBinMeshError();
+    }
+  }
+
+  m_occluder_verts.resize(m_header.num_occluder_verts);
+  m_occluder_inds.resize(m_header.num_occluder_inds);
+
+  auto occluder = ptr + m_header.occluder_offset;
+  memcpy(m_occluder_verts.data(), occluder, m_occluder_verts.size()*sizeof(vec3));
+  memcpy(m_occluder_inds.data(), occluder + m_occluder_verts.size()*sizeof(vec3),
+      m_occluder_inds.size()*sizeof(u16));
+
+  // The vertices and indices are used only during
+  //   stream<Indexed>() so don't copy them
+  m_verts = ptr + m_header.vertex_offset;
+  m_inds  = ptr + m_header.index_offset;
+
+  for(u32 i = 0; i < m_header.num_inds; i++) {
+    if(index(i) >= m_header.num_verts) throw InvalidBinMeshError();
+  }
+
+  for(auto idx : m_occluder_inds) {
+    if(idx >= m_occluder_verts.size()) throw InvalidBinMeshError();
+  }
+
+  m_loaded = true;
+
+  return *this;
+}
+
+MeshLoader& BinMeshLoader::initBuffers(const gx::VertexFormat& fmt, gx::BufferHandle verts)
+{
+  // Every index gets it's own vertex
+  verts().init(fmt.vertexByteSize(), m_header.num_inds);
+
+  return *this;
+}
+
+MeshLoader& BinMeshLoader::initBuffers(const gx::VertexFormat& fmt,
+  gx::BufferHandle verts, gx::BufferHandle inds)
+{
+  auto index_sz = inds.get<gx::IndexBuffer>().elemSize();
+
+  verts().init(fmt.vertexByteSize(), m_header.num_verts);
+  inds().init(index_sz, m_header.num_inds);
+
+  return *this;
+}
+
+MeshLoader& BinMeshLoader::doStream(const gx::VertexFormat& fmt, gx::BufferHandle vert_buf)
+{
+  if(!m_loaded) MeshLoader::load();
+
+  if(fmt.vertexByteSize() != m_header.vertex_stride) throw VertexFormatMismatchError();
+
+  initBuffers(fmt, vert_buf);
+
+  auto verts_view = vert_buf().map(gx::Buffer::Write, gx::Buffer::MapInvalidate);
+  auto dst = verts_view.get<byte>();
+
+  // Un-index the vertices
+  for(u32 i = 0; i < m_header.num_inds; i++) {
+    memcpy(dst, m_verts + (size_t)index(i)*m_header.vertex_stride, m_header.vertex_stride);
+    dst += m_header.vertex_stride;
+  }
+
+  return *this;
+}
+
+MeshLoader& BinMeshLoader::doStreamIndexed(const gx::VertexFormat& fmt,
+  gx::BufferHandle vert_buf, gx::BufferHandle ind_buf)
+{
+  if(!m_loaded) MeshLoader::load();
+
+  if(fmt.vertexByteSize() != m_header.vertex_stride) throw VertexFormatMismatchError();
+
+  const auto& index_buf = ind_buf.get<gx::IndexBuffer>();
+  auto index_sz = index_buf.elemSize();
+
+  // The vertices are already laid out exactly as they
+  //   should be in the VertexBuffer...
+  vert_buf().init(m_verts, m_header.vertex_stride, m_header.num_verts);
+
+  // ...and so are the indices if the IndexBuffer's
+  //   element type matches the baked one
+  if(index_sz == m_header.index_size) {
+    ind_buf().init(m_inds, index_sz, m_header.num_inds);
+
+    return *this;
+  }
+
+  assert((index_sz >= sizeof(u16) || m_header.num_verts <= (1u<<8)) &&
+      (index_sz >= sizeof(u32) || m_header.num_verts <= (1u<<16)) &&
+      "The IndexBuffer's elemType() is too small to index all the vertices!");
+
+  ind_buf().init(index_sz, m_header.num_inds);
+
+  auto inds_view = ind_buf().map(gx::Buffer::Write, gx::Buffer::MapInvalidate);
+
+  auto convert = [&](auto *dst) {
+    using T = std::remove_pointer_t<decltype(dst)>;
+
+    if(m_header.index_size == sizeof(u16)) {
+      auto src = (const u16 *)m_inds;
+      for(u32 i = 0; i < m_header.num_inds; i++) *dst++ = (T)*src++;
+    } else {
+      auto src = (const u32 *)m_inds;
+      for(u32 i = 0; i < m_header.num_inds; i++) *dst++ = (T)*src++;
+    }
+  };
+
+  switch(index_buf.elemType()) {
+  case gx::Type::u8:  convert(inds_view.get<u8>()); break;
+  case gx::Type::u16: convert(inds_view.get<u16>()); break;
+  case gx::Type::u32: convert(inds_view.get<u32>()); break;
+
+  default: assert(0); // unreachable
+  }
+
+  return *this;
+}
+
+MeshLoader& BinMeshLoader::doStreamPooled(const gx::VertexFormat& fmt,
+  std::vector<byte>& verts, std::vector<u32>& inds)
+{
+  if(!m_loaded) MeshLoader::load();
+
+  if(fmt.vertexByteSize() != m_header.vertex_stride) throw VertexFormatMismatchError();
+
+  verts.resize((size_t)m_header.num_verts * m_header.vertex_stride);
+  memcpy(verts.data(), m_verts, verts.size());
+
+  // gx::MeshPool indices are always u32
+  inds.resize(m_header.num_inds);
+  if(m_header.index_size == sizeof(u16)) {
+    auto src = (const u16 *)m_inds;
+    for(u32 i = 0; i < m_header.num_inds; i++) inds[i] = src[i];
+  } else {
+    memcpy(inds.data(), m_inds, inds.size()*sizeof(u32));
+  }
+
+  return *this;
+}
+
+u32 BinMeshLoader::index(u32 idx) const
+{
+  if(m_header.index_size == sizeof(u16)) return ((const u16 *)m_inds)[idx];
+
+  return ((const u32 *)m_inds)[idx];
+}
+
+BinMeshBuilder& BinMeshBuilder::fromObj(const ObjLoader& obj, uint flags)
+{
+  m_header = BinMeshHeader();
+
+  u32 components = 0;
+  if(obj.hasNormals())   components |= Mesh::Normal;
+  if(obj.hasTexCoords()) components |= Mesh::TexCoord;
+
+  const auto& v  = obj.vertices();
+  const auto& vn = obj.normals();
+  const auto& vt = obj.texCoords();
+
+  // After normalization every vertex has all of it's attributes
+  if((components & Mesh::Normal && vn.size() != v.size())
+    || (components & Mesh::TexCoord && vt.size() != v.size())) {
+    throw NotNormalizedError();
+  }
+
+  m_header.flags = (flags & HalfFloat) ? BinMeshHeader::HalfFloat : 0;
+  m_header.vertex_components = components;
+  m_header.vertex_stride = vertex_stride(components, m_header.flags);
+
+  m_header.num_verts = (u32)v.size();
+  m_header.index_size = v.size() <= (1u<<16) ? sizeof(u16) : sizeof(u32);
+
+  bool half = m_header.flags & BinMeshHeader::HalfFloat;
+
+  // Interleave the vertex attributes
+  m_verts.resize(v.size() * m_header.vertex_stride);
+  for(size_t i = 0; i < v.size(); i++) {
+    auto dst = m_verts.data() + i*m_header.vertex_stride;
+
+    memcpy(dst, &v[i], sizeof(vec3));
+    dst += sizeof(vec3);
+
+    if(components & Mesh::Normal) {
+      if(half) {
+        auto n = to_f16(vec4(vn[i], 0.0f));
+
+        memcpy(dst, &n, sizeof(hvec4));
+        dst += sizeof(hvec4);
+      } else {
+        memcpy(dst, &vn[i], sizeof(vec3));
+        dst += sizeof(vec3);
+      }
+    }
+
+    if(components & Mesh::TexCoord) {
+      auto uv = vt[i].xy();
+
+      if(half) {
+        auto h = to_f16(uv);
+
+        memcpy(dst, &h, sizeof(hvec2));
+      } else {
+        memcpy(dst, &uv, sizeof(vec2));
+      }
+    }
+  }
+
+  AABB aabb = { vec3(INFINITY), vec3(-INFINITY) };
+
+  m_submeshes.clear();
+  m_inds.clear();
+  for(size_t i = 0; i < obj.numMeshes(); i++) {
+    const auto& mesh = obj.mesh((uint)i);
+
+    BinSubmesh submesh;
+    submesh.first_index = (u32)m_inds.size();
+    submesh.num_inds = (u32)mesh.faces().size() * 3;
+
+    for(const auto& face : mesh.faces()) {
+      for(const auto& vert : face) {
+        if(vert.needsNormalization()) throw NotNormalizedError();
+
+        m_inds.push_back(vert.v);
+      }
+    }
+
+    auto mesh_aabb = mesh.aabb();
+    memcpy(submesh.aabb_min, &mesh_aabb.min, sizeof(submesh.aabb_min));
+    memcpy(submesh.aabb_max, &mesh_aabb.max, sizeof(submesh.aabb_max));
+
+    if(!mesh.faces().empty()) {
+      aabb = { vec3::min(aabb.min, mesh_aabb.min), vec3::max(aabb.max, mesh_aabb.max) };
+    }
+
+    m_submeshes.push_back(submesh);
+  }
+
+  m_header.num_submeshes = (u32)m_submeshes.size();
+  m_header.num_inds = (u32)m_inds.size();
+
+  memcpy(m_header.aabb_min, &aabb.min, sizeof(m_header.aabb_min));
+  memcpy(m_header.aabb_max, &aabb.max, sizeof(m_header.aabb_max));
+
+  return *this;
+}
+
+BinMeshBuilder& BinMeshBuilder::occluder(std::vector<vec3> verts, std::vector<u16> inds)
+{
+  if(verts.size() > (1u<<16)) throw OccluderTooLargeError();
+
+  assert(inds.size() % 3 == 0 && "The occluder must be a triangle mesh!");
+
+  m_occluder_verts = std::move(verts);
+  m_occluder_inds  = std::move(inds);
+
+  return *this;
+}
+
+size_t BinMeshBuilder::write(os::File& file)
+{
+  auto header = m_header;
+  header.magic = BinMeshHeader::Magic;
+  header.version = BinMeshHeader::Version;
+
+  header.num_occluder_verts = (u32)m_occluder_verts.size();
+  header.num_occluder_inds  = (u32)m_occluder_inds.size();
+  header.reserved_ = 0;
+
+  // Lay out the file...
+  size_t submeshes_end = sizeof(BinMeshHeader) + m_submeshes.size()*sizeof(BinSubmesh);
+
+  header.vertex_offset = align_offset(submeshes_end, BinMeshDataAlign);
+  size_t verts_end = header.vertex_offset + m_verts.size();
+
+  header.index_offset = align_offset(verts_end, BinMeshDataAlign);
+  size_t inds_end = header.index_offset + (size_t)header.num_inds*header.index_size;
+
+  header.occluder_offset = align_offset(inds_end, BinMeshDataAlign);
+  size_t occluder_end = header.occluder_offset
+    + m_occluder_verts.size()*sizeof(vec3) + m_occluder_inds.size()*sizeof(u16);
+
+  // ...and write it out
+  file.write(&header, sizeof(BinMeshHeader));
+  file.write(m_submeshes.data(), m_submeshes.size()*sizeof(BinSubmesh));
+
+  write_padding(file, submeshes_end, header.vertex_offset);
+  file.write(m_verts.data(), m_verts.size());
+
+  write_padding(file, verts_end, header.index_offset);
+  if(header.index_size == sizeof(u16)) {
+    std::vector<u16> inds(m_inds.begin(), m_inds.end());
+
+    file.write(inds.data(), inds.size()*sizeof(u16));
+  } else {
+    file.write(m_inds.data(), m_inds.size()*sizeof(u32));
+  }
+
+  write_padding(file, inds_end, header.occluder_offset);
+  file.write(m_occluder_verts.data(), m_occluder_verts.size()*sizeof(vec3));
+  file.write(m_occluder_inds.data(), m_occluder_inds.size()*sizeof(u16));
+
+  return occluder_end;
+}
+
+}
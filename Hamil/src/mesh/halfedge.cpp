@@ -9,193 +9,249 @@ namespace mesh {
 
 HalfEdgeStructure::HalfEdgeStructure()
 {
-  m_edge_set = std::make_unique<EdgeSet>();
 }
 
 void HalfEdgeStructure::addTraingle(HalfEdge::Vertex v0, HalfEdge::Vertex v1, HalfEdge::Vertex v2)
 {
-  m_edge_set->emplace(std::min(v0, v1), std::max(v0, v1));
-  m_edge_set->emplace(std::min(v1, v2), std::max(v1, v2));
-  m_edge_set->emplace(std::min(v2, v0), std::max(v2, v0));
-
   m_faces.emplace_back(v0, v1, v2);
 }
 
-// Source: https://github.com/yig/halfedge/blob/master/trimesh.cpp
 void HalfEdgeStructure::build(size_t num_verts)
 {
-  for(auto& e : *m_edge_set) {
-    m_edges.emplace_back(e);
-  }
+  const auto num_face_halfedges = (HalfEdge::Index)(m_faces.size() * 3);
 
-  // No longer needed
-  m_edge_set.reset();
+  m_halfedges.clear();
+  m_halfedges.resize(num_face_halfedges);
 
-  DirectedEdgeMap edge_map;
+  const auto origin = [this](HalfEdge::Index hei) -> HalfEdge::Vertex {
+    const auto& he = m_halfedges[hei];
 
-  const auto add_to_edge_map = [&](HalfEdge::Vertex a, HalfEdge::Vertex b, HalfEdge::Index i) {
-    edge_map.emplace(std::make_pair(
-      HalfEdge::Edge(a, b),
-      i
-    ));
+    return he.face != HalfEdge::None ?
+      m_faces[he.face].v[hei % 3] : m_halfedges[he.opposite].vertex;
   };
 
-  const auto directed_edge_to_face = [&](HalfEdge::Vertex a, HalfEdge::Vertex b) -> HalfEdge::Index {
-    auto it = edge_map.find(HalfEdge::Edge(a, b));
+  // The halfedges which belong to faces are laid out
+  //   in order, so they can be created directly
+  IndexVector valence(num_verts, 0);   // Number of outgoing halfedges
+  for(HalfEdge::Index fi = 0; fi < m_faces.size(); fi++) {
+    const auto& face = m_faces[fi];
 
-    if(it == edge_map.end()) {
-      assert(edge_map.find(HalfEdge::Edge(b, a)) != edge_map.end());
-      return HalfEdge::None;
-    }
+    for(HalfEdge::Index k = 0; k < 3; k++) {
+      auto& he = m_halfedges[fi*3 + k];
 
-    return it->second;
-  };
+      he.vertex = face.v[(k+1) % 3];
+      he.face = fi;
+      he.next = fi*3 + (k+1) % 3;
+
+      valence[face.v[k]]++;
+    }
+  }
 
-  for(HalfEdge::Index i = 0; i < m_faces.size(); i++) {
-    const auto& tri = m_faces[i];
+  // Bucket the halfedges by their origin (a counting sort of the
+  //   edges' (origin, target) keys by the origin) so the opposite
+  //   of each one can be found by scanning a few adjacent entries
+  IndexVector bucket_offsets(num_verts+1);
 
-    add_to_edge_map(tri.v[0], tri.v[1], i);
-    add_to_edge_map(tri.v[1], tri.v[2], i);
-    add_to_edge_map(tri.v[2], tri.v[0], i);
+  HalfEdge::Index offset = 0;
+  for(HalfEdge::Vertex v = 0; v < num_verts; v++) {
+    bucket_offsets[v] = offset;
+    offset += valence[v];
   }
+  bucket_offsets[num_verts] = offset;
 
-  m_vert_he.resize(num_verts, HalfEdge::None);
-  m_face_he.resize(m_faces.size(), HalfEdge::None);
-  m_edge_he.resize(m_edges.size(), HalfEdge::None);
+  IndexVector bucket_halfedges(num_face_halfedges),
+    bucket_targets(num_face_halfedges);
+  {
+    IndexVector cursors(bucket_offsets.begin(), bucket_offsets.end()-1);
+    for(HalfEdge::Index hei = 0; hei < num_face_halfedges; hei++) {
+      auto i = cursors[origin(hei)]++;
 
-  m_halfedges.reserve(m_edges.size() * 2);
+      bucket_halfedges[i] = hei;
+      bucket_targets[i] = m_halfedges[hei].vertex;
+    }
+  }
 
-  for(HalfEdge::Index ei = 0; ei < m_edges.size(); ei++) {
-    const auto& e = m_edges[ei];
+  const auto find_in_bucket = [&](HalfEdge::Vertex a, HalfEdge::Vertex b) -> HalfEdge::Index {
+    for(auto i = bucket_offsets[a]; i < bucket_offsets[a+1]; i++) {
+      if(bucket_targets[i] == b) return bucket_halfedges[i];
+    }
 
-    const auto he0_idx = (HalfEdge::Index)m_halfedges.size();
-    auto& he0 = m_halfedges.emplace_back();
+    return HalfEdge::None;
+  };
 
-    const auto he1_idx = (HalfEdge::Index)m_halfedges.size();
-    auto& he1 = m_halfedges.emplace_back();
+  // Pair up the halfedges with their opposites, creating
+  //   boundary halfedges for the ones which don't have any
+  IndexVector boundary_out(num_verts, HalfEdge::None);  // Boundary halfedge leaving each vertex
+  for(HalfEdge::Index hei = 0; hei < num_face_halfedges; hei++) {
+    if(m_halfedges[hei].opposite != HalfEdge::None) continue;
 
-    he0.face = directed_edge_to_face(e.first, e.second);
-    he0.vertex = e.second;
-    he0.edge = ei;
+    const auto a = origin(hei),
+      b = m_halfedges[hei].vertex;
 
-    he1.face = directed_edge_to_face(e.second, e.first);
-    he1.vertex = e.first;
-    he1.edge = ei;
+    // Each directed edge can belong to only one face
+    if(find_in_bucket(a, b) != hei) throw NonManifoldEdgeError();
 
-    he0.opposite = he1_idx;
-    he1.opposite = he0_idx;
+    auto opposite = find_in_bucket(b, a);
+    if(opposite == HalfEdge::None) {
+      opposite = (HalfEdge::Index)m_halfedges.size();
 
-    m_edge_to_halfedge.emplace(std::make_pair(
-      HalfEdge::Edge(e.first, e.second),
-      he0_idx
-    ));
-    m_edge_to_halfedge.emplace(std::make_pair(
-      HalfEdge::Edge(e.second, e.first),
-      he1_idx
-    ));
+      auto& boundary = m_halfedges.emplace_back();
+      boundary.vertex = a;
 
-    if(m_vert_he[he0.vertex] == HalfEdge::None || he1.face == HalfEdge::None) {
-      m_vert_he[he0.vertex] = he0.opposite;
-    }
-    if(m_vert_he[he1.vertex] == HalfEdge::None || he0.face == HalfEdge::None) {
-      m_vert_he[he1.vertex] = he1.opposite;
-    }
+      if(boundary_out[b] != HalfEdge::None) throw ButterflyVertexError();
+      boundary_out[b] = opposite;
 
-    if(he0.face != HalfEdge::None && m_face_he[he0.face] == HalfEdge::None) {
-      m_face_he[he0.face] = he0_idx;
-    }
-    if(he1.face != HalfEdge::None && m_face_he[he1.face] == HalfEdge::None) {
-      m_face_he[he1.face] = he1_idx;
+      valence[b]++;
+    } else if(m_halfedges[opposite].opposite != HalfEdge::None) {
+      throw NonManifoldEdgeError();
     }
 
-    m_edge_he[ei] = he0_idx;
+    m_halfedges[hei].opposite = opposite;
+    m_halfedges[opposite].opposite = hei;
   }
 
-  IndexVector boundary;
+  // Boundary halfedges are chained along the boundary loops
+  for(auto hei = num_face_halfedges; hei < m_halfedges.size(); hei++) {
+    auto& he = m_halfedges[hei];
+
+    he.next = boundary_out[he.vertex];
+  }
+
+  m_edges.clear();
+  m_edge_he.clear();
+  m_edges.reserve(m_halfedges.size() / 2);
+  m_edge_he.reserve(m_halfedges.size() / 2);
+
+  m_vert_he.assign(num_verts, HalfEdge::None);
+
   for(HalfEdge::Index hei = 0; hei < m_halfedges.size(); hei++) {
     auto& he = m_halfedges[hei];
+    const auto a = origin(hei);
 
-    if(he.face == HalfEdge::None) {
-      boundary.emplace_back(hei);
-      continue;
-    }
+    if(m_vert_he[a] == HalfEdge::None) m_vert_he[a] = hei;
 
-    const auto& face = m_faces[he.face];
-    const auto i = he.vertex;
+    if(hei > he.opposite) continue;
 
-    HalfEdge::Index j = HalfEdge::None;
-    if(face.v[0] == i)      j = face.v[1];
-    else if(face.v[1] == i) j = face.v[2];
-    else if(face.v[2] == i) j = face.v[0];
+    // Store the halfedge going from the lower
+    //   to the higher vertex in 'm_edge_he'
+    const auto b = he.vertex;
+    const auto ei = (HalfEdge::Index)m_edges.size();
 
-    he.next = edge_map.at(HalfEdge::Edge(i, j));
+    m_edges.emplace_back(std::min(a, b), std::max(a, b));
+    m_edge_he.push_back(a < b ? hei : he.opposite);
+
+    he.edge = ei;
+    m_halfedges[he.opposite].edge = ei;
+  }
+
+  // Make sure the walks around boundary vertices start
+  //   on the boundary, so they visit all the neighbours
+  for(HalfEdge::Vertex v = 0; v < num_verts; v++) {
+    if(boundary_out[v] != HalfEdge::None) m_vert_he[v] = boundary_out[v];
   }
 
-  std::map<HalfEdge::Index, std::set<HalfEdge::Index>> vert_to_boundary;
-  for(auto& hei : boundary) {
-    const auto opposite = m_halfedges[hei].opposite;
-    const auto origin = m_halfedges[opposite].vertex;
+  m_face_he.resize(m_faces.size());
+  for(HalfEdge::Index fi = 0; fi < m_faces.size(); fi++) m_face_he[fi] = fi*3;
+
+  // Lay out the final adjacency in rotational order, now
+  //   including the boundary halfedges
+  m_vert_offsets.resize(num_verts+1);
 
-    vert_to_boundary[origin].emplace(hei);
-    if(vert_to_boundary[origin].size() > 1) throw ButterflyVertexError();
+  offset = 0;
+  for(HalfEdge::Vertex v = 0; v < num_verts; v++) {
+    m_vert_offsets[v] = offset;
+    offset += valence[v];
   }
+  m_vert_offsets[num_verts] = offset;
 
-  for(auto& hei : boundary) {
-    auto& he = m_halfedges[hei];
+  m_vert_neighbours.resize(offset);
+  m_vert_halfedges.resize(offset);
+
+  for(HalfEdge::Vertex v = 0; v < num_verts; v++) {
+    const auto start = m_vert_he[v];
+    if(start == HalfEdge::None) continue;
+
+    auto hei = start;
+    auto i = m_vert_offsets[v];
+    const auto end = m_vert_offsets[v+1];
 
-    auto& outgoing = vert_to_boundary[he.vertex];
-    if(outgoing.empty()) continue;
+    do {
+      const auto& he = m_halfedges[hei];
 
-    const auto it = outgoing.begin();
-    he.next = *it;
+      // The vertex has more than one fan of faces
+      if(i == end) throw ButterflyVertexError();
 
-    outgoing.erase(it);
+      m_vert_neighbours[i] = he.vertex;
+      m_vert_halfedges[i] = hei;
+      i++;
+
+      hei = m_halfedges[he.opposite].next;
+    } while(hei != start && hei != HalfEdge::None);
+
+    if(i != end) throw ButterflyVertexError();
   }
+}
 
-  // No longer needed as well
-  //m_edges.clear();
-  //m_edges.shrink_to_fit();
+size_t HalfEdgeStructure::numFaces() const
+{
+  return m_faces.size();
 }
 
-const HalfEdge& HalfEdgeStructure::halfedge(HalfEdge::Vertex a, HalfEdge::Vertex b) const
+size_t HalfEdgeStructure::numEdges() const
 {
-  auto it = m_edge_to_halfedge.find({ a, b });
-  if(it == m_edge_to_halfedge.end()) throw InvalidQueryError();
+  return m_edges.size();
+}
 
-  return m_halfedges.at(it->second);
+size_t HalfEdgeStructure::numHalfEdges() const
+{
+  return m_halfedges.size();
 }
 
-void HalfEdgeStructure::walkVertexNeighbours(HalfEdge::Vertex v, VertexVisitor visitor) const
+const HalfEdge::Face& HalfEdgeStructure::face(HalfEdge::Index idx) const
 {
-  const auto start = m_vert_he[v];
-  auto hei = start;
+  return m_faces.at(idx);
+}
 
-  do {
-    const auto& he = m_halfedges[hei];
-    const auto& opposite = m_halfedges[he.opposite];
+const HalfEdge::Edge& HalfEdgeStructure::edge(HalfEdge::Index idx) const
+{
+  return m_edges.at(idx);
+}
 
-    visitor(he.vertex);
+const HalfEdge& HalfEdgeStructure::halfedge(HalfEdge::Index idx) const
+{
+  return m_halfedges.at(idx);
+}
 
-    hei = opposite.next;
-  } while(hei != start);
+const HalfEdge& HalfEdgeStructure::halfedge(HalfEdge::Vertex a, HalfEdge::Vertex b) const
+{
+  if(a+1 >= m_vert_offsets.size()) throw InvalidQueryError();
+
+  for(auto i = m_vert_offsets[a]; i < m_vert_offsets[a+1]; i++) {
+    if(m_vert_neighbours[i] == b) return m_halfedges[m_vert_halfedges[i]];
+  }
+
+  throw InvalidQueryError();
 }
 
-void HalfEdgeStructure::walkFaceNeighbours(HalfEdge::Vertex v, FaceVisitor visitor) const
+void HalfEdgeStructure::walkVertexNeighbours(HalfEdge::Vertex v, VertexVisitor visitor) const
 {
-  const auto start = m_vert_he[v];
-  auto hei = start;
+  const auto begin = m_vert_offsets[v],
+    end = m_vert_offsets[v+1];
 
-  do {
-    const auto& he = m_halfedges[hei];
-    const auto& opposite = m_halfedges[he.opposite];
+  for(auto i = begin; i < end; i++) visitor(m_vert_neighbours[i]);
+}
 
-    if(he.face != HalfEdge::None) {
-      const auto& face = m_faces[he.face];
-      visitor(face);
-    }
+void HalfEdgeStructure::walkFaceNeighbours(HalfEdge::Vertex v, FaceVisitor visitor) const
+{
+  const auto begin = m_vert_offsets[v],
+    end = m_vert_offsets[v+1];
 
-    hei = opposite.next;
-  } while(hei != start);
+  for(auto i = begin; i < end; i++) {
+    const auto fi = m_halfedges[m_vert_halfedges[i]].face;
+    if(fi == HalfEdge::None) continue;
+
+    visitor(m_faces[fi]);
+  }
 }
 
-}
\ No newline at end of file
+}
@@ -42,6 +42,54 @@ MeshLoader::StreamJobPtr MeshLoader::streamIndexed(const gx::VertexFormat& fmt,
   ));
 }
 
+MeshLoader::StreamJobPtr MeshLoader::streamPooled(const gx::VertexFormat& fmt)
+{
+  return StreamJobPtr(new sched::Job<Unit, gx::VertexFormat>(
+    sched::create_job([this](gx::VertexFormat fmt) -> Unit {
+      m_pooled_fmt = fmt;
+      doStreamPooled(fmt, m_pooled_verts, m_pooled_inds);
+      if(m_on_loaded) m_on_loaded(*this);
+
+      return {};
+    }, fmt)
+  ));
+}
+
+MeshLoader::StreamJobPtr MeshLoader::streamPooled()
+{
+  return StreamJobPtr(new sched::Job<Unit>(
+    sched::create_job([this]() -> Unit {
+      if(!loaded()) load();
+
+      m_pooled_fmt = vertexFormat();
+      doStreamPooled(m_pooled_fmt, m_pooled_verts, m_pooled_inds);
+      if(m_on_loaded) m_on_loaded(*this);
+
+      return {};
+    })
+  ));
+}
+
+gx::MeshPool::Allocation MeshLoader::upload(gx::MeshPool& pool)
+{
+  auto vertex_sz = m_pooled_fmt.vertexByteSize();
+  if(m_pooled_verts.empty() || m_pooled_inds.empty()) return gx::MeshPool::Allocation();
+
+  auto num_verts = (u32)(m_pooled_verts.size() / vertex_sz);
+  auto num_inds  = (u32)m_pooled_inds.size();
+
+  auto a = pool.alloc(m_pooled_fmt, num_verts, num_inds);
+
+  pool.uploadVertices(a, m_pooled_verts.data());
+  pool.uploadIndices(a, m_pooled_inds.data());
+
+  // The data now lives on the GPU
+  m_pooled_verts = std::vector<byte>();
+  m_pooled_inds  = std::vector<u32>();
+
+  return a;
+}
+
 MeshLoader& MeshLoader::onLoaded(OnLoadedFn fn)
 {
   m_on_loaded = fn;
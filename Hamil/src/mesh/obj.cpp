@@ -1,16 +1,18 @@
 #include <mesh/obj.h>
 
-#include <util/str.h>
+#include <util/hash.h>
+#include <sched/pool.h>
+#include <sched/job.h>
 #include <gx/buffer.h>
 
 #include <cassert>
-#include <cctype>
 #include <cstring>
-#include <cstdio>
-#include <cstdlib>
 
 #include <string>
 #include <tuple>
+#include <charconv>
+#include <atomic>
+#include <algorithm>
 
 namespace mesh {
 
@@ -30,55 +32,199 @@ enum : char {
   Face = 'f',
 };
 
-enum : size_t {
-  InitialVertices  = 4096,
-  InitialTexCoords = 4096,
-  InitialNormals   = 4096,
-
-  InitialFaces = 4096,
-};
-
 ObjLoader& ObjLoader::load(const void *data, size_t sz, uint flags)
 {
   doLoad(data, sz);
 
-  if(flags & Normalize && !m_normalized) normalizeMeshes();
+  if(flags & Optimize) {
+    optimize();
+  } else if(flags & Normalize && !m_normalized) {
+    normalizeMeshes();
+  }
 
   return *this;
 }
 
-size_t ObjLoader::numMeshes() const
+ObjLoader& ObjLoader::load(sched::WorkerPool& pool, const void *data, size_t sz, uint flags)
 {
-  return m_meshes.size();
+  parse((const char *)data, sz, &pool);
+
+  if(flags & Optimize) {
+    optimize();
+  } else if(flags & Normalize && !m_normalized) {
+    normalizeMeshes();
+  }
+
+  return *this;
 }
 
-MeshLoader& ObjLoader::doLoad(const void *data, size_t sz)
+OptimizeStats ObjLoader::optimize(uint flags)
 {
-  m_normalized = true;
+  if(!m_normalized) normalizeMeshes();
 
-  m_v.reserve(InitialVertices);
-  m_vt.reserve(InitialTexCoords);
-  m_vn.reserve(InitialNormals);
+  auto num_verts = m_v.size();
 
-  m_current_offset = 0;
+  // After normalization the index alone determines
+  //   which attributes a given vertex has
+  std::vector<ObjMesh::Vertex> attrs(num_verts);
+  for(const auto& mesh : m_meshes) {
+    for(const auto& face : mesh.faces()) {
+      for(const auto& vert : face) attrs[vert.v] = vert;
+    }
+  }
 
-  appendMesh();  // Make sure back() doesn't get called when m_meshes is empty
+  std::vector<u32> inds;
+  std::vector<u32> clusters;
+
+  auto gather_indices = [&]() {
+    inds.clear();
+    for(const auto& mesh : m_meshes) {
+      for(const auto& face : mesh.faces()) {
+        for(const auto& vert : face) inds.push_back(vert.v);
+      }
+    }
+  };
+
+  // Meshes are drawn separately so their faces
+  //   can only be reordered among themselves
+  size_t offset = 0;
+  auto foreach_mesh = [&](auto fn) {
+    offset = 0;
+    for(auto& mesh : m_meshes) {
+      fn(mesh, inds.data() + offset, mesh.faces().size()*3);
+
+      offset += mesh.faces().size()*3;
+    }
+  };
+
+  auto cache_stats = [&]() {
+    float num_tris = 0.0f, num_referenced = 0.0f, num_transformed = 0.0f;
+
+    foreach_mesh([&](ObjMesh& mesh, u32 *mesh_inds, size_t num_inds) {
+      if(!num_inds) return;
+
+      auto s = vertex_cache_stats(mesh_inds, num_inds, num_verts);
+      auto transformed = s.acmr * (float)(num_inds/3);
 
-  util::splitlines(std::string((const char *)data, sz), [this](const std::string& line) {
-    auto it = line.begin();
-    while(it != line.end() && isspace(*it)) it++; // skip leading whitespace
+      num_tris += (float)(num_inds/3);
+      num_referenced += transformed / s.atvr;
+      num_transformed += transformed;
+    });
+
+    VertexCacheStats stats;
+    if(num_tris > 0.0f) {
+      stats.acmr = num_transformed / num_tris;
+      stats.atvr = num_transformed / num_referenced;
+    }
+
+    return stats;
+  };
 
-    if(it == line.end() || *it == Comment) return; // Line is empty or a comment - skip it
-   
-    parseLine(it);
+  OptimizeStats stats;
+
+  gather_indices();
+  stats.before = cache_stats();
+
+  foreach_mesh([&](ObjMesh& mesh, u32 *mesh_inds, size_t num_inds) {
+    if(flags & OptimizeOverdraw) {
+      tipsify(mesh_inds, num_inds, num_verts, DefaultVertexCacheSize, &clusters);
+      optimize_overdraw(mesh_inds, num_inds, StridePtr<vec3>(m_v.data(), sizeof(vec3)), num_verts,
+          clusters);
+    } else {
+      optimize_vertex_cache(mesh_inds, num_inds, num_verts);
+    }
   });
 
+  stats.after = cache_stats();
+
+  auto remap = optimize_vertex_fetch(inds.data(), inds.size(), num_verts);
+
+  remap_vertices(m_v, remap);
+  if(m_vn.size() == num_verts) remap_vertices(m_vn, remap);
+  if(m_vt.size() == num_verts) remap_vertices(m_vt, remap);
+
+  remap_vertices(attrs, remap);
+
+  // Write the optimized faces back into the meshes
+  const u32 *src = inds.data();
+  for(auto& mesh : m_meshes) {
+    for(auto& face : mesh.m_tris) {
+      for(auto& vert : face) {
+        auto index = *src++;
+        const auto& a = attrs[index];
+
+        vert.v  = index;
+        vert.vt = a.vt != ObjMesh::None ? index : ObjMesh::None;
+        vert.vn = a.vn != ObjMesh::None ? index : ObjMesh::None;
+      }
+    }
+  }
+
+  return stats;
+}
+
+bool ObjLoader::loaded() const
+{
+  return !m_meshes.empty();
+}
+
+gx::VertexFormat ObjLoader::vertexFormat() const
+{
+  auto fmt = gx::VertexFormat()
+    .attr(gx::Type::f32, 3);
+
+  if(hasNormals())   fmt.attr(gx::Type::f32, 3);
+  if(hasTexCoords()) fmt.attr(gx::Type::f32, 2);
+
+  return fmt;
+}
+
+uint ObjLoader::numSubmeshes() const
+{
+  return (uint)m_meshes.size();
+}
+
+MeshLoader::Submesh ObjLoader::submesh(uint idx) const
+{
+  const auto& obj = mesh(idx);
+
+  Submesh s;
+  s.first_index = (u32)obj.offset();
+  s.num_inds = (u32)obj.faces().size() * 3;
+  s.aabb = obj.aabb();
+
+  return s;
+}
+
+void ObjLoader::positions(std::vector<vec3>& verts, std::vector<u32>& inds) const
+{
+  verts = m_v;
+
+  inds.clear();
+  inds.reserve(m_current_offset);
+  for(const auto& mesh : m_meshes) {
+    for(const auto& face : mesh.faces()) {
+      for(const auto& vert : face) inds.push_back((u32)vert.v);
+    }
+  }
+}
+
+size_t ObjLoader::numMeshes() const
+{
+  return m_meshes.size();
+}
+
+MeshLoader& ObjLoader::doLoad(const void *data, size_t sz)
+{
+  parse((const char *)data, sz, nullptr);
+
   return *this;
 }
 
 MeshLoader& ObjLoader::initBuffers(const gx::VertexFormat& fmt, gx::BufferHandle verts)
 {
-  STUB();
+  // Every face vertex gets it's own vertex
+  verts().init(fmt.vertexByteSize(), m_current_offset);
 
   return *this;
 }
@@ -104,31 +250,45 @@ MeshLoader& ObjLoader::initBuffers(const gx::VertexFormat& fmt,
   return *this;
 }
 
-MeshLoader& ObjLoader::doStream(const gx::VertexFormat& fmt, gx::BufferHandle verts)
+MeshLoader& ObjLoader::doStream(const gx::VertexFormat& fmt, gx::BufferHandle vert_buf)
 {
-  STUB();
+  ensureNormalized();
 
-  return *this;
-}
+  initBuffers(fmt, vert_buf);
 
-MeshLoader& ObjLoader::doStreamIndexed(const gx::VertexFormat& fmt,
-  gx::BufferHandle vert_buf, gx::BufferHandle ind_buf)
-{
-  if(m_meshes.empty()) {
-    MeshLoader::load();
+  auto vertex_sz = fmt.vertexByteSize();
+
+  // Unpack the vertices once and then copy them
+  //   out for every face which uses them
+  std::vector<byte> unpacked(vertices().size() * vertex_sz);
+  unpackVertices(fmt, unpacked.data());
+
+  auto verts_view = vert_buf().map(gx::Buffer::Write, gx::Buffer::MapInvalidate);
+  auto dst = verts_view.get<byte>();
 
-    // Meshes must be normalized so they can be
-    //   streamed into the Vertex/IndexBuffers
-    if(!m_normalized) normalizeMeshes();
+  for(auto& mesh : m_meshes) {
+    for(const auto& face : mesh.faces()) {
+      for(const auto& vert : face) {
+        memcpy(dst, unpacked.data() + (size_t)vert.v*vertex_sz, vertex_sz);
+        dst += vertex_sz;
+      }
+    }
   }
 
-  initBuffers(fmt, vert_buf, ind_buf);
+  return *this;
+}
 
-  auto verts_view = vert_buf().map(gx::Buffer::Write, gx::Buffer::MapInvalidate);
-  auto inds_view = ind_buf().map(gx::Buffer::Write, gx::Buffer::MapInvalidate);
+void ObjLoader::ensureNormalized()
+{
+  if(m_meshes.empty()) MeshLoader::load();
 
-  auto verts = verts_view.get<byte>();
+  // Meshes must be normalized so they can be
+  //   streamed into the Vertex/IndexBuffers
+  if(!m_normalized) normalizeMeshes();
+}
 
+void ObjLoader::unpackVertices(const gx::VertexFormat& fmt, byte *verts) const
+{
   const vec3 *v_src  = vertices().data();
   const vec3 *vn_src = normals().data();
   const vec3 *vt_src = texCoords().data();
@@ -156,6 +316,19 @@ MeshLoader& ObjLoader::doStreamIndexed(const gx::VertexFormat& fmt,
       *vt_dst++ = vt.xy();
     }
   }
+}
+
+MeshLoader& ObjLoader::doStreamIndexed(const gx::VertexFormat& fmt,
+  gx::BufferHandle vert_buf, gx::BufferHandle ind_buf)
+{
+  ensureNormalized();
+
+  initBuffers(fmt, vert_buf, ind_buf);
+
+  auto verts_view = vert_buf().map(gx::Buffer::Write, gx::Buffer::MapInvalidate);
+  auto inds_view = ind_buf().map(gx::Buffer::Write, gx::Buffer::MapInvalidate);
+
+  unpackVertices(fmt, verts_view.get<byte>());
 
   union {
     void *inds;
@@ -183,6 +356,25 @@ MeshLoader& ObjLoader::doStreamIndexed(const gx::VertexFormat& fmt,
   return *this;
 }
 
+MeshLoader& ObjLoader::doStreamPooled(const gx::VertexFormat& fmt,
+  std::vector<byte>& verts, std::vector<u32>& inds)
+{
+  ensureNormalized();
+
+  verts.resize(vertices().size() * fmt.vertexByteSize());
+  unpackVertices(fmt, verts.data());
+
+  inds.clear();
+  inds.reserve(m_current_offset);
+  for(auto& mesh : m_meshes) {
+    for(const auto& face : mesh.faces()) {
+      for(const auto& vert : face) inds.push_back((u32)vert.v);
+    }
+  }
+
+  return *this;
+}
+
 const ObjMesh& ObjLoader::mesh(uint index) const
 {
   return m_meshes.at(index);
@@ -229,200 +421,379 @@ const std::vector<vec3>& ObjLoader::texCoords() const
   return m_vt;
 }
 
-ObjMesh *ObjLoader::appendMesh(const std::string& name)
-{
-  auto& mesh = m_meshes.emplace_back();
+// A run of faces following an 'o'/'g' command (or
+//   the start of the chunk) within a ParsedChunk
+struct ObjChunkMesh {
+  // 'false' only for the run at the start of the chunk,
+  //   whose faces belong to the previous chunk's last mesh
+  bool has_name = false;
+  std::string name;
 
-  mesh.m_name = name;
+  std::vector<ObjMesh::Triangle> tris;
+};
 
+struct ObjLoader::ParsedChunk {
+  std::vector<vec3> v, vt, vn;
 
-  mesh.m_tris.reserve(InitialVertices);
+  // meshes[0] is the run at the start of the chunk
+  std::vector<ObjChunkMesh> meshes = std::vector<ObjChunkMesh>(1);
 
-  return &mesh;
-}
+  bool normalized = true;
+};
 
-void ObjLoader::parseLine(std::string::const_iterator it)
+void ObjLoader::parse(const char *data, size_t sz, sched::WorkerPool *pool)
 {
-  char keyword = *it;
-  it++;
+  m_normalized = true;
 
-  // Take the current (i.e. most recently added) mesh
-  auto& mesh = m_meshes.back();
+  m_v.clear();
+  m_vt.clear();
+  m_vn.clear();
+  m_meshes.clear();
 
-  switch(keyword) {
-  case Vertex:
-    if(isspace(*it)) {  // This is a 'v' command
-      [[maybe_unused]] auto& aabb = mesh.m_aabb;
-      auto vert = loadVertex(it);
+  m_current_offset = 0;
 
-      m_v.push_back(vert);
-    } else {            // Either a 'vn' or 'vt'
-      char ch = *it;
-      it++;
+  appendMesh();  // Make sure back() doesn't get called when m_meshes is empty
 
-      switch(ch) {
-      case TexCoord: m_vt.push_back(loadTexCoord(it)); break;
-      case Normal:   m_vn.push_back(loadNormal(it)); break;
+  // Split the file into line-aligned chunks
+  std::vector<std::pair<const char *, const char *>> chunk_ranges;
 
-      default: throw ParseError();
-      }
+  auto end = data + sz;
+  auto chunk_size = pool ? (size_t)ParseChunkSize : sz;
+  for(auto begin = data; begin < end; ) {
+    auto chunk_end = (size_t)(end - begin) > chunk_size ? begin + chunk_size : end;
+
+    // Extend the chunk up to (and including) the next newline
+    chunk_end = std::find(chunk_end, end, '\n');
+    if(chunk_end != end) chunk_end++;
+
+    chunk_ranges.emplace_back(begin, chunk_end);
+    begin = chunk_end;
+  }
+
+  std::vector<ParsedChunk> chunks(chunk_ranges.size());
+
+  if(!pool || chunks.size() < 2) {
+    for(size_t i = 0; i < chunks.size(); i++) {
+      auto [begin, end] = chunk_ranges[i];
+      parseChunk(begin, end, chunks[i]);
     }
-    break;
-
-  case Face:
-    mesh.m_tris.push_back(loadTriangle(it));
-    break;
-
-  case Object:
-  case Group:    // TODO: handle groups differently (?)
-    if(mesh.m_tris.empty()) {
-      // A mesh is always created (in case the .obj
-      //   has no 'o' command), but when objects ARE
-      //   defined, calling appendMesh() here would
-      //   create an empty one at index 0, so use it
-      //   instead of creating a new one
-      mesh.m_name = loadName(it);
-    } else {
-      // When faces have already been appended
-      //   to the current mesh - append a new one
-      //  - Next time parseLine() is called it
-      //    will automatically choose it
-      auto new_mesh = appendMesh(loadName(it));
+  } else {
+    std::atomic<size_t> next_chunk = 0;
+
+    // The first exception thrown by any of the jobs
+    //   is rethrown after they all finish
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+
+    auto parse_job_fn = [&]() -> Unit {
+      size_t idx = 0;
+      while((idx = next_chunk.fetch_add(1)) < chunks.size()) {
+        auto [begin, end] = chunk_ranges[idx];
+
+        try {
+          parseChunk(begin, end, chunks[idx]);
+        } catch(...) {
+          if(!failed.exchange(true)) error = std::current_exception();
+        }
+      }
 
-      new_mesh->m_offset = m_current_offset;
+      return {};
+    };
+
+    using ParseJobData = std::pair<sched::WorkerPool::JobId, sched::IJob *>;
+
+    auto num_jobs = std::min<size_t>(chunks.size(), NumParseJobs);
+    std::array<ParseJobData, NumParseJobs> jobs;
+    for(size_t job_idx = 0; job_idx < num_jobs; job_idx++) {
+      sched::IJob *job = new sched::Job<Unit>(sched::create_job(parse_job_fn));
+
+      auto id = pool->scheduleJob(job);
+      jobs[job_idx] = std::make_pair(id, job);
     }
-    break;
 
-  case Shading: break;   //  Ignore
-  case Material: break;  // -- || --
-  case UseMtl: break;    // -- || -- 
+    for(size_t job_idx = 0; job_idx < num_jobs; job_idx++) {
+      const auto& job = jobs[job_idx];
 
-  case Comment: return;   // Nothing to do
+      pool->waitJob(job.first);
+      delete job.second;
+    }
+
+    if(error) std::rethrow_exception(error);
+  }
 
-  default: throw ParseError();
+  // Reserve space for all the attributes up front
+  size_t num_v = 0, num_vt = 0, num_vn = 0;
+  for(const auto& chunk : chunks) {
+    num_v  += chunk.v.size();
+    num_vt += chunk.vt.size();
+    num_vn += chunk.vn.size();
   }
+
+  m_v.reserve(num_v);
+  m_vt.reserve(num_vt);
+  m_vn.reserve(num_vn);
+
+  for(auto& chunk : chunks) mergeChunk(chunk);
+
+  computeAABBs();
 }
 
-std::string ObjLoader::loadName(std::string::const_iterator it)
+// Returns 'true' for whitespace other than '\n'
+static bool is_blank(char ch)
 {
-  std::string name;
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+}
 
-  while(isspace(*it)) {  // Skip whitespace
-    if(*it == '\n') throw ParseError();  // A name wasn't specified
+static const char *skip_blanks(const char *p, const char *end)
+{
+  while(p != end && is_blank(*p)) p++;
 
-    it++;
-  }
+  return p;
+}
 
-  // Read the name (this ignores potential
-  //   extreneous characters at the end of
-  //   the line - oh well)
-  while(!isspace(*it)) name.push_back(*it++);
+static const char *skip_line(const char *p, const char *end)
+{
+  p = std::find(p, end, '\n');
 
-  return name;
+  return p != end ? p+1 : p;
 }
 
-vec3 ObjLoader::loadVec3(std::string::const_iterator it)
+// Parses up to 3 whitespace separated floats from the
+//   rest of the line, the missing ones are set to 0.0f
+static vec3 parse_vec3(const char *& p, const char *end)
 {
-  const char *str = &(*it);
+  vec3 v(0.0f);
+
+  for(uint i = 0; i < 3; i++) {
+    p = skip_blanks(p, end);
+    if(p == end || *p == '\n') break;
+
+    if(*p == '+') p++;   // std::from_chars() doesn't accept a leading '+'
+
+    auto [ptr, ec] = std::from_chars(p, end, v[i]);
+    if(ec != std::errc()) throw MeshLoader::ParseError();
 
-  alignas(16) vec3 v;
-  sscanf(str, "%f%f%f", &v.x, &v.y, &v.z);
+    p = ptr;
+  }
 
   return v;
 }
 
-vec3 ObjLoader::loadVertex(std::string::const_iterator it)
+// Parses a single 1-based index and converts
+//   it to a 0-based one
+static uint parse_index(const char *& p, const char *end)
 {
-  return loadVec3(it);
-}
+  uint idx = 0;
 
-vec3 ObjLoader::loadTexCoord(std::string::const_iterator it)
-{
-  return loadVec3(it);
+  auto [ptr, ec] = std::from_chars(p, end, idx);
+  if(ec != std::errc() || !idx) throw MeshLoader::ParseError();
+
+  p = ptr;
+
+  return idx - 1;
 }
 
-vec3 ObjLoader::loadNormal(std::string::const_iterator it)
+// Parses an 'f' command's vertices, which can be in
+//   any of the following forms:
+//       v   v/vt   v//vn   v/vt/vn
+static ObjMesh::Triangle parse_triangle(const char *& p, const char *end)
 {
-  return loadVec3(it);
+  ObjMesh::Triangle triangle;
+
+  auto it = triangle.begin();
+  while(true) {
+    p = skip_blanks(p, end);
+    if(p == end || *p == '\n') break;
+
+    // Too many vertices
+    if(it == triangle.end()) throw MeshLoader::NonTriangularFaceError();
+
+    it->v = parse_index(p, end);
+
+    if(p != end && *p == '/') {
+      p++;
+      if(p != end && *p != '/') it->vt = parse_index(p, end);
+
+      if(p != end && *p == '/') {
+        p++;
+        it->vn = parse_index(p, end);
+      }
+    }
+
+    if(p != end && !is_blank(*p) && *p != '\n') throw MeshLoader::ParseError();
+
+    it++;
+  }
+
+  // Not enough vertices
+  if(it != triangle.end()) throw MeshLoader::NonTriangularFaceError();
+
+  return triangle;
 }
 
-ObjMesh::Triangle ObjLoader::loadTriangle(std::string::const_iterator str_it)
+// Implements the 'o' and 'g' commands
+static std::string parse_name(const char *& p, const char *end)
 {
-  const char *str = &(*str_it);
+  p = skip_blanks(p, end);
 
-  auto& mesh = m_meshes.back();
+  // Read the name (this ignores potential
+  //   extreneous characters at the end of
+  //   the line - oh well)
+  auto name_end = p;
+  while(name_end != end && !is_blank(*name_end) && *name_end != '\n') name_end++;
 
-  ObjMesh::Triangle triangle;
+  auto name = std::string(p, name_end);
+  p = name_end;
 
-  const char *pos = str;
-  auto it = triangle.begin();
-  while(*pos) {
-    char *end = nullptr;
-    auto read_index = [&]() -> uint {
-      return std::strtoul(pos, &end, 0);
-    };
+  return name;
+}
 
-    while(isspace(*pos)) pos++;
-    if(*pos == '\0') break;
+void ObjLoader::parseChunk(const char *begin, const char *end, ParsedChunk& chunk)
+{
+  auto p = begin;
+  while(p != end) {
+    p = skip_blanks(p, end);
+    if(p == end) break;
+
+    // Line is empty or a comment - skip it
+    if(*p == '\n' || *p == Comment) {
+      p = skip_line(p, end);
+      continue;
+    }
 
-    // Too many vertices
-    if(it == triangle.end()) throw NonTriangularFaceError();
+    char keyword = *p++;
+    switch(keyword) {
+    case Vertex:
+      if(p != end && is_blank(*p)) {  // This is a 'v' command
+        chunk.v.push_back(parse_vec3(p, end));
+      } else if(p != end) {           // Either a 'vn' or 'vt'
+        char ch = *p++;
 
-    it->v = read_index();
+        switch(ch) {
+        case TexCoord: chunk.vt.push_back(parse_vec3(p, end)); break;
+        case Normal:   chunk.vn.push_back(parse_vec3(p, end)); break;
 
-    if(*end == '/') {
-      pos = end+1;
-      if(*pos != '/') {
-        it->vt = read_index();
+        default: throw ParseError();
+        }
       } else {
-        end = (char *)pos;
+        throw ParseError();
+      }
+      break;
+
+    case Face: {
+      auto triangle = parse_triangle(p, end);
+
+      // Any un-normalized vertex causes all the meshes
+      //   to have to be normalized
+      for(const auto& v : triangle) {
+        if(v.needsNormalization()) chunk.normalized = false;
       }
+
+      chunk.meshes.back().tris.push_back(triangle);
+      break;
     }
 
-    if(*end == '/') {
-      pos = end+1;
-      it->vn = read_index();
+    case Object:
+    case Group: {   // TODO: handle groups differently (?)
+      auto& mesh = chunk.meshes.emplace_back();
+
+      mesh.has_name = true;
+      mesh.name = parse_name(p, end);
+      break;
     }
 
-    // Done appending this vertex
-    m_current_offset++;
+    case Shading: break;   //  Ignore
+    case Material: break;  // -- || --
+    case UseMtl: break;    // -- || --
 
-    pos = end+1;
-    it++;
+    default: throw ParseError();
+    }
+
+    p = skip_line(p, end);
   }
+}
 
-  // Not enough vertices
-  if(it != triangle.end()) throw NonTriangularFaceError();
-
-  // .obj indices are 1-based, but in C++ 0-based ones
-  //   are preffered so convert them
-  for(auto& v : triangle) {
-    if(v.v  != ObjMesh::None) v.v--;
-    if(v.vt != ObjMesh::None) v.vt--;
-    if(v.vn != ObjMesh::None) v.vn--;
-
-    // Any un-normalized vertex causes all the meshes
-    //   to have to be normalized
-    if(v.needsNormalization()) m_normalized = false;
-
-    // Recompute the AABB (for the current ObjMesh)
-    auto vert = m_v[v.v];
-    mesh.m_aabb = {
-      vec3::min(mesh.m_aabb.min, vert), vec3::max(mesh.m_aabb.max, vert)
-    };
+void ObjLoader::mergeChunk(ParsedChunk& chunk)
+{
+  m_v.insert(m_v.end(), chunk.v.begin(), chunk.v.end());
+  m_vt.insert(m_vt.end(), chunk.vt.begin(), chunk.vt.end());
+  m_vn.insert(m_vn.end(), chunk.vn.begin(), chunk.vn.end());
+
+  if(!chunk.normalized) m_normalized = false;
+
+  for(auto& chunk_mesh : chunk.meshes) {
+    // Take the current (i.e. most recently added) mesh
+    auto mesh = &m_meshes.back();
+
+    if(chunk_mesh.has_name) {
+      if(mesh->m_tris.empty()) {
+        // A mesh is always created (in case the .obj
+        //   has no 'o' command), but when objects ARE
+        //   defined, calling appendMesh() here would
+        //   create an empty one at index 0, so use it
+        //   instead of creating a new one
+        mesh->m_name = std::move(chunk_mesh.name);
+      } else {
+        // When faces have already been appended
+        //   to the current mesh - append a new one
+        mesh = appendMesh(chunk_mesh.name);
+      }
+    }
+
+    auto& tris = chunk_mesh.tris;
+    m_current_offset += tris.size() * 3;
+
+    if(mesh->m_tris.empty()) {
+      mesh->m_tris = std::move(tris);
+    } else {
+      mesh->m_tris.insert(mesh->m_tris.end(), tris.begin(), tris.end());
+    }
   }
+}
 
-  return triangle;
+ObjMesh *ObjLoader::appendMesh(const std::string& name)
+{
+  auto& mesh = m_meshes.emplace_back();
+
+  mesh.m_name = name;
+  mesh.m_offset = m_current_offset;
+
+  return &mesh;
+}
+
+void ObjLoader::computeAABBs()
+{
+  for(auto& mesh : m_meshes) {
+    auto aabb = mesh.m_aabb;
+
+    for(const auto& face : mesh.m_tris) {
+      for(const auto& v : face) {
+        // Make sure all the referenced attributes exist
+        if(v.v >= m_v.size()) throw ParseError();
+        if(v.vt != ObjMesh::None && v.vt >= m_vt.size()) throw ParseError();
+        if(v.vn != ObjMesh::None && v.vn >= m_vn.size()) throw ParseError();
+
+        auto vert = m_v[v.v];
+        aabb = { vec3::min(aabb.min, vert), vec3::max(aabb.max, vert) };
+      }
+    }
+
+    mesh.m_aabb = aabb;
+  }
 }
 
 void ObjLoader::normalizeMeshes()
 {
   if(!hasNormals() && !hasTexCoords()) return;  // Nothing to do
 
-  for(auto& mesh : m_meshes) normalizeOne(mesh);
+  // Shared by all the meshes, as they share the attributes
+  VertexMap remap;
+  for(auto& mesh : m_meshes) normalizeOne(mesh, remap);
+
+  m_normalized = true;
 }
 
-void ObjLoader::normalizeOne(ObjMesh& mesh)
+void ObjLoader::normalizeOne(ObjMesh& mesh, VertexMap& remap)
 {
   auto num_verts = std::max({ m_v.size(), m_vn.size(), m_vt.size() });
 
@@ -436,39 +807,49 @@ void ObjLoader::normalizeOne(ObjMesh& mesh)
   if(has_normals)   m_vn.resize(num_verts);
   if(has_texcoords) m_vt.resize(num_verts);
 
-  // When an unnormalized Vertex is found,
-  //   a new v,vn,vt is appended to the attribute
-  //   vectors and the Vertex' indices are updated
+  // When an unnormalized Vertex is found for the
+  //   first time a new v,vn,vt is appended to the
+  //   attribute vectors, after which all the Vertices
+  //   with the same v,vt,vn indices are pointed at it
   for(auto& face : mesh.m_tris) {
     for(auto& vert : face) {
       if(!vert.needsNormalization()) continue;
 
-      if(has_normals) {
-        auto new_index = (uint)m_vn.size();
-        auto vn = m_vn[vert.vn];
-
-        vert.vn = new_index;
-        m_vn.emplace_back(vn);
-      }
+      auto new_index = (uint)m_v.size();
+      auto [it, inserted] = remap.emplace(vert, new_index);
 
-      if(has_texcoords) {
-        auto new_index = (uint)m_vt.size();
-        auto vt = m_vt[vert.vt];
+      if(inserted) {
+        if(has_normals)   m_vn.push_back(vert.vn != ObjMesh::None ? m_vn[vert.vn] : vec3(0.0f));
+        if(has_texcoords) m_vt.push_back(vert.vt != ObjMesh::None ? m_vt[vert.vt] : vec3(0.0f));
 
-        vert.vt = new_index;
-        m_vt.emplace_back(vt);
+        // Positions are always present
+        m_v.push_back(m_v[vert.v]);
       }
 
-      // Positions are always present
-      auto new_index = (uint)m_v.size();
-      auto v  = m_v[vert.v];
+      auto index = it->second;
 
-      vert.v  = new_index;
-      m_v.emplace_back(v);
+      vert.v = index;
+      if(has_normals)   vert.vn = index;
+      if(has_texcoords) vert.vt = index;
     }
   }
 }
 
+size_t ObjLoader::VertexHash::operator()(const ObjMesh::Vertex& v) const
+{
+  size_t seed = 0;
+  util::hash_combine<std::hash<uint>>(seed, v.v);
+  util::hash_combine<std::hash<uint>>(seed, v.vt);
+  util::hash_combine<std::hash<uint>>(seed, v.vn);
+
+  return seed;
+}
+
+bool ObjLoader::VertexEqual::operator()(const ObjMesh::Vertex& a, const ObjMesh::Vertex& b) const
+{
+  return a.v == b.v && a.vt == b.vt && a.vn == b.vn;
+}
+
 const std::string& ObjMesh::name() const
 {
   return m_name;
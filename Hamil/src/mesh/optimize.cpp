@@ -0,0 +1,542 @@
+#include <mesh/optimize.h>
+
+#include <cassert>
+#include <cmath>
+
+#include <algorithm>
+
+namespace mesh {
+
+enum : u32 {
+  None = ~0u,
+};
+
+// The indices passed to the functions below often refer to a small,
+//   contiguous range of a much larger (shared) vertex array so all
+//   of the per-vertex state is allocated only for that range
+struct VertexRange {
+  u32 base;
+  size_t span;
+};
+
+static VertexRange vertex_range(const u32 *inds, size_t num_inds, size_t num_verts)
+{
+  if(!num_inds) return { 0, 0 };
+
+  auto [min, max] = std::minmax_element(inds, inds+num_inds);
+  assert(*max < num_verts && "Index out of range!");
+
+  return { *min, (size_t)(*max - *min) + 1 };
+}
+
+// Lists of the triangles which use each vertex,
+//   stored as a compressed sparse row matrix
+struct Adjacency {
+  std::vector<u32> offsets;   // Into 'tris', has (VertexRange::span + 1) entries
+  std::vector<u32> tris;
+  std::vector<u32> valence;   // Number of triangles which use each vertex
+};
+
+static Adjacency build_adjacency(const u32 *inds, size_t num_inds, VertexRange r)
+{
+  Adjacency adj;
+  adj.offsets.resize(r.span+1, 0);
+  adj.tris.resize(num_inds);
+  adj.valence.resize(r.span, 0);
+
+  for(size_t i = 0; i < num_inds; i++) adj.valence[inds[i] - r.base]++;
+
+  u32 offset = 0;
+  for(size_t v = 0; v < r.span; v++) {
+    adj.offsets[v] = offset;
+    offset += adj.valence[v];
+  }
+  adj.offsets[r.span] = offset;
+
+  // Use 'valence' as the write cursors and then
+  //   restore it once all the triangles are in
+  for(size_t v = 0; v < r.span; v++) adj.valence[v] = 0;
+
+  for(size_t i = 0; i < num_inds; i++) {
+    auto v = inds[i] - r.base;
+
+    adj.tris[adj.offsets[v] + adj.valence[v]++] = (u32)(i / 3);
+  }
+
+  return adj;
+}
+
+// FIFO cache where each vertex stores the time of it's insertion,
+//   which makes checking for and inserting vertices O(1)
+class FifoCache {
+public:
+  FifoCache(size_t span, uint cache_size) :
+    m_timestamps(span, 0), m_cache_size(cache_size),
+    m_time(cache_size+1)
+  { }
+
+  // Returns 'true' on a cache miss
+  bool access(u32 v)
+  {
+    if(m_time - m_timestamps[v] <= m_cache_size) return false;
+
+    m_timestamps[v] = m_time++;
+
+    return true;
+  }
+
+  void flush()
+  {
+    m_time += m_cache_size+1;
+  }
+
+private:
+  std::vector<u32> m_timestamps;
+  u32 m_cache_size;
+
+  u32 m_time;
+};
+
+VertexCacheStats vertex_cache_stats(const u32 *inds, size_t num_inds, size_t num_verts, uint cache_size)
+{
+  assert(num_inds % 3 == 0 && "Only triangle lists are supported!");
+
+  VertexCacheStats stats;
+  if(!num_inds) return stats;
+
+  auto r = vertex_range(inds, num_inds, num_verts);
+
+  FifoCache cache(r.span, cache_size);
+  std::vector<bool> referenced(r.span, false);
+
+  size_t misses = 0, num_referenced = 0;
+  for(size_t i = 0; i < num_inds; i++) {
+    auto v = inds[i] - r.base;
+
+    if(cache.access(v)) misses++;
+
+    if(!referenced[v]) {
+      referenced[v] = true;
+      num_referenced++;
+    }
+  }
+
+  stats.acmr = (float)misses / (float)(num_inds / 3);
+  stats.atvr = (float)misses / (float)num_referenced;
+
+  return stats;
+}
+
+// Constants from Tom Forsyth's original article
+namespace forsyth {
+
+enum : int {
+  MaxCacheSize = 32,
+
+  // Valence scores are tabulated up to this value
+  MaxTabulatedValence = 32,
+};
+
+static constexpr float CacheDecayPower   = 1.5f;
+static constexpr float LastTriScore      = 0.75f;
+static constexpr float ValenceBoostScale = 2.0f;
+static constexpr float ValenceBoostPower = 0.5f;
+
+struct ScoreTables {
+  float cache[MaxCacheSize];
+  float valence[MaxTabulatedValence];
+
+  ScoreTables()
+  {
+    for(int i = 0; i < MaxCacheSize; i++) {
+      if(i < 3) {
+        // The vertices used by the last triangle are scored
+        //   lower to avoid producing strips
+        cache[i] = LastTriScore;
+      } else {
+        const float scaler = 1.0f / (float)(MaxCacheSize - 3);
+        cache[i] = powf(1.0f - (float)(i - 3)*scaler, CacheDecayPower);
+      }
+    }
+
+    valence[0] = 0.0f;
+    for(int i = 1; i < MaxTabulatedValence; i++) {
+      valence[i] = ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+    }
+  }
+
+  float score(int cache_pos, u32 num_tris) const
+  {
+    // Vertices which aren't used by any triangles
+    //   have no influence on the scores
+    if(!num_tris) return -1.0f;
+
+    float s = cache_pos >= 0 ? cache[cache_pos] : 0.0f;
+    s += num_tris < MaxTabulatedValence ? valence[num_tris] :
+      ValenceBoostScale * powf((float)num_tris, -ValenceBoostPower);
+
+    return s;
+  }
+};
+
+static const ScoreTables p_tables;
+
+}
+
+void optimize_vertex_cache(u32 *inds, size_t num_inds, size_t num_verts)
+{
+  using namespace forsyth;
+
+  assert(num_inds % 3 == 0 && "Only triangle lists are supported!");
+
+  size_t num_tris = num_inds / 3;
+  if(num_tris < 2) return;
+
+  auto r = vertex_range(inds, num_inds, num_verts);
+  auto adj = build_adjacency(inds, num_inds, r);
+
+  // Triangles which haven't been emitted yet are kept at the front of
+  //   each vertex's list in 'adj.tris' and 'live' holds their count
+  auto& live = adj.valence;
+
+  std::vector<float> vertex_score(r.span);
+  std::vector<int> cache_pos(r.span, -1);
+  for(size_t v = 0; v < r.span; v++) vertex_score[v] = p_tables.score(-1, live[v]);
+
+  std::vector<float> tri_score(num_tris);
+  std::vector<bool> emitted(num_tris, false);
+  for(size_t t = 0; t < num_tris; t++) {
+    tri_score[t] = vertex_score[inds[t*3 + 0] - r.base]
+      + vertex_score[inds[t*3 + 1] - r.base]
+      + vertex_score[inds[t*3 + 2] - r.base];
+  }
+
+  // The cache has 3 extra entries to make room for the vertices
+  //   of the emitted triangle before the old ones are evicted
+  u32 cache[MaxCacheSize+3], new_cache[MaxCacheSize+3];
+  size_t cache_count = 0;
+
+  std::vector<u32> out(num_inds);
+
+  u32 best_tri = (u32)(std::max_element(tri_score.begin(), tri_score.end()) - tri_score.begin());
+  size_t cursor = 0;   // Fallback for when none of the cached vertices has any triangles left
+
+  for(size_t i = 0; i < num_tris; i++) {
+    if(best_tri == None) {
+      while(emitted[cursor]) cursor++;
+
+      best_tri = (u32)cursor;
+    }
+
+    auto t = best_tri;
+    const u32 *tri = inds + t*3;
+
+    out[i*3 + 0] = tri[0];
+    out[i*3 + 1] = tri[1];
+    out[i*3 + 2] = tri[2];
+    emitted[t] = true;
+
+    size_t new_count = 0;
+    for(int k = 0; k < 3; k++) {
+      auto v = tri[k] - r.base;
+
+      // Move 't' past the end of the vertex's live triangles
+      auto begin = adj.tris.begin() + adj.offsets[v];
+      auto it = std::find(begin, begin + live[v], t);
+      assert(it != begin + live[v]);
+
+      std::swap(*it, *(begin + live[v] - 1));
+      live[v]--;
+
+      new_cache[new_count++] = v;
+    }
+
+    for(size_t j = 0; j < cache_count; j++) {
+      auto v = cache[j];
+      if(v == tri[0] - r.base || v == tri[1] - r.base || v == tri[2] - r.base) continue;
+
+      new_cache[new_count++] = v;
+    }
+
+    // Re-score the vertices whose position in the cache (or
+    //   number of triangles) has changed along with their
+    //   triangles and find the best one for the next iteration
+    best_tri = None;
+    float best_score = -1.0f;
+    for(size_t j = 0; j < new_count; j++) {
+      auto v = new_cache[j];
+
+      int pos = j < MaxCacheSize ? (int)j : -1;
+      cache_pos[v] = pos;
+
+      auto score = p_tables.score(pos, live[v]);
+      auto delta = score - vertex_score[v];
+      vertex_score[v] = score;
+
+      auto begin = adj.tris.data() + adj.offsets[v];
+      for(u32 k = 0; k < live[v]; k++) {
+        auto vt = begin[k];
+
+        tri_score[vt] += delta;
+        if(pos >= 0 && tri_score[vt] > best_score) {
+          best_score = tri_score[vt];
+          best_tri = vt;
+        }
+      }
+    }
+
+    cache_count = std::min(new_count, (size_t)MaxCacheSize);
+    std::copy(new_cache, new_cache + cache_count, cache);
+  }
+
+  std::copy(out.begin(), out.end(), inds);
+}
+
+void tipsify(u32 *inds, size_t num_inds, size_t num_verts,
+  uint cache_size, std::vector<u32> *clusters)
+{
+  assert(num_inds % 3 == 0 && "Only triangle lists are supported!");
+
+  if(clusters) clusters->clear();
+  if(!num_inds) return;
+
+  auto r = vertex_range(inds, num_inds, num_verts);
+  auto adj = build_adjacency(inds, num_inds, r);
+
+  auto& live = adj.valence;
+  std::vector<u32> timestamps(r.span, 0);
+  std::vector<bool> emitted(num_inds / 3, false);
+
+  std::vector<u32> dead_end;
+  std::vector<u32> candidates;
+
+  std::vector<u32> out(num_inds);
+  size_t num_out = 0;
+
+  u32 time = cache_size+1;
+  size_t cursor = 0;
+
+  auto begin_cluster = [&]() {
+    if(!clusters) return;
+
+    auto first_tri = (u32)(num_out / 3);
+    if(clusters->empty() || clusters->back() != first_tri) clusters->push_back(first_tri);
+  };
+
+  // Picks the vertex around which triangles will be fanned next
+  auto next_vertex = [&]() -> u32 {
+    u32 best = None;
+    int best_priority = -1;
+
+    for(auto v : candidates) {
+      if(!live[v]) continue;
+
+      // Prefer vertices which will still be in
+      //   the cache after all of their triangles
+      //   have been emitted
+      int priority = 0;
+      if(time - timestamps[v] + 2*live[v] <= cache_size) priority = (int)(time - timestamps[v]);
+
+      if(priority > best_priority) {
+        best_priority = priority;
+        best = v;
+      }
+    }
+    if(best != None) return best;
+
+    // All of the candidates are dead-ends - the cache
+    //   contents can't be relied upon from now on
+    begin_cluster();
+
+    while(!dead_end.empty()) {
+      auto v = dead_end.back();
+      dead_end.pop_back();
+
+      if(live[v]) return v;
+    }
+
+    for(; cursor < r.span; cursor++) {
+      if(live[cursor]) return (u32)cursor;
+    }
+
+    return None;
+  };
+
+  begin_cluster();
+
+  u32 fan = inds[0] - r.base;
+  while(fan != None) {
+    candidates.clear();
+
+    auto tris = adj.tris.data() + adj.offsets[fan];
+    auto num_tris = adj.offsets[fan+1] - adj.offsets[fan];
+    for(u32 i = 0; i < num_tris; i++) {
+      auto t = tris[i];
+      if(emitted[t]) continue;
+
+      for(int k = 0; k < 3; k++) {
+        auto v = inds[t*3 + k] - r.base;
+
+        out[num_out++] = v + r.base;
+
+        dead_end.push_back(v);
+        candidates.push_back(v);
+
+        live[v]--;
+
+        if(time - timestamps[v] > cache_size) timestamps[v] = time++;
+      }
+
+      emitted[t] = true;
+    }
+
+    fan = next_vertex();
+  }
+
+  assert(num_out == num_inds);
+
+  std::copy(out.begin(), out.end(), inds);
+}
+
+void optimize_overdraw(u32 *inds, size_t num_inds, StridePtr<vec3> positions, size_t num_verts,
+  const std::vector<u32>& clusters, float threshold, uint cache_size)
+{
+  assert(num_inds % 3 == 0 && "Only triangle lists are supported!");
+
+  size_t num_tris = num_inds / 3;
+  if(clusters.size() < 1 || num_tris < 2) return;
+
+  auto r = vertex_range(inds, num_inds, num_verts);
+
+  auto target_acmr = vertex_cache_stats(inds, num_inds, num_verts, cache_size).acmr * threshold;
+
+  // Split the clusters further at points where the cache has
+  //   already been 'warmed up' enough, so the vertex cache
+  //   efficiency doesn't suffer when they're reordered
+  std::vector<u32> split;
+  FifoCache cache(r.span, cache_size);
+  for(size_t i = 0; i < clusters.size(); i++) {
+    u32 begin = clusters[i];
+    u32 end = i+1 < clusters.size() ? clusters[i+1] : (u32)num_tris;
+
+    split.push_back(begin);
+    cache.flush();
+
+    u32 start = begin;
+    size_t misses = 0;
+    for(u32 t = begin; t < end; t++) {
+      for(int k = 0; k < 3; k++) {
+        if(cache.access(inds[t*3 + k] - r.base)) misses++;
+      }
+
+      if(t+1 < end && (float)misses / (float)(t+1 - start) <= target_acmr) {
+        split.push_back(t+1);
+        cache.flush();
+
+        start = t+1;
+        misses = 0;
+      }
+    }
+
+    // The cache never warmed up enough over the cluster's tail, so
+    //   it'd start cold wherever it ended up - keep it attached to
+    //   the preceding piece instead
+    if(start > begin && (float)misses / (float)(end - start) > target_acmr) split.pop_back();
+  }
+
+  auto position = [&](u32 v) {
+    auto p = positions;
+    p += v;
+
+    return *p;
+  };
+
+  struct Cluster {
+    u32 begin, end;
+
+    float sort_key;
+  };
+
+  std::vector<Cluster> sorted;
+  sorted.reserve(split.size());
+
+  // Area-weighted centroids and normals of the clusters
+  std::vector<vec3> centroids, normals;
+  centroids.reserve(split.size());
+  normals.reserve(split.size());
+
+  vec3 mesh_centroid = vec3::zero();
+  float mesh_area = 0.0f;
+
+  for(size_t i = 0; i < split.size(); i++) {
+    u32 begin = split[i];
+    u32 end = i+1 < split.size() ? split[i+1] : (u32)num_tris;
+
+    vec3 centroid = vec3::zero(), normal = vec3::zero();
+    float area = 0.0f;
+    for(u32 t = begin; t < end; t++) {
+      auto a = position(inds[t*3 + 0]),
+        b = position(inds[t*3 + 1]),
+        c = position(inds[t*3 + 2]);
+
+      auto n = (b - a).cross(c - a);
+      auto tri_area = n.length();
+
+      centroid += (a + b + c) * (tri_area / 3.0f);
+      normal += n;
+      area += tri_area;
+    }
+
+    mesh_centroid += centroid;
+    mesh_area += area;
+
+    centroids.push_back(area > 0.0f ? centroid * (1.0f / area) : centroid);
+    normals.push_back(normal);
+
+    sorted.push_back({ begin, end, 0.0f });
+  }
+
+  if(mesh_area > 0.0f) mesh_centroid *= 1.0f / mesh_area;
+
+  for(size_t i = 0; i < sorted.size(); i++) {
+    auto n = normals[i];
+    auto len = n.length();
+
+    sorted[i].sort_key = len > 0.0f ? (centroids[i] - mesh_centroid).dot(n * (1.0f / len)) : 0.0f;
+  }
+
+  std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+    return a.sort_key > b.sort_key;
+  });
+
+  std::vector<u32> out;
+  out.reserve(num_inds);
+  for(const auto& cluster : sorted) {
+    out.insert(out.end(), inds + cluster.begin*3, inds + cluster.end*3);
+  }
+
+  std::copy(out.begin(), out.end(), inds);
+}
+
+std::vector<u32> optimize_vertex_fetch(u32 *inds, size_t num_inds, size_t num_verts)
+{
+  std::vector<u32> remap(num_verts, None);
+
+  u32 next = 0;
+  for(size_t i = 0; i < num_inds; i++) {
+    auto& v = inds[i];
+    assert(v < num_verts && "Index out of range!");
+
+    if(remap[v] == None) remap[v] = next++;
+
+    v = remap[v];
+  }
+
+  for(auto& v : remap) {
+    if(v == None) v = next++;
+  }
+
+  return remap;
+}
+
+}
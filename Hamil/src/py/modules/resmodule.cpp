@@ -54,9 +54,12 @@ static PyObject *Res_Load(PyObject *self, PyObject *args)
     auto err = util::fmt("failed to load resource with guid=0x%.16llx", guid);
 
     PyErr_SetString(PyExc_ValueError, err.data());
+    return nullptr;
   }
 
-  return nullptr; // unreachable with no exception set
+  // Precache loads are finished in the background (see
+  //   ResourceManager::load()), so there's nothing to describe yet
+  Py_RETURN_NONE;
 }
 
 struct ResModuleToken;
@@ -2,23 +2,101 @@
 
 namespace res {
 
-ResourceCache::ResourceCache(Type type) :
-  m_type(type)
+ResourceCache::ResourceCache(Type type, size_t budget) :
+  m_type(type), m_budget(budget)
 {
 }
 
 std::optional<ResourceCache::ResourcePtr> ResourceCache::probe(Resource::Id id)
 {
   auto it = m.find(id);
-  return it != m.end() ? std::optional<ResourcePtr>(it->second) : std::nullopt;
+  if(it == m.end()) {
+    m_stats.misses++;
+    return std::nullopt;
+  }
+
+  m_stats.hits++;
+
+  // Move the entry to the front of the LRU list
+  auto entry = it->second;
+  m_lru.splice(m_lru.begin(), m_lru, entry);
+
+  return ResourcePtr(entry->r);
 }
 
 ResourceCache::ResourcePtr ResourceCache::fill(const Resource::Ptr& r)
 {
-  auto result = m.emplace(r->id(), r);
-  if(result.second) return ResourcePtr(result.first->second);
+  if(m.find(r->id()) != m.end()) return ResourcePtr();
+
+  auto sz = r->residentSize();
+  m_lru.push_front(Entry { r, sz });
+  m.emplace(r->id(), m_lru.begin());
+
+  m_stats.num_resources++;
+  m_stats.resident_bytes += sz;
+
+  if(m_stats.resident_bytes > m_budget) evict(r.get());
+
+  return ResourcePtr(r);
+}
+
+ResourceCache& ResourceCache::budget(size_t budget)
+{
+  m_budget = budget;
+  trim();
+
+  return *this;
+}
 
-  return ResourcePtr();
+size_t ResourceCache::budget() const
+{
+  return m_budget;
 }
 
-}
\ No newline at end of file
+size_t ResourceCache::trim()
+{
+  size_t resident_bytes = 0;
+  for(auto& entry : m_lru) {
+    entry.size = entry.r->residentSize();
+    resident_bytes += entry.size;
+  }
+  m_stats.resident_bytes = resident_bytes;
+
+  return evict(nullptr);
+}
+
+const ResourceCache::Stats& ResourceCache::stats() const
+{
+  return m_stats;
+}
+
+size_t ResourceCache::evict(const Resource *keep)
+{
+  if(m_type == Static) return 0;
+
+  size_t num_evicted = 0;
+
+  // Walk the LRU list starting from the least recently used entry
+  auto it = m_lru.end();
+  while(m_stats.resident_bytes > m_budget && it != m_lru.begin()) {
+    --it;
+
+    const auto& r = it->r;
+    // Resources which are in use (i.e. someone holds a
+    //   Resource::Ptr to them) can't be evicted
+    if(r.get() == keep || r.use_count() > 1) continue;
+
+    m_stats.resident_bytes -= it->size;
+    m_stats.num_resources--;
+    m_stats.evictions++;
+
+    m.erase(r->id());
+    it = m_lru.erase(it);
+
+    num_evicted++;
+  }
+
+  return num_evicted;
+}
+
+}
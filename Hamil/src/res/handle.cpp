@@ -4,13 +4,24 @@
 namespace res {
 
 HandleBase::HandleBase(Resource::Id id) :
-  m(resources().handle(id))
+  m_id(id)
 {
+  try {
+    m = resources().handle(id);
+  } catch(const ResourceManager::NoSuchResourceError&) {
+    // The resource could've been evicted from the cache since it was loaded
+    m = resources().load(id);
+  }
 }
 
-Resource::Ptr& HandleBase::lock()
+Resource::Ptr HandleBase::lock()
 {
-  return m_locked ? m_locked : m_locked = m.lock();
+  if(auto r = m.lock()) return r;
+
+  // The resource was evicted from the cache - re-load it
+  m = resources().load(m_id);
+
+  return m.lock();
 }
 
 }
\ No newline at end of file
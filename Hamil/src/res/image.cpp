@@ -1,7 +1,13 @@
 #include <res/image.h>
 
+#include <os/rwlock.h>
+
 #include <stb_image/stb_image.h>
 
+#include <cstring>
+
+#include <vector>
+
 namespace res {
 
 Resource::Ptr Image::from_memory(void *buf, size_t sz, unsigned channels, unsigned flags,
@@ -24,15 +30,62 @@ Resource::Ptr Image::from_file(void *buf, size_t sz, unsigned channels, unsigned
   return Resource::Ptr(image);
 }
 
+// stb_image's load options are process-wide, while Images are decoded
+//   by the ResourceManager's streaming workers and the main thread
+//   at the same time, so:
+//     - Flipping is done after decoding, the global flag
+//       always stays cleared
+//     - Decodes which need the unpremultiply flag set hold
+//       the lock exclusively, all others share it
+static os::ReaderWriterLock& p_stbi_options_lock()
+{
+  static auto lock = os::ReaderWriterLock::alloc();
+
+  return *lock;
+}
+
+static void flip_vertical(byte *data, int width, int height, int channels)
+{
+  size_t row_sz = (size_t)width * channels;
+  std::vector<byte> tmp(row_sz);
+
+  for(int y = 0; y < height/2; y++) {
+    auto top = data + y*row_sz;
+    auto bottom = data + (height-1 - y)*row_sz;
+
+    memcpy(tmp.data(), top, row_sz);
+    memcpy(top, bottom, row_sz);
+    memcpy(bottom, tmp.data(), row_sz);
+  }
+}
+
 void Image::load(void *buf, size_t sz, unsigned channels, unsigned flags)
 {
   if(!buf) return;    // TODO: async loading
 
-  stbi_set_flip_vertically_on_load(flags & FlipVertical ? true : false);
-  stbi_set_unpremultiply_on_load(flags & Unpremultiply ? true : false);
+  auto& lock = p_stbi_options_lock();
+
+  if(flags & Unpremultiply) {
+    lock.acquireExclusive();
+    stbi_set_unpremultiply_on_load(true);
+  } else {
+    lock.acquireShared();
+  }
 
   m_data = stbi_load_from_memory((byte *)buf, (int)sz, &m_dims.x, &m_dims.y, &m_channels, channels);
 
+  if(flags & Unpremultiply) {
+    stbi_set_unpremultiply_on_load(false);
+    lock.releaseExclusive();
+  } else {
+    lock.releaseShared();
+  }
+
+  // When 'channels' != 0 the pixels were converted to it
+  if(m_data && (flags & FlipVertical)) {
+    flip_vertical((byte *)m_data, m_dims.x, m_dims.y, channels ? (int)channels : m_channels);
+  }
+
   m_loaded = true;
 }
 
@@ -41,4 +94,10 @@ Image::~Image()
   stbi_image_free(m_data);
 }
 
-}
\ No newline at end of file
+size_t Image::residentSize() const
+{
+  if(!m_data) return Resource::residentSize();
+
+  return Resource::residentSize() + (size_t)m_dims.x*m_dims.y*m_channels;
+}
+}
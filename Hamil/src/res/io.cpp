@@ -3,6 +3,7 @@
 #include <math/util.h>
 #include <os/file.h>
 
+#include <cassert>
 #include <tuple>
 #include <numeric>
 
@@ -75,11 +76,33 @@ void *IOBuffer::get()
   return m_ptr;
 }
 
+const void *IOBuffer::get() const
+{
+  return m_ptr;
+}
+
 size_t IOBuffer::size() const
 {
   return m_sz;
 }
 
+size_t IOBuffer::ownedSize() const
+{
+  return m_buf.index() == MemoryBuffer ? m_sz : 0;
+}
+
+IOBuffer IOBuffer::slice(size_t offset, size_t sz) const
+{
+  assert(offset+sz <= m_sz && "IOBuffer::slice() out of range!");
+
+  IOBuffer self(*this);
+
+  self.m_ptr = (byte *)m_ptr + offset;
+  self.m_sz  = sz;
+
+  return self;
+}
+
 IOBuffer::operator bool() const
 {
   return m_ptr;
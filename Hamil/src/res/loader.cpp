@@ -47,8 +47,9 @@ Resource::Ptr ResourceLoader::load(Resource::Id id, LoadFlags flags)
   return doLoad(id, flags);
 }
 
-SimpleFsLoader::SimpleFsLoader(const char *base_path) :
-  m_path(base_path),
+SimpleFsLoader::SimpleFsLoader(const char *base_path, uint flags) :
+  m_path(base_path), m_flags(flags),
+  m_enum_mutex(os::Mutex::alloc()),
   m_available_mutex(os::Mutex::alloc())
 {
 }
@@ -85,83 +86,143 @@ static const std::unordered_map<Resource::Tag, yaml::Schema> p_meta_schemas = {
                              .scalar("type", yaml::Scalar::String) },
 };
 
-const std::unordered_map<Resource::Tag, SimpleFsLoader::LoaderFn> SimpleFsLoader::loader_fns = {
-  { Text::tag(),        &SimpleFsLoader::loadText    },
-  { Shader::tag(),      &SimpleFsLoader::loadShader  },
-  { Image::tag(),       &SimpleFsLoader::loadImage   },
-  { Texture::tag(),     &SimpleFsLoader::loadTexture },
-  { Mesh::tag(),        &SimpleFsLoader::loadMesh    },
-  { LookupTable::tag(), &SimpleFsLoader::loadLUT     },
+const std::unordered_map<Resource::Tag, MetaLoader::LoaderFn> MetaLoader::loader_fns = {
+  { Text::tag(),        &MetaLoader::loadText    },
+  { Shader::tag(),      &MetaLoader::loadShader  },
+  { Image::tag(),       &MetaLoader::loadImage   },
+  { Texture::tag(),     &MetaLoader::loadTexture },
+  { Mesh::tag(),        &MetaLoader::loadMesh    },
+  { LookupTable::tag(), &MetaLoader::loadLUT     },
 };
 
+std::optional<Resource::Tag> MetaLoader::validate(const yaml::Document& meta)
+{
+  if(p_meta_generic_schema.validate(meta)) return std::nullopt;
+
+  auto tag = ResourceManager::make_tag(meta("tag")->as<yaml::Scalar>()->str());
+  if(!tag) return std::nullopt;
+
+  auto schema_it = p_meta_schemas.find(tag.value());
+  assert(schema_it != p_meta_schemas.end() && "schema missing in p_meta_schemas!");
+
+  if(schema_it->second.validate(meta)) return std::nullopt;
+
+  return tag;
+}
+
+Resource::Ptr MetaLoader::loadFromMeta(Resource::Id id, Resource::Tag tag, const yaml::Document& meta)
+{
+  auto loader_it = loader_fns.find(tag);
+  assert(loader_it != loader_fns.end() && "loading function missing in MetaLoader!");
+
+  auto loader = loader_it->second;
+
+  return (this->*loader)(id, meta);
+}
+
 void SimpleFsLoader::doInit()
 {
   os::current_working_directory(m_path.data());
 
+  if(m_flags & EnumOnDemand) return;
+
+  ensureEnumerated();
+}
+
+void SimpleFsLoader::ensureEnumerated()
+{
+  auto guard = m_enum_mutex->acquireScoped();
+  if(m_enumerated) return;
+
+  m_meta_cache.load(MetaCacheFile);
+
   enumAvailable("./"); // enum all resources starting from 'base_path'
+
+  if(m_meta_cache.dirty()) m_meta_cache.save(MetaCacheFile);
+
+  m_enumerated = true;
 }
 
 Resource::Ptr SimpleFsLoader::doLoad(Resource::Id id, LoadFlags flags)
 {
+  ensureEnumerated();
+
   auto it = m_available.find(id);
   if(it == m_available.end()) return Resource::Ptr();  // Resource not found!
 
+  auto& available = it->second;
+
+  // Compiled descriptors have already passed validation
+  if(auto cached = m_meta_cache.document(available.cache_key)) {
+    auto& meta = cached.value();
+
+    auto tag = ResourceManager::make_tag(meta("tag")->as<yaml::Scalar>()->str());
+    if(!tag) throw InvalidResourceError(id);
+
+    return loadFromMeta(id, tag.value(), meta);
+  }
+
   // The file was already parsed (in enumOne()) so we can assume it is valid
-  auto meta = yaml::Document::from_string(it->second.get<const char>(), it->second.size());
-  if(p_meta_generic_schema.validate(meta)) throw InvalidResourceError(id);
+  auto& meta_file = available.meta_file;
+  auto meta = yaml::Document::from_string(meta_file.get<const char>(), meta_file.size());
 
-  auto tag = ResourceManager::make_tag(meta("tag")->as<yaml::Scalar>()->str());
+  auto tag = validate(meta);
   if(!tag) throw InvalidResourceError(id);
 
-  auto schema_it = p_meta_schemas.find(tag.value());
-  assert(schema_it != p_meta_schemas.end() && "schema missing in p_meta_schemas!");
+  return loadFromMeta(id, tag.value(), meta);
+}
 
-  if(schema_it->second.validate(meta)) throw InvalidResourceError(id);
+IOBuffer SimpleFsLoader::readLocation(Resource::Id id, const yaml::Scalar *location)
+{
+  auto req = IORequest::read_file(location->str());
+  manager().requestIo(req);
 
-  auto loader_it = loader_fns.find(tag.value());
-  assert(loader_it != loader_fns.end() && "loading function missing in SimpleFsLoader!");
+  return manager().waitIo(req);
+}
 
-  auto loader = loader_it->second;
+IOBuffer SimpleFsLoader::mapLocation(Resource::Id id, const yaml::Scalar *location)
+{
+  auto view = manager().mapLocation(location);
+  if(!view) throw IOError(location->repr());
 
-  return (this->*loader)(id, meta);
+  return view;
 }
 
-void SimpleFsLoader::enumAvailable(std::string path)
+void SimpleFsLoader::enumAvailable(const std::string& base_path)
 {
   using namespace std::literals::string_literals;
 
-  // Snoop subdirectories first
-  std::string dir_query_str = path + "*";
-  auto dir_query = os::FileQuery::open(dir_query_str.data());
+  std::vector<std::string> dirs = { base_path };
+  while(!dirs.empty()) {
+    auto path = std::move(dirs.back());
+    dirs.pop_back();
 
-  dir_query().foreach([this,&path](const char *name, os::FileQuery::Attributes attrs) {
-    // Have to manually check whether 'name' is a directory
-    bool is_directory = attrs & os::FileQuery::IsDirectory;
-    if(!is_directory) return;
+    // Queue up the subdirectories...
+    auto dir_query_str = path + "*";
+    auto dir_query = os::FileQuery::open(dir_query_str.data());
 
-    // 'name' is a directory - descend into it
-    enumAvailable(path + name + "/"s);
-  });
+    dir_query().foreach([&](const char *name, os::FileQuery::Attributes attrs) {
+      // Have to manually check whether 'name' is a directory
+      bool is_directory = attrs & os::FileQuery::IsDirectory;
+      if(!is_directory) return;
 
-  // Now query *.meta files (resource descriptors)
-  auto meta_query_str = path + "*.meta"s;
-  auto meta_query = os::FileQuery::null();
-  try {
-    meta_query = os::FileQuery::open(meta_query_str.data());
-  } catch(const os::FileQuery::Error&) {
-    return; // no .meta files in current directory
-  }
+      dirs.emplace_back(path + name + "/"s);
+    });
 
-  meta_query->foreach([this,path](const char *name, os::FileQuery::Attributes attrs) {
-    // if there's somehow a directory that fits *.meta ignore it
-    if(attrs & os::FileQuery::IsDirectory) return;
+    // ...and kick off reads of the *.meta files (resource descriptors)
+    auto meta_query_str = path + "*.meta"s;
+    auto meta_query = os::FileQuery::null();
+    try {
+      meta_query = os::FileQuery::open(meta_query_str.data());
+    } catch(const os::FileQuery::Error&) {
+      continue; // no .meta files in current directory
+    }
 
-    auto full_path = path + name;
+    meta_query->foreach([&](const char *name, os::FileQuery::Attributes attrs) {
+      // if there's somehow a directory that fits *.meta ignore it
+      if(attrs & os::FileQuery::IsDirectory) return;
 
-    try {
-      // The std::vector of IORequests must be a class member here, as otherwise
-      //   resizing it will cause use-after-free bugs due to emplace_back()
-      //   refernce invalidation semantics
+      auto full_path = path + name;
 
       // TODO: A splash screen should be up on the screen here to let the user
       //       know the application is doing something and isn't just frozen
@@ -172,22 +233,45 @@ void SimpleFsLoader::enumAvailable(std::string path)
       );
 
       manager().requestIo(req);
-    } catch(const os::FileQuery::Error&) {
-      // panic, there really shouldn't be an exception here
-      os::panic(util::fmt("error opening file \"%s\"", full_path).data(), os::FileOpenError);
-    }
-  });
+
+      // Don't let the reads run ahead of the workers unbounded
+      if(m_io_reqs.size() >= MaxInFlightMetaReads) retireMetaReads(MaxInFlightMetaReads/2);
+    });
+  }
 
   // Wait until all the requests have completed
-  manager().waitIoIdle();
+  retireMetaReads(0);
+}
+
+void SimpleFsLoader::retireMetaReads(size_t max_in_flight)
+{
+  while(m_io_reqs.size() > max_in_flight) {
+    auto& req = m_io_reqs.front();
+
+    // Releases the request's JobId
+    manager().waitIo(req);
+
+    m_io_reqs.pop_front();
+  }
 }
 
 void SimpleFsLoader::metaIoCompleted(std::string full_path, IORequest& req)
 {
   auto file = req.result();
+  auto cache_key = MetaCache::key(file.get(), file.size());
+
+  Resource::Id id = Resource::InvalidId;
+  if(auto cached_id = m_meta_cache.probe(cache_key)) {
+    id = cached_id.value();
+  } else {
+    yaml::Document meta;
+
+    id = enumOne(file.get<const char>(), file.size(), meta, full_path.data());
+    if(id == Resource::InvalidId) return;  // The *.meta file was invalid
 
-  auto id = enumOne(file.get<const char>(), file.size(), full_path.data());
-  if(id == Resource::InvalidId) return;  // The *.meta file was invalid
+    // Only cache descriptors which will load successfully
+    if(validate(meta)) m_meta_cache.insert(cache_key, id, meta);
+  }
 
   printf("found resource %-25s: 0x%.16lx\n", full_path.data(), id);
 
@@ -195,13 +279,13 @@ void SimpleFsLoader::metaIoCompleted(std::string full_path, IORequest& req)
   auto guard = m_available_mutex->acquireScoped();
   m_available.emplace(
     id,
-    std::move(file)
+    AvailableMeta { std::move(file), cache_key }
   );
 }
 
-Resource::Id SimpleFsLoader::enumOne(const char *meta_file, size_t sz, const char *full_path)
+Resource::Id SimpleFsLoader::enumOne(const char *meta_file, size_t sz, yaml::Document& meta,
+  const char *full_path)
 {
-  yaml::Document meta;
   try {
     meta = yaml::Document::from_string(meta_file, sz);
   } catch(const yaml::Document::Error& e) {
@@ -222,7 +306,7 @@ Resource::Id SimpleFsLoader::enumOne(const char *meta_file, size_t sz, const cha
   return Resource::InvalidId;
 }
 
-SimpleFsLoader::NamePathTuple SimpleFsLoader::name_path(const yaml::Document& meta)
+MetaLoader::NamePathTuple MetaLoader::name_path(const yaml::Document& meta)
 {
   return std::make_tuple(
     meta("name")->as<yaml::Scalar>(),
@@ -230,7 +314,7 @@ SimpleFsLoader::NamePathTuple SimpleFsLoader::name_path(const yaml::Document& me
   );
 }
 
-SimpleFsLoader::NamePathLocationTuple SimpleFsLoader::name_path_location(const yaml::Document& meta)
+MetaLoader::NamePathLocationTuple MetaLoader::name_path_location(const yaml::Document& meta)
 {
   return std::make_tuple(
     meta("name")->as<yaml::Scalar>(),
@@ -239,21 +323,19 @@ SimpleFsLoader::NamePathLocationTuple SimpleFsLoader::name_path_location(const y
   );
 }
 
-Resource::Ptr SimpleFsLoader::loadText(Resource::Id id, const yaml::Document& meta)
+Resource::Ptr MetaLoader::loadText(Resource::Id id, const yaml::Document& meta)
 {
   // execution only reaches here when 'meta' has passed validation
   // so we can assume it's valid
   auto [name, path, location] = name_path_location(meta);
 
-  auto req = IORequest::read_file(location->str());
-  manager().requestIo(req);
+  // The Text references the mapping directly
+  auto text = mapLocation(id, location);
 
-  auto text = manager().waitIo(req);
-
-  return Text::from_file(text.get<const char>(), text.size(), id, name->str(), path->str());
+  return Text::from_buffer(std::move(text), id, name->str(), path->str());
 }
 
-Resource::Ptr SimpleFsLoader::loadShader(Resource::Id id, const yaml::Document& meta)
+Resource::Ptr MetaLoader::loadShader(Resource::Id id, const yaml::Document& meta)
 {
   auto [name, path] = name_path(meta);
 
@@ -267,7 +349,7 @@ static const std::map<std::string, unsigned> p_num_channels = {
   { "rgba", 4 },
 };
 
-Resource::Ptr SimpleFsLoader::loadImage(Resource::Id id, const yaml::Document& meta)
+Resource::Ptr MetaLoader::loadImage(Resource::Id id, const yaml::Document& meta)
 {
   auto [name, path, location] = name_path_location(meta);
 
@@ -290,8 +372,7 @@ Resource::Ptr SimpleFsLoader::loadImage(Resource::Id id, const yaml::Document& m
   unsigned flags = 0;
   if(flip_vertical && flip_vertical->as<yaml::Scalar>()->b()) flags |= Image::FlipVertical;
 
-  auto view = manager().mapLocation(location);
-  if(!view) throw IOError(location->repr());
+  auto view = mapLocation(id, location);
 
   auto img = Image::from_file(view.get(), view.size(), num_channels, flags, id, name->str(), path->str());
 
@@ -302,40 +383,37 @@ Resource::Ptr SimpleFsLoader::loadImage(Resource::Id id, const yaml::Document& m
   return img;
 }
 
-Resource::Ptr SimpleFsLoader::loadTexture(Resource::Id id, const yaml::Document& meta)
+Resource::Ptr MetaLoader::loadTexture(Resource::Id id, const yaml::Document& meta)
 {
   auto [name, path, location] = name_path_location(meta);
 
-  // Texture copies the data so map it to
-  //   prevent unnecessary copying
-  auto view = manager().mapLocation(location);
-  if(!view) throw IOError(location->repr());
+  // Texture copies the data (flipping it vertically along
+  //   the way), so map it to prevent unnecessary copying
+  auto view = mapLocation(id, location);
 
-  return Texture::from_yaml(view, meta, id, name->str(), path->str());
+  // Cubemaps and Arrays with full mip chains are a lot
+  //   of data to flip, so spread it among the IO workers
+  return Texture::from_yaml(manager().ioWorkers(), view, meta, id, name->str(), path->str());
 }
 
-Resource::Ptr SimpleFsLoader::loadMesh(Resource::Id id, const yaml::Document& meta)
+Resource::Ptr MetaLoader::loadMesh(Resource::Id id, const yaml::Document& meta)
 {
   auto [name, path, location] = name_path_location(meta);
 
-  auto req = IORequest::read_file(location->str());
-  manager().requestIo(req);
-
-  auto& mesh_data = manager().waitIo(req);
+  // The Mesh keeps the IOBuffer around, so it can
+  //   reference the mapping instead of a copy
+  auto mesh_data = mapLocation(id, location);
 
   return Mesh::from_yaml(std::move(mesh_data), meta, id, name->str(), path->str());
 }
 
-Resource::Ptr SimpleFsLoader::loadLUT(Resource::Id id, const yaml::Document& meta)
+Resource::Ptr MetaLoader::loadLUT(Resource::Id id, const yaml::Document& meta)
 {
   auto [name, path, location] = name_path_location(meta);
 
-  // Read in the file, because the LookupTable stores
-  //   the IOBuffer with the data directly
-  auto req = IORequest::read_file(location->str());
-  manager().requestIo(req);
-
-  auto& lut_data = manager().waitIo(req);
+  // The LookupTable stores the IOBuffer with the data
+  //   directly, so it can reference the mapping
+  auto lut_data = mapLocation(id, location);
 
   return LookupTable::from_yaml(std::move(lut_data), meta, id, name->str(), path->str());
 }
@@ -0,0 +1,75 @@
+#include <res/loadrequest.h>
+#include <res/manager.h>
+
+#include <cassert>
+
+namespace res {
+
+LoadRequest::LoadRequest(ResourceManager *man, Resource::Id id, LoadFlags flags, Priority p, u64 seq) :
+  m_man(man),
+  m_id(id), m_flags(flags),
+  m_priority(p), m_seq(seq)
+{
+}
+
+Resource::Id LoadRequest::id() const
+{
+  return m_id;
+}
+
+LoadFlags LoadRequest::flags() const
+{
+  return m_flags;
+}
+
+LoadRequest::Status LoadRequest::status() const
+{
+  return m_status.load();
+}
+
+bool LoadRequest::done() const
+{
+  auto s = status();
+  return s == Loaded || s == Failed || s == Cancelled;
+}
+
+LoadRequest::Priority LoadRequest::priority() const
+{
+  return m_priority;
+}
+
+LoadRequest& LoadRequest::priority(Priority p)
+{
+  m_man->reprioritizeLoad(*this, p);
+
+  return *this;
+}
+
+bool LoadRequest::cancel()
+{
+  return m_man->cancelLoad(*this);
+}
+
+LoadRequest& LoadRequest::onCompleted(LoadComplete fn)
+{
+  m_complete = fn;
+
+  return *this;
+}
+
+ResourceHandle LoadRequest::result() const
+{
+  assert(status() == Loaded && "Attempted to get the result() of a LoadRequest which isn't Loaded!");
+
+  return m_handle;
+}
+
+bool LoadRequest::Order::operator()(const Ptr& a, const Ptr& b) const
+{
+  // std::*_heap() functions put the largest element at the front
+  if(a->m_priority != b->m_priority) return a->m_priority < b->m_priority;
+
+  return a->m_seq > b->m_seq;
+}
+
+}
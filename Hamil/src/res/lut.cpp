@@ -33,9 +33,9 @@ LookupTable::DataType LookupTable::type() const
   return m_type;
 }
 
-void *LookupTable::data()
+const void *LookupTable::data() const
 {
-  return m_lut.get<void>();
+  return m_lut.get<const void>();
 }
 
 size_t LookupTable::size() const
@@ -43,4 +43,9 @@ size_t LookupTable::size() const
   return m_lut.size();
 }
 
-}
\ No newline at end of file
+size_t LookupTable::residentSize() const
+{
+  return Resource::residentSize() + m_lut.ownedSize();
+}
+
+}
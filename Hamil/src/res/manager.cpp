@@ -7,9 +7,13 @@
 #include <res/lut.h>
 
 #include <util/hash.h>
+#include <os/cpuinfo.h>
+#include <os/error.h>
 #include <yaml/node.h>
 
+#include <cassert>
 #include <cstring>
+#include <algorithm>
 #include <map>
 #include <utility>
 
@@ -18,11 +22,14 @@ namespace res {
 ResourceManager::ResourceManager(std::initializer_list<ResourceLoader *> loader_chain) :
   m_caches({ { ResourceCache::Generic }, { ResourceCache::Static } }),
   m_loader_chain(loader_chain.size()),
-  m_io_workers(NumIOWorkers)
+  m_io_workers(num_io_workers()),
+  m_stream_workers(NumStreamingWorkers),
+  m_stream_mutex(os::Mutex::alloc())
 {
   // Kick off the IO workers right away so loaders
   //   can utilize IORequests during init()
   m_io_workers.kickWorkers("ResourceManager_IOWorker");
+  m_stream_workers.kickWorkers("ResourceManager_StreamingWorker");
 
   // Populate the loader chain in reverse to allow
   //   listing the loaders in a natural order (the last loader
@@ -34,6 +41,31 @@ ResourceManager::ResourceManager(std::initializer_list<ResourceLoader *> loader_
   }
 }
 
+ResourceManager::~ResourceManager()
+{
+  // Cancel all the requests which haven't been started yet...
+  decltype(m_stream_jobs) stream_jobs;
+  {
+    auto guard = m_stream_mutex->acquireScoped();
+
+    for(auto& req : m_stream_queue) {
+      req->m_status = LoadRequest::Failed;
+
+      m_stream_requests.erase(req->id());
+    }
+    m_stream_queue.clear();
+
+    stream_jobs.swap(m_stream_jobs);
+  }
+
+  // ...and wait for the in-flight ones, as they use the loaders
+  //   and the caches (the lock can't be held here, as the Jobs
+  //   acquire it before returning)
+  for(auto& [job_id, job] : stream_jobs) m_stream_workers.waitJob(job_id);
+
+  m_stream_workers.killWorkers();
+}
+
 Resource::Id ResourceManager::guid(Resource::Tag tag,
   const std::string& name, const std::string& path)
 {
@@ -47,17 +79,106 @@ Resource::Id ResourceManager::guid(Resource::Tag tag,
 
 ResourceHandle ResourceManager::load(Resource::Id id, LoadFlags flags)
 {
+  if(flags & Precache) {
+    loadAsync(id, 0, flags);
+
+    return ResourceHandle();
+  }
+
   auto& cache = getCache(flags);
   if(auto r = cache.probe(id)) return *r;
 
-  for(auto& loader : m_loader_chain) {
-    if(auto r = loader->load(id, flags)) return cache.fill(r);
-  }
+  if(auto r = loadFromChain(id, flags)) return cache.fill(r);
   throw Error(); // if no loader manages to locate the resource - throw :(
 
   return ResourceHandle(); // unreachable
 }
 
+LoadRequest::Ptr ResourceManager::loadAsync(Resource::Id id, LoadRequest::Priority priority,
+  LoadFlags flags)
+{
+  auto guard = m_stream_mutex->acquireScoped();
+
+  auto it = m_stream_requests.find(id);
+  if(it != m_stream_requests.end()) {
+    auto& req = it->second;
+    if(req->status() == LoadRequest::Queued && req->m_priority < priority) {
+      req->m_priority = priority;
+      std::make_heap(m_stream_queue.begin(), m_stream_queue.end(), LoadRequest::Order());
+    }
+
+    return req;
+  }
+
+  auto req = LoadRequest::Ptr(new LoadRequest(this, id, flags, priority, m_stream_seq++));
+  m_stream_requests.emplace(id, req);
+
+  // Skip the streaming workers entirely when the resource is already loaded
+  if(auto r = getCache(flags).probe(id)) {
+    if(auto resource = r->lock()) {
+      req->m_status = LoadRequest::Loading;
+      req->m_resource = std::move(resource);
+
+      m_stream_completed.push_back(req);
+
+      return req;
+    }
+  }
+
+  m_stream_queue.push_back(req);
+  std::push_heap(m_stream_queue.begin(), m_stream_queue.end(), LoadRequest::Order());
+
+  kickStreamingJob();
+
+  return req;
+}
+
+ResourceManager& ResourceManager::dispatchLoads()
+{
+  std::vector<LoadRequest::Ptr> completed;
+  {
+    auto guard = m_stream_mutex->acquireScoped();
+    completed.swap(m_stream_completed);
+
+    for(const auto& req : completed) m_stream_requests.erase(req->id());
+  }
+
+  for(const auto& req : completed) {
+    if(req->m_resource) {
+      auto& cache = getCache(req->flags());
+
+      // The resource might've been cached already (by the fast path in
+      //   loadAsync() or a load() in the meantime), in which case
+      //   fill() would return an empty ResourcePtr
+      if(auto r = cache.probe(req->id())) {
+        req->m_handle = *r;
+      } else {
+        req->m_handle = cache.fill(req->m_resource);
+      }
+      req->m_resource.reset();
+
+      req->m_status = LoadRequest::Loaded;
+    } else {
+      req->m_status = LoadRequest::Failed;
+    }
+
+    if(req->m_complete) req->m_complete(*req);
+  }
+
+  // Release the JobIds of the streaming Jobs which have finished
+  //   (they're kicked in order, so stop at the first one still running)
+  auto guard = m_stream_mutex->acquireScoped();
+  while(!m_stream_jobs.empty()) {
+    auto& [job_id, job] = m_stream_jobs.front();
+    if(!job->done()) break;
+
+    m_stream_workers.waitJob(job_id);
+    m_stream_jobs.pop_front();
+  }
+
+  return *this;
+}
+
 ResourceHandle ResourceManager::handle(Resource::Id id)
 {
   for(auto& cache : m_caches) {
@@ -68,6 +189,18 @@ ResourceHandle ResourceManager::handle(Resource::Id id)
   return ResourceHandle(); // unreachable
 }
 
+ResourceManager& ResourceManager::memoryBudget(size_t budget)
+{
+  m_caches[ResourceCache::Generic].budget(budget);
+
+  return *this;
+}
+
+const ResourceCache::Stats& ResourceManager::cacheStats(ResourceCache::Type type) const
+{
+  return m_caches.at(type).stats();
+}
+
 ResourceManager& ResourceManager::requestIo(const IORequest::Ptr& req)
 {
   req->m_id = m_io_workers.scheduleJob(req->job());
@@ -92,20 +225,32 @@ ResourceManager& ResourceManager::waitIoIdle()
   return *this;
 }
 
+sched::WorkerPool& ResourceManager::ioWorkers()
+{
+  return m_io_workers;
+}
+
 IOBuffer ResourceManager::mapLocation(const yaml::Scalar *location, size_t offset, size_t sz)
 {
   IOBuffer view(nullptr, 0);
 
-  if(location->tag().value() == "!file") {
-    auto f = os::File::alloc();
-    f().open(location->str(), os::File::Read, os::File::ShareRead, os::File::OpenExisting);
+  if(location->tag().value() == "!file") return mapFile(location->str(), offset, sz);
 
-    size_t map_sz = sz ? sz : f().size();
+  return view;
+}
 
-    return IOBuffer(f().map(os::File::ProtectRead, offset, map_sz));
-  }
+IOBuffer ResourceManager::mapFile(const std::string& path, size_t offset, size_t sz)
+{
+  auto f = os::File::alloc();
+  f().open(path.data(), os::File::Read, os::File::ShareRead, os::File::OpenExisting);
 
-  return view;
+  size_t map_sz = sz ? sz : f().size();
+
+  // Zero-length mappings aren't allowed, so return an
+  //   empty (but valid) buffer instead
+  if(!map_sz) return IOBuffer::make_memory_buffer(0);
+
+  return IOBuffer(f().map(os::File::ProtectRead, offset, map_sz));
 }
 
 static const std::map<std::string, res::Resource::Tag> p_tags = {
@@ -123,6 +268,107 @@ std::optional<Resource::Tag> ResourceManager::make_tag(const char *tag)
   return it != p_tags.end() ? std::optional<Resource::Tag>(it->second) : std::nullopt;
 }
 
+Resource::Ptr ResourceManager::loadFromChain(Resource::Id id, LoadFlags flags)
+{
+  for(auto& loader : m_loader_chain) {
+    if(auto r = loader->load(id, flags)) return r;
+  }
+
+  return nullptr;
+}
+
+void ResourceManager::kickStreamingJob()
+{
+  if(m_num_stream_jobs >= NumStreamingWorkers) return;
+
+  auto job = StreamingJob(new sched::Job<Unit>(
+    std::bind(&ResourceManager::streamingJob, this),
+    std::make_tuple()
+  ));
+  auto job_id = m_stream_workers.scheduleJob(job.get());
+
+  m_stream_jobs.emplace_back(job_id, std::move(job));
+  m_num_stream_jobs++;
+}
+
+Unit ResourceManager::streamingJob()
+{
+  while(true) {
+    LoadRequest::Ptr req;
+    {
+      auto guard = m_stream_mutex->acquireScoped();
+
+      // Decrementing the counter while holding the lock guarantees
+      //   loadAsync() never sees a stale count and strands a request
+      if(m_stream_queue.empty()) {
+        m_num_stream_jobs--;
+        return {};
+      }
+
+      std::pop_heap(m_stream_queue.begin(), m_stream_queue.end(), LoadRequest::Order());
+      req = std::move(m_stream_queue.back());
+      m_stream_queue.pop_back();
+
+      req->m_status = LoadRequest::Loading;
+    }
+
+    // Nothing can be allowed to escape the job, as the request would
+    //   be stuck Loading and m_num_stream_jobs would never be
+    //   decremented (so no new streaming jobs would be kicked)
+    Resource::Ptr resource;
+    try {
+      resource = loadFromChain(req->id(), req->flags());
+    } catch(...) {
+      // Leave 'resource' empty - the request will be Failed
+      resource.reset();
+    }
+
+    auto guard = m_stream_mutex->acquireScoped();
+    req->m_resource = std::move(resource);
+
+    m_stream_completed.push_back(std::move(req));
+  }
+
+  return {}; // unreachable
+}
+
+void ResourceManager::reprioritizeLoad(LoadRequest& req, LoadRequest::Priority priority)
+{
+  auto guard = m_stream_mutex->acquireScoped();
+  if(req.status() != LoadRequest::Queued) return;
+
+  req.m_priority = priority;
+  std::make_heap(m_stream_queue.begin(), m_stream_queue.end(), LoadRequest::Order());
+}
+
+bool ResourceManager::cancelLoad(LoadRequest& req)
+{
+  auto guard = m_stream_mutex->acquireScoped();
+  if(req.status() != LoadRequest::Queued) return false;
+
+  auto it = std::find_if(m_stream_queue.begin(), m_stream_queue.end(), [&](const auto& r) {
+    return r.get() == &req;
+  });
+  assert(it != m_stream_queue.end() && "Queued LoadRequest missing from the queue!");
+
+  m_stream_queue.erase(it);
+  std::make_heap(m_stream_queue.begin(), m_stream_queue.end(), LoadRequest::Order());
+
+  req.m_status = LoadRequest::Cancelled;
+  m_stream_requests.erase(req.id());
+
+  return true;
+}
+
+int ResourceManager::num_io_workers()
+{
+  // Most of the time the IO workers are either blocked on
+  //   reads or parsing, so it pays to have a few of them
+  auto num_threads = (int)os::cpuinfo().numLogicalProcessors();
+
+  return std::clamp<int>(num_threads, MinIOWorkers, MaxIOWorkers);
+}
+
 ResourceCache& ResourceManager::getCache(LoadFlags flags)
 {
   size_t idx = flags & LoadStatic ? ResourceCache::Static : ResourceCache::Generic;
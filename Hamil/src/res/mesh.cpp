@@ -4,6 +4,7 @@
 #include <yaml/node.h>
 #include <gx/gx.h>
 #include <mesh/obj.h>
+#include <mesh/binmesh.h>
 
 #include <cassert>
 
@@ -21,10 +22,8 @@ Resource::Ptr Mesh::from_yaml(IOBuffer mesh_data,
   mesh->m_mesh_data = std::move(mesh_data);
   mesh->populate(doc);
 
-  // TODO:
-  //   1. Read the mesh data from the disk
-  //   2. Parse it
-  //   3. Stream it into a <Indexed>VertexArray
+  // The data is parsed and unpacked by MeshLoader::streamPooled()
+  //   and then copied into a gx::MeshPool by upload()
   mesh->m_loader->loadParams(mesh->m_mesh_data.get(), mesh->m_mesh_data.size());
 
   return Resource::Ptr(mesh);
@@ -35,6 +34,45 @@ mesh::MeshLoader& Mesh::loader()
   return *m_loader;
 }
 
+Mesh& Mesh::upload(gx::MeshPool& pool)
+{
+  deallocate();
+
+  m_alloc = m_loader->upload(pool);
+  if(!m_alloc.valid()) return *this;
+
+  m_mesh_pool = pool.ref();
+
+  m_mesh
+    .withIndexedArray(m_alloc.array)
+    .withBase(m_alloc.base_vertex)
+    .withOffset(m_alloc.first_index)
+    .withNum(m_alloc.num_inds);
+
+  return *this;
+}
+
+const gx::MeshPool::Allocation& Mesh::allocation() const
+{
+  return m_alloc;
+}
+
+Mesh::~Mesh()
+{
+  deallocate();
+}
+
+void Mesh::deallocate()
+{
+  if(!m_mesh_pool) return;
+
+  // The arenas are released along with the MeshPool
+  if(auto pool = *m_mesh_pool) pool->dealloc(m_alloc);
+
+  m_mesh_pool.reset();
+  m_alloc = gx::MeshPool::Allocation();
+}
+
 const mesh::Mesh& Mesh::mesh() const
 {
   return m_mesh;
@@ -54,7 +92,8 @@ static const std::unordered_map<std::string, gx::Primitive> p_mesh_prims = {
 
 using MeshLoaderFactoryFn = std::function<mesh::MeshLoader *()>;
 static const std::unordered_map<std::string, MeshLoaderFactoryFn> p_loader_factories = {
-  { "obj", []() -> mesh::MeshLoader * { return new mesh::ObjLoader(); } },
+  { "obj",   []() -> mesh::MeshLoader * { return new mesh::ObjLoader(); } },
+  { "hmesh", []() -> mesh::MeshLoader * { return new mesh::BinMeshLoader(); } },
 };
 
 void Mesh::populate(const yaml::Document& doc)
@@ -90,7 +129,7 @@ void Mesh::populate(const yaml::Document& doc)
   auto loader_factory = p_loader_factories.find(location_str.substr(mesh_type_off+1));
   if(loader_factory == p_loader_factories.end()) throw UnknownTypeError();
   
-  m_loader = loader_factory->second();
+  m_loader.reset(loader_factory->second());
 
   m_loader->onLoaded([this](mesh::MeshLoader& loader) {
     m_mesh_data.release();   // Dispose of the mesh data when it's no longer needed
@@ -99,4 +138,8 @@ void Mesh::populate(const yaml::Document& doc)
   });
 }
 
+size_t Mesh::residentSize() const
+{
+  return Resource::residentSize() + m_mesh_data.ownedSize();
+}
 }
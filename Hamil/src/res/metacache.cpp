@@ -0,0 +1,163 @@
+#include <res/metacache.h>
+
+#include <util/hash.h>
+#include <os/file.h>
+#include <os/error.h>
+#include <yaml/document.h>
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace res {
+
+MetaCache::MetaCache() :
+  m_mutex(os::Mutex::alloc())
+{
+}
+
+MetaCache::Key MetaCache::key(const void *meta_file, size_t sz)
+{
+  return util::hash(meta_file, sz);
+}
+
+void MetaCache::load(const std::string& path)
+{
+  auto guard = m_mutex->acquireScoped();
+
+  m_records.clear();
+  m_num_loaded = 0;
+  m_inserted = false;
+
+  auto f = os::File::alloc();
+  try {
+    f().open(path.data(), os::File::Read, os::File::ShareRead, os::File::OpenExisting);
+  } catch(const os::Error&) {
+    return;    // No cache yet
+  }
+
+  auto sz = f().size();
+  if(sz < sizeof(Header)) return;
+
+  auto view = f().map(os::File::ProtectRead);
+  auto data = view->get<const byte>();
+
+  Header header;
+  memcpy(&header, data, sizeof(Header));
+
+  if(header.magic != Magic || header.version != Version) return;
+
+  size_t offset = sizeof(Header);
+  for(u64 i = 0; i < header.num_records; i++) {
+    RecordHeader record;
+    if(offset + sizeof(RecordHeader) > sz) break;
+
+    memcpy(&record, data + offset, sizeof(RecordHeader));
+    offset += sizeof(RecordHeader);
+
+    if(offset + record.size > sz) break;   // Truncated cache
+
+    auto& r = m_records[record.key];
+    r.id = record.id;
+    r.data.assign((const char *)data + offset, record.size);
+
+    offset += record.size;
+  }
+
+  m_num_loaded = m_records.size();
+}
+
+void MetaCache::save(const std::string& path)
+{
+  auto guard = m_mutex->acquireScoped();
+
+  std::string out;
+
+  Header header;
+  header.magic = Magic;
+  header.version = Version;
+  header.num_records = 0;
+
+  out.append((const char *)&header, sizeof(Header));
+
+  for(const auto& [key, r] : m_records) {
+    if(!r.used) continue;
+
+    RecordHeader record;
+    record.key = key;
+    record.id = r.id;
+    record.size = r.data.size();
+
+    out.append((const char *)&record, sizeof(RecordHeader));
+    out.append(r.data);
+
+    header.num_records++;
+  }
+
+  memcpy(out.data(), &header, sizeof(Header));
+
+  auto f = os::File::alloc();
+  f().open(path.data(), os::File::Write, os::File::ShareRead, os::File::CreateAlways);
+
+  f().write(out.data(), out.size());
+}
+
+bool MetaCache::dirty() const
+{
+  auto guard = m_mutex->acquireScoped();
+  if(m_inserted) return true;
+
+  size_t num_used = 0;
+  for(const auto& [key, r] : m_records) {
+    if(r.used) num_used++;
+  }
+
+  return num_used != m_num_loaded;
+}
+
+std::optional<Resource::Id> MetaCache::probe(Key k)
+{
+  auto guard = m_mutex->acquireScoped();
+
+  auto it = m_records.find(k);
+  if(it == m_records.end()) return std::nullopt;
+
+  it->second.used = true;
+
+  return it->second.id;
+}
+
+std::optional<yaml::Document> MetaCache::document(Key k) const
+{
+  std::string data;
+  {
+    auto guard = m_mutex->acquireScoped();
+
+    auto it = m_records.find(k);
+    if(it == m_records.end()) return std::nullopt;
+
+    data = it->second.data;
+  }
+
+  try {
+    return yaml::Document::from_binary(data.data(), data.size());
+  } catch(const yaml::Document::Error&) {
+    return std::nullopt;
+  }
+}
+
+void MetaCache::insert(Key k, Resource::Id id, const yaml::Document& meta)
+{
+  auto data = meta.toBinary();
+
+  auto guard = m_mutex->acquireScoped();
+
+  auto& r = m_records[k];
+  r.id = id;
+  r.data = std::move(data);
+  r.used = true;
+
+  m_inserted = true;
+}
+
+}
@@ -0,0 +1,332 @@
+#include <res/pack.h>
+#include <res/manager.h>
+#include <res/metacache.h>
+
+#include <os/file.h>
+#include <util/hash.h>
+#include <yaml/document.h>
+#include <yaml/node.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace res {
+
+PackLoader::PackLoader(const char *archive_path, const char *source_path) :
+  m_path(archive_path), m_source_path(source_path ? source_path : "")
+{
+}
+
+void PackLoader::doInit()
+{
+  try {
+    checkArchive();
+  } catch(const os::Error& e) {
+    printf("warning: resource pack '%s' couldn't be used (%s)\n", m_path.data(), e.what());
+
+    // Defer to the rest of the loader chain
+    m_archive = IOBuffer();
+    m_index = nullptr;
+    m_num_entries = 0;
+    m_stale.reset();
+  }
+}
+
+void PackLoader::checkArchive()
+{
+  m_archive = manager().mapFile(m_path);
+
+  auto archive = m_archive.get<const byte>();
+  auto archive_sz = m_archive.size();
+
+  if(archive_sz < sizeof(PackHeader)) throw InvalidPackError(m_path);
+
+  auto header = (const PackHeader *)archive;
+  if(header->magic != PackHeader::Magic || header->version != PackHeader::Version) {
+    throw InvalidPackError(m_path);
+  }
+
+  // Make sure all of the sections lie inside of the archive
+  auto in_bounds = [archive_sz](u64 offset, u64 size) {
+    return offset <= archive_sz && size <= archive_sz-offset;
+  };
+
+  if(header->size != archive_sz || header->num_entries > archive_sz/sizeof(PackEntry)
+    || !in_bounds(header->index_offset, header->num_entries*sizeof(PackEntry))) {
+    throw InvalidPackError(m_path);
+  }
+
+  auto index = (const PackEntry *)(archive + header->index_offset);
+  for(u64 i = 0; i < header->num_entries; i++) {
+    const auto& e = index[i];
+
+    // find() relies on the index being sorted
+    if(i > 0 && index[i-1].id >= e.id) throw InvalidPackError(m_path);
+
+    if(!in_bounds(e.meta_offset, e.meta_size) || !in_bounds(e.source_offset, e.source_size)
+      || !in_bounds(e.payload_offset, e.payload_size)) {
+      throw InvalidPackError(m_path);
+    }
+  }
+
+  m_index = index;
+  m_num_entries = header->num_entries;
+
+  if(m_source_path.empty()) return;
+
+  m_stale.reset(new std::atomic<u8>[m_num_entries]);
+  for(size_t i = 0; i < m_num_entries; i++) m_stale[i].store(StaleUnknown, std::memory_order_relaxed);
+}
+
+Resource::Ptr PackLoader::doLoad(Resource::Id id, LoadFlags flags)
+{
+  auto entry = find(id);
+  if(!entry) return Resource::Ptr();   // Resource not found!
+
+  auto meta_data = m_archive.get<const byte>() + entry->meta_offset;
+
+  yaml::Document meta;
+  try {
+    meta = yaml::Document::from_binary(meta_data, entry->meta_size);
+  } catch(const yaml::Document::Error&) {
+    throw InvalidPackError(m_path);
+  }
+
+  // Let the rest of the loader chain pick up the edited version
+  if(stale(*entry, meta)) return Resource::Ptr();
+
+  // The meta was validated when the archive was built
+  auto tag = ResourceManager::make_tag(meta("tag")->as<yaml::Scalar>()->str());
+  if(!tag) throw InvalidResourceError(id);
+
+  return loadFromMeta(id, tag.value(), meta);
+}
+
+IOBuffer PackLoader::readLocation(Resource::Id id, const yaml::Scalar *location)
+{
+  auto view = payload(id, location);
+
+  auto buf = IOBuffer::make_memory_buffer(view.size());
+  memcpy(buf.get(), view.get(), view.size());
+
+  return buf;
+}
+
+IOBuffer PackLoader::mapLocation(Resource::Id id, const yaml::Scalar *location)
+{
+  return payload(id, location);
+}
+
+const PackEntry *PackLoader::find(Resource::Id id) const
+{
+  auto end = m_index + m_num_entries;
+  auto it = std::lower_bound(m_index, end, id, [](const PackEntry& e, Resource::Id id) {
+    return e.id < id;
+  });
+
+  return it != end && it->id == id ? it : nullptr;
+}
+
+bool PackLoader::stale(const PackEntry& entry, const yaml::Document& meta)
+{
+  if(m_source_path.empty()) return false;
+
+  auto& state = m_stale[&entry - m_index];
+  switch(state.load(std::memory_order_relaxed)) {
+  case StaleFresh: return false;
+  case StaleStale: return true;
+  }
+
+  bool is_stale = checkStale(entry, meta);
+  state.store(is_stale ? StaleStale : StaleFresh, std::memory_order_relaxed);
+
+  return is_stale;
+}
+
+bool PackLoader::checkStale(const PackEntry& entry, const yaml::Document& meta) const
+{
+
+  // Returns nullptr when the file can't be opened
+  auto open_source = [this](const std::string& path) -> os::File::Ptr {
+    try {
+      auto f = os::File::alloc();
+      f().open((m_source_path + "/" + path).data(),
+          os::File::Read, os::File::ShareRead, os::File::OpenExisting);
+
+      return f;
+    } catch(const os::Error&) {
+      return os::File::Ptr();
+    }
+  };
+
+  auto source_path = std::string(m_archive.get<const char>() + entry.source_offset, entry.source_size);
+  if(auto f = open_source(source_path)) {
+    std::string source(f().size(), '\0');
+    f().read(source.data(), source.size());
+
+    if(MetaCache::key(source.data(), source.size()) != entry.source_key) return true;
+  }
+
+  auto location = meta("location");
+  if(!entry.location_hash || !location) return false;
+
+  // Re-hashing every payload would defeat the purpose of the
+  //   archive, so settle for comparing their sizes
+  if(auto f = open_source(location->as<yaml::Scalar>()->str())) {
+    if(f().size() != entry.payload_size) return true;
+  }
+
+  return false;
+}
+
+IOBuffer PackLoader::payload(Resource::Id id, const yaml::Scalar *location)
+{
+  auto entry = find(id);
+  assert(entry && "payload() called with an 'id' not present in the archive!");
+
+  // Only the files referred to by a meta's 'location' get packed
+  auto location_str = location->str();
+  if(!entry->location_hash || location->tag().value() != "!file"
+    || util::hash(location_str, strlen(location_str)) != entry->location_hash) {
+    throw IOError(location->repr());
+  }
+
+  // Empty payloads still get a valid (zero-sized) view
+  return m_archive.slice(entry->payload_offset, entry->payload_size);
+}
+
+PackBuilder& PackBuilder::add(Resource::Id id, const std::string& meta,
+    const std::string& source_path, const std::string& payload_path)
+{
+  m_entries.push_back({ id, meta, source_path, payload_path });
+
+  return *this;
+}
+
+size_t PackBuilder::numEntries() const
+{
+  return m_entries.size();
+}
+
+static size_t align_offset(size_t offset, size_t align)
+{
+  return (offset + align-1) & ~(align-1);
+}
+
+static void write_padding(os::File& file, size_t offset, size_t padded_offset)
+{
+  static const byte zeroes[PackPayloadAlign] = { 0 };
+
+  assert(padded_offset-offset <= sizeof(zeroes));
+
+  file.write(zeroes, padded_offset-offset);
+}
+
+void PackBuilder::write(os::File& file)
+{
+  std::sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+    return a.id < b.id;
+  });
+
+  auto dup = std::adjacent_find(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+    return a.id == b.id;
+  });
+  if(dup != m_entries.end()) throw DuplicateIdError(dup->id);
+
+  std::vector<PackEntry> index(m_entries.size());
+
+  // Lay out the archive...
+  size_t offset = sizeof(PackHeader) + index.size()*sizeof(PackEntry);
+  for(size_t i = 0; i < m_entries.size(); i++) {
+    const auto& entry = m_entries[i];
+    auto& e = index[i];
+
+    e.id = entry.id;
+    e.meta_offset = offset;
+    e.meta_size = entry.meta.size();
+
+    offset += e.meta_size;
+  }
+
+  for(size_t i = 0; i < m_entries.size(); i++) {
+    const auto& entry = m_entries[i];
+    auto& e = index[i];
+
+    e.source_offset = offset;
+    e.source_size = entry.source_path.size();
+
+    offset += e.source_size;
+
+    auto f = os::File::alloc();
+    f().open(entry.source_path.data(), os::File::Read, os::File::ShareRead, os::File::OpenExisting);
+
+    std::string source(f().size(), '\0');
+    f().read(source.data(), source.size());
+
+    e.source_key = MetaCache::key(source.data(), source.size());
+  }
+
+  for(size_t i = 0; i < m_entries.size(); i++) {
+    const auto& entry = m_entries[i];
+    auto& e = index[i];
+
+    e.payload_offset = e.payload_size = 0;
+    e.location_hash = 0;
+    if(entry.payload_path.empty()) continue;
+
+    e.location_hash = util::hash(entry.payload_path.data(), entry.payload_path.size());
+
+    auto f = os::File::alloc();
+    f().open(entry.payload_path.data(), os::File::Read, os::File::ShareRead, os::File::OpenExisting);
+
+    offset = align_offset(offset, PackPayloadAlign);
+
+    e.payload_offset = offset;
+    e.payload_size = f().size();
+
+    offset += e.payload_size;
+  }
+
+  PackHeader header;
+  header.magic = PackHeader::Magic;
+  header.version = PackHeader::Version;
+  header.num_entries = index.size();
+  header.index_offset = sizeof(PackHeader);
+  header.size = offset;
+
+  // ...and write it out
+  file.write(&header, sizeof(PackHeader));
+  file.write(index.data(), index.size()*sizeof(PackEntry));
+
+  offset = sizeof(PackHeader) + index.size()*sizeof(PackEntry);
+  for(const auto& entry : m_entries) {
+    file.write(entry.meta.data(), entry.meta.size());
+
+    offset += entry.meta.size();
+  }
+
+  for(const auto& entry : m_entries) {
+    file.write(entry.source_path.data(), entry.source_path.size());
+
+    offset += entry.source_path.size();
+  }
+
+  for(size_t i = 0; i < m_entries.size(); i++) {
+    const auto& e = index[i];
+    if(!e.payload_size) continue;
+
+    write_padding(file, offset, e.payload_offset);
+
+    auto f = os::File::alloc();
+    f().open(m_entries[i].payload_path.data(), os::File::Read, os::File::ShareRead, os::File::OpenExisting);
+
+    auto view = f().map(os::File::ProtectRead);
+    file.write(view->get(), e.payload_size);
+
+    offset = e.payload_offset + e.payload_size;
+  }
+}
+
+}
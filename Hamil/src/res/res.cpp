@@ -2,11 +2,14 @@
 #include <res/manager.h>
 #include <res/cache.h>
 #include <res/loader.h>
+#include <res/pack.h>
 #include <res/resource.h>
 #include <res/text.h>
 #include <res/shader.h>
 
 #include <win32/file.h>
+#include <os/file.h>
+#include <os/error.h>
 #include <util/staticstring.h>
 
 #include <config>
@@ -18,11 +21,43 @@ namespace res {
 
 ResourceManager::Ptr p_manager;
 
+static const char *p_resource_pack = __PROJECT_DIR "/resources.pack";
+
+static bool resource_pack_present()
+{
+  try {
+    auto f = os::File::alloc();
+    f().open(p_resource_pack, os::File::Read, os::File::ShareRead, os::File::OpenExisting);
+  } catch(const os::Error&) {
+    return false;
+  }
+
+  return true;
+}
+
 void init()
 {
-  p_manager = ResourceManager::Ptr(new ResourceManager(
-    { new SimpleFsLoader(__PROJECT_DIR), }
-  ));
+  // Prefer the resource pack when one was built (see the
+  //   '--resource-pack' command line option), as it doesn't
+  //   require enumerating all the assets during startup
+  //  - The SimpleFsLoader is kept (with a lower priority) to load
+  //    the resources the pack is missing or (in debug builds, which
+  //    check the sources for edits) has stale copies of, and only
+  //    enumerates the assets once that happens
+  if(resource_pack_present()) {
+#if !defined(NDEBUG)
+    const char *pack_source_path = __PROJECT_DIR;
+#else
+    const char *pack_source_path = nullptr;
+#endif
+
+    p_manager = ResourceManager::Ptr(new ResourceManager({
+      new SimpleFsLoader(__PROJECT_DIR, SimpleFsLoader::EnumOnDemand),
+      new PackLoader(p_resource_pack, pack_source_path),
+    }));
+  } else {
+    p_manager = ResourceManager::Ptr(new ResourceManager({ new SimpleFsLoader(__PROJECT_DIR) }));
+  }
 }
 
 void finalize()
@@ -12,4 +12,8 @@ bool Resource::Compare::operator()(const Resource::Ptr& a, const Resource::Ptr&
   return a->getTag() == b->getTag() && a->name() == b->name() && a->path() == b->path();
 }
 
-}
\ No newline at end of file
+size_t Resource::residentSize() const
+{
+  return sizeof(Resource) + m_name.capacity() + m_path.capacity();
+}
+}
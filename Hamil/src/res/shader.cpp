@@ -3,6 +3,7 @@
 #include <yaml/document.h>
 #include <yaml/node.h>
 #include <util/format.h>
+#include <os/mutex.h>
 
 #include <unordered_map>
 #include <unordered_set>
@@ -13,12 +14,23 @@
 
 namespace res {
 
+// Shaders can be loaded by the ResourceManager's streaming
+//   workers and the main thread at the same time, so all
+//   access to the library is guarded by 'm_mutex'
 class pShaderLibrary {
 public:
   using ImportSet = std::unordered_set<std::string>;
 
+  pShaderLibrary() :
+    m_mutex(os::Mutex::alloc())
+  { }
+
+  // The returned pointer stays valid, as exported
+  //   sources are never overwritten
   const char *get(const std::string& name) const
   {
+    auto guard = m_mutex->acquireScoped();
+
     auto it = m_library.find(name);
     return it != m_library.end() ? it->second.data() : nullptr;
   }
@@ -26,12 +38,31 @@ public:
   // Returns 'true' when 'name' was never exported before
   bool exportSource(const std::string& name, std::string shader)
   {
+    auto guard = m_mutex->acquireScoped();
+
     auto result = m_library.emplace(name, std::move(shader));
 
     return result.second;
   }
 
   void addImports(const std::string& name, const std::string& shader)
+  {
+    auto guard = m_mutex->acquireScoped();
+
+    doAddImports(name, shader);
+  }
+
+  // Returns a copy, as the set can be modified
+  //   by other threads once the lock is released
+  ImportSet getImports(const std::string& shader)
+  {
+    auto guard = m_mutex->acquireScoped();
+
+    return m_imports[shader];
+  }
+
+private:
+  void doAddImports(const std::string& name, const std::string& shader)
   {
     auto& imports = m_imports[name];
     auto import_result = imports.emplace(shader);
@@ -43,16 +74,12 @@ public:
     if(shader_imports_it == m_imports.end()) return;
 
     for(auto& shader_import : shader_imports_it->second) {
-      addImports(name, shader_import);  // Recursively import
+      doAddImports(name, shader_import);  // Recursively import
     }
   }
 
-  const ImportSet& getImports(const std::string& shader)
-  {
-    return m_imports[shader];
-  }
+  os::Mutex::Ptr m_mutex;
 
-private:
   // Stores concatenated inline (non-imported) sources
   //   whose parent stage is marked as !export
   std::unordered_map<std::string, std::string> m_library;
@@ -107,7 +134,7 @@ Shader& Shader::doStage(const yaml::Document& doc, Stage stage_id, const char *s
     if(!(src->tag() == ImportSource)) continue;
 
     auto import_name = src->as<yaml::Scalar>()->str();
-    const auto& imports_imports = p_library.getImports(import_name);
+    auto imports_imports = p_library.getImports(import_name);
 
     // Import the requested source
     imports.emplace(import_name);
@@ -159,4 +186,11 @@ const std::vector<const char *>& Shader::source(Stage stage) const
   return m_sources[stage];
 }
 
-}
\ No newline at end of file
+size_t Shader::residentSize() const
+{
+  size_t sz = Resource::residentSize();
+  for(const auto& src : m_inline) sz += src.size();
+
+  return sz;
+}
+}
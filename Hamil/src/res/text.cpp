@@ -30,7 +30,19 @@ Resource::Ptr Text::from_file(const char *buf, size_t sz,
   return Resource::Ptr(text);
 }
 
-const std::string_view& Text::str() const
+Resource::Ptr Text::from_buffer(IOBuffer buf, Id id,
+  const std::string& name, const std::string& path)
+{
+  auto text = new Text(id, Text::tag(), name, File, path);
+
+  text->m_data = std::move(buf);
+  text->m_str = std::string_view(text->m_data.get<const char>(), text->m_data.size());
+  text->m_loaded = true;
+
+  return Resource::Ptr(text);
+}
+
+std::string_view Text::str() const
 {
   return m_str;
 }
@@ -49,4 +61,13 @@ void Text::fillBuffer(const char *buf, size_t sz)
   m_buf[sz] = '\0'; // just to be safe...
 }
 
-}
\ No newline at end of file
+size_t Text::residentSize() const
+{
+  // Static Texts only reference the memory they were created from,
+  //   while from_buffer() ones usually view a mapped file
+  size_t sz = m_buf ? m_str.size() : m_data.ownedSize();
+
+  return Resource::residentSize() + sz;
+}
+
+}
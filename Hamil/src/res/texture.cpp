@@ -17,9 +17,38 @@ Resource::Ptr Texture::from_yaml(IOBuffer& image,
   return Resource::Ptr(self);
 }
 
+Resource::Ptr Texture::from_yaml(sched::WorkerPool& workers, IOBuffer& image,
+  const yaml::Document& doc, Id id,
+  const std::string& name, const std::string& path)
+{
+  auto self = new Texture(id, Texture::tag(), name, File, path);
+
+  self->m_tex.load(workers, image.get(), image.size(), util::DDSImage::FlipV);
+  self->m_loaded = true;
+
+  return Resource::Ptr(self);
+}
+
 const util::DDSImage& Texture::get() const
 {
   return m_tex;
 }
 
-}
\ No newline at end of file
+size_t Texture::residentSize() const
+{
+  size_t sz = Resource::residentSize();
+  if(!loaded()) return sz;
+
+  auto num_levels = m_tex.maxLevel() + 1;
+  m_tex.eachLayer([&](const util::DDSImage::MipChain& chain) {
+    for(uint level = 0; level < num_levels; level++) {
+      const auto& img = chain.at(level);
+
+      // The data could've been released via DDSImage::releaseData()
+      if(img.data) sz += img.sz;
+    }
+  });
+
+  return sz;
+}
+}
@@ -49,7 +49,7 @@ public:
   // Workers sleep() on this while the 'job_queue' is empty
   os::ConditionVariable::Ptr cv;
 
-  FreeListAllocator jobs_alloc;
+  TLSFAllocator jobs_alloc;
   std::vector<IJob *> jobs;  // Job pool
 
   // - Scheduler does push_back()
@@ -118,7 +118,7 @@ WorkerPool::JobId WorkerPool::scheduleJob(IJob *job)
   if(id == jobs.size()) {
     jobs.push_back(job);
   } else {
-    assert(id != (JobId)FreeListAllocator::Error && "Too many jobs in pool!");
+    assert(id != (JobId)TLSFAllocator::Error && "Too many jobs in pool!");
     assert(jobs.at(id) == nullptr && "Issued a JobId already in use!");
 
     jobs.at(id) = job;
@@ -224,7 +224,9 @@ WorkerPool& WorkerPool::kickWorkers(const char *name)
       thread = (i % num_cores)*2ull | thread_group;
     }
 
-    worker->affinity(1ull << thread);
+    // There can be more workers than HW threads (e.g. the
+    //   ResourceManager's MinIOWorkers), so wrap around
+    worker->affinity(1ull << (thread % num_cores));
 #endif
   }
 
@@ -19,6 +19,8 @@ bool ButtonFrame::input(CursorDriver& cursor, const InputPtr& input)
   if(m_state == Default) {
     m_state = Hover;
     ui().capture(this);
+
+    markDirty();
   }
 
   auto mouse = input->get<os::Mouse>();
@@ -28,9 +30,12 @@ bool ButtonFrame::input(CursorDriver& cursor, const InputPtr& input)
   if(mouse->buttonDown(Mouse::Left)) {
     m_state = Pressed;
     ui().keyboard(nullptr);
+
+    markDirty();
   } else if(m_state == Pressed && mouse->buttonUp(Mouse::Left)) {
     if(mouse_over) {
       m_state = Hover;
+      markDirty();
 
       emitClicked();
     } else {
@@ -44,6 +49,8 @@ bool ButtonFrame::input(CursorDriver& cursor, const InputPtr& input)
 void ButtonFrame::losingCapture()
 {
   m_state = Default;
+
+  markDirty();
 }
 
 void ButtonFrame::captionPaint(const Drawable& caption, VertexPainter& painter,
@@ -105,6 +112,7 @@ void PushButtonFrame::paint(VertexPainter& painter, Geometry parent)
 PushButtonFrame& PushButtonFrame::caption(std::string caption)
 {
   m_caption = ui().drawable().fromText(ownStyle().font, caption, white());
+  markDirty();
 
   return *this;
 }
@@ -144,6 +152,7 @@ void ToggleButtonFrame::paint(VertexPainter& painter, Geometry parent)
 ToggleButtonFrame& ToggleButtonFrame::caption(std::string caption)
 {
   m_caption = ui().drawable().fromText(ownStyle().font, caption, white());
+  markDirty();
 
   return *this;
 }
@@ -151,6 +160,7 @@ ToggleButtonFrame& ToggleButtonFrame::caption(std::string caption)
 ToggleButtonFrame& ToggleButtonFrame::value(bool value)
 {
   m_value = value;
+  markDirty();
 
   return *this;
 }
@@ -185,6 +195,7 @@ Geometry ToggleButtonFrame::getSolidGeometry() const
 void ToggleButtonFrame::emitClicked()
 {
   m_value = !m_value;
+  markDirty();
 
   m_on_click.emit(this);
 }
@@ -242,6 +253,7 @@ void CheckBoxFrame::paint(VertexPainter& painter, Geometry parent)
 CheckBoxFrame& CheckBoxFrame::value(bool value)
 {
   m_value = value;
+  markDirty();
 
   return *this;
 }
@@ -281,6 +293,7 @@ Geometry CheckBoxFrame::getSolidGeometry() const
 void CheckBoxFrame::emitClicked()
 {
   m_value = !m_value;
+  markDirty();
 
   m_on_click.emit(this);
 }
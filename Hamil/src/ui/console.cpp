@@ -131,7 +131,12 @@ void ConsoleFrame::paint(VertexPainter& painter, Geometry parent)
     isDropped() ? y : (-ConsoleSize.y - y)
   });
 
-  if(m_dropdown.done()) m_dropped &= ~Transitioning;
+  // Keep repainting until the animation is done
+  if(m_dropdown.done()) {
+    m_dropped &= ~Transitioning;
+  } else {
+    markDirty();
+  }
 
   m_console->paint(painter, geometry());
 }
@@ -158,6 +163,8 @@ ConsoleFrame& ConsoleFrame::dropped(bool val)
   m_dropped = (val ? Dropped : Hidden) | Transitioning;
   m_dropdown.start();
 
+  markDirty();
+
   return *this;
 }
 
@@ -267,6 +274,8 @@ bool ConsoleBufferFrame::input(CursorDriver& cursor, const InputPtr& input)
     } else {
       if(m_scroll > 0) m_scroll += direction;
     }
+
+    markDirty();
   }
 
   return true;
@@ -339,6 +348,8 @@ void ConsoleBufferFrame::print(const std::string& str)
 
   m_history = CursorNotSet;
   m_scroll = 0;
+
+  markDirty();
 }
 
 void ConsoleBufferFrame::input(const std::string& str)
@@ -356,6 +367,8 @@ void ConsoleBufferFrame::clear()
   m_input.clear();
   m_history = CursorNotSet;
   m_scroll = 0;
+
+  markDirty();
 }
 
 std::string ConsoleBufferFrame::historyPrevious()
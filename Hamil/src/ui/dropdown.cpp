@@ -20,6 +20,8 @@ bool DropDownFrame::input(CursorDriver& cursor, const InputPtr& input)
   if(m_state == Default) {
     m_state = Hover;
     ui().capture(this);
+
+    markDirty();
   }
 
   auto mouse = input->get<os::Mouse>();
@@ -34,6 +36,8 @@ bool DropDownFrame::input(CursorDriver& cursor, const InputPtr& input)
     if(mouse_over && (mouse->buttons & Mouse::Left)) {
       m_state = Pressed;
       ui().keyboard(nullptr);
+
+      markDirty();
     } else {
       ui().capture(nullptr);
     }
@@ -42,8 +46,10 @@ bool DropDownFrame::input(CursorDriver& cursor, const InputPtr& input)
       m_state = Hover;
 
       m_dropped = !m_dropped;
+      markDirty();
     } else if(m_dropped) {
       m_state = mouse_over ? Hover : Default;
+      markDirty();
     } else {
       ui().capture(nullptr);
     }
@@ -135,6 +141,7 @@ DropDownFrame& DropDownFrame::item(DropDownItem item)
   if(item.id == DropDownItem::Invalid) item.id = (DropDownItem::Id)m_items.size();
 
   m_items.push_back(std::move(item));
+  markDirty();
 
   return *this;
 }
@@ -147,6 +154,8 @@ DropDownFrame& DropDownFrame::selected(DropDownItem::Id id)
 
   m_selected = it != m_items.end() ? &(*it) : nullptr;
   m_highlighted = m_selected ? m_selected->id : DropDownItem::Invalid;
+  markDirty();
+
   m_on_change.emit(this);
 
   return *this;
@@ -173,6 +182,8 @@ void DropDownFrame::losingCapture()
 {
   m_state = Default;
   m_dropped = false;
+
+  markDirty();
 }
 
 vec2 DropDownFrame::sizeHint() const
@@ -216,18 +227,25 @@ bool DropDownFrame::inputDropped(vec2 mouse_pos, os::Mouse *mouse)
 
     if(!item_g.intersect(mouse_pos)) continue;
 
+    if(item.id != m_highlighted) markDirty();
+
     m_highlighted = item.id;
     if(mouse->buttonDown(Mouse::Left)) {
       return true;
     } else if(mouse->buttonUp(Mouse::Left)) {
       m_selected = &item;
+      markDirty();
+
       m_on_change.emit(this);
-      
+
       return m_dropped = false;;
     }
     break;
   }
-  if(i == m_items.size()) m_highlighted = DropDownItem::Invalid;
+  if(i == m_items.size() && m_highlighted != DropDownItem::Invalid) {
+    m_highlighted = DropDownItem::Invalid;
+    markDirty();
+  }
 
   return i != m_items.size();
 }
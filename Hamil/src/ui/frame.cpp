@@ -5,7 +5,8 @@ namespace ui {
 
 Frame::Frame(Ui &ui, const char *name, Geometry geom) :
   m_ui(&ui), m_parent(nullptr),
-  m_name(name), m_gravity(Center), m_geom(geom), m_pad({ 0.0f, 0.0f })
+  m_name(name), m_gravity(Center), m_geom(geom), m_pad({ 0.0f, 0.0f }),
+  m_dirty(true)
 {
   m_ui->registerFrame(this);
 }
@@ -36,11 +37,17 @@ bool Frame::input(CursorDriver& cursor, const InputPtr& input)
 
 Frame& Frame::geometry(Geometry g)
 {
-  m_geom = {
+  Geometry geom = {
     g.pos().floor(),
     g.size().ceil()
   };
 
+  // Layouts set their children's geometry() while painting,
+  //   so only mark the Frame dirty when it actually changes
+  if(geom != m_geom) markDirty();
+
+  m_geom = geom;
+
   return *this;
 }
 
@@ -51,6 +58,8 @@ Geometry Frame::geometry() const
 
 Frame& Frame::gravity(Gravity gravity)
 {
+  if(gravity != m_gravity) markDirty();
+
   m_gravity = gravity;
 
   return *this;
@@ -78,6 +87,8 @@ void Frame::losingCapture()
 void Frame::attached(Frame *parent)
 {
   m_parent = parent;
+
+  markDirty();
 }
 
 vec2 Frame::sizeHint() const
@@ -142,6 +153,8 @@ vec2 Frame::positionRelative() const
 
 Frame& Frame::position(vec2 pos)
 {
+  if(pos != m_geom.pos()) markDirty();
+
   m_geom.x = pos.x;
   m_geom.y = pos.y;
 
@@ -161,6 +174,8 @@ vec2 Frame::size() const
 
 Frame& Frame::size(vec2 sz)
 {
+  if(sz != m_geom.size()) markDirty();
+
   m_geom.w = sz.x;
   m_geom.h = sz.y;
 
@@ -174,6 +189,8 @@ vec2 Frame::padding() const
 
 Frame& Frame::padding(vec2 pad)
 {
+  if(pad != m_pad) markDirty();
+
   m_pad = pad;
 
   return *this;
@@ -183,4 +200,20 @@ void Frame::paint(VertexPainter& painter, Geometry parent)
 {
 }
 
+void Frame::markDirty()
+{
+  Frame *top_level = this;
+  while(top_level->m_parent) top_level = top_level->m_parent;
+
+  m_ui->markDirty(top_level);
+}
+
+bool Frame::dirty() const
+{
+  const Frame *top_level = this;
+  while(top_level->m_parent) top_level = top_level->m_parent;
+
+  return top_level->m_dirty;
+}
+
 }
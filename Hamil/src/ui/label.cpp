@@ -51,6 +51,7 @@ void LabelFrame::paint(VertexPainter& painter, Geometry parent)
 LabelFrame& LabelFrame::caption(const std::string& caption)
 {
   m_caption = ui().drawable().fromText(ownFont(), caption, m_color);
+  markDirty();
 
   return *this;
 }
@@ -58,6 +59,7 @@ LabelFrame& LabelFrame::caption(const std::string& caption)
 LabelFrame& LabelFrame::drawable(const Drawable& img)
 {
   m_caption = img;
+  markDirty();
 
   return *this;
 }
@@ -65,6 +67,7 @@ LabelFrame& LabelFrame::drawable(const Drawable& img)
 LabelFrame& LabelFrame::font(const ft::Font::Ptr& font)
 {
   m_font = font;
+  markDirty();
 
   return *this;
 }
@@ -72,6 +75,7 @@ LabelFrame& LabelFrame::font(const ft::Font::Ptr& font)
 LabelFrame& LabelFrame::color(Color c)
 {
   m_color = c;
+  markDirty();
 
   return *this;
 }
@@ -79,6 +83,7 @@ LabelFrame& LabelFrame::color(Color c)
 LabelFrame& LabelFrame::background(Color bg)
 {
   m_bg = bg;
+  markDirty();
 
   return *this;
 }
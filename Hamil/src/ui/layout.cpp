@@ -50,6 +50,8 @@ void LayoutFrame::paint(VertexPainter& painter, Geometry parent)
 LayoutFrame& LayoutFrame::dbg_DrawBBoxes(bool enabled)
 {
   m_dbg_bboxes = enabled;
+  markDirty();
+
   return *this;
 }
 
@@ -37,6 +37,7 @@ VertexPainter::VertexPainter(gx::ResourcePool& pool) :
   m_overlay(false),
   m_pool(pool),
   m_vtx_id(gx::ResourcePool::Invalid),
+  m_buf_first(0), m_ind_first(0),
   m_buf(nullptr), m_buf_rover(nullptr), m_buf_end(nullptr),
   m_ind(nullptr), m_ind_rover(nullptr), m_ind_end(nullptr),
   m_current_pipeline(nullptr)
@@ -71,15 +72,50 @@ gx::Pipeline VertexPainter::defaultPipeline(ivec4 scissor)
 
 VertexPainter& VertexPainter::begin(Vertex *verts, size_t num_verts, u16 *inds, size_t num_inds)
 {
+  return begin(Mark(), verts, num_verts, inds, num_inds);
+}
+
+VertexPainter& VertexPainter::begin(const Mark& from, Vertex *verts, size_t num_verts, u16 *inds, size_t num_inds)
+{
+  assert(from.num_commands <= m_commands.size() && from.num_overlay_commands <= m_overlay_commands.size()
+    && "attempted to resume painting from a stale Mark!");
+
+  m_buf_first = from.base;
+  m_ind_first = from.offset;
+
   m_buf = m_buf_rover = verts;
   m_ind = m_ind_rover = inds;
 
   m_buf_end = m_buf + num_verts;
   m_ind_end = m_ind + num_inds;
 
+  m_commands.resize(from.num_commands);
+  m_overlay_commands.resize(from.num_overlay_commands);
+
+  m_merge_floor = from.num_commands;
+  m_overlay_merge_floor = from.num_overlay_commands;
+
+  m_current_pipeline = from.pipeline;
+  m_overlay = false;
+
   return *this;
 }
 
+VertexPainter::Mark VertexPainter::mark()
+{
+  m_merge_floor = m_commands.size();
+  m_overlay_merge_floor = m_overlay_commands.size();
+
+  Mark m;
+  m.base = currentBase();
+  m.offset = currentOffset();
+  m.num_commands = m_commands.size();
+  m.num_overlay_commands = m_overlay_commands.size();
+  m.pipeline = m_current_pipeline;
+
+  return m;
+}
+
 VertexPainter& VertexPainter::line(vec2 a, vec2 b, float width, LineCap cap, float cap_r, Color ca, Color cb)
 {
   if(b.x < a.x) {
@@ -566,15 +602,12 @@ VertexPainter& VertexPainter::triangle(vec2 pos, float h, float angle, Color col
 
 ft::String VertexPainter::appendTextVertices(ft::Font& font, const std::string& str)
 {
-  auto base = currentBase();
-  auto offset = currentOffset();
-
-  Vertex *ptr = m_buf + base;
+  Vertex *ptr = m_buf_rover;
 
   StridePtr<ft::Position> pos_ptr(&ptr->pos, sizeof(Vertex));
   StridePtr<ft::UV> uv_ptr(&ptr->uv, sizeof(Vertex));
 
-  auto s = font.writeVertsAndIndices(str.data(), pos_ptr, uv_ptr, m_ind+offset);
+  auto s = font.writeVertsAndIndices(str.data(), pos_ptr, uv_ptr, m_ind_rover);
 
   unsigned num = s.num();
 
@@ -868,21 +901,25 @@ void VertexPainter::end()
 {
   endOverlay();
 
+  m_buf_first = m_ind_first = 0;
+
   m_buf = m_buf_rover = m_buf_end = nullptr;
   m_ind = m_ind_rover = m_ind_end = nullptr;
 
   m_commands.clear();
   m_overlay_commands.clear();
+
+  m_merge_floor = m_overlay_merge_floor = 0;
 }
 
 size_t VertexPainter::currentBase() const
 {
-  return m_buf_rover - m_buf;
+  return m_buf_first + (m_buf_rover - m_buf);
 }
 
 size_t VertexPainter::currentOffset() const
 {
-  return m_ind_rover - m_ind;
+  return m_ind_first + (m_ind_rover - m_ind);
 }
 
 void VertexPainter::appendVertices(std::initializer_list<Vertex> verts)
@@ -915,13 +952,13 @@ void VertexPainter::restartPrimitive()
 void VertexPainter::appendCommand(const Command& c)
 {
   if(m_overlay) {
-    doAppendCommand(c, m_overlay_commands);
+    doAppendCommand(c, m_overlay_commands, m_overlay_merge_floor);
   } else {
-    doAppendCommand(c, m_commands);
+    doAppendCommand(c, m_commands, m_merge_floor);
   }
 }
 
-void VertexPainter::doAppendCommand(const Command& c, std::vector<Command>& commands)
+void VertexPainter::doAppendCommand(const Command& c, std::vector<Command>& commands, size_t merge_floor)
 {
   if(commands.empty()) {
     commands.push_back(c);
@@ -943,7 +980,7 @@ void VertexPainter::doAppendCommand(const Command& c, std::vector<Command>& comm
   }
 
   // Try to merge command with previous if possible
-  if(c.type == Primitive && last.type == c.type) {
+  if(c.type == Primitive && last.type == c.type && commands.size() > merge_floor) {
     auto& c_data = c.d;
     auto& last_data = last.d;
 
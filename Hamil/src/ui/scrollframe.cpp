@@ -53,6 +53,7 @@ void ScrollFrame::paint(VertexPainter& painter, Geometry parent)
 ScrollFrame& ScrollFrame::scrollbars(uint sb)
 {
   m_scrollbars = sb;
+  markDirty();
 
   return *this;
 }
@@ -16,7 +16,12 @@ bool SliderFrame::input(CursorDriver& cursor, const InputPtr& input)
 
   bool over_head = headPos().distance(cursor.pos()) < ownStyle().slider.width*1.05f;
 
-  if(m_state != Pressed) m_state = over_head ? Hover : Default;
+  if(m_state != Pressed) {
+    auto state = over_head ? Hover : Default;
+    if(state != m_state) markDirty();
+
+    m_state = state;
+  }
 
   auto mouse = input->get<os::Mouse>();
   if(!mouse) return false;
@@ -26,6 +31,8 @@ bool SliderFrame::input(CursorDriver& cursor, const InputPtr& input)
     m_state = Pressed;
     ui().capture(this);
     ui().keyboard(nullptr);
+
+    markDirty();
   } else if(mouse->buttonUp(Mouse::Left)) {
     if(mouse_inside) {
       m_state = Hover;
@@ -33,10 +40,14 @@ bool SliderFrame::input(CursorDriver& cursor, const InputPtr& input)
       m_state = Default;
       ui().capture(nullptr);
     }
+
+    markDirty();
   } 
   
   if(m_state == Pressed && mouse->buttons & Mouse::Left) {
     m_value = clickedValue(cursor.pos() + vec2{ mouse->dx, mouse->dy });
+    markDirty();
+
     m_on_change.emit(this);
 
     return true;
@@ -48,12 +59,15 @@ bool SliderFrame::input(CursorDriver& cursor, const InputPtr& input)
 void SliderFrame::losingCapture()
 {
   m_state = Default;
+
+  markDirty();
 }
 
 SliderFrame& SliderFrame::range(double min, double max)
 {
   m_min = min; m_max = max;
   m_value = (max+min)/2.0;
+  markDirty();
 
   return *this;
 }
@@ -68,6 +82,8 @@ SliderFrame& SliderFrame::step(double step)
 SliderFrame& SliderFrame::value(double value)
 {
   m_value = clampedValue(value);
+  markDirty();
+
   m_on_change.emit(this);
 
   return *this;
@@ -55,8 +55,10 @@ Style Style::basic_style()
 
 void Style::init(gx::ResourcePool& pool)
 {
-  font.reset(new ft::Font(font_style.font.family, font_style.font.height, &pool));
-  monospace.reset(new ft::Font(font_style.monospace.family, font_style.monospace.height, &pool));
+  font_cache = std::make_shared<ft::FontCache>(pool);
+
+  font.reset(new ft::Font(font_style.font.family, font_style.font.height, font_cache));
+  monospace.reset(new ft::Font(font_style.monospace.family, font_style.monospace.height, font_cache));
 }
 
 }
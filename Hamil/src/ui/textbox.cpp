@@ -53,6 +53,7 @@ bool TextBoxFrame::input(CursorDriver& cursor, const InputPtr& input)
       default: return mouseGesture(pos);
       }
 
+      markDirty();
       return true;
     } else {
       // The TextBoxFrame should remain editable after
@@ -64,6 +65,7 @@ bool TextBoxFrame::input(CursorDriver& cursor, const InputPtr& input)
         m_state = Default;
 
         ui().keyboard(nullptr);
+        markDirty();
         return false;
       }
     }
@@ -72,6 +74,8 @@ bool TextBoxFrame::input(CursorDriver& cursor, const InputPtr& input)
     if(m_state != Editing || kb->event != os::Keyboard::KeyDown) return false;
 
     cursor.visible(!mouse_over);
+    markDirty();
+
     return keyboardDown(cursor, kb);
   }
 
@@ -90,7 +94,12 @@ void TextBoxFrame::paint(VertexPainter& painter, Geometry parent)
   Color cursor_color = textbox.cursor;
   auto cursor_alpha = m_cursor_blink.channel<float>(0);
   switch(m_state) {
-  case Editing: cursor_color = cursor_color.opacity(cursor_alpha); break;
+  case Editing:
+    cursor_color = cursor_color.opacity(cursor_alpha);
+
+    // Keep repainting for as long as the cursor is blinking
+    markDirty();
+    break;
   }
 
   Color border_color = textbox.border_color[0];
@@ -151,6 +160,8 @@ void TextBoxFrame::paint(VertexPainter& painter, Geometry parent)
 void TextBoxFrame::losingCapture()
 {
   m_state = Default;
+
+  markDirty();
 }
 
 void TextBoxFrame::attached(Frame *parent)
@@ -168,6 +179,8 @@ const ft::Font::Ptr& TextBoxFrame::font() const
 TextBoxFrame& TextBoxFrame::font(const ft::Font::Ptr& font)
 {
   m_font = font;
+  markDirty();
+
   return *this;
 }
 
@@ -181,6 +194,7 @@ TextBoxFrame& TextBoxFrame::text(const std::string& s)
   m_text = s;
   m_cursor = m_text.size();
   m_selection.reset();
+  markDirty();
 
   return *this;
 }
@@ -193,6 +207,7 @@ const std::string& TextBoxFrame::hint() const
 TextBoxFrame& TextBoxFrame::hint(const std::string& s)
 {
   m_hint = s;
+  markDirty();
 
   return *this;
 }
@@ -418,6 +433,8 @@ SelectionRange TextBoxFrame::selectWord(vec2 pos) const
 void TextBoxFrame::cursor(size_t x)
 {
   m_cursor = clamp(x, (size_t)0, m_text.size());
+
+  markDirty();
 }
 
 bool TextBoxFrame::doDeleteSelection()
@@ -465,6 +482,8 @@ void TextBoxFrame::selection(size_t first, size_t last)
   };
   
   m_cursor = m_selection.last;
+
+  markDirty();
 }
 
 }
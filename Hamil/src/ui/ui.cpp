@@ -151,6 +151,7 @@ Ui::Ui(gx::ResourcePool& pool, Geometry geom, const Style& style) :
   m_renderpass_id(gx::ResourcePool::Invalid),
   m_drawable(m_pool),
   m_painter(m_pool),
+  m_repaint(true),
   m_buf(gx::Buffer::Dynamic),
   m_ind(gx::Buffer::Dynamic, gx::Type::u16),
   m_vtx_id(gx::ResourcePool::Invalid)
@@ -237,6 +238,13 @@ ivec4 Ui::scissorRect(Geometry g)
 
 Ui& Ui::realSize(vec2 real_size)
 {
+  // The scissor rects painted into the Commands depend
+  //   on 'm_real_size', so everything must be repainted
+  if(real_size != m_real_size) {
+    m_painted.clear();
+    m_repaint = true;
+  }
+
   m_real_size = real_size;
   return *this;
 }
@@ -335,8 +343,13 @@ bool Ui::input(CursorDriver& cursor, const InputPtr& input)
     // After the user interacts with a top-level Frame
     //   bring it to the front (i.e. draw it on top of
     //   everything else and pass input to it first)
-    m_frames.erase(it);
-    m_frames.push_back(frame);
+    if(frame != m_frames.back()) {
+      m_frames.erase(it);
+      m_frames.push_back(frame);
+
+      m_repaint = true;
+    }
+
     return true;
   }
 
@@ -350,23 +363,47 @@ gx::CommandBuffer Ui::paint()
   // Have to wait for the previous paint to complete
   m_pool.get<gx::Fence>(m_fence_id).block();
 
-  // Make sure the MemoryPool is clean (previous paint()
-  //   leaves behind data)
-  m_mempool.purge();
+  auto fence_wait = m_drawable.prepareDraw();
 
-  auto& renderpass = m_pool.get<gx::RenderPass>(m_renderpass_id);
-  auto command_buf = gx::CommandBuffer::begin()
-    .bindResourcePool(&m_pool)
-    .bindMemoryPool(&m_mempool);
+  auto repainted = m_repaint && repaintFrames();
+  m_repaint = false;
+
+  // Nothing changed since the previous paint() so the same
+  //   gx::CommandBuffer (along with the data it references
+  //   in 'm_mempool') can be executed again
+  if(!repainted && !fence_wait && m_command_buf) return *m_command_buf;
 
-  if(m_drawable.prepareDraw()) {
-    command_buf.fenceWait(m_drawable.fenceId());
+  auto command_buf = recordCommands(fence_wait);
+
+  // A gx::CommandBuffer which waits on the DrawableManager's
+  //   fence can't be reused as the fence won't be signaled again
+  if(!fence_wait) {
+    m_command_buf = command_buf;
+  } else {
+    m_command_buf.reset();
+  }
+
+  return command_buf;
+}
+
+bool Ui::repaintFrames()
+{
+  size_t first = 0;
+  auto it = m_frames.begin();
+
+  // Find the first top-level Frame which needs to be repainted
+  for(; it != m_frames.end(); it++, first++) {
+    auto frame = *it;
+    if(first >= m_painted.size() || m_painted[first].frame != frame || frame->m_dirty) break;
   }
 
-  if(m_repaint || true) {     // TODO: intelligently decide on this somehow?
-    // Same as above - clean up after previous paint()
-    m_painter.end();
+  if(it == m_frames.end() && first == m_painted.size()) return false;
 
+  // All the Frames before 'first' are unchanged so painting
+  //   resumes right after them (or from scratch when first == 0)
+  VertexPainter::Mark from;
+  uint map_flags = gx::Buffer::MapUnsynchronized;
+  if(!first) {
     m_buf.init(sizeof(Vertex), VertexPainter::BufferSize);
     m_ind.init(sizeof(u16), VertexPainter::BufferSize);
 
@@ -376,21 +413,68 @@ gx::CommandBuffer Ui::paint()
     //   will take care of synchronization/storage lifetime
     // (Turns out - waiting for vsync with swapBuffers() does
     //   not guarantee the previous commands have executed)
-    auto map_flags = gx::Buffer::MapUnsynchronized | gx::Buffer::MapInvalidate;
+    map_flags |= gx::Buffer::MapInvalidate;
+  } else {
+    from = first < m_painted.size() ? m_painted[first].mark : m_painted_end;
+
+    // The vertices/indices of the Frames before 'first' are
+    //   reused, so only the range after them is overwritten
+    //   - The previous paint() has already completed (the
+    //     fence was waited on) so nothing reads it anymore
+    map_flags |= gx::Buffer::MapInvalidateRange;
+  }
+
+  auto num_verts = VertexPainter::BufferSize - from.base;
+  auto num_inds  = VertexPainter::BufferSize - from.offset;
 
-    auto verts = m_buf.map(gx::Buffer::Write, map_flags);
-    auto inds = m_ind.map(gx::Buffer::Write, map_flags);
+  auto verts = m_buf.map(gx::Buffer::Write,
+    (GLintptr)(from.base*sizeof(Vertex)), (GLint)(num_verts*sizeof(Vertex)), map_flags);
+  auto inds = m_ind.map(gx::Buffer::Write,
+    (GLintptr)(from.offset*sizeof(u16)), (GLint)(num_inds*sizeof(u16)), map_flags);
 
-    m_painter.begin(
-      verts.get<Vertex>(), VertexPainter::BufferSize,
-      inds.get<u16>(), VertexPainter::BufferSize);
+  m_painter.begin(from,
+    verts.get<Vertex>(), num_verts,
+    inds.get<u16>(), num_inds);
 
-    // Fill the vertex and index buffers
-    for(const auto& frame : m_frames) frame->paint(m_painter, m_geom);
+  // Fill the vertex and index buffers
+  m_painted.resize(first);
+  for(; it != m_frames.end(); it++) {
+    auto frame = *it;
+
+    m_painted.push_back({ frame, m_painter.mark() });
+
+    // Cleared before calling paint() so the Frame
+    //   can request another one from inside it
+    frame->m_dirty = false;
+    frame->paint(m_painter, m_geom);
   }
+  m_painted_end = m_painter.mark();
+
+  return true;
+}
+
+gx::CommandBuffer Ui::recordCommands(bool fence_wait)
+{
+  // Make sure the MemoryPool is clean (previous paint()
+  //   leaves behind data) and drop the subpasses added for the
+  //   previous gx::CommandBuffer, which won't be executed again
+  m_mempool.purge();
+
+  auto& renderpass = m_pool.get<gx::RenderPass>(m_renderpass_id);
+  renderpass.clearSubpasses();
+
+  auto command_buf = gx::CommandBuffer::begin()
+    .bindResourcePool(&m_pool)
+    .bindMemoryPool(&m_mempool);
+
+  if(fence_wait) command_buf.fenceWait(m_drawable.fenceId());
 
   auto projection = xform::ortho(0, 0, FramebufferSize.y, FramebufferSize.x, 0.0f, 1.0f);
 
+  // Shared by all the Primitive commands
+  auto projection_handle = m_mempool.alloc<mat4>();
+  *m_mempool.ptr<mat4>(projection_handle) = projection;
+
   command_buf
     .renderpass(m_renderpass_id)
     .program(m_program_id)
@@ -402,11 +486,6 @@ gx::CommandBuffer Ui::paint()
 
   m_painter.doCommands([&,this](VertexPainter::Command cmd)
   {
-    auto mvp_handle = m_mempool.alloc<mat4>();
-    auto& mvp = *m_mempool.ptr<mat4>(mvp_handle);
-
-    mvp = projection;
-
     auto prim = cmd.d.p;
     auto num = (u32)cmd.d.num;
     auto base = (u32)cmd.d.base;
@@ -417,7 +496,7 @@ gx::CommandBuffer Ui::paint()
     switch(cmd.type) {
     case VertexPainter::Primitive:
       command_buf
-        .uniformMatrix4x4(U.ui.uModelViewProjection, mvp_handle)
+        .uniformMatrix4x4(U.ui.uModelViewProjection, projection_handle)
         .uniformInt(U.ui.uType, Shader_TypeShape)
         .drawBaseVertex(prim, m_vtx_id, num, base, offset);
       break;
@@ -434,11 +513,11 @@ gx::CommandBuffer Ui::paint()
         last_font_id = font_id;
       }
 
+      auto mvp_handle = m_mempool.alloc<mat4>();
       auto color_handle = m_mempool.alloc<vec4>();
-      auto& color = *m_mempool.ptr<vec4>(color_handle);
 
-      color = cmd.d.color.normalize();
-      mvp = mvp * xform::translate(pos.x, pos.y, 0);
+      *m_mempool.ptr<mat4>(mvp_handle) = projection * xform::translate(pos.x, pos.y, 0);
+      *m_mempool.ptr<vec4>(color_handle) = cmd.d.color.normalize();
 
       command_buf
         .uniformMatrix4x4(U.ui.uModelViewProjection, mvp_handle)
@@ -448,8 +527,9 @@ gx::CommandBuffer Ui::paint()
       break;
     }
 
-    case VertexPainter::Image:
-      mvp = mvp * xform::translate(pos.x, pos.y, 0);
+    case VertexPainter::Image: {
+      auto mvp_handle = m_mempool.alloc<mat4>();
+      *m_mempool.ptr<mat4>(mvp_handle) = projection * xform::translate(pos.x, pos.y, 0);
 
       command_buf
         .uniformMatrix4x4(U.ui.uModelViewProjection, mvp_handle)
@@ -457,6 +537,7 @@ gx::CommandBuffer Ui::paint()
         .uniformFloat(U.ui.uImagePage, (float)cmd.d.page)
         .drawBaseVertex(prim, m_vtx_id, num, base, offset);
       break;
+    }
 
     case VertexPainter::Pipeline: {
       auto subpass_id = renderpass.nextSubpassId();
@@ -492,4 +573,10 @@ void Ui::keyboard(Frame *frame)
   m_keyboard = frame;
 }
 
+void Ui::markDirty(Frame *frame)
+{
+  frame->m_dirty = true;
+  m_repaint = true;
+}
+
 }
@@ -78,6 +78,16 @@ vec2 Geometry::centerRelative() const
   return center() - pos();
 }
 
+bool Geometry::operator==(const Geometry& other) const
+{
+  return x == other.x && y == other.y && w == other.w && h == other.h;
+}
+
+bool Geometry::operator!=(const Geometry& other) const
+{
+  return !(*this == other);
+}
+
 Color Color::darken(unsigned factor) const
 {
   auto f = [=](int v) -> byte
@@ -65,6 +65,7 @@ void WindowFrame::paint(VertexPainter& painter, Geometry parent)
 WindowFrame& WindowFrame::title(const std::string& title)
 {
   m_title = ui().drawable().fromText(ownStyle().font, title, white());
+  markDirty();
 
   return *this;
 }
@@ -72,6 +73,7 @@ WindowFrame& WindowFrame::title(const std::string& title)
 WindowFrame& WindowFrame::background(Color c)
 {
   m_bg = c;
+  markDirty();
 
   return *this;
 }
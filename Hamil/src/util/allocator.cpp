@@ -1,75 +1,299 @@
 #include <util/allocator.h>
 
+#include <config>
+
+#include <cassert>
 #include <algorithm>
 
-FreeListAllocator::FreeListAllocator(size_t sz) :
-  m_sz(sz), m_ptr(0)
+#if defined(_MSVC_VER)
+#  include <intrin.h>
+#endif
+
+// Returns the index of the most significant set bit of 'x'
+static unsigned find_msb(uint64_t x)
+{
+  unsigned long idx;
+#if __win32
+  _BitScanReverse64(&idx, x);
+#else
+  idx = 63 - __builtin_clzll(x);
+#endif
+
+  return (unsigned)idx;
+}
+
+// Returns the index of the least significant set bit of 'x'
+static unsigned find_lsb(uint64_t x)
 {
+  unsigned long idx;
+#if __win32
+  _BitScanForward64(&idx, x);
+#else
+  idx = __builtin_ctzll(x);
+#endif
+
+  return (unsigned)idx;
 }
 
-size_t FreeListAllocator::alloc(size_t sz)
+TLSFAllocator::TLSFAllocator(size_t sz) :
+  m_sz(sz)
 {
-  if(m_free_list.empty()) return allocAtEnd(sz);
+  m_sl_bitmaps.fill(0);
+  for(auto& fl : m_free_lists) fl.fill(NilBlock);
+
+  if(!sz) return;
+
+  // Keep 'm_block_starts' small for large ranges at the
+  //   cost of having to walk a few Blocks in findBlock()
+  while((sz >> m_start_shift) >= MaxStartBuckets) m_start_shift++;
 
-  for(auto iter = m_free_list.begin(); iter != m_free_list.end(); iter++) {
-    if(iter->second < sz) continue;
+  m_block_starts.assign((sz >> m_start_shift) + 1, NilBlock);
 
-    auto ret = iter->first,
-      leftover = iter->second-sz;
+  // The whole range starts out as a single free block
+  auto idx = newBlock();
+  auto& block = m_blocks[idx];
 
-    m_free_list.erase(iter);
-    if(leftover > 0) m_free_list.push_front({ ret+sz, leftover });
+  block.offset = 0;
+  block.sz = sz;
+
+  m_block_starts[0] = idx;
+
+  insertFreeBlock(idx);
+}
 
-    return ret;
+size_t TLSFAllocator::alloc(size_t sz)
+{
+  if(!sz) sz = 1;     // Keep all returned offsets unique
+
+  auto idx = findFreeBlock(sz);
+  if(idx == NilBlock) return Error;
+
+  removeFreeBlock(idx);
+
+  auto leftover = m_blocks[idx].sz - sz;
+  if(leftover > 0) {     // Split off the unused tail of the block
+    auto tail_idx = newBlock();   // Can invalidate references into 'm_blocks'
+
+    auto& block = m_blocks[idx];
+    auto& tail  = m_blocks[tail_idx];
+
+    tail.offset = block.offset + sz;
+    tail.sz = leftover;
+
+    blockStarted(tail_idx);
+
+    tail.prev_phys = idx;
+    tail.next_phys = block.next_phys;
+    if(block.next_phys != NilBlock) m_blocks[block.next_phys].prev_phys = tail_idx;
+
+    block.sz = sz;
+    block.next_phys = tail_idx;
+
+    insertFreeBlock(tail_idx);
   }
 
-  return allocAtEnd(sz);
+  return m_blocks[idx].offset;
 }
 
-void FreeListAllocator::dealloc(size_t offset, size_t sz)
+void TLSFAllocator::dealloc(size_t offset, size_t sz)
 {
-  if(m_ptr == offset+sz) {
-    m_ptr -= sz;
-    return;
+  auto idx = findBlock(offset);
+
+  assert(idx != NilBlock && !m_blocks[idx].free && "dealloc() called with an 'offset' which wasn't allocated!");
+  if(idx == NilBlock || m_blocks[idx].free) return;
+
+  assert(m_blocks[idx].sz == std::max<size_t>(sz, 1) && "dealloc() 'sz' doesn't match the one passed to alloc()!");
+
+  // Coalesce with the neighbouring blocks if they're free
+  auto next = m_blocks[idx].next_phys;
+  if(next != NilBlock && m_blocks[next].free) {
+    removeFreeBlock(next);
+    absorb(idx, next);
+  }
+
+  auto prev = m_blocks[idx].prev_phys;
+  if(prev != NilBlock && m_blocks[prev].free) {
+    removeFreeBlock(prev);
+    absorb(prev, idx);
+
+    idx = prev;
+  }
+
+  insertFreeBlock(idx);
+}
+
+size_t TLSFAllocator::size() const
+{
+  return m_sz;
+}
+
+std::pair<unsigned, unsigned> TLSFAllocator::mapping_insert(size_t sz)
+{
+  if(sz < SecondLevelCount) return { 0, (unsigned)sz };
+
+  auto msb = find_msb(sz);
+
+  unsigned fl = msb - SecondLevelBits + 1;
+  unsigned sl = (unsigned)(sz >> (msb - SecondLevelBits)) ^ SecondLevelCount;
+
+  return { fl, sl };
+}
+
+std::pair<unsigned, unsigned> TLSFAllocator::mapping_search(size_t sz)
+{
+  if(sz >= SecondLevelCount) {
+    // Round 'sz' up to the next bin boundary, so any
+    //   block found in the resulting bin will fit
+    auto round = ((size_t)1 << (find_msb(sz) - SecondLevelBits)) - 1;
+
+    if(sz + round > sz) sz += round;
   }
 
-  m_free_list.push_front({ offset, sz });
-  coalesce();
+  return mapping_insert(sz);
 }
 
-size_t FreeListAllocator::allocAtEnd(size_t sz)
+uint32_t TLSFAllocator::findFreeBlock(size_t sz)
 {
-  if(m_ptr+sz >= m_sz) return Error;
+  auto [fl, sl] = mapping_search(sz);
+
+  uint32_t idx = NilBlock;
+  if(fl < FirstLevelCount) {
+    // Look for a non-empty bin in the same first-level bin...
+    uint32_t sl_map = m_sl_bitmaps[fl] & (~0u << sl);
+    if(!sl_map) {
+      // ...and then fall back to the larger ones
+      uint64_t fl_map = fl+1 < 64 ? m_fl_bitmap & (~0ull << (fl+1)) : 0;
+
+      fl = fl_map ? find_lsb(fl_map) : FirstLevelCount;
+      sl_map = fl_map ? m_sl_bitmaps[fl] : 0;
+    }
+
+    if(sl_map) idx = m_free_lists[fl][find_lsb(sl_map)];
+  }
 
-  auto ret = m_ptr;
-  m_ptr += sz;
+  // mapping_search() can't round up 'sz' near the top of the
+  //   size_t range, so double check the block is big enough
+  if(idx != NilBlock && m_blocks[idx].sz >= sz) return idx;
 
-  return ret;
+  // Rounding 'sz' up skips over the bin it maps to, which can
+  //   still hold a block large enough (eg. when a fresh allocator
+  //   is asked for all of it's range), so search it linearly
+  //   before giving up
+  auto [ins_fl, ins_sl] = mapping_insert(sz);
+  for(idx = m_free_lists[ins_fl][ins_sl]; idx != NilBlock; idx = m_blocks[idx].next_free) {
+    if(m_blocks[idx].sz >= sz) return idx;
+  }
+
+  return NilBlock;
 }
 
-void FreeListAllocator::coalesce()
+void TLSFAllocator::insertFreeBlock(uint32_t idx)
 {
-  auto in_range = [](Range a, Range b) -> bool
-  {
-    if(a.first < b.first) return a.first+a.second >= b.first;
-    else                  return b.first+b.second >= a.first;
+  auto& block = m_blocks[idx];
+  auto [fl, sl] = mapping_insert(block.sz);
+
+  auto head = m_free_lists[fl][sl];
 
-    return false;
-  };
+  block.free = true;
+  block.prev_free = NilBlock;
+  block.next_free = head;
+  if(head != NilBlock) m_blocks[head].prev_free = idx;
 
-  auto prev = m_free_list.begin(),
-    iter = ++m_free_list.begin();
-  while(iter != m_free_list.end()) {
-    if(in_range(*prev, *iter)) {
-      Range a = { prev->first, prev->first+prev->second },
-        b = { iter->first, iter->first+iter->second };
+  m_free_lists[fl][sl] = idx;
 
-      iter->first = std::min(a.first, b.first);
-      iter->second = std::max(a.second, b.second) - iter->first;
+  m_fl_bitmap |= 1ull << fl;
+  m_sl_bitmaps[fl] |= 1u << sl;
+}
+
+void TLSFAllocator::removeFreeBlock(uint32_t idx)
+{
+  auto& block = m_blocks[idx];
+  auto [fl, sl] = mapping_insert(block.sz);
 
-      m_free_list.erase(prev);
+  if(block.prev_free != NilBlock) m_blocks[block.prev_free].next_free = block.next_free;
+  if(block.next_free != NilBlock) m_blocks[block.next_free].prev_free = block.prev_free;
+
+  if(m_free_lists[fl][sl] == idx) {
+    m_free_lists[fl][sl] = block.next_free;
+
+    // The bin is now empty
+    if(block.next_free == NilBlock) {
+      m_sl_bitmaps[fl] &= ~(1u << sl);
+      if(!m_sl_bitmaps[fl]) m_fl_bitmap &= ~(1ull << fl);
     }
-    prev = iter;
-    iter++;
   }
+
+  block.free = false;
+  block.prev_free = block.next_free = NilBlock;
+}
+
+void TLSFAllocator::absorb(uint32_t idx, uint32_t next)
+{
+  blockRemoved(next);
+
+  auto& block = m_blocks[idx];
+  auto& next_block = m_blocks[next];
+
+  block.sz += next_block.sz;
+  block.next_phys = next_block.next_phys;
+  if(block.next_phys != NilBlock) m_blocks[block.next_phys].prev_phys = idx;
+
+  releaseBlock(next);
+}
+
+uint32_t TLSFAllocator::findBlock(size_t offset) const
+{
+  if(offset >= m_sz) return NilBlock;
+
+  // Blocks starting in the same bucket are adjacent in
+  //   the managed range, so follow them in order
+  auto idx = m_block_starts[offset >> m_start_shift];
+  while(idx != NilBlock && m_blocks[idx].offset < offset) idx = m_blocks[idx].next_phys;
+
+  if(idx == NilBlock || m_blocks[idx].offset != offset) return NilBlock;
+
+  return idx;
+}
+
+void TLSFAllocator::blockStarted(uint32_t idx)
+{
+  const auto& block = m_blocks[idx];
+  auto& start = m_block_starts[block.offset >> m_start_shift];
+
+  if(start == NilBlock || m_blocks[start].offset > block.offset) start = idx;
+}
+
+void TLSFAllocator::blockRemoved(uint32_t idx)
+{
+  const auto& block = m_blocks[idx];
+  auto bucket = block.offset >> m_start_shift;
+
+  if(m_block_starts[bucket] != idx) return;
+
+  // The next Block takes it's place if it starts in the same bucket
+  auto next = block.next_phys;
+  bool next_in_bucket = next != NilBlock && (m_blocks[next].offset >> m_start_shift) == bucket;
+
+  m_block_starts[bucket] = next_in_bucket ? next : NilBlock;
+}
+
+uint32_t TLSFAllocator::newBlock()
+{
+  if(!m_unused_blocks.empty()) {
+    auto idx = m_unused_blocks.back();
+    m_unused_blocks.pop_back();
+
+    m_blocks[idx] = Block();
+
+    return idx;
+  }
+
+  m_blocks.emplace_back();
+
+  return (uint32_t)(m_blocks.size() - 1);
+}
+
+void TLSFAllocator::releaseBlock(uint32_t idx)
+{
+  m_unused_blocks.push_back(idx);
 }
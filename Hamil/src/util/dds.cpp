@@ -1,11 +1,16 @@
 #include <util/dds.h>
 
 #include <math/util.h>
+#include <util/unit.h>
+#include <sched/pool.h>
+#include <sched/job.h>
 #include <gx/gx.h>
 
 #include <cassert>
 #include <cstring>
 #include <algorithm>
+#include <array>
+#include <atomic>
 
 namespace util {
 
@@ -148,6 +153,71 @@ DDSImage& DDSImage::operator=(DDSImage&& other)
 }
 
 DDSImage& DDSImage::load(const void *data, size_t data_sz, uint flags)
+{
+  auto copies = loadLayout(data, data_sz);
+  for(const auto& copy : copies) {
+    copyData(*copy.img, copy.src, flags);
+  }
+
+  return *this;
+}
+
+DDSImage& DDSImage::load(sched::WorkerPool& pool, const void *data, size_t data_sz, uint flags)
+{
+  auto copies = loadLayout(data, data_sz);
+
+  // Start with the largest copies so the small
+  //   ones fill in the gaps at the end
+  std::sort(copies.begin(), copies.end(), [](const CopyOp& a, const CopyOp& b) {
+    return a.img->sz > b.img->sz;
+  });
+
+  // Small levels aren't worth the overhead of being
+  //   handed off to the workers
+  auto parallel_end = std::find_if(copies.begin(), copies.end(), [](const CopyOp& copy) {
+    return copy.img->sz < ParallelCopyMinSize;
+  });
+  auto num_parallel = (size_t)(parallel_end - copies.begin());
+
+  std::atomic<size_t> next_copy = 0;
+  auto copy_job_fn = [&]() -> Unit {
+    size_t idx = 0;
+    while((idx = next_copy.fetch_add(1)) < num_parallel) {
+      const auto& copy = copies[idx];
+
+      copyData(*copy.img, copy.src, flags);
+    }
+
+    return {};
+  };
+
+  using CopyJobData = std::pair<sched::WorkerPool::JobId, sched::IJob *>;
+
+  auto num_jobs = std::min<size_t>(num_parallel, NumCopyJobs);
+  std::array<CopyJobData, NumCopyJobs> jobs;
+  for(size_t job_idx = 0; job_idx < num_jobs; job_idx++) {
+    sched::IJob *job = new sched::Job<Unit>(sched::create_job(copy_job_fn));
+
+    auto id = pool.scheduleJob(job);
+    jobs[job_idx] = std::make_pair(id, job);
+  }
+
+  // Copy the small levels while the workers are busy
+  for(auto it = parallel_end; it != copies.end(); it++) {
+    copyData(*it->img, it->src, flags);
+  }
+
+  for(size_t job_idx = 0; job_idx < num_jobs; job_idx++) {
+    const auto& job = jobs[job_idx];
+
+    pool.waitJob(job.first);
+    delete job.second;
+  }
+
+  return *this;
+}
+
+DDSImage::CopyOps DDSImage::loadLayout(const void *data, size_t data_sz)
 {
   auto ptr = (byte *)data;
 
@@ -273,6 +343,9 @@ DDSImage& DDSImage::load(const void *data, size_t data_sz, uint flags)
     m_num_layers = 6;
   }
 
+  CopyOps copies;
+  copies.reserve(m_num_layers * m_mips);
+
   m_layers = std::make_unique<MipChain[]>(m_num_layers);
   for(uint n = 0; n < m_num_layers; n++) {
     auto& chain = m_layers[n];
@@ -291,7 +364,7 @@ DDSImage& DDSImage::load(const void *data, size_t data_sz, uint flags)
     img.sz   = sz;
 
     check_size(sz);
-    copyData(img, ptr, flags);
+    copies.push_back({ nullptr, ptr, n, 0 });
     ptr += sz;
 
     for(uint i = 0; i < (m_mips-1) && (w || h); i++) {
@@ -312,12 +385,18 @@ DDSImage& DDSImage::load(const void *data, size_t data_sz, uint flags)
       img.sz = sz;
 
       check_size(sz);
-      copyData(img, ptr, flags);
+      copies.push_back({ nullptr, ptr, n, i+1 });
       ptr += sz;
     }
   }
 
-  return *this;
+  // Growing the MipChains can move the Images, so
+  //   only point at them once they're all allocated
+  for(auto& copy : copies) {
+    copy.img = &m_layers[copy.layer].at(copy.level);
+  }
+
+  return copies;
 }
 
 DDSImage::Type DDSImage::type() const
@@ -854,17 +933,21 @@ void DDSImage::copyDataFlipV(Image& img, void *src)
     auto [block_sz, flip_block] = it->second;
     copyDataFlipVCompressed(img, src, block_sz, flip_block);
   } else {
+    // m_pitch is the pitch of level 0, so it
+    //   can't be used for the smaller levels
+    auto pitch = img.sz / img.height;
+
     // Start at the top
     auto dst_row = (byte *)img.data.get();
 
     // Start at the bottom (last_row == num_rows-1)
-    auto src_row = (byte *)src + (img.height-1)*m_pitch;
+    auto src_row = (byte *)src + (img.height-1)*pitch;
 
     for(ulong y = img.height; y > 0; y--) {
-      memcpy(dst_row, src_row, m_pitch);
+      memcpy(dst_row, src_row, pitch);
 
-      dst_row += m_pitch;
-      src_row -= m_pitch;
+      dst_row += pitch;
+      src_row -= pitch;
     }
   }
 }
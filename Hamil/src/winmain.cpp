@@ -9,6 +9,7 @@
 #include <math/transform.h>
 #include <math/util.h>
 #include <math/frustum.h>
+#include <math/cull.h>
 
 #include <os/os.h>
 #include <os/stdstream.h>
@@ -98,6 +99,7 @@
 #include <hm/component.h>
 #include <hm/componentman.h>
 #include <hm/components/all.h>
+#include <hm/transformsystem.h>
 
 #include <ek/euklid.h>
 #include <ek/renderer.h>
@@ -172,31 +174,21 @@ int main(int argc, char *argv[])
 //  res::load(R.image.ids);
   res::load(R.mesh.ids);
 
-  auto bunny_fmt = gx::VertexFormat()
-    .attr(gx::f32, 3)
-    .attr(gx::f32, 3)
-    .attr(gx::f32, 2);
-    //.attrAlias(0, gx::f32, 2);
-
-  auto bunny_vbuf_id = pool.createBuffer<gx::VertexBuffer>("bvBunny",
-    gx::Buffer::Static);
-  auto bunny_ibuf_id = pool.createBuffer<gx::IndexBuffer>("biBunny",
-    gx::Buffer::Static, gx::u16);
-
-  auto bunny_vbuf = pool.getBuffer(bunny_vbuf_id);
-  auto bunny_ibuf = pool.getBuffer(bunny_ibuf_id);
-
-  auto bunny_arr_id = pool.create<gx::IndexedVertexArray>("iaBunny",
-    bunny_fmt, bunny_vbuf.get<gx::VertexBuffer>(), bunny_ibuf.get<gx::IndexBuffer>());
-  auto& bunny_arr = pool.get<gx::IndexedVertexArray>(bunny_arr_id);
+  auto& mesh_pool = ek::renderer().meshPool();
 
   res::Handle<res::Mesh> r_model = R.mesh.autumn_plains,
     r_model_hull = R.mesh.monkey_cube_hulls;
 
-  auto& obj_loader = (mesh::ObjLoader&)r_model->loader();
-  auto& obj_hull_loader = (mesh::ObjLoader&)r_model_hull->loader();
+  // Pin the meshes, so the loaders stay alive for as long as they're used
+  auto model_pin = r_model.lock();
+  auto hull_pin = r_model_hull.lock();
 
-  auto model_load_job = obj_loader.streamIndexed(bunny_fmt, bunny_vbuf, bunny_ibuf);
+  auto& model_loader = model_pin->loader();
+  auto& hull_loader = hull_pin->loader();
+
+  // Use the mesh's own vertex layout, as baked meshes
+  //   can store some of the attributes as f16
+  auto model_load_job = model_loader.streamPooled();
   auto model_load_job_id = worker_pool.scheduleJob(model_load_job.get());
 
   ft::Font face(ft::FontFamily("georgia"), 35);
@@ -218,7 +210,8 @@ int main(int argc, char *argv[])
     .attrAlias(0, gx::f32, 2);
 
   res::Handle<res::Texture> r_texture = R.texture.autumn_plains_tex;
-  const auto& desk = r_texture->get();
+  auto texture_pin = r_texture.lock();
+  const auto& desk = texture_pin->get();
 
   auto tex_id = pool.createTexture<gx::Texture2D>("t2dFloor", desk.texInternalFormat());
   auto& tex = pool.getTexture<gx::Texture2D>(tex_id);
@@ -544,6 +537,26 @@ int main(int argc, char *argv[])
 
   scene.addComponent<hm::Transform>(xform::Transform());
 
+  // Computes the world matrices and AABBs of the scene's Entities
+  //   for the Renderer, so every Entity with a hm::Transform
+  //   has to be add()'ed to (and remove()'d from) it
+  hm::TransformSystem transforms;
+
+  // hm::Transform::aabb is world-space, while the TransformSystem
+  //   expects one in the Entity's local space
+  auto add_transform = [&](hm::Entity e, hm::Entity parent) {
+    auto transform = e.component<hm::Transform>();
+
+    auto model = transform().matrix();
+    auto local_aabb = aabb_transform(model.inverse(), transform().aabb);
+
+    transforms.add(e.id(), parent.id(), model, local_aabb);
+  };
+
+  add_transform(scene, hm::Entity());
+
+  ek::renderer().transformSystem(&transforms);
+
   const int PboSize = sizeof(u8)*3 * FramebufferSize.area();
 
   auto pbo_id = pool.createBuffer<gx::PixelBuffer>("bpTest",
@@ -575,6 +588,8 @@ int main(int argc, char *argv[])
     floor.addComponent<hm::RigidBody>(body);
     floor.addComponent<hm::Mesh>(floor_mesh);
 
+    add_transform(floor, scene);
+
     auto material = floor.addComponent<hm::Material>();
 
     material().diff_type = hm::Material::DiffuseTexture;
@@ -629,6 +644,8 @@ int main(int argc, char *argv[])
     entity.addComponent<hm::RigidBody>(body);
     entity.addComponent<hm::Mesh>(sphere_mesh);
 
+    add_transform(entity, scene);
+
     auto material = entity.addComponent<hm::Material>();
 
     material().diff_type = hm::Material::Other;
@@ -690,6 +707,9 @@ int main(int argc, char *argv[])
     light_entity.addComponent<hm::Transform>(xform::Transform());
     auto light = light_entity.addComponent<hm::Light>();
 
+    add_transform(sphere_entity, scene);
+    add_transform(light_entity, sphere_entity);
+
     light().type = hm::Light::Sphere;
     light().color = color;
     light().radius = 100.0f;
@@ -740,6 +760,9 @@ int main(int argc, char *argv[])
     light_entity.addComponent<hm::Transform>(xform::Transform());
     auto light = light_entity.addComponent<hm::Light>();
 
+    add_transform(line_entity, scene);
+    add_transform(light_entity, line_entity);
+
     light().type = hm::Light::Line;
     light().color = color;
     light().radius = 1.0f;
@@ -763,33 +786,31 @@ int main(int argc, char *argv[])
     return line_entity;
   };
 
-  auto create_model = [&](const mesh::Mesh& mesh, const mesh::ObjMesh& obj,
-    const mesh::ObjMesh& hull, const vec3 *hull_verts,
-    const std::string& name = "")
+  auto create_model = [&](const mesh::Mesh& mesh, const mesh::MeshLoader::Submesh& submesh,
+    const mesh::MeshLoader::Submesh& hull,
+    const std::vector<vec3>& hull_verts, const std::vector<u32>& hull_inds,
+    const std::string& name)
   {
     vec3 origin = { 0.0f, 4.0f, -50.0f };
     vec3 scale(1.0f);
 
-    AABB aabb = obj.aabb().scale(scale);
+    AABB aabb = submesh.aabb.scale(scale);
     aabb.min += origin; aabb.max += origin;
 
     vec3 extents = aabb.max - aabb.min;
 
-    uint idx = 0;
-    const auto& faces = hull.faces();
+    u32 idx = 0;
     auto model_shape = bt::shapes().convexHull([&](vec3 &dst) -> bool {
-      if(idx >= faces.size()*3) return false;
+      if(idx >= hull.num_inds) return false;
 
-      dst = hull_verts[faces[idx/3][idx%3].v];
+      dst = hull_verts.at(hull_inds.at(hull.first_index + idx));
       idx++;
 
       return true;
     });
     auto body = bt::RigidBody::create(model_shape, origin, 1.0f);
 
-    auto entity = hm::entities().createGameObject(
-      !name.empty() ? name : obj.name(),
-      scene);
+    auto entity = hm::entities().createGameObject(name, scene);
 
     entity.addComponent<hm::Transform>(
       xform::Transform(origin, quat::identity(), scale),
@@ -798,6 +819,8 @@ int main(int argc, char *argv[])
     entity.addComponent<hm::RigidBody>(body);
     entity.addComponent<hm::Mesh>(mesh);
 
+    add_transform(entity, scene);
+
     //world.addRigidBody(body);
 
     auto material = entity.addComponent<hm::Material>();
@@ -857,16 +880,15 @@ int main(int argc, char *argv[])
   auto transforms_extract_job = sched::create_job([&]() -> Unit {
     hm::components().requireUnlocked();
 
-    // Update Transforms
-    hm::components().foreach([&](hmRef<hm::RigidBody> rb) {
-      if(rb().rb.isStatic()) return;
-
-      auto entity = rb().entity();
+    // Update the Transforms of only the bodies which
+    //   were moved by the physics step
+    for(const auto& body : world.movedBodies()) {
+      auto entity = body.rb.user<hm::Entity>();
       auto transform = entity.component<hm::Transform>();
 
-      transform() = rb().rb.worldTransform();
-      transform().aabb = rb().rb.aabb();
-    });
+      transform() = xform::Transform(body.transform);
+      transform().aabb = body.aabb;
+    }
 
     hm::components().endRequireUnlocked();
 
@@ -896,6 +918,9 @@ int main(int argc, char *argv[])
     win32::Timers::tick();
     if(std_stream.size()) console.print(std_stream);
 
+    // Finalize the resources which finished streaming in
+    res::resources().dispatchLoads();
+
     vec4 eye{ 0, 0, 60.0f/zoom, 1 };
 
     mat4 eye_mtx = xform::Transform()
@@ -922,10 +947,12 @@ int main(int argc, char *argv[])
             world.removeRigidBody(rb().rb);
           });
 
+          transforms.remove(scene.id());
           scene.destroy();
           scene = entities().createGameObject("Scene");
 
           scene.addComponent<hm::Transform>(xform::Transform());
+          add_transform(scene, hm::Entity());
 
           floor = create_floor();
           create_lights();
@@ -1070,6 +1097,10 @@ int main(int argc, char *argv[])
 
     step_timer.reset();
 
+    // The Renderer reads the world matrices during extraction, and
+    //   the TransformSystem can't be touched until it's done
+    transforms.update(&worker_pool);
+
     auto extract_for_view_job = ek::renderer().extractForView(scene, render_view);
     auto extract_for_view_job_id = worker_pool.scheduleJob(extract_for_view_job.get());
 
@@ -1080,46 +1111,49 @@ int main(int argc, char *argv[])
       worker_pool.waitJob(model_load_job_id);
       model_load_job_id = sched::WorkerPool::InvalidJob;
 
-      ((mesh::MeshLoader&)obj_hull_loader).load();
-      auto hull_verts = obj_hull_loader.vertices().data();
+      r_model->upload(mesh_pool);
+      const auto& model_mesh = r_model->mesh();
+
+      if(!hull_loader.loaded()) hull_loader.load();
+
+      std::vector<vec3> hull_verts, model_verts;
+      std::vector<u32> hull_inds, model_inds;
+      hull_loader.positions(hull_verts, hull_inds);
+      model_loader.positions(model_verts, model_inds);
+
+      auto hull = hull_loader.submesh(0);
 
       vec3 origin = { 0.0f, 4.0f, -50.0f };
 
       hm::components().requireUnlocked();
 
-      verts_vec.reserve(obj_loader.numMeshes());
-      inds_vec.reserve(obj_loader.numMeshes());
+      verts_vec.reserve(model_loader.numSubmeshes());
+      inds_vec.reserve(model_loader.numSubmeshes());
 
-      for(uint i = 0; i < obj_loader.numMeshes(); i++) {
-        auto& mesh = obj_loader.mesh(i);
-        auto& hull = obj_hull_loader.mesh(0);
+      for(uint i = 0; i < model_loader.numSubmeshes(); i++) {
+        auto submesh = model_loader.submesh(i);
 
-        auto num_inds = mesh.faces().size() * 3;
         auto bunny_mesh = mesh::Mesh()
           .withNormals()
           .withTexCoords(1)
-          .withIndexedArray(bunny_arr_id)
-          .withNum((u32)num_inds)
-          .withOffset((u32)mesh.offset());
+          .withIndexedArray(model_mesh.vertex_array_id)
+          .withNum(submesh.num_inds)
+          .withBase(model_mesh.base)
+          .withOffset(model_mesh.offset + submesh.first_index);
 
-        bunny = create_model(bunny_mesh, mesh, hull, hull_verts);
+        bunny = create_model(bunny_mesh, submesh, hull, hull_verts, hull_inds,
+            r_model->name() + "." + std::to_string(i));
 
         auto& verts = verts_vec.emplace_back();
-        verts.reserve(mesh.faces().size());
+        verts.reserve(submesh.num_inds);
         auto& inds = inds_vec.emplace_back();
-        inds.reserve(mesh.faces().size());
-        for(auto& face : mesh.faces()) {
-          auto idx = verts.size();
-
-          verts.push_back(obj_loader.vertices().at(face[0].v));
-          inds.push_back((u16)idx);
-          verts.push_back(obj_loader.vertices().at(face[1].v));
-          inds.push_back((u16)idx + 1);
-          verts.push_back(obj_loader.vertices().at(face[2].v));
-          inds.push_back((u16)idx + 2);
+        inds.reserve(submesh.num_inds);
+        for(u32 j = 0; j < submesh.num_inds; j++) {
+          verts.push_back(model_verts.at(model_inds.at(submesh.first_index + j)));
+          inds.push_back((u16)j);
         }
 
-        auto aabb = mesh.aabb();
+        auto aabb = submesh.aabb;
         auto vis_object = bunny.component<hm::Visibility>().get().visObject();
 
         vis_object->addMesh(ek::VisibilityMesh::from_vectors(
@@ -1205,6 +1239,9 @@ int main(int argc, char *argv[])
 
     worker_pool.waitJob(physics_step_job_id);
 
+    // Picked up by the next frame's transforms.update()
+    transforms.syncPhysics(world.movedBodies());
+
     auto transforms_extract_job_id = worker_pool.scheduleJob(transforms_extract_job.withParams());
 
     float fps = 1.0f / step_dt;
@@ -1283,6 +1320,7 @@ int main(int argc, char *argv[])
     // Kill off dead_entites
     for(auto& e : dead_entities) {
       world.removeRigidBody(e.component<hm::RigidBody>().get().rb);
+      if(transforms.contains(e.id())) transforms.remove(e.id());
       e.destroy();
     }
 
@@ -1338,6 +1376,11 @@ int main(int argc, char *argv[])
 
   worker_pool.killWorkers();
 
+  // The Renderer's MeshPool is destroyed by ek::finalize()
+  r_model->deallocate();
+
+  ek::renderer().transformSystem(nullptr);
+
   window.destroy();
 
   ek::finalize();
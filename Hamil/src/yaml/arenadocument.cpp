@@ -0,0 +1,574 @@
+#include <yaml/arenadocument.h>
+#include <util/format.h>
+
+#include <yaml.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+
+namespace yaml {
+
+Arena::~Arena()
+{
+  for(auto block : m_blocks) delete[] block;
+}
+
+void *Arena::alloc(size_t sz, size_t align)
+{
+  m_size += sz;
+
+  if(sz > MaxSmallAlloc) {
+    // Insert the block before the current one so the
+    //   space left in it can still be used
+    auto block = new byte[sz];
+    m_blocks.insert(m_blocks.empty() ? m_blocks.end() : m_blocks.end()-1, block);
+
+    return block;
+  }
+
+  auto ptr = (byte *)(((uintptr_t)m_ptr + (align-1)) & ~(uintptr_t)(align-1));
+  if(!m_ptr || ptr+sz > m_end) {
+    auto block = new byte[BlockSize];
+    m_blocks.push_back(block);
+
+    ptr   = block;  // new[] returns memory suitably aligned for any type
+    m_end = block + BlockSize;
+  }
+
+  m_ptr = ptr+sz;
+
+  return ptr;
+}
+
+const char *Arena::copy(const void *data, size_t sz)
+{
+  auto str = (char *)alloc(sz+1, 1);
+
+  memcpy(str, data, sz);
+  str[sz] = '\0';
+
+  return str;
+}
+
+size_t Arena::size() const
+{
+  return m_size;
+}
+
+ArenaNode::Type ArenaNode::type() const
+{
+  return (Type)m_type;
+}
+
+ArenaNode::Style ArenaNode::style() const
+{
+  return (Style)m_style;
+}
+
+std::string_view ArenaNode::tag() const
+{
+  return std::string_view(m_tag, m_tag_len);
+}
+
+bool ArenaNode::tagged() const
+{
+  return m_tag;
+}
+
+size_t ArenaNode::size() const
+{
+  return m_size;
+}
+
+std::string_view ArenaNode::str() const
+{
+  if(type() != Node::Scalar) return std::string_view();
+
+  return std::string_view(m_str, m_size);
+}
+
+ArenaNode::DataType ArenaNode::dataType() const
+{
+  if(type() != Node::Scalar) return Scalar::Invalid;
+  if(tagged()) return Scalar::tag_data_type(std::string(tag()));
+
+  return Scalar::data_type(m_str, m_size);
+}
+
+// Plain scalars aren't null-terminated, so they have to be
+//   copied before being passed to strto*()
+template <typename T, typename Fn>
+static T scalar_convert(std::string_view str, Fn fn)
+{
+  enum : size_t { BufSize = 64 };
+
+  if(str.size() >= BufSize) return fn(std::string(str).data());
+
+  char buf[BufSize];
+  memcpy(buf, str.data(), str.size());
+  buf[str.size()] = '\0';
+
+  return fn(buf);
+}
+
+long long ArenaNode::i() const
+{
+  return scalar_convert<long long>(str(), [](const char *s) { return strtoll(s, nullptr, 0); });
+}
+
+unsigned long long ArenaNode::ui() const
+{
+  return scalar_convert<unsigned long long>(str(), [](const char *s) { return strtoull(s, nullptr, 0); });
+}
+
+double ArenaNode::f() const
+{
+  return scalar_convert<double>(str(), [](const char *s) { return strtod(s, nullptr); });
+}
+
+bool ArenaNode::b() const
+{
+  return Scalar::parse_bool(m_str, m_size);
+}
+
+bool ArenaNode::null() const
+{
+  return str() == "null";
+}
+
+const ArenaNode *ArenaNode::get(size_t idx) const
+{
+  if(type() != Node::Sequence || idx >= m_size) return nullptr;
+
+  return m_items[idx];
+}
+
+// Mapping keys which aren't Scalars are ordered after all of the Scalar ones
+static bool key_less(const ArenaNode *a, const ArenaNode *b)
+{
+  bool a_scalar = a->type() == Node::Scalar;
+  bool b_scalar = b->type() == Node::Scalar;
+  if(a_scalar != b_scalar) return a_scalar;
+
+  return a->str() < b->str();
+}
+
+const ArenaNode *ArenaNode::get(std::string_view key) const
+{
+  if(type() != Node::Mapping) return nullptr;
+
+  auto it = std::lower_bound(m_sorted, m_sorted+m_size, key, [this](u32 entry, std::string_view key) {
+    auto k = m_items[entry*2];
+    return k->type() == Node::Scalar && k->str() < key;
+  });
+  if(it == m_sorted+m_size) return nullptr;
+
+  auto k = m_items[*it * 2];
+  if(k->type() != Node::Scalar || k->str() != key) return nullptr;
+
+  return m_items[*it * 2 + 1];
+}
+
+const ArenaNode *ArenaNode::key(size_t idx) const
+{
+  if(type() != Node::Mapping || idx >= m_size) return nullptr;
+
+  return m_items[idx*2];
+}
+
+const ArenaNode *ArenaNode::value(size_t idx) const
+{
+  if(type() != Node::Mapping || idx >= m_size) return nullptr;
+
+  return m_items[idx*2 + 1];
+}
+
+using ArenaNodeCopies = std::unordered_map<const ArenaNode *, Node::Ptr>;
+
+static Node::Ptr arena_node_copy(const ArenaNode *node, ArenaNodeCopies& anchored);
+
+static Node::Ptr arena_node_copy_tree(const ArenaNode *node, ArenaNodeCopies& anchored)
+{
+  Node::Tag tag = node->tagged() ? Node::Tag(std::string(node->tag())) : std::nullopt;
+
+  switch(node->type()) {
+  case Node::Scalar: {
+    auto str = node->str();
+
+    return std::make_shared<Scalar>((byte *)str.data(), str.size(), tag, node->style());
+  }
+
+  case Node::Sequence: {
+    auto seq = std::make_shared<Sequence>(tag, node->style());
+    for(size_t i = 0; i < node->size(); i++) seq->append(arena_node_copy(node->get(i), anchored));
+
+    return seq;
+  }
+
+  case Node::Mapping: {
+    auto map = std::make_shared<Mapping>(tag, node->style());
+    for(size_t i = 0; i < node->size(); i++) {
+      map->append(arena_node_copy(node->key(i), anchored), arena_node_copy(node->value(i), anchored));
+    }
+
+    return map;
+  }
+
+  default: assert(0); break;
+  }
+
+  return Node::Ptr(); // unreachable
+}
+
+Node::Ptr ArenaNode::toNode() const
+{
+  ArenaNodeCopies anchored;
+
+  return arena_node_copy(this, anchored);
+}
+
+class ArenaParser {
+public:
+  ArenaParser(Arena& arena);
+  ~ArenaParser();
+
+  ArenaParser& input(const char *input, size_t sz);
+
+  const ArenaNode *parse();
+
+  static bool anchored(const ArenaNode *node) { return node->m_flags & ArenaNode::Anchored; }
+
+private:
+  bool nextEvent();
+
+  // returns an ArenaNode based on current m_event
+  const ArenaNode *node();
+
+  ArenaNode *newNode(Node::Type type, Node::Style style, const yaml_char_t *tag, const yaml_char_t *anchor);
+
+  const ArenaNode *scalar();
+  const ArenaNode *sequence();
+  const ArenaNode *mapping();
+
+  const ArenaNode *alias();
+
+  // Moves m_stack[base..] into the Arena
+  const ArenaNode **popItems(size_t base);
+
+  Document::ParseError parseError() const;
+
+  Arena& m_arena;
+
+  const char *m_input = nullptr;
+  size_t m_input_sz = 0;
+
+  yaml_parser_t m_parser;
+  yaml_event_t m_event;
+  bool m_has_event = false;
+
+  // Children of all the currently open Sequences/Mappings
+  std::vector<const ArenaNode *> m_stack;
+  std::vector<u32> m_sort_scratch;
+
+  std::unordered_map<std::string, const ArenaNode *> m_anchors;
+};
+
+static Node::Ptr arena_node_copy(const ArenaNode *node, ArenaNodeCopies& anchored)
+{
+  // Preserve the sharing of aliased nodes
+  if(!ArenaParser::anchored(node)) return arena_node_copy_tree(node, anchored);
+
+  auto it = anchored.find(node);
+  if(it != anchored.end()) return it->second;
+
+  auto copy = arena_node_copy_tree(node, anchored);
+  anchored.emplace(node, copy);
+
+  return copy;
+}
+
+ArenaParser::ArenaParser(Arena& arena) :
+  m_arena(arena)
+{
+  if(!yaml_parser_initialize(&m_parser)) throw Document::Error(0, 0, "failed to initialie libyaml!");
+}
+
+ArenaParser::~ArenaParser()
+{
+  if(m_has_event) yaml_event_delete(&m_event);
+  yaml_parser_delete(&m_parser);
+}
+
+ArenaParser& ArenaParser::input(const char *input, size_t sz)
+{
+  m_input = input;
+  m_input_sz = sz;
+
+  yaml_parser_set_input_string(&m_parser, (const unsigned char *)input, sz);
+  return *this;
+}
+
+const ArenaNode *ArenaParser::parse()
+{
+  do {
+    if(!nextEvent()) throw parseError();
+
+    switch(m_event.type) {
+    case YAML_NO_EVENT:
+    case YAML_STREAM_START_EVENT:
+    case YAML_DOCUMENT_START_EVENT: break;
+
+    case YAML_STREAM_END_EVENT:
+    case YAML_DOCUMENT_END_EVENT: return nullptr;
+
+    default: return node();
+    }
+
+  } while(m_event.type != YAML_STREAM_END_EVENT);
+
+  return nullptr;
+}
+
+bool ArenaParser::nextEvent()
+{
+  if(m_has_event) yaml_event_delete(&m_event);
+
+  m_has_event = yaml_parser_parse(&m_parser, &m_event);
+  return m_has_event;
+}
+
+const ArenaNode *ArenaParser::node()
+{
+  switch(m_event.type) {
+  case YAML_SCALAR_EVENT:         return scalar();
+
+  case YAML_SEQUENCE_START_EVENT: return sequence();
+  case YAML_MAPPING_START_EVENT:  return mapping();
+
+  case YAML_ALIAS_EVENT:          return alias();
+
+  default: assert(0); break;
+  }
+
+  return nullptr; // unreachable
+}
+
+ArenaNode *ArenaParser::newNode(Node::Type type, Node::Style style, const yaml_char_t *tag, const yaml_char_t *anchor)
+{
+  auto node = m_arena.alloc<ArenaNode>();
+
+  node->m_type  = (u8)type;
+  node->m_style = (u8)style;
+  node->m_flags = anchor ? ArenaNode::Anchored : 0;
+
+  node->m_size = 0;
+  node->m_str = nullptr;
+  node->m_sorted = nullptr;
+
+  if(tag) {
+    auto len = strlen((const char *)tag);
+
+    node->m_tag = m_arena.copy(tag, len);
+    node->m_tag_len = (u32)len;
+  } else {
+    node->m_tag = nullptr;
+    node->m_tag_len = 0;
+  }
+
+  if(anchor) m_anchors.insert({ (const char *)anchor, node });
+
+  return node;
+}
+
+const ArenaNode *ArenaParser::scalar()
+{
+  auto data = m_event.data.scalar;
+
+  auto style = Node::Any;
+  size_t quote_len = 0;
+  switch(data.style) {
+  case YAML_PLAIN_SCALAR_STYLE:         style = Node::Plain; break;
+
+  case YAML_SINGLE_QUOTED_SCALAR_STYLE: style = Node::SingleQuoted; quote_len = 1; break;
+  case YAML_DOUBLE_QUOTED_SCALAR_STYLE: style = Node::DoubleQuoted; quote_len = 1; break;
+
+  case YAML_FOLDED_SCALAR_STYLE:       style = Node::Folded; break;
+  case YAML_LITERAL_SCALAR_STYLE:      style = Node::Literal; break;
+  }
+
+  auto node = newNode(Node::Scalar, style, data.tag, data.anchor);
+  node->m_size = (u32)data.length;
+
+  // Flow scalars without escapes or line folding appear in the
+  //   source verbatim (after any quotes) - point straight at them,
+  //   otherwise fall back to copying libyaml's (processed) value
+  auto start = m_event.start_mark.index + quote_len;
+  auto value = (const char *)data.value;
+  if(style != Node::Literal && style != Node::Folded && start+data.length <= m_input_sz
+    && !memcmp(m_input+start, value, data.length)) {
+    node->m_str = m_input+start;
+  } else {
+    node->m_str = m_arena.copy(value, data.length);
+  }
+
+  return node;
+}
+
+const ArenaNode *ArenaParser::sequence()
+{
+  auto data = m_event.data.sequence_start;
+
+  auto style = Node::Any;
+  switch(data.style) {
+  case YAML_BLOCK_SEQUENCE_STYLE: style = Node::Block; break;
+  case YAML_FLOW_SEQUENCE_STYLE:  style = Node::Flow; break;
+  }
+
+  auto seq = newNode(Node::Sequence, style, data.tag, data.anchor);
+  auto base = m_stack.size();
+
+  while(true) {
+    if(!nextEvent()) throw parseError();
+    if(m_event.type == YAML_SEQUENCE_END_EVENT) break;
+
+    m_stack.push_back(node());
+  }
+
+  seq->m_size = (u32)(m_stack.size() - base);
+  seq->m_items = popItems(base);
+
+  return seq;
+}
+
+const ArenaNode *ArenaParser::mapping()
+{
+  auto data = m_event.data.mapping_start;
+
+  auto style = Node::Any;
+  switch(data.style) {
+  case YAML_BLOCK_MAPPING_STYLE: style = Node::Block; break;
+  case YAML_FLOW_MAPPING_STYLE:  style = Node::Flow; break;
+  }
+
+  auto map = newNode(Node::Mapping, style, data.tag, data.anchor);
+  auto base = m_stack.size();
+
+  while(true) {
+    if(!nextEvent()) throw parseError();
+    if(m_event.type == YAML_MAPPING_END_EVENT) break;
+
+    m_stack.push_back(node());
+
+    if(!nextEvent()) throw parseError();
+    m_stack.push_back(node());
+  }
+
+  auto num = (m_stack.size() - base) / 2;
+  auto items = m_stack.data() + base;
+
+  // A stable sort makes get() find the first of any duplicate keys,
+  //   which matches Mapping::append() ignoring all but the first one
+  m_sort_scratch.resize(num);
+  for(size_t i = 0; i < num; i++) m_sort_scratch[i] = (u32)i;
+
+  std::stable_sort(m_sort_scratch.begin(), m_sort_scratch.end(), [items](u32 a, u32 b) {
+    return key_less(items[a*2], items[b*2]);
+  });
+
+  auto sorted = m_arena.alloc<u32>(num);
+  std::copy(m_sort_scratch.begin(), m_sort_scratch.end(), sorted);
+
+  map->m_size = (u32)num;
+  map->m_items = popItems(base);
+  map->m_sorted = sorted;
+
+  return map;
+}
+
+const ArenaNode *ArenaParser::alias()
+{
+  auto data = m_event.data.alias;
+
+  auto it = m_anchors.find((const char *)data.anchor);
+  if(it == m_anchors.end()) {
+    auto line = m_parser.mark.line, column = m_parser.mark.column;
+
+    throw Document::AliasError(line, column, util::fmt("anchor '%s' has not been defined", data.anchor));
+  }
+
+  return it->second;
+}
+
+const ArenaNode **ArenaParser::popItems(size_t base)
+{
+  auto num = m_stack.size() - base;
+
+  auto items = m_arena.alloc<const ArenaNode *>(num);
+  std::copy(m_stack.begin()+base, m_stack.end(), items);
+
+  m_stack.resize(base);
+
+  return items;
+}
+
+Document::ParseError ArenaParser::parseError() const
+{
+  auto line = m_parser.problem_mark.line, column = m_parser.problem_mark.column;
+
+  return Document::ParseError(line, column, m_parser.problem);
+}
+
+ArenaDocument::ArenaDocument()
+{
+}
+
+ArenaDocument::~ArenaDocument()
+{
+}
+
+ArenaDocument ArenaDocument::from_string(const char *doc, size_t len)
+{
+  ArenaDocument self;
+  self.m_arena = std::make_unique<Arena>();
+
+  self.m_root = ArenaParser(*self.m_arena).input(doc, len).parse();
+
+  return self;
+}
+
+const ArenaNode *ArenaDocument::get() const
+{
+  return m_root;
+}
+
+const ArenaNode *ArenaDocument::get(const Path& path) const
+{
+  auto node = m_root;
+  if(!node) return nullptr;
+
+  for(const auto& term : path.terms()) {
+    node = term.is_index ? node->get(term.idx) : node->get(std::string_view(term.key));
+
+    if(!node) return nullptr;
+  }
+
+  return node;
+}
+
+Document ArenaDocument::toDocument() const
+{
+  if(!m_root) return Document();
+
+  return Document(m_root->toNode());
+}
+
+size_t ArenaDocument::arenaSize() const
+{
+  return m_arena ? m_arena->size() : 0;
+}
+
+}
@@ -6,8 +6,8 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <unordered_map>
-#include <sstream>
 
 namespace std {
   template <>
@@ -481,6 +481,176 @@ std::string Document::toString()
   return Emitter().emit(m_root);
 }
 
+// Binary node encoding:
+//   u8 type, u8 style, u8 flags, [u32 tag_len, tag]
+//     Scalar:   u32 len, data
+//     Sequence: u32 num, node...
+//     Mapping:  u32 num, (key node, value node)...
+enum BinaryFlags : u8 {
+  BinaryHasTag  = 1<<0,
+  BinaryOrdered = 1<<1,
+};
+
+static void binary_write_u32(std::string& out, u32 x)
+{
+  out.append((const char *)&x, sizeof(u32));
+}
+
+static void binary_write_str(std::string& out, const char *str, size_t len)
+{
+  binary_write_u32(out, (u32)len);
+  out.append(str, len);
+}
+
+static void binary_write_node(std::string& out, const Node::Ptr& node)
+{
+  u8 flags = 0;
+  if(node->tag()) flags |= BinaryHasTag;
+
+  if(auto map = node->as<Mapping>()) {
+    if(map->ordered()) flags |= BinaryOrdered;
+  }
+
+  out.push_back((char)node->type());
+  out.push_back((char)node->style());
+  out.push_back((char)flags);
+
+  if(flags & BinaryHasTag) binary_write_str(out, node->tag()->data(), node->tag()->size());
+
+  switch(node->type()) {
+  case Node::Scalar: {
+    auto scalar = node->as<Scalar>();
+
+    binary_write_str(out, scalar->str(), scalar->size());
+    break;
+  }
+
+  case Node::Sequence: {
+    auto seq = node->as<Sequence>();
+
+    binary_write_u32(out, (u32)seq->size());
+    seq->foreach([&](Node::Ptr value) {
+      binary_write_node(out, value);
+    });
+    break;
+  }
+
+  case Node::Mapping: {
+    auto map = node->as<Mapping>();
+
+    binary_write_u32(out, (u32)map->size());
+    map->foreach([&](Node::Ptr key, Node::Ptr value) {
+      binary_write_node(out, key);
+      binary_write_node(out, value);
+    });
+    break;
+  }
+
+  default: assert(0); // unreachable
+  }
+}
+
+class BinaryReader {
+public:
+  BinaryReader(const byte *data, size_t sz) :
+    m_data(data), m_sz(sz), m_offset(0)
+  { }
+
+  Node::Ptr node()
+  {
+    auto type  = (Node::Type)u8_();
+    auto style = (Node::Style)u8_();
+    auto flags = u8_();
+
+    Node::Tag tag = std::nullopt;
+    if(flags & BinaryHasTag) {
+      auto len = u32_();
+      tag = std::string((const char *)bytes(len), len);
+    }
+
+    switch(type) {
+    case Node::Scalar: {
+      auto len = u32_();
+      auto data = bytes(len);
+
+      return std::make_shared<Scalar>((byte *)data, len, tag, style);
+    }
+
+    case Node::Sequence: {
+      auto seq = std::make_shared<Sequence>(tag, style);
+
+      auto num = u32_();
+      for(u32 i = 0; i < num; i++) seq->append(node());
+
+      return seq;
+    }
+
+    case Node::Mapping: {
+      auto map = std::make_shared<Mapping>(tag, style);
+      if(flags & BinaryOrdered) map->retainOrder();
+
+      auto num = u32_();
+      for(u32 i = 0; i < num; i++) {
+        auto key = node();
+        map->append(key, node());
+      }
+
+      return map;
+    }
+
+    default: break;
+    }
+
+    throw Document::BinaryFormatError(m_offset);
+  }
+
+  bool done() const { return m_offset == m_sz; }
+
+private:
+  const byte *bytes(size_t n)
+  {
+    if(m_offset+n > m_sz) throw Document::BinaryFormatError(m_offset);
+
+    auto ptr = m_data + m_offset;
+    m_offset += n;
+
+    return ptr;
+  }
+
+  u8 u8_() { return *bytes(sizeof(u8)); }
+  u32 u32_()
+  {
+    u32 x;
+    memcpy(&x, bytes(sizeof(u32)), sizeof(u32));
+
+    return x;
+  }
+
+  const byte *m_data;
+  size_t m_sz;
+  size_t m_offset;
+};
+
+std::string Document::toBinary() const
+{
+  std::string out;
+  if(m_root) binary_write_node(out, m_root);
+
+  return out;
+}
+
+Document Document::from_binary(const void *data, size_t sz)
+{
+  if(!sz) return Document();
+
+  BinaryReader reader((const byte *)data, sz);
+
+  auto root = reader.node();
+  if(!reader.done()) throw BinaryFormatError(sz);
+
+  return Document(root);
+}
+
 Node::Ptr Document::get() const
 {
   return m_root;
@@ -488,19 +658,16 @@ Node::Ptr Document::get() const
 
 Node::Ptr Document::get(const std::string& what) const
 {
-  auto node = m_root;
+  return get(Path(what));
+}
 
-  std::istringstream stream(what);
-  std::string term;
-  while(std::getline(stream, term, '.')) {
-    char *end = nullptr;
-    auto idx = strtoull(term.data(), &end, 0);
+Node::Ptr Document::get(const Path& path) const
+{
+  auto node = m_root;
+  if(!node) return Node::Ptr();
 
-    if(end == term.data()+term.length()) { // 'term' was an index
-      node = node->get(idx);
-    } else {
-      node = node->get(term);
-    }
+  for(const auto& term : path.terms()) {
+    node = term.is_index ? node->get(term.idx) : node->get(term.key);
 
     if(!node) return Node::Ptr();
   }
@@ -508,4 +675,30 @@ Node::Ptr Document::get(const std::string& what) const
   return node;
 }
 
+Path::Path(const std::string& what)
+{
+  size_t begin = 0;
+  while(begin < what.length()) {
+    auto end = what.find('.', begin);
+    if(end == std::string::npos) end = what.length();
+
+    Term term;
+    term.key = what.substr(begin, end-begin);
+
+    char *idx_end = nullptr;
+    term.idx = strtoull(term.key.data(), &idx_end, 0);
+    term.is_index = idx_end == term.key.data()+term.key.length();
+
+    if(term.is_index) term.key.clear();
+
+    m_terms.push_back(std::move(term));
+    begin = end+1;
+  }
+}
+
+const Path::Terms& Path::terms() const
+{
+  return m_terms;
+}
+
 }
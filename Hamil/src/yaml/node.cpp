@@ -3,10 +3,11 @@
 
 #include <yaml.h>
 
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
+#include <string_view>
 #include <unordered_map>
-#include <regex>
 
 namespace yaml {
 
@@ -107,34 +108,152 @@ std::string Scalar::repr() const
   return tag() ? tagString()+" "+val : val;
 }
 
-// Must be kept in sync with Scalar::DataType!
+// Hand-written matchers for the untagged scalar types, equivalent to the regexes:
+//   Null:    ~|null                                         (case-insensitive)
+//   Int:     [-+]?0b[0-1_]+|[-+]?0[0-7_]+
+//            |[-+]?(0|[1-9][0-9_]*)
+//            |[-+]?0x[0-9a-fA-F_]+
+//            |[-+]?[1-9][0-9_]*(:[0-5]?[0-9])+
+//   Float:   [-+]?([0-9][0-9_]*)?\.[0-9.]*([eE][-+][0-9]+)?
+//            |[-+]?[0-9][0-9_]*(:[0-5]?[0-9])+\.[0-9_]*
+//            |[-+]?\.(inf|Inf|INF)
+//            |\.(nan|NaN|NAN)
+//   Boolean: (yes|true|on|y)|(no|false|off|n)               (case-insensitive)
 // 
-// The Scalar::Int,Scalar::Float regex patterns come from:
+// The Scalar::Int,Scalar::Float patterns come from:
 //   - yaml.org/type/int.html
 //   - yaml.org/type/float.html
-static const std::regex p_datatype_regexes[] = {
-  // Scalar::Null
-  std::regex("~|null",                            std::regex::icase|std::regex::optimize), 
-
-  // Scalar::Int
-  std::regex("[-+]?0b[0-1_]+|[-+]?0[0-7_]+"
-             "|[-+]?(0|[1-9][0-9_]*)"
-             "|[-+]?0x[0-9a-fA-F_]+"
-             "|[-+]?[1-9][0-9_]*(:[0-5]?[0-9])+", std::regex::optimize),
-
-  // Scalar::Float
-  std::regex("[-+]?([0-9][0-9_]*)?\\.[0-9.]*([eE][-+][0-9]+)?"
-             "|[-+]?[0-9][0-9_]*(:[0-5]?[0-9])+\\.[0-9_]*"
-             "|[-+]?\\.(inf|Inf|INF)"
-             "|\\.(nan|NaN|NAN)",                 std::regex::optimize),
-
-  // Scalar::Boolean
-  std::regex("(yes|true|on|y)"
-             "|(no|false|off|n)",                 std::regex::icase|std::regex::optimize),
-
-  // Scalar::String
-  std::regex(".*",                                std::regex::optimize),
-};
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+static bool is_digit_(char c) { return is_digit(c) || c == '_'; }
+
+template <typename Pred>
+static const char *skip_while(const char *p, const char *end, Pred pred)
+{
+  while(p != end && pred(*p)) p++;
+
+  return p;
+}
+
+static bool equals_icase(const char *p, const char *end, const char *str)
+{
+  for(; p != end; p++, str++) {
+    if(!*str || tolower((unsigned char)*p) != *str) return false;
+  }
+
+  return !*str;
+}
+
+static const char *skip_sign(const char *p, const char *end)
+{
+  return p != end && (*p == '-' || *p == '+') ? p+1 : p;
+}
+
+// Matches (:[0-5]?[0-9])+ and returns a pointer past the
+//   last group or nullptr when there are none
+static const char *skip_sexagesimal(const char *p, const char *end)
+{
+  if(p == end || *p != ':') return nullptr;
+
+  while(p != end && *p == ':') {
+    p++;
+    if(p == end || !is_digit(*p)) return nullptr;
+
+    if(p+1 != end && is_digit(p[1])) {
+      if(*p > '5') return nullptr;
+      p += 2;
+    } else {
+      p++;
+    }
+  }
+
+  return p;
+}
+
+static bool match_null(const char *p, const char *end)
+{
+  return (end-p == 1 && *p == '~') || equals_icase(p, end, "null");
+}
+
+static bool match_int(const char *p, const char *end)
+{
+  p = skip_sign(p, end);
+  if(p == end) return false;
+
+  if(*p == '0') {
+    if(end-p == 1) return true;
+
+    auto digits = p+2;
+    switch(p[1]) {
+    case 'b': return digits != end && skip_while(digits, end, [](char c) { return c == '0' || c == '1' || c == '_'; }) == end;
+    case 'x': return digits != end && skip_while(digits, end, [](char c) { return isxdigit((unsigned char)c) || c == '_'; }) == end;
+    }
+
+    return skip_while(p+1, end, [](char c) { return (c >= '0' && c <= '7') || c == '_'; }) == end;
+  }
+
+  if(!is_digit(*p)) return false;
+
+  p = skip_while(p+1, end, is_digit_);
+  if(p == end) return true;
+
+  return skip_sexagesimal(p, end) == end;
+}
+
+// Matches [0-9.]*([eE][-+][0-9]+)?
+static bool match_fraction(const char *p, const char *end)
+{
+  p = skip_while(p, end, [](char c) { return is_digit(c) || c == '.'; });
+  if(p == end) return true;
+
+  if(*p != 'e' && *p != 'E') return false;
+  p++;
+
+  if(p == end || (*p != '-' && *p != '+')) return false;
+  p++;
+
+  if(p == end || !is_digit(*p)) return false;
+
+  return skip_while(p, end, is_digit) == end;
+}
+
+static bool match_float(const char *p, const char *end)
+{
+  auto begin = p;
+  p = skip_sign(p, end);
+  if(p == end) return false;
+
+  if(*p == '.') {
+    auto special = std::string_view(p+1, end-p-1);
+    if(special == "inf" || special == "Inf" || special == "INF") return true;
+    if(p == begin && (special == "nan" || special == "NaN" || special == "NAN")) return true;
+
+    return match_fraction(p+1, end);
+  }
+
+  if(!is_digit(*p)) return false;
+
+  p = skip_while(p+1, end, is_digit_);
+  if(p == end) return false;
+
+  if(*p == '.') return match_fraction(p+1, end);
+
+  p = skip_sexagesimal(p, end);
+  if(!p || p == end || *p != '.') return false;
+
+  return skip_while(p+1, end, is_digit_) == end;
+}
+
+// Returns -1 when [p, end) isn't a Boolean
+static int match_bool(const char *p, const char *end)
+{
+  static const char *true_strs[]  = { "yes", "true", "on", "y" };
+  static const char *false_strs[] = { "no", "false", "off", "n" };
+
+  for(auto str : true_strs)  if(equals_icase(p, end, str)) return 1;
+  for(auto str : false_strs) if(equals_icase(p, end, str)) return 0;
+
+  return -1;
+}
 
 static const std::unordered_map<std::string, Scalar::DataType> p_core_types = {
   { YAML_NULL_TAG,  Scalar::Null    },
@@ -146,24 +265,36 @@ static const std::unordered_map<std::string, Scalar::DataType> p_core_types = {
 
 Scalar::DataType Scalar::dataType() const
 {
-  if(tag()) {
-    auto val = tag().value();
-    if(val.front() == '!') return Scalar::Tagged;
+  if(tag()) return tag_data_type(tag().value());
 
-    auto it = p_core_types.find(val);
-    if(it == p_core_types.end()) return Scalar::Invalid;
+  return data_type(str(), size());
+}
 
-    return it->second;
-  }
+Scalar::DataType Scalar::data_type(const char *data, size_t sz)
+{
+  auto end = data+sz;
 
-  std::string s = str();
-  for(int i = 0; i < NumDataTypes; i++) {
-    if(!std::regex_match(s, p_datatype_regexes[i])) continue;
+  if(match_null(data, end))       return Scalar::Null;
+  if(match_int(data, end))        return Scalar::Int;
+  if(match_float(data, end))      return Scalar::Float;
+  if(match_bool(data, end) >= 0)  return Scalar::Boolean;
 
-    return (DataType)i;
-  }
+  return Scalar::String;
+}
+
+Scalar::DataType Scalar::tag_data_type(const std::string& tag)
+{
+  if(tag.front() == '!') return Scalar::Tagged;
+
+  auto it = p_core_types.find(tag);
+  if(it == p_core_types.end()) return Scalar::Invalid;
 
-  return Scalar::Invalid; // should never be reached
+  return it->second;
+}
+
+bool Scalar::parse_bool(const char *data, size_t sz)
+{
+  return match_bool(data, data+sz) > 0;
 }
 
 const char *Scalar::str() const
@@ -193,11 +324,7 @@ bool Scalar::b() const
 {
   if(auto val = probeCache<bool>()) return *val;
 
-  std::match_results<const char *> matches;
-  if(!std::regex_match(str(), matches, p_datatype_regexes[Scalar::Boolean])) return false;
-
-  return fillCache(matches[1].matched); // matches[0] is the whole pattern
-                                        // matches[1..n] are the capture groups
+  return fillCache(parse_bool(str(), size()));
 }
 
 bool Scalar::null() const
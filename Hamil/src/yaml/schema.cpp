@@ -1,7 +1,65 @@
 #include <yaml/schema.h>
 
+#include <array>
+#include <cassert>
+
 namespace yaml {
 
+using CharClass = std::array<bool, 256>;
+
+static constexpr CharClass char_class(const char *chars)
+{
+  CharClass c = {};
+  for(; *chars; chars++) c[(unsigned char)*chars] = true;
+
+  return c;
+}
+
+static constexpr CharClass p_path_invalid_chars = char_class("<>:\"|?* ");
+static constexpr CharClass p_filename_invalid_chars = char_class("<>;\"|?* ");
+
+static bool has_invalid_chars(const char *str, const CharClass& invalid)
+{
+  for(; *str; str++) {
+    if(invalid[(unsigned char)*str]) return true;
+  }
+
+  return false;
+}
+
+// Equivalent to matching "((/[^<>:\"/\\|?* ]*)+/?)?"
+static bool is_path(const char *str)
+{
+  if(!*str) return true;
+
+  return *str == '/' && !has_invalid_chars(str, p_path_invalid_chars);
+}
+
+// Equivalent to matching "[^<>;\"\\|?* ]+"
+static bool is_filename(const char *str)
+{
+  return *str && !has_invalid_chars(str, p_filename_invalid_chars);
+}
+
+static bool scalar_is_type(const Node::Ptr& node, Scalar::DataType type)
+{
+  if(auto scalar = node->as<Scalar>()) {
+    if(type == Scalar::Invalid) return true;
+
+    return scalar->dataType() == type;
+  }
+
+  return false;
+}
+
+template <typename Fn>
+static bool scalar_matches(const Node::Ptr& node, Fn fn)
+{
+  if(auto scalar = node->as<Scalar>()) return fn(scalar->str());
+
+  return false;
+}
+
 SchemaCondition::SchemaCondition(Flags flags) :
   m_flags(flags)
 {
@@ -15,46 +73,72 @@ bool SchemaCondition::validate(const Node::Ptr& node) const
                              // it's optional
 }
 
+u32 SchemaCondition::compile(SchemaProgram& program) const
+{
+  auto idx = emit(program, SchemaOp::Custom);
+  program[idx].custom = this;
+
+  return idx;
+}
+
+u32 SchemaCondition::emit(SchemaProgram& program, SchemaOp::Code code,
+  Scalar::DataType type, u32 element) const
+{
+  SchemaOp op;
+  op.code = code;
+  op.flags = m_flags;
+  op.type = type;
+  op.element = element;
+  op.custom = nullptr;
+
+  program.push_back(op);
+
+  return (u32)(program.size() - 1);
+}
+
 ScalarCondition::ScalarCondition(Flags flags, Scalar::DataType type) :
   SchemaCondition(flags), m_type(type)
 {
 }
 
-bool ScalarCondition::doValidate(const Node::Ptr& node) const
+u32 ScalarCondition::compile(SchemaProgram& program) const
 {
-  if(auto scalar = node->as<Scalar>()) {
-    if(m_type == Scalar::Invalid) return true;
-
-    return scalar->dataType() == m_type;
-  }
+  return emit(program, SchemaOp::IsScalar, m_type);
+}
 
-  return false;
+bool ScalarCondition::doValidate(const Node::Ptr& node) const
+{
+  return scalar_is_type(node, m_type);
 }
 
-RegexCondition::RegexCondition(Flags flags) :
+PathCondition::PathCondition(Flags flags) :
   SchemaCondition(flags)
 {
 }
 
-bool RegexCondition::doValidate(const Node::Ptr& node) const
+u32 PathCondition::compile(SchemaProgram& program) const
 {
-  if(auto path = node->as<Scalar>()) {
-    return std::regex_match(path->str(), regex());
-  }
+  return emit(program, SchemaOp::IsPath);
+}
 
-  return false;
+bool PathCondition::doValidate(const Node::Ptr& node) const
+{
+  return scalar_matches(node, is_path);
+}
+
+FileCondition::FileCondition(Flags flags) :
+  SchemaCondition(flags)
+{
 }
 
-static const std::regex p_path_regex("^((/[^<>:\"/\\|?* ]*)+/?)?$", std::regex::optimize);
-const std::regex& PathCondition::regex() const
+u32 FileCondition::compile(SchemaProgram& program) const
 {
-  return p_path_regex;
+  return emit(program, SchemaOp::IsFile);
 }
 
-static const std::regex p_filename_regex("^[^<>;\"\\|?* ]+$", std::regex::optimize);
-const std::regex& FileCondition::regex() const
+bool FileCondition::doValidate(const Node::Ptr& node) const
 {
-  return p_filename_regex;
+  return scalar_matches(node, is_filename);
 }
 
 SequenceCondition::SequenceCondition(Flags flags) :
@@ -62,13 +146,14 @@ SequenceCondition::SequenceCondition(Flags flags) :
 {
 }
 
-bool SequenceCondition::doValidate(const Node::Ptr& node) const
+u32 SequenceCondition::compile(SchemaProgram& program) const
 {
-  if(auto seq = node->as<Sequence>()) {
-    return true;
-  }
+  return emit(program, SchemaOp::IsSequence);
+}
 
-  return false;
+bool SequenceCondition::doValidate(const Node::Ptr& node) const
+{
+  return node->type() == Node::Sequence;
 }
 
 MappingCondition::MappingCondition(Flags flags) :
@@ -76,21 +161,28 @@ MappingCondition::MappingCondition(Flags flags) :
 {
 }
 
-bool MappingCondition::doValidate(const Node::Ptr& node) const
+u32 MappingCondition::compile(SchemaProgram& program) const
 {
-  if(auto map = node->as<Mapping>()) {
-    return true;
-  }
-
-  return false;
+  return emit(program, SchemaOp::IsMapping);
 }
 
+bool MappingCondition::doValidate(const Node::Ptr& node) const
+{
+  return node->type() == Node::Mapping;
+}
 
 AllOfCondition::AllOfCondition(SchemaCondition::Ptr cond, Flags flags) :
   SchemaCondition(flags), m_cond(cond)
 {
 }
 
+u32 AllOfCondition::compile(SchemaProgram& program) const
+{
+  auto element = m_cond->compile(program);
+
+  return emit(program, SchemaOp::AllOf, Scalar::Invalid, element);
+}
+
 bool AllOfCondition::doValidate(const Node::Ptr& node) const
 {
   if(auto seq = node->as<Sequence>()) {
@@ -104,20 +196,52 @@ bool AllOfCondition::doValidate(const Node::Ptr& node) const
 
 Node::Ptr Schema::validate(const Document& doc) const
 {
-  for(const auto& cond : m_conditions) {
-    auto node = doc(cond.first);
+  for(const auto& check : m_checks) {
+    auto node = doc(check.path);
 
     // bail out when the node failes validation
-    if(!cond.second->validate(node)) return node;
+    if(!execute(check.op, node)) return node;
   }
 
   // validation successful
   return {};
 }
 
+bool Schema::execute(u32 idx, const Node::Ptr& node) const
+{
+  const auto& op = m_program[idx];
+
+  // if there's no value return true only when it's optional
+  if(!node) return op.flags & Optional;
+
+  switch(op.code) {
+  case SchemaOp::IsScalar:   return scalar_is_type(node, op.type);
+  case SchemaOp::IsPath:     return scalar_matches(node, is_path);
+  case SchemaOp::IsFile:     return scalar_matches(node, is_filename);
+  case SchemaOp::IsSequence: return node->type() == Node::Sequence;
+  case SchemaOp::IsMapping:  return node->type() == Node::Mapping;
+
+  case SchemaOp::AllOf:
+    if(auto seq = node->as<Sequence>()) {
+      for(auto& elem : *seq) if(!execute(op.element, elem)) return false;
+
+      return true;
+    }
+    return false;
+
+  case SchemaOp::Custom: return op.custom->validate(node);
+  }
+
+  assert(0); // unreachable
+  return false;
+}
+
 Schema& Schema::condition(const std::string& node, SchemaCondition *cond)
 {
-  m_conditions.emplace_back(node, cond);
+  auto ptr = SchemaCondition::Ptr(cond);
+  auto op = ptr->compile(m_program);
+
+  m_checks.push_back({ Path(node), op, ptr });
   return *this;
 }
 
@@ -161,4 +285,4 @@ Schema& Schema::scalarSequence(const std::string& node, Scalar::DataType type, F
   return allOf(node, cond<ScalarCondition>(Default, type), flags);
 }
 
-}
\ No newline at end of file
+}
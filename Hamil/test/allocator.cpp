@@ -0,0 +1,242 @@
+#include "test.h"
+
+#include <util/allocator.h>
+
+#include <cstdio>
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+namespace {
+
+struct Range {
+  size_t offset, sz;
+};
+
+// Returns 'true' when none of the 'ranges' overlap
+//   and all of them lie inside [0; sz)
+bool ranges_valid(std::vector<Range> ranges, size_t sz)
+{
+  std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+    return a.offset < b.offset;
+  });
+
+  size_t end = 0;
+  for(const auto& r : ranges) {
+    if(r.offset < end) return false;
+
+    end = r.offset + r.sz;
+    if(end > sz) return false;
+  }
+
+  return true;
+}
+
+}
+
+TEST_CASE(tlsf_alloc_dealloc)
+{
+  TLSFAllocator alloc(64);
+
+  CHECK(alloc.size() == 64);
+
+  auto a = alloc.alloc(16);
+  auto b = alloc.alloc(48);
+  CHECK(a != TLSFAllocator::Error && b != TLSFAllocator::Error);
+  CHECK(a != b);
+
+  // The whole range is in use
+  CHECK(alloc.alloc(1) == TLSFAllocator::Error);
+
+  alloc.dealloc(a, 16);
+  CHECK(alloc.alloc(16) != TLSFAllocator::Error);
+
+  CHECK(alloc.alloc(65) == TLSFAllocator::Error);
+}
+
+TEST_CASE(tlsf_alloc_whole_range)
+{
+  // Sizes which aren't on a bin boundary used to be rounded
+  //   up past the bin holding the only (large enough) block
+  for(size_t sz : { 16, 64, 100, 1000, 4097, 100000, 102400000 }) {
+    TLSFAllocator alloc(sz);
+
+    CHECK(alloc.alloc(sz) == 0);
+    CHECK(alloc.alloc(1) == TLSFAllocator::Error);
+  }
+}
+
+TEST_CASE(tlsf_random_stress)
+{
+  enum : size_t {
+    Size = 1<<20,
+    MaxAllocSize = 4096,
+    NumIterations = 200000,
+  };
+
+  TLSFAllocator alloc(Size);
+
+  std::mt19937 random(0x7154F);
+  std::uniform_int_distribution<size_t> random_sz(1, MaxAllocSize);
+
+  std::vector<Range> live;
+  size_t in_use = 0;
+
+  for(size_t i = 0; i < NumIterations; i++) {
+    // Bias towards allocating until the range is mostly
+    //   full and then keep it hovering there
+    bool do_alloc = live.empty() || (random() % 100) < (in_use < Size*3/4 ? 70u : 40u);
+
+    if(do_alloc) {
+      auto sz = random_sz(random);
+      auto offset = alloc.alloc(sz);
+
+      if(offset == TLSFAllocator::Error) {
+        // Failing is only allowed when the range can't fit 'sz' at all...
+        CHECK(in_use + sz > Size || in_use > Size/2);
+        continue;
+      }
+
+      // ...and successful allocations must lie inside of it
+      CHECK(offset + sz <= Size);
+
+      live.push_back({ offset, sz });
+      in_use += sz;
+    } else {
+      auto idx = random() % live.size();
+      auto r = live[idx];
+
+      alloc.dealloc(r.offset, r.sz);
+      in_use -= r.sz;
+
+      live[idx] = live.back();
+      live.pop_back();
+    }
+
+    if(i % 10000 == 0) CHECK(ranges_valid(live, Size));
+  }
+
+  CHECK(ranges_valid(live, Size));
+
+  // Returning every range must coalesce all the free
+  //   blocks back into one spanning the whole range
+  for(const auto& r : live) alloc.dealloc(r.offset, r.sz);
+
+  CHECK(alloc.alloc(Size) == 0);
+}
+
+TEST_CASE(tlsf_fill_exactly)
+{
+  enum : size_t {
+    Size = 1<<16,
+    AllocSize = 64,
+  };
+
+  TLSFAllocator alloc(Size);
+
+  std::vector<Range> ranges;
+  for(size_t i = 0; i < Size/AllocSize; i++) {
+    auto offset = alloc.alloc(AllocSize);
+    if(offset == TLSFAllocator::Error) break;
+
+    ranges.push_back({ offset, AllocSize });
+  }
+
+  CHECK(ranges.size() == Size/AllocSize);
+  CHECK(ranges_valid(ranges, Size));
+  CHECK(alloc.alloc(1) == TLSFAllocator::Error);
+
+  // Free every other range, which leaves only holes of AllocSize
+  for(size_t i = 0; i < ranges.size(); i += 2) alloc.dealloc(ranges[i].offset, AllocSize);
+
+  CHECK(alloc.alloc(AllocSize*2) == TLSFAllocator::Error);
+  CHECK(alloc.alloc(AllocSize) != TLSFAllocator::Error);
+}
+
+TEST_CASE(tlsf_small_ranges_in_large_range)
+{
+  enum : size_t {
+    // Large enough for many Blocks to share a bucket
+    Size = 1<<24,
+    MaxAllocSize = 8,
+    NumRanges = 20000,
+  };
+
+  TLSFAllocator alloc(Size);
+
+  std::mt19937 random(0x5A11);
+  std::uniform_int_distribution<size_t> random_sz(1, MaxAllocSize);
+
+  std::vector<Range> ranges;
+  for(size_t i = 0; i < NumRanges; i++) {
+    auto sz = random_sz(random);
+    ranges.push_back({ alloc.alloc(sz), sz });
+  }
+
+  for(const auto& r : ranges) CHECK(r.offset != TLSFAllocator::Error);
+  CHECK(ranges_valid(ranges, Size));
+
+  // Free half of them in a random order and then allocate
+  //   again, so freed Blocks get re-used and re-split
+  std::shuffle(ranges.begin(), ranges.end(), random);
+  for(size_t i = NumRanges/2; i < NumRanges; i++) alloc.dealloc(ranges[i].offset, ranges[i].sz);
+  ranges.resize(NumRanges/2);
+
+  for(size_t i = 0; i < NumRanges/2; i++) {
+    auto sz = random_sz(random);
+    ranges.push_back({ alloc.alloc(sz), sz });
+  }
+
+  CHECK(ranges_valid(ranges, Size));
+
+  std::shuffle(ranges.begin(), ranges.end(), random);
+  for(const auto& r : ranges) alloc.dealloc(r.offset, r.sz);
+
+  CHECK(alloc.alloc(Size) == 0);
+}
+
+BENCHMARK(tlsf_100k_ranges)
+{
+  enum : size_t {
+    NumRanges = 100000,
+    MaxAllocSize = 1024,
+    Size = NumRanges*MaxAllocSize,
+  };
+
+  using Clock = std::chrono::high_resolution_clock;
+
+  TLSFAllocator alloc(Size);
+
+  std::mt19937 random(0x100000);
+  std::uniform_int_distribution<size_t> random_sz(1, MaxAllocSize);
+
+  std::vector<Range> ranges;
+  ranges.reserve(NumRanges);
+  for(size_t i = 0; i < NumRanges; i++) ranges.push_back({ 0, random_sz(random) });
+
+  auto alloc_start = Clock::now();
+  for(auto& r : ranges) r.offset = alloc.alloc(r.sz);
+  auto alloc_end = Clock::now();
+
+  for(const auto& r : ranges) CHECK(r.offset != TLSFAllocator::Error);
+
+  // Free them in a random order to fragment the range
+  std::shuffle(ranges.begin(), ranges.end(), random);
+
+  auto dealloc_start = Clock::now();
+  for(const auto& r : ranges) alloc.dealloc(r.offset, r.sz);
+  auto dealloc_end = Clock::now();
+
+  CHECK(alloc.alloc(Size) == 0);
+
+  auto ns_per_op = [](Clock::time_point start, Clock::time_point end) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    return (double)ns / (double)NumRanges;
+  };
+
+  printf("    alloc():   %.1fns/range\n", ns_per_op(alloc_start, alloc_end));
+  printf("    dealloc(): %.1fns/range\n", ns_per_op(dealloc_start, dealloc_end));
+}
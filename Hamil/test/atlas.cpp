@@ -0,0 +1,198 @@
+#include "test.h"
+
+#include <ft/atlas.h>
+
+#include <vector>
+#include <random>
+
+namespace {
+
+using ft::GlyphAtlas;
+
+// A 'width' x 'rows' bitmap of random, non-zero pixels
+std::vector<u8> random_bitmap(std::mt19937& random, unsigned width, unsigned rows)
+{
+  std::uniform_int_distribution<unsigned> pixel(1, 255);
+
+  std::vector<u8> bitmap(width*rows);
+  for(auto& p : bitmap) p = (u8)pixel(random);
+
+  return bitmap;
+}
+
+// Checks that none of the 'rects' (borders included) overlap or
+//   stick out of the atlas, and that all the pixels which aren't
+//   covered by any of their bitmaps are zero
+bool check_layout(const GlyphAtlas& atlas, const std::vector<GlyphAtlas::Rect>& rects)
+{
+  auto size = atlas.size();
+
+  // 0 - free, 1 - border, 2 - bitmap (in the atlas' top-down coordinates)
+  std::vector<u8> coverage(size*size, 0);
+  for(const auto& r : rects) {
+    if(r.x + r.width+2u > size || r.y + r.rows+2u > size) return false;
+
+    for(unsigned y = 0; y < r.rows+2u; y++) {
+      for(unsigned x = 0; x < r.width+2u; x++) {
+        auto& c = coverage[(r.y+y)*size + r.x+x];
+        if(c) return false;
+
+        bool border = x == 0 || y == 0 || x == r.width+1u || y == r.rows+1u;
+        c = border ? 1 : 2;
+      }
+    }
+  }
+
+  // The storage is upside down
+  for(unsigned y = 0; y < size; y++) {
+    for(unsigned x = 0; x < size; x++) {
+      if(coverage[y*size + x] == 2) continue;
+
+      if(atlas.pixels()[(size - y - 1)*size + x]) return false;
+    }
+  }
+
+  return true;
+}
+
+}
+
+TEST_CASE(glyph_atlas_pack)
+{
+  std::mt19937 random(0xA71A5);
+  GlyphAtlas atlas(64);
+
+  CHECK(atlas.dirtyBegin() == 0 && atlas.dirtyEnd() == 64);
+  atlas.clearDirty();
+
+  std::vector<std::vector<u8>> bitmaps;
+  std::vector<GlyphAtlas::Rect> rects;
+
+  // Fill the atlas up
+  for(;;) {
+    unsigned width = random() % 12 + 1, rows = random() % 12 + 1;
+    auto bitmap = random_bitmap(random, width, rows);
+
+    GlyphAtlas::Rect rect;
+    if(!atlas.pack(bitmap.data(), width, rows, rect)) break;
+
+    CHECK(rect.width == width && rect.rows == rows);
+
+    bitmaps.push_back(std::move(bitmap));
+    rects.push_back(rect);
+  }
+
+  CHECK(rects.size() > 10);
+  CHECK(check_layout(atlas, rects));
+
+  for(size_t i = 0; i < rects.size(); i++) CHECK(atlas.read(rects[i]) == bitmaps[i]);
+
+  // Only the rows which were written to are dirty
+  CHECK(atlas.dirtyBegin() < atlas.dirtyEnd());
+
+  auto size = atlas.size();
+  for(unsigned y = 0; y < size; y++) {
+    if(y >= atlas.dirtyBegin() && y < atlas.dirtyEnd()) continue;
+
+    for(unsigned x = 0; x < size; x++) CHECK(!atlas.pixels()[y*size + x]);
+  }
+
+  atlas.reset();
+  CHECK(atlas.dirtyBegin() == 0 && atlas.dirtyEnd() == 64);
+
+  for(unsigned i = 0; i < size*size; i++) CHECK(!atlas.pixels()[i]);
+}
+
+TEST_CASE(glyph_atlas_repack)
+{
+  std::mt19937 random(0x4E9AC);
+
+  for(unsigned size : { 64, 128, 256 }) {
+    GlyphAtlas atlas(size);
+
+    std::vector<std::vector<u8>> bitmaps;
+    std::vector<GlyphAtlas::Rect> rects;
+
+    std::vector<u8> overflow;
+    unsigned overflow_width = 0, overflow_rows = 0;
+
+    // Fill the atlas up, keeping the bitmap which didn't fit
+    for(;;) {
+      unsigned width = random() % 16 + 1, rows = random() % 16 + 1;
+      auto bitmap = random_bitmap(random, width, rows);
+
+      GlyphAtlas::Rect rect;
+      if(!atlas.pack(bitmap.data(), width, rows, rect)) {
+        overflow = std::move(bitmap);
+        overflow_width = width; overflow_rows = rows;
+        break;
+      }
+
+      bitmaps.push_back(std::move(bitmap));
+      rects.push_back(rect);
+    }
+
+    // Drop every other bitmap (as FontCache::evict() would)
+    std::vector<std::vector<u8>> live_bitmaps;
+    std::vector<GlyphAtlas::Rect> live;
+    for(size_t i = 0; i < rects.size(); i += 2) {
+      live_bitmaps.push_back(bitmaps[i]);
+      live.push_back(rects[i]);
+    }
+
+    std::vector<GlyphAtlas::Rect *> live_ptrs;
+    for(auto& r : live) live_ptrs.push_back(&r);
+
+    atlas.clearDirty();
+
+    std::vector<bool> packed;
+    atlas.repack(live_ptrs, packed);
+
+    // Half of the bitmaps easily fit into the space all of them took up
+    CHECK(packed.size() == live.size());
+    for(auto p : packed) CHECK(p);
+
+    // ...keeping their pixels, while the dropped ones are gone
+    CHECK(check_layout(atlas, live));
+    for(size_t i = 0; i < live.size(); i++) {
+      CHECK(atlas.read(live[i]) == live_bitmaps[i]);
+    }
+
+    // All of it has to be uploaded again
+    CHECK(atlas.dirtyBegin() == 0 && atlas.dirtyEnd() == size);
+
+    // The reclaimed space is reused
+    GlyphAtlas::Rect rect;
+    CHECK(atlas.pack(overflow.data(), overflow_width, overflow_rows, rect));
+
+    live.push_back(rect);
+    CHECK(check_layout(atlas, live));
+    CHECK(atlas.read(rect) == overflow);
+  }
+}
+
+TEST_CASE(glyph_atlas_repack_overflow)
+{
+  // A 14x14 bitmap fills the whole atlas by itself...
+  GlyphAtlas atlas(16);
+
+  std::mt19937 random(0x0F10);
+  auto big = random_bitmap(random, 14, 14);
+
+  GlyphAtlas::Rect big_rect;
+  CHECK(atlas.pack(big.data(), 14, 14, big_rect));
+
+  // ...so only one of them fits after repacking - the taller
+  //   one, as the bitmaps are packed tallest first
+  GlyphAtlas::Rect small_rect;
+  small_rect.width = 1; small_rect.rows = 1;
+  small_rect.x = small_rect.y = 0;
+
+  std::vector<GlyphAtlas::Rect *> rects = { &small_rect, &big_rect };
+  std::vector<bool> packed;
+  atlas.repack(rects, packed);
+
+  CHECK(packed.size() == 2);
+  CHECK(!packed[0] && packed[1]);
+  CHECK(atlas.read(big_rect) == big);
+}
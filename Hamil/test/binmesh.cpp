@@ -0,0 +1,268 @@
+#include "test.h"
+
+#include <mesh/binmesh.h>
+#include <mesh/mesh.h>
+#include <mesh/obj.h>
+#include <math/util.h>
+#include <os/file.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+const float Epsilon = 1e-3f;
+
+// Two objects, where the texture coordinates and normals are indexed
+//   differently from the positions, so ObjLoader::Normalize has to
+//   duplicate some of the vertices
+const char *SampleObj =
+  "o quad\n"
+  "v -1.0 -1.0 0.0\n"
+  "v  1.0 -1.0 0.0\n"
+  "v  1.0  1.0 0.0\n"
+  "v -1.0  1.0 0.0\n"
+  "vt 0.0 0.0\n"
+  "vt 1.0 0.0\n"
+  "vt 1.0 1.0\n"
+  "vt 0.0 1.0\n"
+  "vn 0.0 0.0 1.0\n"
+  "f 1/1/1 2/2/1 3/3/1\n"
+  "f 1/1/1 3/3/1 4/4/1\n"
+  "o tri\n"
+  "v 0.0 2.0 -1.0\n"
+  "v 3.0 2.0 -1.0\n"
+  "v 0.0 5.0 -1.0\n"
+  "vn 0.0 0.0 -1.0\n"
+  "f 5/1/2 6/2/2 7/4/2\n";
+
+mesh::ObjLoader load_sample_obj()
+{
+  mesh::ObjLoader obj;
+  obj.load(SampleObj, strlen(SampleObj), mesh::ObjLoader::Normalize);
+
+  return obj;
+}
+
+// Writes out 'builder' through an os::File (the same way resource-gen
+//   does) and returns the contents of the written file
+std::vector<byte> bake(mesh::BinMeshBuilder& builder)
+{
+  auto path = (fs::temp_directory_path() / "hamil_test.hmesh").string();
+
+  size_t sz = 0;
+  {
+    auto file = os::File::alloc();
+    file().open(path.data(), os::File::Write, os::File::ShareRead, os::File::CreateAlways);
+
+    sz = builder.write(file());
+  }
+
+  std::vector<byte> data;
+  {
+    auto file = os::File::alloc();
+    file().open(path.data(), os::File::Read);
+
+    data.resize(file().size());
+    file().read(data.data());
+  }
+
+  fs::remove(path);
+
+  CHECK(data.size() == sz);
+
+  return data;
+}
+
+bool load_throws_invalid(const std::vector<byte>& data, size_t sz)
+{
+  mesh::BinMeshLoader loader;
+  try {
+    loader.loadParams(data.data(), sz).load();
+  } catch(const mesh::BinMeshLoader::InvalidBinMeshError&) {
+    return !loader.loaded();
+  }
+
+  return false;
+}
+
+bool load_throws_invalid(const std::vector<byte>& data)
+{
+  return load_throws_invalid(data, data.size());
+}
+
+u32 read_u32(const std::vector<byte>& data, size_t offset)
+{
+  u32 x;
+  memcpy(&x, data.data() + offset, sizeof(u32));
+
+  return x;
+}
+
+void write_u32(std::vector<byte>& data, size_t offset, u32 x)
+{
+  memcpy(data.data() + offset, &x, sizeof(u32));
+}
+
+}
+
+TEST_CASE(binmesh_round_trip)
+{
+  auto obj = load_sample_obj();
+
+  for(uint flags : { mesh::BinMeshBuilder::Default, mesh::BinMeshBuilder::HalfFloat }) {
+    std::vector<vec3> occluder_verts = obj.vertices();
+    std::vector<u16> occluder_inds;
+    for(size_t i = 0; i < obj.numMeshes(); i++) {
+      for(const auto& face : obj.mesh((uint)i).faces()) {
+        for(const auto& vert : face) occluder_inds.push_back((u16)vert.v);
+      }
+    }
+
+    auto builder = mesh::BinMeshBuilder()
+      .fromObj(obj, flags)
+      .occluder(occluder_verts, occluder_inds);
+
+    auto data = bake(builder);
+
+    mesh::BinMeshLoader loader;
+    loader.loadParams(data.data(), data.size()).load();
+
+    CHECK(loader.loaded());
+
+    const auto& header = loader.header();
+    CHECK(header.magic == mesh::BinMeshHeader::Magic);
+    CHECK(header.vertex_components == (mesh::Mesh::Normal|mesh::Mesh::TexCoord));
+    CHECK(header.index_size == sizeof(u16));
+    CHECK(loader.vertexFormat().vertexByteSize() == header.vertex_stride);
+
+    // The vertices and indices must be uploadable straight from a mapping
+    CHECK(header.vertex_offset % mesh::BinMeshDataAlign == 0);
+    CHECK(header.index_offset % mesh::BinMeshDataAlign == 0);
+
+    // Submeshes
+    CHECK(loader.numSubmeshes() == obj.numSubmeshes());
+    for(uint i = 0; i < loader.numSubmeshes(); i++) {
+      auto a = loader.submesh(i), b = obj.submesh(i);
+
+      CHECK(a.first_index == b.first_index && a.num_inds == b.num_inds);
+      CHECK(a.aabb.min.distance(b.aabb.min) < Epsilon && a.aabb.max.distance(b.aabb.max) < Epsilon);
+    }
+
+    CHECK(loader.aabb().min.distance(vec3(-1.0f, -1.0f, -1.0f)) < Epsilon);
+    CHECK(loader.aabb().max.distance(vec3(3.0f, 5.0f, 0.0f)) < Epsilon);
+
+    // Positions and indices
+    std::vector<vec3> obj_verts, bin_verts;
+    std::vector<u32> obj_inds, bin_inds;
+    obj.positions(obj_verts, obj_inds);
+    loader.positions(bin_verts, bin_inds);
+
+    CHECK(obj_inds == bin_inds);
+    CHECK(obj_verts.size() == bin_verts.size());
+    for(size_t i = 0; i < std::min(obj_verts.size(), bin_verts.size()); i++) {
+      CHECK(obj_verts[i].distance(bin_verts[i]) < Epsilon);
+    }
+
+    // Normals and texture coordinates
+    bool half = flags & mesh::BinMeshBuilder::HalfFloat;
+    for(size_t i = 0; i < obj.vertices().size(); i++) {
+      auto vertex = data.data() + header.vertex_offset + i*header.vertex_stride + sizeof(vec3);
+
+      vec3 n;
+      vec2 uv;
+      if(half) {
+        hvec4 hn; hvec2 huv;
+        memcpy(&hn, vertex, sizeof(hvec4));
+        memcpy(&huv, vertex + sizeof(hvec4), sizeof(hvec2));
+
+        n = from_f16(hn).xyz();
+        uv = from_f16(huv);
+      } else {
+        memcpy(&n, vertex, sizeof(vec3));
+        memcpy(&uv, vertex + sizeof(vec3), sizeof(vec2));
+      }
+
+      CHECK(n.distance(obj.normals()[i]) < Epsilon);
+      CHECK(uv.distance(obj.texCoords()[i].xy()) < Epsilon);
+    }
+
+    // Occluder
+    CHECK(loader.occluderIndices() == occluder_inds);
+    CHECK(loader.occluderVertices().size() == occluder_verts.size());
+  }
+}
+
+TEST_CASE(binmesh_rejects_out_of_range_indices)
+{
+  auto obj = load_sample_obj();
+
+  auto builder = mesh::BinMeshBuilder().fromObj(obj);
+  auto data = bake(builder);
+
+  mesh::BinMeshHeader header;
+  memcpy(&header, data.data(), sizeof(mesh::BinMeshHeader));
+
+  // Sanity check - the unmodified file loads
+  CHECK(!load_throws_invalid(data));
+
+  // An index one past the last vertex
+  {
+    auto corrupt = data;
+
+    u16 idx = (u16)header.num_verts;
+    memcpy(corrupt.data() + header.index_offset + 2*sizeof(u16), &idx, sizeof(u16));
+
+    CHECK(load_throws_invalid(corrupt));
+  }
+
+  // A submesh which runs past the end of the indices
+  {
+    auto corrupt = data;
+
+    auto submesh_offset = sizeof(mesh::BinMeshHeader) + sizeof(mesh::BinSubmesh);
+    auto num_inds_offset = submesh_offset + offsetof(mesh::BinSubmesh, num_inds);
+
+    write_u32(corrupt, num_inds_offset, read_u32(corrupt, num_inds_offset) + 3);
+
+    CHECK(load_throws_invalid(corrupt));
+  }
+
+  // An occluder index past the occluder's vertices
+  {
+    std::vector<vec3> verts = { vec3(0.0f), vec3(1.0f), vec3(2.0f) };
+
+    builder.occluder(verts, { 0, 1, 3 });
+    CHECK(load_throws_invalid(bake(builder)));
+  }
+
+  // More indices than the file holds
+  {
+    auto corrupt = data;
+
+    write_u32(corrupt, offsetof(mesh::BinMeshHeader, num_inds), header.num_inds + 1024);
+
+    CHECK(load_throws_invalid(corrupt));
+  }
+
+  // Truncated files
+  for(size_t sz : { (size_t)0, sizeof(mesh::BinMeshHeader) - 1, (size_t)header.index_offset + 2 }) {
+    CHECK(load_throws_invalid(data, sz));
+  }
+
+  // Wrong magic
+  {
+    auto corrupt = data;
+
+    write_u32(corrupt, offsetof(mesh::BinMeshHeader, magic), 0);
+
+    CHECK(load_throws_invalid(corrupt));
+  }
+}
@@ -0,0 +1,144 @@
+#include "test.h"
+
+#include <res/cache.h>
+#include <res/resource.h>
+
+#include <vector>
+
+namespace {
+
+// Resource whose residentSize() is settable
+class SizedResource : public res::Resource {
+public:
+  static constexpr Tag tag() { return "SizedResource"; }
+
+  SizedResource(Id id, size_t size) :
+    Resource(id, tag(), "sized" + std::to_string(id), Memory, ""),
+    m_size(size)
+  { }
+
+  virtual size_t residentSize() const override { return m_size; }
+
+  void size(size_t sz) { m_size = sz; }
+
+private:
+  size_t m_size;
+};
+
+res::Resource::Ptr make_resource(res::Resource::Id id, size_t size)
+{
+  return res::Resource::Ptr(new SizedResource(id, size));
+}
+
+// Fills 'cache' with resources of 'size' bytes with ids [0; n),
+//   NOT keeping any references to them
+void fill_cache(res::ResourceCache& cache, size_t n, size_t size)
+{
+  for(res::Resource::Id id = 0; id < n; id++) cache.fill(make_resource(id, size));
+}
+
+bool cached(res::ResourceCache& cache, res::Resource::Id id)
+{
+  auto r = cache.probe(id);
+
+  return r && !r->expired();
+}
+
+}
+
+TEST_CASE(resource_cache_evicts_least_recently_used)
+{
+  res::ResourceCache cache(res::ResourceCache::Generic, 400);
+
+  fill_cache(cache, 4, 100);
+  CHECK(cache.stats().num_resources == 4);
+  CHECK(cache.stats().resident_bytes == 400);
+  CHECK(cache.stats().evictions == 0);
+
+  // 0 becomes the most recently used, so 1 is next in line
+  cache.probe(0);
+
+  cache.fill(make_resource(4, 100));
+  CHECK(cache.stats().evictions == 1);
+  CHECK(cache.stats().resident_bytes == 400);
+
+  CHECK(!cached(cache, 1));
+  CHECK(cached(cache, 0) && cached(cache, 2) && cached(cache, 3) && cached(cache, 4));
+
+  // The probes above made 0 the least recently used again
+  cache.fill(make_resource(5, 150));
+  CHECK(cache.stats().evictions == 3);
+  CHECK(cache.stats().resident_bytes <= cache.budget());
+
+  CHECK(!cached(cache, 0) && !cached(cache, 2));
+  CHECK(cached(cache, 3) && cached(cache, 4) && cached(cache, 5));
+}
+
+TEST_CASE(resource_cache_keeps_referenced_resources)
+{
+  res::ResourceCache cache(res::ResourceCache::Generic, 300);
+
+  // The least recently used resource is held onto
+  //   outside of the cache, so it must be skipped
+  auto pinned = make_resource(0, 100);
+  cache.fill(pinned);
+  cache.fill(make_resource(1, 100));
+  cache.fill(make_resource(2, 100));
+
+  cache.fill(make_resource(3, 100));
+  CHECK(cache.stats().evictions == 1);
+  CHECK(cached(cache, 0));
+  CHECK(!cached(cache, 1));
+
+  // Nothing can be evicted - the cache goes over budget
+  //   rather than drop a resource which is in use
+  std::vector<res::Resource::Ptr> refs;
+  for(res::Resource::Id id : { 2, 3 }) refs.push_back(cache.probe(id)->lock());
+
+  cache.fill(make_resource(4, 100));
+  CHECK(cache.stats().evictions == 1);
+  CHECK(cache.stats().resident_bytes == 400);
+
+  // Once the references are dropped the cache can be trimmed
+  //   back, oldest first
+  refs.clear();
+  pinned.reset();
+
+  CHECK(cache.trim() == 1);
+  CHECK(cache.stats().resident_bytes == 300);
+  CHECK(cached(cache, 4));
+}
+
+TEST_CASE(resource_cache_budget)
+{
+  res::ResourceCache cache(res::ResourceCache::Generic);
+
+  fill_cache(cache, 10, 100);
+  CHECK(cache.stats().evictions == 0);
+  CHECK(cache.stats().resident_bytes == 1000);
+
+  // Lowering the budget trims the cache right away
+  cache.budget(550);
+  CHECK(cache.stats().evictions == 5);
+  CHECK(cache.stats().num_resources == 5);
+  CHECK(cache.stats().resident_bytes == 500);
+
+  for(res::Resource::Id id = 0; id < 5; id++) CHECK(!cached(cache, id));
+
+  // Resources which grew after being inserted are
+  //   accounted for by trim()
+  auto r = cache.probe(9)->lock();
+  static_cast<SizedResource *>(r.get())->size(300);
+  r.reset();
+
+  cache.trim();
+  CHECK(cache.stats().resident_bytes <= cache.budget());
+  CHECK(cached(cache, 9));
+
+  // Static caches never evict
+  res::ResourceCache static_cache(res::ResourceCache::Static, 100);
+
+  fill_cache(static_cache, 4, 100);
+  CHECK(static_cache.stats().evictions == 0);
+  CHECK(static_cache.stats().resident_bytes == 400);
+}
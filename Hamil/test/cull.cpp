@@ -0,0 +1,203 @@
+#include "test.h"
+
+#include <math/geometry.h>
+#include <math/frustum.h>
+#include <math/xform.h>
+#include <math/cull.h>
+
+#include <cmath>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+namespace {
+
+enum : size_t {
+  // Not a multiple of 8, so the scalar tail
+  //   of the kernels is exercised as well
+  NumObjects = 10007,
+};
+
+// The kernels evaluate the plane equations in a different order
+//   than frustum3, so objects lying (almost) exactly on one of
+//   the planes are allowed to disagree
+const float Epsilon = 1e-3f;
+
+frustum3 test_frustum()
+{
+  auto view = xform::look_at(vec3(10.0f, 5.0f, 20.0f), vec3(0.0f), vec3::up());
+  auto projection = xform::perspective(70.0f, 16.0f/9.0f, 0.1f, 100.0f);
+
+  return frustum3(view, projection);
+}
+
+// Returns the smallest distance from any of the frustum's
+//   planes to the sphere's surface
+float sphere_plane_distance(const frustum3& frustum, const vec3& c, float r)
+{
+  float dist = INFINITY;
+  for(const auto& p : frustum.planes) {
+    float d = p.x*c.x + p.y*c.y + p.z*c.z + p.w;
+
+    dist = std::min(dist, fabsf(d + r));
+  }
+
+  return dist;
+}
+
+// Returns the smallest distance from any of the frustum's
+//   planes to the AABB's positive vertex
+float aabb_plane_distance(const frustum3& frustum, const AABB& aabb)
+{
+  float dist = INFINITY;
+  for(const auto& p : frustum.planes) {
+    float x = p.x > 0.0f ? aabb.max.x : aabb.min.x;
+    float y = p.y > 0.0f ? aabb.max.y : aabb.min.y;
+    float z = p.z > 0.0f ? aabb.max.z : aabb.min.z;
+
+    dist = std::min(dist, fabsf(p.x*x + p.y*y + p.z*z + p.w));
+  }
+
+  return dist;
+}
+
+}
+
+TEST_CASE(cull_spheres_match_frustum3)
+{
+  auto frustum = test_frustum();
+
+  std::mt19937 random(0xC011);
+  std::uniform_real_distribution<float> random_pos(-150.0f, 150.0f);
+  std::uniform_real_distribution<float> random_r(0.0f, 20.0f);
+
+  std::vector<float> x(NumObjects), y(NumObjects), z(NumObjects), r(NumObjects);
+  for(size_t i = 0; i < NumObjects; i++) {
+    x[i] = random_pos(random); y[i] = random_pos(random); z[i] = random_pos(random);
+    r[i] = random_r(random);
+  }
+
+  std::vector<u32> mask(cull_mask_size(NumObjects));
+  frustum_spheres_inside(frustum, { x.data(), y.data(), z.data(), r.data() }, NumObjects, mask.data());
+
+  size_t num_inside = 0, num_mismatched = 0;
+  for(size_t i = 0; i < NumObjects; i++) {
+    vec3 c(x[i], y[i], z[i]);
+
+    bool expected = frustum.sphereInside(c, r[i]);
+    bool inside = cull_mask_test(mask.data(), i);
+
+    if(inside != expected) {
+      num_mismatched++;
+
+      CHECK(sphere_plane_distance(frustum, c, r[i]) < Epsilon);
+    }
+
+    if(inside) num_inside++;
+  }
+
+  // Make sure the frustum actually splits the spheres
+  CHECK(num_inside > 0 && num_inside < NumObjects);
+  CHECK(num_mismatched < 4);
+}
+
+TEST_CASE(cull_aabbs_match_frustum3)
+{
+  auto frustum = test_frustum();
+
+  std::mt19937 random(0xAABB);
+  std::uniform_real_distribution<float> random_pos(-150.0f, 150.0f);
+  std::uniform_real_distribution<float> random_extent(0.0f, 20.0f);
+
+  std::vector<AABB> aabbs(NumObjects);
+  std::vector<float> min_x(NumObjects), min_y(NumObjects), min_z(NumObjects);
+  std::vector<float> max_x(NumObjects), max_y(NumObjects), max_z(NumObjects);
+  for(size_t i = 0; i < NumObjects; i++) {
+    vec3 min(random_pos(random), random_pos(random), random_pos(random));
+    vec3 extent(random_extent(random), random_extent(random), random_extent(random));
+
+    aabbs[i] = AABB(min, min + extent);
+
+    min_x[i] = aabbs[i].min.x; min_y[i] = aabbs[i].min.y; min_z[i] = aabbs[i].min.z;
+    max_x[i] = aabbs[i].max.x; max_y[i] = aabbs[i].max.y; max_z[i] = aabbs[i].max.z;
+  }
+
+  AABBsSoA soa = {
+    min_x.data(), min_y.data(), min_z.data(),
+    max_x.data(), max_y.data(), max_z.data(),
+  };
+
+  std::vector<u32> mask(cull_mask_size(NumObjects));
+  frustum_aabbs_inside(frustum, soa, NumObjects, mask.data());
+
+  size_t num_inside = 0, num_mismatched = 0;
+  for(size_t i = 0; i < NumObjects; i++) {
+    bool expected = frustum.aabbInside(aabbs[i]);
+    bool inside = cull_mask_test(mask.data(), i);
+
+    if(inside != expected) {
+      num_mismatched++;
+
+      CHECK(aabb_plane_distance(frustum, aabbs[i]) < Epsilon);
+    }
+
+    if(inside) num_inside++;
+  }
+
+  CHECK(num_inside > 0 && num_inside < NumObjects);
+  CHECK(num_mismatched < 4);
+}
+
+TEST_CASE(cull_mask_tail_bits_clear)
+{
+  auto frustum = test_frustum();
+
+  // Every sphere is huge, so all of them are inside, but
+  //   the bits past 'n' in the last mask word must stay clear
+  for(size_t n : { 1, 3, 4, 7, 8, 9, 31, 32, 33, 45 }) {
+    std::vector<float> zeroes(n, 0.0f), r(n, 1000.0f);
+
+    std::vector<u32> mask(cull_mask_size(n), ~0u);
+    frustum_spheres_inside(frustum, { zeroes.data(), zeroes.data(), zeroes.data(), r.data() }, n, mask.data());
+
+    for(size_t i = 0; i < n; i++) CHECK(cull_mask_test(mask.data(), i));
+
+    for(size_t i = n; i < mask.size()*32; i++) CHECK(!cull_mask_test(mask.data(), i));
+  }
+}
+
+TEST_CASE(aabb_transform_bounds_corners)
+{
+  std::mt19937 random(0xA7B0);
+  std::uniform_real_distribution<float> random_pos(-10.0f, 10.0f);
+  std::uniform_real_distribution<float> random_angle(-PIf, PIf);
+
+  for(size_t i = 0; i < 1000; i++) {
+    vec3 min(random_pos(random), random_pos(random), random_pos(random));
+    AABB aabb(min, min + vec3(fabsf(random_pos(random)), fabsf(random_pos(random)), 1.0f));
+
+    auto m = xform::translate(random_pos(random), random_pos(random), random_pos(random))
+      * xform::rotx(random_angle(random))
+      * xform::roty(random_angle(random))
+      * xform::scale(2.0f);
+
+    // The tightest AABB is the one bounding all the transformed corners
+    AABB expected = { vec3(INFINITY), vec3(-INFINITY) };
+    for(uint c = 0; c < 8; c++) {
+      vec4 corner(
+          c & 1 ? aabb.max.x : aabb.min.x,
+          c & 2 ? aabb.max.y : aabb.min.y,
+          c & 4 ? aabb.max.z : aabb.min.z,
+          1.0f);
+      vec3 p = (m * corner).xyz();
+
+      expected = { vec3::min(expected.min, p), vec3::max(expected.max, p) };
+    }
+
+    auto transformed = aabb_transform(m, aabb);
+
+    CHECK(transformed.min.distance(expected.min) < Epsilon);
+    CHECK(transformed.max.distance(expected.max) < Epsilon);
+  }
+}
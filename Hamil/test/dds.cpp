@@ -0,0 +1,153 @@
+#include "test.h"
+
+#include <util/dds.h>
+#include <sched/pool.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+namespace {
+
+enum : u32 {
+  Size = 4096,
+  NumFaces = 6,
+  // 4096x4096 down to 1x1
+  NumLevels = 13,
+
+  // DXGI formats
+  BC1 = 71, BC7 = 98,
+
+  BlockSize_BC1 = 8, BlockSize_BC7 = 16,
+};
+
+void put_u32(std::vector<byte>& v, u32 x)
+{
+  auto ptr = (const byte *)&x;
+  v.insert(v.end(), ptr, ptr + sizeof(u32));
+}
+
+// Returns a DDS file with a full mip chain for each of the 6
+//   Cubemap faces, in a block compressed DXGI 'format', filled
+//   with random data
+std::vector<byte> make_cubemap_dds(u32 format, u32 block_size)
+{
+  std::vector<byte> dds = { 'D', 'D', 'S', ' ' };
+
+  // DDSHeader
+  put_u32(dds, 124);                  // size
+  put_u32(dds, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000);  // flags
+  put_u32(dds, Size);                 // height
+  put_u32(dds, Size);                 // width
+  put_u32(dds, (Size/4)*(Size/4) * block_size);   // pitch_or_linear_sz
+  put_u32(dds, 0);                    // depth
+  put_u32(dds, NumLevels);            // mipmap_count
+  for(int i = 0; i < 11; i++) put_u32(dds, 0);
+
+  // DDSPixelFormat
+  put_u32(dds, 32);                   // size
+  put_u32(dds, 0x4);                  // flags = FourCC
+  put_u32(dds, 'D' | ('X'<<8) | ('1'<<16) | ('0'<<24));
+  for(int i = 0; i < 5; i++) put_u32(dds, 0);
+
+  put_u32(dds, 0x8 | 0x1000 | 0x400000);   // caps1
+  put_u32(dds, 0x200 | 0xFC00);            // caps2 = Cubemap | CubemapAll
+  for(int i = 0; i < 3; i++) put_u32(dds, 0);
+
+  // DDSHeaderDX10
+  put_u32(dds, format);
+  put_u32(dds, 3);                    // res_dimensions = Texture2D
+  put_u32(dds, 0x4);                  // misc_flag = Cubemap
+  put_u32(dds, NumFaces);             // array_size
+  put_u32(dds, 0);
+
+  size_t data_sz = 0;
+  for(u32 level = 0; level < NumLevels; level++) {
+    u32 blocks = std::max<u32>((Size >> level) / 4, 1);
+
+    data_sz += blocks*blocks * block_size;
+  }
+  data_sz *= NumFaces;
+
+  std::mt19937 random(0xDD5);
+
+  auto header_sz = dds.size();
+  dds.resize(header_sz + data_sz);
+  for(size_t i = header_sz; i + sizeof(u32) <= dds.size(); i += sizeof(u32)) {
+    u32 x = random();
+    memcpy(dds.data() + i, &x, sizeof(u32));
+  }
+
+  return dds;
+}
+
+bool same_images(const util::DDSImage& a, const util::DDSImage& b)
+{
+  if(a.numLayers() != b.numLayers() || a.maxLevel() != b.maxLevel()) return false;
+
+  for(uint layer = 0; layer < a.numLayers(); layer++) {
+    for(uint level = 0; level <= a.maxLevel(); level++) {
+      const auto& img_a = a.imageLayer(layer, level);
+      const auto& img_b = b.imageLayer(layer, level);
+
+      if(img_a.sz != img_b.sz) return false;
+      if(memcmp(img_a.getData(), img_b.getData(), img_a.sz)) return false;
+    }
+  }
+
+  return true;
+}
+
+// Prints the best of a few serial and parallel load()s of 'dds'
+//   and checks they produce the same images
+void bench_cubemap_load(const char *name, const std::vector<byte>& dds, uint flags,
+  sched::WorkerPool& pool)
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  enum {
+    NumRuns = 3,
+  };
+
+  auto ms = [](Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+  };
+
+  double serial_ms = INFINITY, parallel_ms = INFINITY;
+  for(int run = 0; run < NumRuns; run++) {
+    util::DDSImage serial, parallel;
+
+    auto serial_start = Clock::now();
+    serial.load(dds.data(), dds.size(), flags);
+    auto serial_end = Clock::now();
+
+    auto parallel_start = Clock::now();
+    parallel.load(pool, dds.data(), dds.size(), flags);
+    auto parallel_end = Clock::now();
+
+    serial_ms = std::min(serial_ms, ms(serial_start, serial_end));
+    parallel_ms = std::min(parallel_ms, ms(parallel_start, parallel_end));
+
+    CHECK(serial.numLayers() == NumFaces);
+    CHECK(serial.maxLevel() == NumLevels-1);
+    CHECK(same_images(serial, parallel));
+  }
+
+  printf("    %-14s %.1fMB: load() %.1fms, load(WorkerPool) %.1fms\n",
+      name, dds.size() / (1024.0*1024.0), serial_ms, parallel_ms);
+}
+
+}
+
+BENCHMARK(dds_load_4k_cubemap)
+{
+  sched::WorkerPool pool;
+  pool.kickWorkers("DDSBench_Worker");
+
+  bench_cubemap_load("BC7",        make_cubemap_dds(BC7, BlockSize_BC7), util::DDSImage::LoadDefault, pool);
+  bench_cubemap_load("BC1 (FlipV)", make_cubemap_dds(BC1, BlockSize_BC1), util::DDSImage::FlipV, pool);
+}
@@ -0,0 +1,350 @@
+#include "test.h"
+
+#include <mesh/halfedge.h>
+
+#include <cstdio>
+
+#include <vector>
+#include <set>
+#include <map>
+#include <chrono>
+#include <algorithm>
+
+namespace {
+
+using mesh::HalfEdge;
+using mesh::HalfEdgeStructure;
+
+// HalfEdgeStructure::build() as it was before it was made linear-time
+//   (std::set of the edges + std::map of the directed edges), kept as
+//   the benchmark's baseline and a reference for the faces on either
+//   side of each edge
+//  - The original HalfEdge::next pointed at faces instead of halfedges,
+//    so only the 'face', 'vertex' and 'opposite' links are compared
+class LegacyHalfEdgeStructure {
+public:
+  using Edge = HalfEdge::Edge;
+
+  void addTraingle(HalfEdge::Vertex v0, HalfEdge::Vertex v1, HalfEdge::Vertex v2)
+  {
+    m_edge_set.emplace(std::min(v0, v1), std::max(v0, v1));
+    m_edge_set.emplace(std::min(v1, v2), std::max(v1, v2));
+    m_edge_set.emplace(std::min(v2, v0), std::max(v2, v0));
+
+    m_faces.emplace_back(v0, v1, v2);
+  }
+
+  void build(size_t num_verts)
+  {
+    m_edges.assign(m_edge_set.begin(), m_edge_set.end());
+    m_edge_set.clear();
+
+    std::map<Edge, HalfEdge::Index> edge_map;
+    for(HalfEdge::Index i = 0; i < m_faces.size(); i++) {
+      const auto& tri = m_faces[i];
+
+      edge_map.emplace(Edge(tri.v[0], tri.v[1]), i);
+      edge_map.emplace(Edge(tri.v[1], tri.v[2]), i);
+      edge_map.emplace(Edge(tri.v[2], tri.v[0]), i);
+    }
+
+    auto directed_edge_to_face = [&](HalfEdge::Vertex a, HalfEdge::Vertex b) {
+      auto it = edge_map.find(Edge(a, b));
+
+      return it != edge_map.end() ? it->second : HalfEdge::None;
+    };
+
+    m_vert_he.resize(num_verts, HalfEdge::None);
+    m_halfedges.reserve(m_edges.size() * 2);
+
+    for(HalfEdge::Index ei = 0; ei < m_edges.size(); ei++) {
+      const auto& e = m_edges[ei];
+
+      auto he0_idx = (HalfEdge::Index)m_halfedges.size();
+      auto he1_idx = he0_idx + 1;
+
+      HalfEdge he0, he1;
+      he0.face = directed_edge_to_face(e.first, e.second);
+      he0.vertex = e.second;
+      he0.edge = ei;
+      he0.opposite = he1_idx;
+
+      he1.face = directed_edge_to_face(e.second, e.first);
+      he1.vertex = e.first;
+      he1.edge = ei;
+      he1.opposite = he0_idx;
+
+      m_edge_to_halfedge.emplace(Edge(e.first, e.second), he0_idx);
+      m_edge_to_halfedge.emplace(Edge(e.second, e.first), he1_idx);
+
+      if(m_vert_he[he0.vertex] == HalfEdge::None || he1.face == HalfEdge::None) m_vert_he[he0.vertex] = he1_idx;
+      if(m_vert_he[he1.vertex] == HalfEdge::None || he0.face == HalfEdge::None) m_vert_he[he1.vertex] = he0_idx;
+
+      m_halfedges.push_back(he0);
+      m_halfedges.push_back(he1);
+    }
+
+    std::vector<HalfEdge::Index> boundary;
+    for(HalfEdge::Index hei = 0; hei < m_halfedges.size(); hei++) {
+      auto& he = m_halfedges[hei];
+
+      if(he.face == HalfEdge::None) {
+        boundary.push_back(hei);
+        continue;
+      }
+
+      const auto& face = m_faces[he.face];
+      auto i = he.vertex;
+
+      HalfEdge::Index j = HalfEdge::None;
+      if(face.v[0] == i)      j = face.v[1];
+      else if(face.v[1] == i) j = face.v[2];
+      else if(face.v[2] == i) j = face.v[0];
+
+      he.next = edge_map.at(Edge(i, j));
+    }
+
+    std::map<HalfEdge::Index, std::set<HalfEdge::Index>> vert_to_boundary;
+    for(auto hei : boundary) {
+      auto origin = m_halfedges[m_halfedges[hei].opposite].vertex;
+
+      vert_to_boundary[origin].emplace(hei);
+    }
+
+    for(auto hei : boundary) {
+      auto& outgoing = vert_to_boundary[m_halfedges[hei].vertex];
+      if(outgoing.empty()) continue;
+
+      m_halfedges[hei].next = *outgoing.begin();
+      outgoing.erase(outgoing.begin());
+    }
+  }
+
+  size_t numEdges() const { return m_edges.size(); }
+
+  // Returns the face on the left side of a->b
+  //   or HalfEdge::None when it's on the boundary
+  HalfEdge::Index face(HalfEdge::Vertex a, HalfEdge::Vertex b) const
+  {
+    return m_halfedges[m_edge_to_halfedge.at(Edge(a, b))].face;
+  }
+
+private:
+  std::set<Edge> m_edge_set;
+  std::vector<Edge> m_edges;
+
+  std::vector<HalfEdge::Face> m_faces;
+  std::vector<HalfEdge> m_halfedges;
+
+  std::vector<HalfEdge::Index> m_vert_he;
+
+  std::map<Edge, HalfEdge::Index> m_edge_to_halfedge;
+};
+
+// A 'n' x 'n' grid of quads split into triangles - returns
+//   the number of vertices
+template <typename T>
+size_t add_grid(T& mesh, u32 n)
+{
+  for(u32 y = 0; y < n; y++) {
+    for(u32 x = 0; x < n; x++) {
+      u32 a = y*(n+1) + x, b = a+1, c = a + (n+1), d = c+1;
+
+      mesh.addTraingle(a, b, d);
+      mesh.addTraingle(a, d, c);
+    }
+  }
+
+  return (size_t)(n+1)*(n+1);
+}
+
+// An octahedron - a closed mesh without any boundary
+template <typename T>
+size_t add_octahedron(T& mesh)
+{
+  const u32 faces[][3] = {
+    { 0, 2, 4 }, { 2, 1, 4 }, { 1, 3, 4 }, { 3, 0, 4 },
+    { 2, 0, 5 }, { 1, 2, 5 }, { 3, 1, 5 }, { 0, 3, 5 },
+  };
+
+  for(const auto& f : faces) mesh.addTraingle(f[0], f[1], f[2]);
+
+  return 6;
+}
+
+// Checks 'hes' against 'legacy' and the faces themselves
+void check_structure(const HalfEdgeStructure& hes, const LegacyHalfEdgeStructure& legacy,
+  const std::vector<HalfEdge::Face>& faces, size_t num_verts)
+{
+  CHECK(hes.numFaces() == faces.size());
+  CHECK(hes.numEdges() == legacy.numEdges());
+  CHECK(hes.numHalfEdges() == hes.numEdges()*2);
+
+  std::vector<std::set<HalfEdge::Vertex>> vert_neighbours(num_verts);
+  std::vector<std::set<HalfEdge::Index>> vert_faces(num_verts);
+
+  for(HalfEdge::Index fi = 0; fi < faces.size(); fi++) {
+    const auto& f = faces[fi];
+
+    for(uint k = 0; k < 3; k++) {
+      auto a = f.v[k], b = f.v[(k+1) % 3];
+
+      const auto& he = hes.halfedge(a, b);
+      const auto& opposite = hes.halfedge(he.opposite);
+
+      CHECK(he.face == fi && he.vertex == b);
+      CHECK(opposite.vertex == a);
+      CHECK(opposite.face == legacy.face(b, a));
+      CHECK(&hes.halfedge(fi*3 + k) == &he);
+
+      // 'next' continues around the same face
+      CHECK(hes.halfedge(he.next).vertex == f.v[(k+2) % 3]);
+
+      const auto& edge = hes.edge(he.edge);
+      CHECK(edge.first == std::min(a, b) && edge.second == std::max(a, b));
+
+      vert_neighbours[a].insert(b);
+      vert_neighbours[b].insert(a);
+      vert_faces[a].insert(fi);
+    }
+  }
+
+  for(HalfEdge::Vertex v = 0; v < num_verts; v++) {
+    std::vector<HalfEdge::Vertex> neighbours;
+    hes.walkVertexNeighbours(v, [&](HalfEdge::Vertex n) { neighbours.push_back(n); });
+
+    CHECK(neighbours.size() == vert_neighbours[v].size());
+    CHECK(std::set<HalfEdge::Vertex>(neighbours.begin(), neighbours.end()) == vert_neighbours[v]);
+
+    size_t num_faces = 0;
+    hes.walkFaceNeighbours(v, [&](const HalfEdge::Face& f) {
+      CHECK(std::find(f.v.begin(), f.v.end(), v) != f.v.end());
+
+      num_faces++;
+    });
+
+    CHECK(num_faces == vert_faces[v].size());
+  }
+}
+
+template <typename Fn>
+void test_mesh(Fn add_faces)
+{
+  // Collects the faces in the order they're added
+  struct FaceList {
+    void addTraingle(HalfEdge::Vertex v0, HalfEdge::Vertex v1, HalfEdge::Vertex v2)
+    {
+      faces.emplace_back(v0, v1, v2);
+    }
+
+    std::vector<HalfEdge::Face> faces;
+  };
+
+  HalfEdgeStructure hes;
+  LegacyHalfEdgeStructure legacy;
+  FaceList list;
+
+  auto num_verts = add_faces(hes);
+  add_faces(legacy);
+  add_faces(list);
+
+  hes.build(num_verts);
+  legacy.build(num_verts);
+
+  check_structure(hes, legacy, list.faces, num_verts);
+}
+
+template <typename E, typename Fn>
+bool build_throws(Fn add_faces)
+{
+  HalfEdgeStructure hes;
+  auto num_verts = add_faces(hes);
+
+  try {
+    hes.build(num_verts);
+  } catch(const E&) {
+    return true;
+  }
+
+  return false;
+}
+
+}
+
+TEST_CASE(halfedge_structure_matches_legacy)
+{
+  test_mesh([](auto& mesh) { return add_grid(mesh, 1); });
+  test_mesh([](auto& mesh) { return add_grid(mesh, 17); });
+  test_mesh([](auto& mesh) { return add_octahedron(mesh); });
+
+  // Isolated vertices are walked over without visiting anything
+  HalfEdgeStructure hes;
+  hes.addTraingle(0, 1, 2);
+  hes.build(5);
+
+  size_t visited = 0;
+  hes.walkVertexNeighbours(4, [&](HalfEdge::Vertex) { visited++; });
+  CHECK(visited == 0);
+}
+
+TEST_CASE(halfedge_structure_errors)
+{
+  // The same directed edge 0->1 used by two faces
+  CHECK(build_throws<HalfEdgeStructure::NonManifoldEdgeError>([](auto& mesh) {
+    mesh.addTraingle(0, 1, 2);
+    mesh.addTraingle(0, 1, 3);
+
+    return (size_t)4;
+  }));
+
+  // Two fans of faces touching only at vertex 0
+  CHECK(build_throws<HalfEdgeStructure::ButterflyVertexError>([](auto& mesh) {
+    mesh.addTraingle(0, 1, 2);
+    mesh.addTraingle(0, 3, 4);
+
+    return (size_t)5;
+  }));
+
+  HalfEdgeStructure hes;
+  add_grid(hes, 2);
+  hes.build(9);
+
+  bool threw = false;
+  try {
+    hes.halfedge(0, 8);
+  } catch(const HalfEdgeStructure::InvalidQueryError&) {
+    threw = true;
+  }
+
+  CHECK(threw);
+}
+
+BENCHMARK(halfedge_structure_build)
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto ms = [](Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  };
+
+  for(u32 n : { 100, 300, 700 }) {
+    HalfEdgeStructure hes;
+    LegacyHalfEdgeStructure legacy;
+
+    auto num_verts = add_grid(hes, n);
+    add_grid(legacy, n);
+
+    auto start = Clock::now();
+    hes.build(num_verts);
+    auto hes_ms = ms(start);
+
+    start = Clock::now();
+    legacy.build(num_verts);
+    auto legacy_ms = ms(start);
+
+    CHECK(hes.numEdges() == legacy.numEdges());
+
+    printf("    %7zu triangles: legacy %8.1fms, HalfEdgeStructure %7.1fms\n",
+        hes.numFaces(), legacy_ms, hes_ms);
+  }
+}
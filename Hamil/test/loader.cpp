@@ -0,0 +1,190 @@
+#include "test.h"
+
+#include <res/manager.h>
+#include <res/loader.h>
+#include <res/text.h>
+#include <util/format.h>
+
+#include <config>
+
+#include <cstdio>
+
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+
+#if __sysv
+#  include <unistd.h>
+#  include <fcntl.h>
+#endif
+
+namespace {
+
+namespace fs = std::filesystem;
+
+enum : size_t {
+  NumDirectories    = 250,
+  FilesPerDirectory = 200,
+
+  NumMetaFiles = NumDirectories*FilesPerDirectory,
+};
+
+const char *Payload = "hello, world!";
+
+std::string meta_name(size_t i)
+{
+  return util::fmt("m%zu", i);
+}
+
+std::string meta_path(size_t dir)
+{
+  return util::fmt("/d%zu", dir);
+}
+
+res::Resource::Id meta_guid(size_t dir, size_t i)
+{
+  return res::ResourceManager::guid<res::Text>(meta_name(i), meta_path(dir));
+}
+
+// Creates a tree of NumDirectories directories holding FilesPerDirectory
+//   Text descriptors each, which all refer to the same payload file
+void make_meta_tree(const fs::path& root)
+{
+  fs::remove_all(root);
+  fs::create_directories(root);
+
+  auto payload_path = root / "payload.txt";
+  std::ofstream(payload_path) << Payload;
+
+  for(size_t dir = 0; dir < NumDirectories; dir++) {
+    auto dir_path = root / util::fmt("d%zu", dir);
+    fs::create_directory(dir_path);
+
+    for(size_t i = 0; i < FilesPerDirectory; i++) {
+      std::ofstream meta(dir_path / (meta_name(i) + ".meta"));
+
+      meta << util::fmt(
+        "guid: 0x%.16llx\n"
+        "tag: text\n"
+        "name: %s\n"
+        "path: %s\n"
+        "location: !file %s\n",
+        (unsigned long long)meta_guid(dir, i), meta_name(i), meta_path(dir), payload_path.string());
+    }
+  }
+}
+
+// Asks the kernel to drop the tree's *.meta files from the page
+//   cache, so the next enumeration has to actually read them
+void evict_meta_tree(const fs::path& root)
+{
+#if __sysv
+  sync();
+
+  for(const auto& entry : fs::recursive_directory_iterator(root)) {
+    if(!entry.is_regular_file()) continue;
+
+    int fd = open(entry.path().c_str(), O_RDONLY);
+    if(fd < 0) continue;
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+#endif
+}
+
+// The loader logs every resource it finds, which would
+//   otherwise bury the timings
+class SilenceStdout {
+public:
+  SilenceStdout()
+  {
+#if __sysv
+    fflush(stdout);
+
+    m_fd = dup(STDOUT_FILENO);
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+#endif
+  }
+
+  ~SilenceStdout()
+  {
+#if __sysv
+    fflush(stdout);
+
+    dup2(m_fd, STDOUT_FILENO);
+    close(m_fd);
+#endif
+  }
+
+private:
+  int m_fd = -1;
+};
+
+// Returns the time it took the SimpleFsLoader to enumerate the
+//   tree (in ms) and checks all the descriptors were found
+double enumerate_meta_tree()
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  Clock::time_point start, end;
+  res::ResourceManager::Ptr manager;
+  {
+    SilenceStdout silence;
+
+    // SimpleFsLoader::doInit() enumerates the whole tree
+    start = Clock::now();
+    manager.reset(new res::ResourceManager({ new res::SimpleFsLoader("./") }));
+    end = Clock::now();
+  }
+
+  // Spot check a few descriptors from all over the tree
+  for(size_t dir = 0; dir < NumDirectories; dir += 49) {
+    for(size_t i = 0; i < FilesPerDirectory; i += 67) {
+      auto r = manager->load(meta_guid(dir, i)).lock();
+
+      CHECK(r && r->as<res::Text>());
+      if(r) CHECK(r->as<res::Text>()->str() == Payload);
+    }
+  }
+
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}
+
+BENCHMARK(simplefsloader_enum_50k_metas)
+{
+  auto root = fs::temp_directory_path() / "hamil_meta_tree";
+  auto cwd = fs::current_path();
+
+  make_meta_tree(root);
+
+  // SimpleFsLoader enumerates (and keeps it's MetaCache in)
+  //   the working directory
+  fs::current_path(root);
+
+  // Cold - nothing in the page cache and no MetaCache,
+  //   so every *.meta file is read from disk and parsed
+  evict_meta_tree(root);
+  auto cold_ms = enumerate_meta_tree();
+
+  // Page cache warm, but the descriptors still get parsed
+  fs::remove(res::SimpleFsLoader::MetaCacheFile);
+  auto warm_parse_ms = enumerate_meta_tree();
+
+  // Warm - the MetaCache saved by the previous run is used
+  auto warm_ms = enumerate_meta_tree();
+
+  fs::current_path(cwd);
+  fs::remove_all(root);
+
+  printf("    %zu *.meta files in %zu directories\n", (size_t)NumMetaFiles, (size_t)NumDirectories);
+  printf("    cold:                %.1fms\n", cold_ms);
+  printf("    warm (no MetaCache): %.1fms\n", warm_parse_ms);
+  printf("    warm:                %.1fms\n", warm_ms);
+}
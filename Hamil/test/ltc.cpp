@@ -0,0 +1,84 @@
+#include "test.h"
+
+#include <math/ltc.h>
+#include <math/brdf.h>
+#include <sched/pool.h>
+
+#include <cstdio>
+
+#include <chrono>
+
+namespace {
+
+using ltc::LTC_CoeffsTable;
+
+// Checks the coefficients of the cells covered by fit(..., extent)
+//   are the same bit for bit
+bool same_coeffs(const LTC_CoeffsTable& a, const LTC_CoeffsTable& b, uvec2 extent)
+{
+  static constexpr unsigned N = LTC_CoeffsTable::TableSize.x;
+
+  for(unsigned t = 0; t < extent.y; t++) {
+    for(unsigned r = N - extent.x; r < N; r++) {
+      for(unsigned i = 0; i < 4; i++) {
+        auto idx = (r + t*N)*4 + i;
+
+        if(a.coeffs1()[idx] != b.coeffs1()[idx]) return false;
+        if(a.coeffs2()[idx] != b.coeffs2()[idx]) return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+}
+
+TEST_CASE(ltc_parallel_fit_matches_serial)
+{
+  // More Jobs than rows, so some of them don't get any
+  const uvec2 extent = { 4, 3 };
+
+  brdf::BRDF_GGX ggx;
+
+  sched::WorkerPool pool;
+  pool.kickWorkers("LTCTest_Worker");
+
+  LTC_CoeffsTable serial, parallel;
+  serial.fit(ggx, nullptr, extent);
+  parallel.fit(ggx, &pool, extent);
+
+  CHECK(same_coeffs(serial, parallel, extent));
+}
+
+BENCHMARK(ltc_fit)
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto ms = [](Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  };
+
+  // A 16th of the table
+  const uvec2 extent = { 16, 16 };
+
+  brdf::BRDF_GGX ggx;
+
+  sched::WorkerPool pool;
+  pool.kickWorkers("LTCBench_Worker");
+
+  LTC_CoeffsTable serial, parallel;
+
+  auto start = Clock::now();
+  serial.fit(ggx, nullptr, extent);
+  auto serial_ms = ms(start);
+
+  start = Clock::now();
+  parallel.fit(ggx, &pool, extent);
+  auto parallel_ms = ms(start);
+
+  CHECK(same_coeffs(serial, parallel, extent));
+
+  printf("    %ux%u cells: fit() %.1fms, fit(WorkerPool) %.1fms\n",
+      extent.x, extent.y, serial_ms, parallel_ms);
+}
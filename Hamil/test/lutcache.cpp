@@ -0,0 +1,220 @@
+#include "test.h"
+
+#include <ek/lutcache.h>
+#include <res/io.h>
+
+#include <cstring>
+
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+using ek::RenderLUTCache;
+
+struct TestRecord {
+  RenderLUTCache::Key key;
+  std::vector<byte> data;
+};
+
+// Records of sizes which do and don't need padding
+std::vector<TestRecord> make_records()
+{
+  std::vector<TestRecord> records;
+  for(size_t sz : { 1, 16, 37, 256 }) {
+    TestRecord r;
+    r.key = RenderLUTCache::key((u32)records.size(), (int)sz, 1);
+
+    for(size_t i = 0; i < sz; i++) r.data.push_back((byte)(i*7 + sz));
+
+    records.push_back(std::move(r));
+  }
+
+  return records;
+}
+
+// Returns the contents of a cache file save()'ed with all the 'records'
+std::vector<byte> make_cache_file(const std::vector<TestRecord>& records)
+{
+  auto path = fs::temp_directory_path() / "hamil_lutcache_test.bin";
+
+  RenderLUTCache cache;
+  for(const auto& r : records) cache.insert(r.key, r.data.data(), r.data.size());
+
+  CHECK(cache.dirty());
+  cache.save(path.string());
+  CHECK(!cache.dirty());
+
+  std::ifstream f(path, std::ios::binary);
+  std::vector<byte> file((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+  f.close();
+  fs::remove(path);
+
+  return file;
+}
+
+res::IOBuffer make_buffer(const std::vector<byte>& file, size_t sz)
+{
+  auto buf = res::IOBuffer::make_memory_buffer(sz);
+  memcpy(buf.get(), file.data(), sz);
+
+  return buf;
+}
+
+bool same_data(const res::IOBuffer& buf, const TestRecord& r)
+{
+  return buf.size() == r.data.size() && !memcmp(buf.get(), r.data.data(), r.data.size());
+}
+
+// Returns the offsets where the data of each record
+//   in 'file' ends, in the order they're stored
+std::vector<size_t> record_ends(const std::vector<byte>& file)
+{
+  enum : size_t {
+    HeaderSize = 16, RecordHeaderSize = 16,
+
+    DataAlign = 16,
+  };
+
+  u64 num_records;
+  memcpy(&num_records, file.data() + 8, sizeof(u64));
+
+  std::vector<size_t> ends;
+
+  size_t offset = HeaderSize;
+  for(u64 i = 0; i < num_records; i++) {
+    u64 size;
+    memcpy(&size, file.data() + offset + 8, sizeof(u64));
+
+    offset += RecordHeaderSize;
+    ends.push_back(offset + size);
+
+    offset += (size + DataAlign-1) & ~(DataAlign-1);
+  }
+
+  return ends;
+}
+
+}
+
+TEST_CASE(lut_cache_round_trip)
+{
+  auto records = make_records();
+  auto file = make_cache_file(records);
+
+  RenderLUTCache cache;
+  {
+    // The records keep the buffer alive
+    cache.load(make_buffer(file, file.size()));
+  }
+
+  // Nothing was probe()'d yet, so save() would drop all the records
+  CHECK(cache.dirty());
+
+  for(const auto& r : records) {
+    CHECK(!cache.probe(r.key, r.data.size()+1));
+    CHECK(same_data(cache.probe(r.key, r.data.size()), r));
+  }
+  CHECK(!cache.probe(RenderLUTCache::key(~0u, 0, 1)));
+
+  CHECK(!cache.dirty());
+
+  // Records which weren't probe()'d aren't saved again
+  cache.load(make_buffer(file, file.size()));
+  cache.probe(records[1].key);
+
+  CHECK(cache.dirty());
+
+  auto path = fs::temp_directory_path() / "hamil_lutcache_test.bin";
+  cache.save(path.string());
+
+  // ...while the probe()'d ones were copied out of the buffer
+  CHECK(same_data(cache.probe(records[1].key), records[1]));
+
+  std::ifstream f(path, std::ios::binary);
+  std::vector<byte> pruned((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+  f.close();
+  fs::remove(path);
+
+  cache.load(make_buffer(pruned, pruned.size()));
+  CHECK(!cache.probe(records[0].key));
+  CHECK(same_data(cache.probe(records[1].key), records[1]));
+}
+
+TEST_CASE(lut_cache_truncated_file)
+{
+  auto records = make_records();
+  auto file = make_cache_file(records);
+  auto ends = record_ends(file);
+
+  CHECK(ends.size() == records.size());
+  CHECK(ends.back() <= file.size());
+
+  // Every record which is whole is loaded, the rest are dropped
+  for(size_t sz = 0; sz <= file.size(); sz++) {
+    RenderLUTCache cache;
+    cache.load(make_buffer(file, sz));
+
+    size_t num_whole = 0;
+    for(auto end : ends) num_whole += end <= sz;
+
+    size_t num_loaded = 0;
+    for(const auto& r : records) {
+      auto buf = cache.probe(r.key);
+      if(!buf) continue;
+
+      CHECK(same_data(buf, r));
+      num_loaded++;
+    }
+
+    CHECK(num_loaded == num_whole);
+  }
+
+  // An empty buffer is the same as a missing file
+  RenderLUTCache cache;
+  cache.load(res::IOBuffer());
+  CHECK(!cache.probe(records[0].key));
+}
+
+TEST_CASE(lut_cache_corrupt_file)
+{
+  auto records = make_records();
+  auto file = make_cache_file(records);
+
+  auto load_corrupted = [&](size_t offset, u64 value, size_t sz) {
+    auto corrupt = file;
+    memcpy(corrupt.data() + offset, &value, sz);
+
+    RenderLUTCache cache;
+    cache.load(make_buffer(corrupt, corrupt.size()));
+
+    size_t num_loaded = 0;
+    for(const auto& r : records) {
+      auto buf = cache.probe(r.key);
+      if(!buf) continue;
+
+      CHECK(same_data(buf, r));
+      num_loaded++;
+    }
+
+    return num_loaded;
+  };
+
+  // Magic, version
+  CHECK(load_corrupted(0, 0, sizeof(u32)) == 0);
+  CHECK(load_corrupted(4, 2, sizeof(u32)) == 0);
+
+  // Claims more records than there are
+  CHECK(load_corrupted(8, ~0ull, sizeof(u64)) == records.size());
+
+  // The size of the first record is past the end (or so large
+  //   adding it to the offset would overflow)
+  CHECK(load_corrupted(16 + 8, file.size(), sizeof(u64)) == 0);
+  CHECK(load_corrupted(16 + 8, ~0ull - 8, sizeof(u64)) == 0);
+}
@@ -0,0 +1,86 @@
+#include "test.h"
+
+#include <os/os.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace test {
+
+struct TestCase {
+  const char *name;
+  TestFn fn;
+
+  bool benchmark;
+};
+
+// Function-local so it's constructed before any
+//   of the registering static initializers run
+static std::vector<TestCase>& p_tests()
+{
+  static std::vector<TestCase> tests;
+  return tests;
+}
+
+static bool p_failed = false;
+
+bool register_test(const char *name, TestFn fn, bool benchmark)
+{
+  p_tests().push_back({ name, fn, benchmark });
+
+  return true;
+}
+
+void check_failed(const char *file, int line, const char *expr)
+{
+  fprintf(stderr, "    %s:%d: CHECK(%s) failed\n", file, line, expr);
+
+  p_failed = true;
+}
+
+}
+
+// Usage: HamilTests [--bench] [filter]
+//   - Only the test cases whose names contain 'filter' are run
+int main(int argc, char *argv[])
+{
+  bool run_benchmarks = false;
+  const char *filter = nullptr;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--bench")) {
+      run_benchmarks = true;
+    } else {
+      filter = argv[i];
+    }
+  }
+
+  // Some of the tested code needs os::cpuinfo() etc.
+  os::init();
+
+  int num_run = 0, num_failed = 0;
+  for(const auto& t : test::p_tests()) {
+    if(t.benchmark != run_benchmarks) continue;
+    if(filter && !strstr(t.name, filter)) continue;
+
+    test::p_failed = false;
+    try {
+      t.fn();
+    } catch(...) {
+      fprintf(stderr, "    uncaught exception\n");
+      test::p_failed = true;
+    }
+
+    printf("[%s] %s\n", test::p_failed ? "FAIL" : " OK ", t.name);
+
+    num_run++;
+    if(test::p_failed) num_failed++;
+  }
+
+  printf("%d/%d passed\n", num_run-num_failed, num_run);
+
+  os::finalize();
+
+  return num_failed ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#include "test.h"
+
+#include <gx/multidraw.h>
+#include <gx/commandbuffer.h>
+#include <gx/memorypool.h>
+
+#include <cstring>
+
+using gx::CommandBuffer;
+using gx::MultiDrawBuilder;
+
+TEST_CASE(multidraw_builder_packs_draws)
+{
+  auto batch = MultiDrawBuilder(gx::Primitive::Triangles, 3);
+
+  CHECK(batch.empty());
+  CHECK(batch.accepts(gx::Primitive::Triangles, 3));
+  CHECK(!batch.accepts(gx::Primitive::Lines, 3));
+  CHECK(!batch.accepts(gx::Primitive::Triangles, 4));
+
+  CHECK(batch.draw(36, 0, 0));
+  CHECK(batch.draw(6, 24, 36, 4, 2));
+
+  CHECK(batch.numDraws() == 2);
+  CHECK(batch.byteSize() == 2*sizeof(gx::DrawElementsIndirectArgs));
+
+  auto draws = batch.data();
+  CHECK(draws[0].count == 36 && draws[0].instance_count == 1);
+  CHECK(draws[0].first_index == 0 && draws[0].base_vertex == 0 && draws[0].base_instance == 0);
+  CHECK(draws[1].count == 6 && draws[1].instance_count == 4);
+  CHECK(draws[1].first_index == 36 && draws[1].base_vertex == 24 && draws[1].base_instance == 2);
+
+  batch.reset();
+  CHECK(batch.empty() && batch.byteSize() == 0);
+}
+
+TEST_CASE(multidraw_builder_full)
+{
+  auto batch = MultiDrawBuilder(gx::Primitive::Triangles, 0);
+
+  for(size_t i = 0; i < MultiDrawBuilder::MaxDraws; i++) {
+    if(!batch.draw(3, 0, (u32)i*3)) {
+      CHECK(0 && "draw() rejected before the batch was full");
+      break;
+    }
+  }
+
+  CHECK(!batch.draw(3, 0, 0));
+  CHECK(batch.numDraws() == MultiDrawBuilder::MaxDraws);
+  CHECK(batch.byteSize() <= MultiDrawBuilder::MaxArgsSize);
+}
+
+TEST_CASE(multidraw_emit_encoding)
+{
+  gx::MemoryPool mempool(4096);
+  auto cmd = CommandBuffer::begin();
+
+  auto batch = MultiDrawBuilder(gx::Primitive::Triangles, 5);
+  batch.draw(36, 0, 0);
+  batch.draw(6, 24, 36);
+  batch.draw(12, 30, 42, 2);
+
+  batch.emit(cmd, mempool, 7);
+  CHECK(batch.empty());
+
+  const auto& commands = cmd.dbg_Commands();
+  CHECK(commands.size() == 4);
+  if(commands.size() != 4) return;
+
+  // CommandWithExtra
+  auto op   = commands[0] >> CommandBuffer::OpShift;
+  auto data = commands[0] & CommandBuffer::OpDataMask;
+
+  CHECK(op == CommandBuffer::OpMultiDrawIndirect);
+  CHECK(data == 5);
+
+  auto primitive = (commands[1] >> CommandBuffer::OpExtraPrimitiveShift) & CommandBuffer::OpExtraPrimitiveMask;
+  auto num_draws = commands[1] & CommandBuffer::OpExtraNumVertsMask;
+
+  CHECK(primitive == 4);   // Primitive::Triangles
+  CHECK(num_draws == 3);
+
+  // ExtraData
+  auto indirect_buffer = commands[2];
+  auto h = (gx::MemoryPool::Handle)commands[3];
+
+  CHECK(indirect_buffer == 7);
+  CHECK((h & gx::MemoryPool::AllocAlignMask) == 0);
+
+  auto draws = mempool.ptr<gx::DrawElementsIndirectArgs>(h);
+  CHECK(draws[0].count == 36 && draws[0].first_index == 0 && draws[0].base_vertex == 0);
+  CHECK(draws[1].count == 6 && draws[1].first_index == 36 && draws[1].base_vertex == 24);
+  CHECK(draws[2].count == 12 && draws[2].instance_count == 2 && draws[2].first_index == 42);
+}
+
+TEST_CASE(multidraw_emit_consecutive_batches)
+{
+  gx::MemoryPool mempool(4096);
+  auto cmd = CommandBuffer::begin();
+
+  auto batch = MultiDrawBuilder(gx::Primitive::Triangles, 1);
+
+  batch.draw(3, 0, 0);
+  batch.emit(cmd, mempool, 2);
+
+  batch.draw(6, 3, 3);
+  batch.emit(cmd, mempool, 2);
+
+  const auto& commands = cmd.dbg_Commands();
+  CHECK(commands.size() == 8);
+  if(commands.size() != 8) return;
+
+  // Each batch must keep it's own copy of the arguments
+  auto first  = mempool.ptr<gx::DrawElementsIndirectArgs>(commands[3]);
+  auto second = mempool.ptr<gx::DrawElementsIndirectArgs>(commands[7]);
+
+  CHECK(commands[3] != commands[7]);
+  CHECK(first->count == 3 && second->count == 6);
+}
+
+TEST_CASE(multidraw_emit_empty_and_alloc_failure)
+{
+  gx::MemoryPool mempool(64);
+  auto cmd = CommandBuffer::begin();
+
+  auto batch = MultiDrawBuilder(gx::Primitive::Triangles, 1);
+
+  batch.emit(cmd, mempool, 2);
+  CHECK(cmd.dbg_Commands().empty());
+
+  for(u32 i = 0; i < 16; i++) batch.draw(3, 0, i*3);
+
+  bool threw = false;
+  try {
+    batch.emit(cmd, mempool, 2);
+  } catch(const MultiDrawBuilder::AllocFailedError&) {
+    threw = true;
+  }
+
+  CHECK(threw);
+  CHECK(batch.numDraws() == 16);   // The draws can still be issued some other way
+  CHECK(cmd.dbg_Commands().empty());
+}
+
+TEST_CASE(multidraw_zero_draws_records_nothing)
+{
+  auto cmd = CommandBuffer::begin();
+
+  cmd.multiDrawIndirect(gx::Primitive::Triangles, 1, 2, 0, 0);
+  CHECK(cmd.dbg_Commands().empty());
+}
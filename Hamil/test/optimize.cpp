@@ -0,0 +1,340 @@
+#include "test.h"
+
+#include <mesh/optimize.h>
+#include <mesh/obj.h>
+#include <math/geometry.h>
+#include <util/format.h>
+
+#include <cmath>
+#include <cstdio>
+
+#include <string>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+namespace {
+
+// The library is built with -ffast-math, which turns
+//   the divisions into reciprocal multiplies
+const float Epsilon = 1e-5f;
+
+bool near(float a, float b)
+{
+  return fabsf(a - b) < Epsilon;
+}
+
+struct TestMesh {
+  std::string name;
+
+  std::vector<vec3> verts;
+  std::vector<u32> inds;
+};
+
+// A 'n' x 'n' quad grid with it's triangles in random order
+TestMesh make_grid(u32 n)
+{
+  TestMesh m;
+  m.name = util::fmt("grid %ux%u", n, n);
+
+  for(u32 y = 0; y <= n; y++) {
+    for(u32 x = 0; x <= n; x++) m.verts.push_back(vec3((float)x, (float)y, 0.0f));
+  }
+
+  for(u32 y = 0; y < n; y++) {
+    for(u32 x = 0; x < n; x++) {
+      u32 a = y*(n+1) + x, b = a+1, c = a + (n+1), d = c+1;
+
+      m.inds.insert(m.inds.end(), { a, b, d,  a, d, c });
+    }
+  }
+
+  return m;
+}
+
+// A UV sphere with 'rings' x 'segments' quads
+TestMesh make_sphere(u32 rings, u32 segments)
+{
+  TestMesh m;
+  m.name = util::fmt("sphere %ux%u", rings, segments);
+
+  for(u32 r = 0; r <= rings; r++) {
+    float phi = PIf * (float)r / (float)rings;
+
+    for(u32 s = 0; s <= segments; s++) {
+      float theta = 2.0f*PIf * (float)s / (float)segments;
+
+      m.verts.push_back(vec3(sinf(phi)*cosf(theta), cosf(phi), sinf(phi)*sinf(theta)));
+    }
+  }
+
+  for(u32 r = 0; r < rings; r++) {
+    for(u32 s = 0; s < segments; s++) {
+      u32 a = r*(segments+1) + s, b = a+1, c = a + (segments+1), d = c+1;
+
+      m.inds.insert(m.inds.end(), { a, d, b,  a, c, d });
+    }
+  }
+
+  return m;
+}
+
+// Scrambles the order of the triangles the way an
+//   exporter which doesn't care about it would
+void shuffle_triangles(std::vector<u32>& inds, u32 seed)
+{
+  std::vector<std::array<u32, 3>> tris(inds.size() / 3);
+  for(size_t i = 0; i < tris.size(); i++) tris[i] = { inds[i*3], inds[i*3 + 1], inds[i*3 + 2] };
+
+  std::shuffle(tris.begin(), tris.end(), std::mt19937(seed));
+
+  for(size_t i = 0; i < tris.size(); i++) {
+    for(size_t j = 0; j < 3; j++) inds[i*3 + j] = tris[i][j];
+  }
+}
+
+std::vector<TestMesh> sample_meshes()
+{
+  std::vector<TestMesh> meshes = { make_grid(64), make_sphere(48, 96), make_grid(7) };
+
+  u32 seed = 0x0971;
+  for(auto& m : meshes) shuffle_triangles(m.inds, seed++);
+
+  return meshes;
+}
+
+// Returns the mesh's triangles, each rotated so it's smallest index
+//   comes first (which keeps the winding), sorted
+std::vector<std::array<u32, 3>> triangle_set(const std::vector<u32>& inds)
+{
+  std::vector<std::array<u32, 3>> tris;
+  for(size_t i = 0; i < inds.size(); i += 3) {
+    std::array<u32, 3> t = { inds[i], inds[i+1], inds[i+2] };
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+
+    tris.push_back(t);
+  }
+
+  std::sort(tris.begin(), tris.end());
+
+  return tris;
+}
+
+// Same as above, except the triangles are made up of
+//   the vertices' positions instead of their indices
+std::vector<std::array<vec3, 3>> triangle_set(const std::vector<vec3>& verts, const std::vector<u32>& inds)
+{
+  auto less = [](const vec3& a, const vec3& b) {
+    return std::make_tuple(a.x, a.y, a.z) < std::make_tuple(b.x, b.y, b.z);
+  };
+
+  std::vector<std::array<vec3, 3>> tris;
+  for(size_t i = 0; i < inds.size(); i += 3) {
+    std::array<vec3, 3> t = { verts[inds[i]], verts[inds[i+1]], verts[inds[i+2]] };
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end(), less), t.end());
+
+    tris.push_back(t);
+  }
+
+  std::sort(tris.begin(), tris.end(), [&](const auto& a, const auto& b) {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+  });
+
+  return tris;
+}
+
+bool same_positions(const std::vector<std::array<vec3, 3>>& a, const std::vector<std::array<vec3, 3>>& b)
+{
+  if(a.size() != b.size()) return false;
+
+  for(size_t i = 0; i < a.size(); i++) {
+    for(size_t j = 0; j < 3; j++) {
+      if(a[i][j].x != b[i][j].x || a[i][j].y != b[i][j].y || a[i][j].z != b[i][j].z) return false;
+    }
+  }
+
+  return true;
+}
+
+mesh::VertexCacheStats stats(const TestMesh& m, const std::vector<u32>& inds)
+{
+  return mesh::vertex_cache_stats(inds.data(), inds.size(), m.verts.size());
+}
+
+// Returns 'm' written out as an *.obj file
+std::string to_obj(const TestMesh& m)
+{
+  std::string obj = "o " + m.name + "\n";
+  for(const auto& v : m.verts) obj += util::fmt("v %g %g %g\n", v.x, v.y, v.z);
+  for(size_t i = 0; i < m.inds.size(); i += 3) {
+    obj += util::fmt("f %u %u %u\n", m.inds[i]+1, m.inds[i+1]+1, m.inds[i+2]+1);
+  }
+
+  return obj;
+}
+
+using Clock = std::chrono::high_resolution_clock;
+
+double ms_since(Clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}
+
+TEST_CASE(vertex_cache_stats_acmr_atvr)
+{
+  // A single triangle - every vertex is a miss
+  std::vector<u32> tri = { 0, 1, 2 };
+  auto s = mesh::vertex_cache_stats(tri.data(), tri.size(), 3);
+  CHECK(near(s.acmr, 3.0f) && near(s.atvr, 1.0f));
+
+  // Two triangles sharing an edge - 4 misses for 2 triangles
+  std::vector<u32> quad = { 0, 1, 2,  2, 1, 3 };
+  s = mesh::vertex_cache_stats(quad.data(), quad.size(), 4);
+  CHECK(near(s.acmr, 2.0f) && near(s.atvr, 1.0f));
+
+  // With a 3 entry FIFO cache the vertices of the first triangle
+  //   are evicted by the second, so the third misses on all of them
+  std::vector<u32> evicted = { 0, 1, 2,  3, 4, 5,  0, 1, 2 };
+  s = mesh::vertex_cache_stats(evicted.data(), evicted.size(), 6, 3);
+  CHECK(near(s.acmr, 3.0f) && near(s.atvr, 1.5f));
+
+  s = mesh::vertex_cache_stats(evicted.data(), evicted.size(), 6, 6);
+  CHECK(near(s.acmr, 2.0f) && near(s.atvr, 1.0f));
+
+  // Unreferenced vertices don't count towards the ATVR
+  s = mesh::vertex_cache_stats(tri.data(), tri.size(), 100);
+  CHECK(near(s.atvr, 1.0f));
+}
+
+TEST_CASE(mesh_optimize_preserves_triangles)
+{
+  for(const auto& m : sample_meshes()) {
+    auto expected = triangle_set(m.inds);
+    auto before = stats(m, m.inds);
+
+    // Forsyth
+    auto forsyth = m.inds;
+    mesh::optimize_vertex_cache(forsyth.data(), forsyth.size(), m.verts.size());
+
+    CHECK(triangle_set(forsyth) == expected);
+    CHECK(stats(m, forsyth).acmr < before.acmr);
+
+    // Tipsify + overdraw
+    std::vector<u32> clusters;
+    auto tipsify = m.inds;
+    mesh::tipsify(tipsify.data(), tipsify.size(), m.verts.size(), mesh::DefaultVertexCacheSize, &clusters);
+
+    CHECK(triangle_set(tipsify) == expected);
+    CHECK(stats(m, tipsify).acmr < before.acmr);
+    CHECK(!clusters.empty() && clusters.front() == 0);
+    CHECK(std::is_sorted(clusters.begin(), clusters.end()));
+
+    auto overdraw = tipsify;
+    mesh::optimize_overdraw(overdraw.data(), overdraw.size(),
+        StridePtr<vec3>((void *)m.verts.data(), sizeof(vec3)), m.verts.size(), clusters);
+
+    CHECK(triangle_set(overdraw) == expected);
+    CHECK(stats(m, overdraw).acmr < stats(m, tipsify).acmr * 1.15f);
+
+    // Vertex fetch - the triangles have to be compared by
+    //   position as the vertices get renumbered
+    auto fetch = forsyth;
+    auto verts = m.verts;
+    auto remap = mesh::optimize_vertex_fetch(fetch.data(), fetch.size(), verts.size());
+    mesh::remap_vertices(verts, remap);
+
+    CHECK(same_positions(triangle_set(verts, fetch), triangle_set(m.verts, m.inds)));
+
+    // The vertices are now referenced in order of their first use
+    u32 next_vertex = 0;
+    bool in_order = true;
+    for(auto idx : fetch) {
+      if(idx > next_vertex) in_order = false;
+      if(idx == next_vertex) next_vertex++;
+    }
+    CHECK(in_order);
+
+    // The vertex cache ordering is unaffected by the renumbering
+    CHECK(stats(m, fetch).acmr == stats(m, forsyth).acmr);
+  }
+}
+
+TEST_CASE(obj_loader_optimize_preserves_triangles)
+{
+  for(const auto& m : sample_meshes()) {
+    auto obj_text = to_obj(m);
+
+    mesh::ObjLoader obj;
+    obj.load(obj_text.data(), obj_text.size(), mesh::ObjLoader::Normalize);
+
+    std::vector<vec3> verts_before, verts_after;
+    std::vector<u32> inds_before, inds_after;
+    obj.positions(verts_before, inds_before);
+
+    auto s = obj.optimize();
+
+    obj.positions(verts_after, inds_after);
+
+    CHECK(same_positions(triangle_set(verts_before, inds_before), triangle_set(verts_after, inds_after)));
+    CHECK(s.after.acmr < s.before.acmr);
+    CHECK(s.after.atvr <= s.before.atvr);
+
+    CHECK(obj.submesh(0).num_inds == m.inds.size());
+  }
+}
+
+BENCHMARK(mesh_optimize)
+{
+  std::vector<TestMesh> meshes = { make_grid(512), make_sphere(256, 512) };
+
+  u32 seed = 0x0972;
+  for(auto& m : meshes) shuffle_triangles(m.inds, seed++);
+
+  for(const auto& m : meshes) {
+    auto before = stats(m, m.inds);
+
+    printf("    %s (%zu triangles) - ACMR %.3f ATVR %.3f\n",
+        m.name.data(), m.inds.size()/3, before.acmr, before.atvr);
+
+    auto forsyth = m.inds;
+    auto start = Clock::now();
+    mesh::optimize_vertex_cache(forsyth.data(), forsyth.size(), m.verts.size());
+    auto forsyth_ms = ms_since(start);
+
+    auto s = stats(m, forsyth);
+    printf("      optimize_vertex_cache() %8.1fms - ACMR %.3f ATVR %.3f\n", forsyth_ms, s.acmr, s.atvr);
+
+    std::vector<u32> clusters;
+    auto tipsify = m.inds;
+    start = Clock::now();
+    mesh::tipsify(tipsify.data(), tipsify.size(), m.verts.size(), mesh::DefaultVertexCacheSize, &clusters);
+    auto tipsify_ms = ms_since(start);
+
+    s = stats(m, tipsify);
+    printf("      tipsify()               %8.1fms - ACMR %.3f ATVR %.3f (%zu clusters)\n",
+        tipsify_ms, s.acmr, s.atvr, clusters.size());
+
+    start = Clock::now();
+    mesh::optimize_overdraw(tipsify.data(), tipsify.size(),
+        StridePtr<vec3>((void *)m.verts.data(), sizeof(vec3)), m.verts.size(), clusters);
+    auto overdraw_ms = ms_since(start);
+
+    s = stats(m, tipsify);
+    printf("      optimize_overdraw()     %8.1fms - ACMR %.3f ATVR %.3f\n", overdraw_ms, s.acmr, s.atvr);
+
+    start = Clock::now();
+    auto remap = mesh::optimize_vertex_fetch(forsyth.data(), forsyth.size(), m.verts.size());
+    auto fetch_ms = ms_since(start);
+
+    printf("      optimize_vertex_fetch() %8.1fms\n", fetch_ms);
+
+    CHECK(remap.size() == m.verts.size());
+
+    CHECK(triangle_set(tipsify) == triangle_set(m.inds));
+  }
+}
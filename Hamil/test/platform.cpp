@@ -0,0 +1,38 @@
+#include <os/glcontext.h>
+#include <os/panic.h>
+#include <gx/context.h>
+
+#include <config>
+
+#include <sysv/x11.h>
+
+// Headless stand-ins for the parts of the platform layer which
+//   need a display server, so the tests can link (and run) the
+//   real os::init(), sched::WorkerPool etc. without one
+//  - Creating a GLContext (and so a Window) in a test is a bug
+
+namespace os {
+
+std::unique_ptr<gx::GLContext> create_glcontext()
+{
+  os::panic("os::create_glcontext() called in a test!", os::UnknownError);
+
+  return nullptr;
+}
+
+}
+
+#if __sysv
+namespace sysv {
+
+X11Connection *X11Connection::connect()
+{
+  return nullptr;
+}
+
+X11Connection::~X11Connection()
+{
+}
+
+}
+#endif
@@ -0,0 +1,27 @@
+#include "test.h"
+
+#include <gx/renderpass.h>
+#include <gx/pipeline.h>
+
+using gx::RenderPass;
+
+TEST_CASE(renderpass_clear_subpasses)
+{
+  RenderPass pass;
+
+  // Recorded the way Ui::paint() does every time it repaints
+  for(int paint = 0; paint < 3; paint++) {
+    pass.clearSubpasses();
+    CHECK(pass.nextSubpassId() == 0);
+
+    for(uint id = 0; id < 4; id++) {
+      CHECK(pass.nextSubpassId() == id);
+
+      pass.subpass(RenderPass::Subpass()
+        .pipeline(gx::Pipeline(nullptr)));
+    }
+
+    // The subpasses from the previous recording don't pile up
+    CHECK(pass.nextSubpassId() == 4);
+  }
+}
@@ -0,0 +1,254 @@
+#include "test.h"
+
+#include <yaml/schema.h>
+#include <yaml/document.h>
+#include <yaml/node.h>
+
+#include <cstdio>
+
+#include <string>
+#include <vector>
+#include <regex>
+#include <random>
+#include <iterator>
+
+namespace {
+
+// The std::regex based matchers Scalar and the Schema conditions
+//   used before they were replaced by hand-written ones, kept
+//   verbatim as the reference the replacements must agree with
+const std::regex RegexDataTypes[] = {
+  // Scalar::Null
+  std::regex("~|null",                            std::regex::icase|std::regex::optimize),
+
+  // Scalar::Int
+  std::regex("[-+]?0b[0-1_]+|[-+]?0[0-7_]+"
+             "|[-+]?(0|[1-9][0-9_]*)"
+             "|[-+]?0x[0-9a-fA-F_]+"
+             "|[-+]?[1-9][0-9_]*(:[0-5]?[0-9])+", std::regex::optimize),
+
+  // Scalar::Float
+  std::regex("[-+]?([0-9][0-9_]*)?\\.[0-9.]*([eE][-+][0-9]+)?"
+             "|[-+]?[0-9][0-9_]*(:[0-5]?[0-9])+\\.[0-9_]*"
+             "|[-+]?\\.(inf|Inf|INF)"
+             "|\\.(nan|NaN|NAN)",                 std::regex::optimize),
+
+  // Scalar::Boolean
+  std::regex("(yes|true|on|y)"
+             "|(no|false|off|n)",                 std::regex::icase|std::regex::optimize),
+
+  // Scalar::String
+  std::regex(".*",                                std::regex::optimize),
+};
+
+const std::regex RegexPath("^((/[^<>:\"/\\|?* ]*)+/?)?$", std::regex::optimize);
+const std::regex RegexFileName("^[^<>;\"\\|?* ]+$", std::regex::optimize);
+
+yaml::Scalar::DataType regex_data_type(const std::string& str)
+{
+  for(int i = 0; i < yaml::Scalar::NumDataTypes; i++) {
+    if(std::regex_match(str, RegexDataTypes[i])) return (yaml::Scalar::DataType)i;
+  }
+
+  return yaml::Scalar::Invalid;
+}
+
+bool regex_parse_bool(const std::string& str)
+{
+  std::smatch matches;
+  if(!std::regex_match(str, matches, RegexDataTypes[yaml::Scalar::Boolean])) return false;
+
+  return matches[1].matched;
+}
+
+// Strings built mostly out of the characters which are
+//   significant to at least one of the matchers
+class RandomScalars {
+public:
+  RandomScalars(u32 seed) :
+    m_random(seed)
+  { }
+
+  std::string next()
+  {
+    static const std::string tokens[] = {
+      "0", "1", "7", "9", "_", ".", ":", "+", "-", "e", "E", "x", "b",
+      "0x", "0b", "a", "F", "inf", "Inf", "INF", "nan", "NaN", "NAN",
+      "~", "null", "NULL", "yes", "YES", "no", "true", "False", "on", "OFF", "y", "N",
+      "/", "\\", " ", "<", ">", "\"", "|", "?", "*", ";", "dir", "file.txt",
+    };
+
+    std::uniform_int_distribution<size_t> num_tokens(0, 4);
+    std::uniform_int_distribution<size_t> token(0, std::size(tokens)-1);
+
+    std::string str;
+    for(size_t i = num_tokens(m_random); i > 0; i--) str += tokens[token(m_random)];
+
+    return str;
+  }
+
+private:
+  std::mt19937 m_random;
+};
+
+// Scalars which sit right on the edges of the patterns
+const char *EdgeCaseScalars[] = {
+  "", "~", "Null", "nUlL", "0", "-0", "+0", "00", "08", "0_7", "0b", "0b2", "0b1_0",
+  "0x", "0xG", "0x_f", "-0x1F", "1_000", "190:20:30", "1:60", "1:5", "1:", ":1",
+  ".", "..", "1.", ".1", "1.2.3", "1e5", "1.e+5", "1.0e5", "1.0E-05", "+.inf", "-.Inf",
+  ".INF", ".nan", "-.nan", ".NaN", "1:20.5", "1:20.", "y", "Y", "n", "yes", "YeS", "On",
+  "oFF", "true ", " true", "yess", "/", "//", "/a/b/", "a/b", "/a b", "/a:b", "/a\\b",
+  "/a|b", "file.txt", "file;txt", "fi*le", "a\"b", "<", "a b",
+};
+
+// Validates 'value' as the only entry of a document
+//   against a compiled 'schema'
+bool schema_accepts(const yaml::Schema& schema, const std::string& value)
+{
+  auto root = new yaml::Mapping();
+  root->append(yaml::Scalar::from_str("v"), yaml::Scalar::from_str(value));
+
+  yaml::Document doc(yaml::Node::Ptr((yaml::Node *)root));
+
+  return !schema.validate(doc);
+}
+
+// Forwards to another condition, but doesn't override compile(),
+//   so the Schema has to run it as a SchemaOp::Custom
+class UncompiledCondition : public yaml::SchemaCondition {
+public:
+  UncompiledCondition(yaml::SchemaCondition::Ptr cond) :
+    SchemaCondition(yaml::Default),
+    m_cond(cond)
+  { }
+
+protected:
+  virtual bool doValidate(const yaml::Node::Ptr& node) const
+  {
+    return m_cond->validate(node);
+  }
+
+private:
+  yaml::SchemaCondition::Ptr m_cond;
+};
+
+}
+
+TEST_CASE(scalar_data_type_matches_regexes)
+{
+  auto check = [](const std::string& str) {
+    auto type = yaml::Scalar::data_type(str.data(), str.size());
+    CHECK(type == regex_data_type(str));
+
+    if(type == yaml::Scalar::Boolean) CHECK(yaml::Scalar::parse_bool(str.data(), str.size()) == regex_parse_bool(str));
+
+    // Make sure the failing string ends up in the output
+    if(type != regex_data_type(str)) printf("    mismatched: '%s'\n", str.data());
+  };
+
+  for(auto str : EdgeCaseScalars) check(str);
+
+  RandomScalars random(0x5C4E);
+  for(size_t i = 0; i < 100000; i++) check(random.next());
+}
+
+TEST_CASE(schema_path_and_file_match_regexes)
+{
+  auto schema = yaml::Schema()
+    .path("v");
+  auto file_schema = yaml::Schema()
+    .file("v");
+
+  auto check = [&](const std::string& str) {
+    CHECK(schema_accepts(schema, str) == std::regex_match(str, RegexPath));
+    CHECK(schema_accepts(file_schema, str) == std::regex_match(str, RegexFileName));
+  };
+
+  for(auto str : EdgeCaseScalars) check(str);
+
+  RandomScalars random(0x9A7E);
+  for(size_t i = 0; i < 20000; i++) check("/" + random.next());
+  for(size_t i = 0; i < 20000; i++) check(random.next());
+}
+
+TEST_CASE(schema_compiled_matches_custom)
+{
+  using yaml::Schema;
+  using yaml::Scalar;
+
+  auto schema = Schema()
+    .scalar("guid", Scalar::Int)
+    .scalar("name", Scalar::String)
+    .path("path")
+    .file("location", yaml::Optional)
+    .scalarSequence("dimensions", Scalar::Int)
+    .mapping("sampler", yaml::Optional);
+
+  const char *docs[] = {
+    "guid: 0x10\nname: a\npath: /a/b\nlocation: a.png\ndimensions: [ 1, 2 ]\n",
+    "guid: 0x10\nname: a\npath: /a/b\ndimensions: [ 1, 2 ]\nsampler: { a: b }\n",
+    "guid: abc\nname: a\npath: /a/b\ndimensions: [ 1, 2 ]\n",
+    "guid: 16\nname: a\npath: a b\ndimensions: [ 1, 2 ]\n",
+    "guid: 16\nname: a\npath: /a\nlocation: a;b\ndimensions: [ 1, 2 ]\n",
+    "guid: 16\nname: a\npath: /a\ndimensions: [ 1, x ]\n",
+    "guid: 16\nname: a\npath: /a\ndimensions: 5\n",
+    "guid: 16\nname: a\npath: /a\ndimensions: [ 1 ]\nsampler: [ a ]\n",
+  };
+  const bool valid[] = { true, true, false, false, false, false, false, false };
+
+  for(size_t i = 0; i < std::size(docs); i++) {
+    auto doc = yaml::Document::from_string(docs[i]);
+
+    CHECK(!schema.validate(doc) == valid[i]);
+  }
+
+  // Every condition which has a SchemaOp of it's own, once
+  //   compiled and once run through SchemaOp::Custom
+  std::vector<yaml::SchemaCondition::Ptr> conds = {
+    Schema::cond<yaml::ScalarCondition>(yaml::Default, Scalar::Int),
+    Schema::cond<yaml::ScalarCondition>(yaml::Default, Scalar::Boolean),
+    Schema::cond<yaml::ScalarCondition>(),
+    Schema::cond<yaml::PathCondition>(),
+    Schema::cond<yaml::FileCondition>(),
+    Schema::cond<yaml::SequenceCondition>(),
+    Schema::cond<yaml::MappingCondition>(),
+  };
+
+  // Each Sequence item is either a random Scalar or
+  //   a (nested) Sequence or Mapping
+  RandomScalars random(0xC0DE);
+  std::mt19937 random_kind(0xC0DF);
+
+  auto random_item = [&]() -> yaml::Node::Ptr {
+    switch(random_kind() % 8) {
+    case 0: return yaml::Node::Ptr(new yaml::Sequence());
+    case 1: return yaml::Node::Ptr(new yaml::Mapping());
+    }
+
+    return yaml::Scalar::from_str(random.next());
+  };
+
+  for(const auto& cond : conds) {
+    auto compiled = Schema()
+      .allOf("v", cond);
+    auto custom = Schema()
+      .allOf("v", Schema::cond<UncompiledCondition>(cond));
+
+    size_t num_rejected = 0;
+    for(size_t i = 0; i < 2000; i++) {
+      auto seq = new yaml::Sequence();
+      for(size_t j = random_kind() % 3; j > 0; j--) seq->append(random_item());
+
+      auto root = new yaml::Mapping();
+      root->append(yaml::Scalar::from_str("v"), yaml::Node::Ptr((yaml::Node *)seq));
+
+      yaml::Document doc(yaml::Node::Ptr((yaml::Node *)root));
+
+      CHECK(!compiled.validate(doc) == !custom.validate(doc));
+      if(compiled.validate(doc)) num_rejected++;
+    }
+
+    // Make sure the documents actually exercise both outcomes
+    CHECK(num_rejected > 0 && num_rejected < 2000);
+  }
+}
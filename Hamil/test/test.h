@@ -0,0 +1,47 @@
+#pragma once
+
+#include <common.h>
+
+// Minimal unit test harness
+//   - TEST_CASE()s register themselves before main() is
+//     entered and are all run by it (see test/main.cpp)
+//   - BENCHMARK()s are registered the same way but are
+//     only run when '--bench' is passed on the command line
+//   - A failed CHECK() reports the condition and marks the
+//     current test case as failed, but doesn't stop it
+//
+//   Usage:
+//       TEST_CASE(allocator_alloc_dealloc)
+//       {
+//         TLSFAllocator alloc(64);
+//
+//         CHECK(alloc.alloc(8) == 0);
+//       }
+//
+namespace test {
+
+using TestFn = void (*)();
+
+// Always returns 'true' (so it can be used in static initializers)
+bool register_test(const char *name, TestFn fn, bool benchmark);
+
+void check_failed(const char *file, int line, const char *expr);
+
+}
+
+#define TEST_CASE(name)                                                  \
+  static void test_##name();                                             \
+  static const bool test_##name##_registered =                           \
+    test::register_test(#name, test_##name, false);                      \
+  static void test_##name()
+
+#define BENCHMARK(name)                                                  \
+  static void bench_##name();                                            \
+  static const bool bench_##name##_registered =                          \
+    test::register_test(#name, bench_##name, true);                      \
+  static void bench_##name()
+
+#define CHECK(cond)                                                      \
+  do {                                                                   \
+    if(!(cond)) test::check_failed(__FILE__, __LINE__, #cond);           \
+  } while(0)
@@ -0,0 +1,129 @@
+#include "test.h"
+
+#include <hm/transformsystem.h>
+#include <hm/entity.h>
+#include <math/geometry.h>
+#include <math/xform.h>
+
+#include <cmath>
+
+namespace {
+
+const float Epsilon = 1e-4f;
+
+float mat_distance(const mat4& a, const mat4& b)
+{
+  float dist = 0.0f;
+  for(uint i = 0; i < 16; i++) dist = std::max(dist, fabsf(a.d[i] - b.d[i]));
+
+  return dist;
+}
+
+mat4 parent_matrix()
+{
+  return xform::translate(1.0f, 2.0f, 3.0f) * xform::roty(0.7f) * xform::scale(2.0f);
+}
+
+const AABB UnitAABB = { vec3(-1.0f), vec3(1.0f) };
+
+}
+
+TEST_CASE(transform_system_concatenates_parents)
+{
+  hm::TransformSystem transforms;
+
+  auto child_local = xform::translate(0.0f, 5.0f, 0.0f) * xform::rotx(0.3f);
+  auto leaf_local = xform::translate(-1.0f, 0.0f, 0.0f);
+
+  transforms
+    .add(1, hm::Entity::Invalid, parent_matrix(), UnitAABB)
+    .add(2, 1, child_local, UnitAABB)
+    .add(3, 2, leaf_local, UnitAABB);
+
+  CHECK(transforms.update() == 3);
+
+  CHECK(mat_distance(transforms.world(1), parent_matrix()) < Epsilon);
+  CHECK(mat_distance(transforms.world(2), parent_matrix()*child_local) < Epsilon);
+  CHECK(mat_distance(transforms.world(3), parent_matrix()*child_local*leaf_local) < Epsilon);
+
+  // Only the dirty node and it's descendants are recomputed
+  transforms.local(2, mat4::identity());
+  CHECK(transforms.update() == 2);
+
+  CHECK(mat_distance(transforms.world(3), parent_matrix()*leaf_local) < Epsilon);
+  CHECK(transforms.update() == 0);
+}
+
+TEST_CASE(transform_system_world_space_child)
+{
+  hm::TransformSystem transforms;
+
+  transforms
+    .add(1, hm::Entity::Invalid, parent_matrix(), UnitAABB)
+    .add(2, 1, mat4::identity(), UnitAABB);
+  transforms.update();
+
+  // What syncPhysics() does for a moved body whose
+  //   Entity has a parent
+  auto body_world = xform::translate(10.0f, 0.0f, -4.0f) * xform::rotz(1.1f);
+  transforms.world(2, body_world);
+  transforms.update();
+
+  CHECK(mat_distance(transforms.world(2), body_world) < Epsilon);
+  CHECK(mat_distance(parent_matrix() * transforms.local(2), body_world) < Epsilon);
+
+  // The recovered local matrix follows the parent from then on
+  auto moved_parent = xform::translate(0.0f, -3.0f, 0.0f) * parent_matrix();
+  transforms.local(1, moved_parent);
+  transforms.update();
+
+  CHECK(mat_distance(transforms.world(2), xform::translate(0.0f, -3.0f, 0.0f) * body_world) < Epsilon);
+}
+
+TEST_CASE(transform_system_world_space_parent_and_child)
+{
+  hm::TransformSystem transforms;
+
+  transforms
+    .add(1, hm::Entity::Invalid, mat4::identity(), UnitAABB)
+    .add(2, 1, xform::translate(1.0f, 0.0f, 0.0f), UnitAABB);
+  transforms.update();
+
+  // Both moved during the same step - the child's local matrix
+  //   must be derived from the parent's NEW world matrix
+  auto parent_world = parent_matrix();
+  auto child_world = xform::translate(-7.0f, 1.0f, 2.0f);
+
+  transforms.world(2, child_world);
+  transforms.world(1, parent_world);
+  transforms.update();
+
+  CHECK(mat_distance(transforms.world(1), parent_world) < Epsilon);
+  CHECK(mat_distance(transforms.world(2), child_world) < Epsilon);
+  CHECK(mat_distance(parent_world * transforms.local(2), child_world) < Epsilon);
+}
+
+TEST_CASE(transform_system_remove_descendants)
+{
+  hm::TransformSystem transforms;
+
+  transforms
+    .add(1, hm::Entity::Invalid, mat4::identity(), UnitAABB)
+    .add(2, 1, mat4::identity(), UnitAABB)
+    .add(3, 2, mat4::identity(), UnitAABB)
+    .add(4, hm::Entity::Invalid, mat4::identity(), UnitAABB);
+
+  transforms.remove(2);
+  transforms.update();
+
+  CHECK(transforms.contains(1) && transforms.contains(4));
+  CHECK(!transforms.contains(2) && !transforms.contains(3));
+  CHECK(transforms.size() == 2);
+
+  // The AABBs are re-bounded after the transform
+  transforms.local(4, xform::scale(3.0f));
+  transforms.update();
+
+  CHECK(transforms.worldAABB(4).max.distance(vec3(3.0f)) < Epsilon);
+  CHECK(transforms.worldAABB(4).min.distance(vec3(-3.0f)) < Epsilon);
+}
@@ -0,0 +1,235 @@
+#include "test.h"
+
+#include <yaml/document.h>
+#include <yaml/arenadocument.h>
+#include <yaml/node.h>
+#include <util/format.h>
+
+#include <yaml.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+namespace {
+
+// Covers every way a scalar can be written, so both the zero-copy
+//   and the copying paths of the ArenaDocument are hit
+const char *SampleDocs[] = {
+  "plain: value\n"
+  "int: -42\n"
+  "uint: 0xDEADBEEF\n"
+  "float: 3.5e2\n"
+  "bool: yes\n"
+  "null: ~\n",
+
+  "single: 'it''s quoted'\n"
+  "double: \"tab\\there \\u00e9\"\n"
+  "empty: ''\n"
+  "folded_plain: this is\n"
+  "  folded over lines\n",
+
+  "literal: |\n"
+  "  line one\n"
+  "  line two\n"
+  "folded: >\n"
+  "  one\n"
+  "  two\n"
+  "\n"
+  "  three\n",
+
+  "base: &base\n"
+  "  x: 1\n"
+  "  y: [ 2, 3 ]\n"
+  "copy: *base\n"
+  "list:\n"
+  "  - *base\n"
+  "  - { a: b, c: [ d, e ] }\n",
+
+  "tagged: !file ./some/path.txt\n"
+  "seq: !!seq [ 1, 2 ]\n"
+  "dup: first\n"
+  "dup: second\n"
+  "nested:\n"
+  "  deeper:\n"
+  "    - - 1\n"
+  "      - 2\n"
+  "    - key: value\n",
+
+  "- just\n"
+  "- a\n"
+  "- sequence\n",
+};
+
+// Looked up in every sample document
+const char *SamplePaths[] = {
+  "plain", "int", "uint", "float", "bool", "null",
+  "single", "double", "empty", "folded_plain",
+  "literal", "folded",
+  "base.x", "base.y.1", "copy.y.0", "list.0.x", "list.1.c.1",
+  "tagged", "seq.1", "dup", "nested.deeper.0.1", "nested.deeper.1.key",
+  "0", "2", "missing", "base.missing", "list.5",
+};
+
+// A document which looks like a resource descriptor (*.meta)
+std::string make_meta(size_t i)
+{
+  return util::fmt(
+    "guid: 0x%.16zx\n"
+    "tag: texture\n"
+    "name: texture%zu\n"
+    "path: /textures/set%zu\n"
+    "location: !file ./textures/set%zu/texture%zu.png\n"
+    "dimensions: [ %zu, %zu ]\n"
+    "format: rgba8\n"
+    "sampler:\n"
+    "  min_filter: linear_mipmap_linear\n"
+    "  mag_filter: linear\n"
+    "  wrap: [ repeat, repeat ]\n"
+    "  anisotropy: 16.0\n"
+    "mipmaps: true\n",
+    i*0x9E3779B97F4A7C15ull, i, i/64, i/64, i, 256 << (i%4), 128 << (i%3));
+}
+
+}
+
+TEST_CASE(arena_document_matches_document)
+{
+  for(auto src : SampleDocs) {
+    auto len = strlen(src);
+
+    auto doc = yaml::Document::from_string(src, len);
+    auto arena_doc = yaml::ArenaDocument::from_string(src, len);
+
+    CHECK(arena_doc.toDocument().toString() == doc.toString());
+
+    for(auto what : SamplePaths) {
+      yaml::Path path(what);
+
+      auto node = doc.get(path);
+      auto arena_node = arena_doc.get(path);
+
+      CHECK(!node == !arena_node);
+      if(!node || !arena_node) continue;
+
+      CHECK(node->type() == arena_node->type());
+      CHECK(node->tagString() == std::string(arena_node->tag()));
+
+      auto scalar = node->as<yaml::Scalar>();
+      if(!scalar) continue;
+
+      CHECK(std::string(scalar->str(), scalar->size()) == std::string(arena_node->str()));
+      CHECK(scalar->dataType() == arena_node->dataType());
+    }
+  }
+}
+
+TEST_CASE(arena_document_plain_scalars_point_into_source)
+{
+  const char *src =
+    "plain: value\n"
+    "escaped: \"a\\nb\"\n";
+  auto len = strlen(src);
+
+  auto doc = yaml::ArenaDocument::from_string(src, len);
+
+  auto in_source = [&](std::string_view str) {
+    return str.data() >= src && str.data() + str.size() <= src + len;
+  };
+
+  CHECK(doc.get(yaml::Path("plain"))->str() == "value");
+  CHECK(in_source(doc.get(yaml::Path("plain"))->str()));
+
+  // Escapes have to be copied out
+  CHECK(doc.get(yaml::Path("escaped"))->str() == "a\nb");
+  CHECK(!in_source(doc.get(yaml::Path("escaped"))->str()));
+}
+
+BENCHMARK(yaml_arena_document_vs_document)
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  enum : size_t {
+    NumDocs = 5000,
+  };
+
+  std::vector<std::string> docs;
+  for(size_t i = 0; i < NumDocs; i++) docs.push_back(make_meta(i));
+
+  yaml::Path guid("guid"), dimension("dimensions.0"), wrap("sampler.wrap.1");
+
+  // Returns the best of a few runs of 'fn' in ms
+  auto best_of = [](auto fn) {
+    double best = INFINITY;
+    for(int run = 0; run < 3; run++) {
+      auto start = Clock::now();
+      fn();
+
+      best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    return best;
+  };
+
+  // Parse every document and look up a few values,
+  //   the way the resource loaders do
+  unsigned long long doc_sum = 0;
+  auto doc_ms = best_of([&]() {
+    doc_sum = 0;
+    for(const auto& src : docs) {
+      auto doc = yaml::Document::from_string(src.data(), src.size());
+
+      doc_sum += doc.get(guid)->as<yaml::Scalar>()->ui();
+      doc_sum += doc.get(dimension)->as<yaml::Scalar>()->ui();
+      doc_sum += doc.get(wrap)->as<yaml::Scalar>()->size();
+    }
+  });
+
+  unsigned long long arena_sum = 0;
+  size_t arena_bytes = 0;
+  auto arena_ms = best_of([&]() {
+    arena_sum = 0;
+    arena_bytes = 0;
+    for(const auto& src : docs) {
+      auto doc = yaml::ArenaDocument::from_string(src.data(), src.size());
+
+      arena_sum += doc.get(guid)->ui();
+      arena_sum += doc.get(dimension)->ui();
+      arena_sum += doc.get(wrap)->size();
+
+      arena_bytes += doc.arenaSize();
+    }
+  });
+
+  CHECK(doc_sum == arena_sum);
+
+  // Same as above without building any DOM at all, which
+  //   is the lower bound for both
+  auto events_ms = best_of([&]() {
+    for(const auto& src : docs) {
+      yaml_parser_t parser;
+      yaml_parser_initialize(&parser);
+      yaml_parser_set_input_string(&parser, (const unsigned char *)src.data(), src.size());
+
+      yaml_event_t event;
+      bool done = false;
+      while(!done && yaml_parser_parse(&parser, &event)) {
+        done = event.type == YAML_STREAM_END_EVENT;
+        yaml_event_delete(&event);
+      }
+
+      yaml_parser_delete(&parser);
+    }
+  });
+
+  printf("    %zu documents (%.1fKiB of arena memory each)\n",
+      (size_t)NumDocs, (double)arena_bytes / (double)NumDocs / 1024.0);
+  printf("    Document:       %7.1fms\n", doc_ms);
+  printf("    ArenaDocument:  %7.1fms\n", arena_ms);
+  printf("    libyaml events: %7.1fms\n", events_ms);
+}